@@ -40,7 +40,6 @@
  *----------------------------------------------------------*/
 
 #define configUSE_PREEMPTION					1
-#define configUSE_PORT_OPTIMISED_TASK_SELECTION	1
 #define configUSE_IDLE_HOOK						1
 #define configUSE_TICK_HOOK						1
 #define configUSE_DAEMON_TASK_STARTUP_HOOK		1
@@ -56,6 +55,7 @@
 #define configQUEUE_REGISTRY_SIZE				20
 #define configUSE_MALLOC_FAILED_HOOK			1
 #define configUSE_APPLICATION_TASK_TAG			1
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS	1
 #define configUSE_COUNTING_SEMAPHORES			1
 #define configUSE_ALTERNATIVE_API				0
 #define configUSE_QUEUE_SETS					1
@@ -80,6 +80,28 @@
 
 #define configMAX_PRIORITIES					( 7 )
 
+/* SMP build variant for multi-core targets: define PETRI_SMP_CORES to the
+number of cores in the project's preprocessor definitions.  Needs a port with
+SMP support; the Windows simulator port runs a single core, so the default
+build keeps PETRI_SMP_CORES at 1.  Stations are pinned to cores by the table
+in main_blinky.c. */
+#ifndef PETRI_SMP_CORES
+	#define PETRI_SMP_CORES						1
+#endif
+
+#if ( PETRI_SMP_CORES > 1 )
+	#define configNUMBER_OF_CORES				PETRI_SMP_CORES
+	#define configUSE_CORE_AFFINITY				1
+	#define configRUN_MULTIPLE_PRIORITIES		1
+	#define configTICK_CORE						0
+	#define configUSE_PASSIVE_IDLE_HOOK			0
+	/* Task selection has to scan the ready lists for a task allowed on each core. */
+	#define configUSE_PORT_OPTIMISED_TASK_SELECTION	0
+#else
+	#define configNUMBER_OF_CORES				1
+	#define configUSE_PORT_OPTIMISED_TASK_SELECTION	1
+#endif
+
 /* Run time stats gathering configuration options. */
 #define configRUN_TIME_COUNTER_TYPE				uint64_t
 configRUN_TIME_COUNTER_TYPE ulGetRunTimeCounterValue( void ); /* Prototype of function that returns run time counter. */
@@ -17,6 +17,19 @@
     extern "C" {
 #endif
 
+/**
+ * @def PETRI_TRACE_STREAMING
+ * @brief Set to 1 (e.g. in the project's preprocessor definitions) to stream
+ * the trace continuously through the stream port in trcStreamPort.c instead
+ * of keeping the latest slice in the snapshot ring buffer. The streaming
+ * recorder sources and trcStreamPort.c are not in WIN32.vcxproj yet, since
+ * that configuration has not been built; add them along with the flag (see
+ * README, Trace Streaming).
+ */
+#ifndef PETRI_TRACE_STREAMING
+#define PETRI_TRACE_STREAMING                    0
+#endif
+
 /**
  * @def TRC_CFG_RECORDER_MODE
  * @brief Specify what recording mode to use. Snapshot means that the data is saved in
@@ -30,7 +43,11 @@
  * TRC_RECORDER_MODE_SNAPSHOT
  * TRC_RECORDER_MODE_STREAMING
  */
+#if PETRI_TRACE_STREAMING
+#define TRC_CFG_RECORDER_MODE                    TRC_RECORDER_MODE_STREAMING
+#else
 #define TRC_CFG_RECORDER_MODE                    TRC_RECORDER_MODE_SNAPSHOT
+#endif
 
 /**
  * @def TRC_CFG_FREERTOS_VERSION
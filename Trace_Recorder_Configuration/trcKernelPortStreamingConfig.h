@@ -0,0 +1,25 @@
+/*
+ * Trace Recorder for Tracealyzer v4.6.0
+ * Copyright 2021 Percepio AB
+ * www.percepio.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Kernel port configuration parameters for streaming mode.
+ */
+
+#ifndef TRC_KERNEL_PORT_STREAMING_CONFIG_H
+#define TRC_KERNEL_PORT_STREAMING_CONFIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The FreeRTOS port has no streaming-specific settings; the buffer and
+ * transport settings are in trcStreamingConfig.h and trcStreamPortConfig.h. */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_KERNEL_PORT_STREAMING_CONFIG_H */
@@ -0,0 +1,211 @@
+/*
+ * Trace stream port for the Windows simulator build: a ring between the
+ * TzCtrl task and a native writer thread. See trcStreamPort.h.
+ */
+
+#include <trcRecorder.h>
+
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <winsock2.h>
+#include <windows.h>
+
+#if ((TRC_CFG_STREAM_PORT_RING_SIZE) & ((TRC_CFG_STREAM_PORT_RING_SIZE) - 1)) != 0
+#error "TRC_CFG_STREAM_PORT_RING_SIZE must be a power of two"
+#endif
+
+#define RING_MASK ((TRC_CFG_STREAM_PORT_RING_SIZE) - 1)
+
+/*
+ * Single producer (TzCtrl), single consumer (the writer thread). The
+ * counters only grow and wrap; their difference is the fill level.
+ */
+static uint8_t ring[TRC_CFG_STREAM_PORT_RING_SIZE];
+static volatile LONG ring_head = 0;    // Bytes ever written, advanced only by the producer
+static volatile LONG ring_tail = 0;    // Bytes ever written out, advanced only by the writer
+
+static TraceStreamPortBuffer_t* port_buffer = NULL;
+
+// ====================
+// RECORDER SIDE (TZCTRL TASK)
+// ====================
+
+traceResult xTraceStreamPortInitialize(TraceStreamPortBuffer_t* pxBuffer) {
+    if (pxBuffer == NULL) {
+        return TRC_FAIL;
+    }
+    port_buffer = pxBuffer;
+    return xTraceInternalEventBufferInitialize(port_buffer->buffer, sizeof(port_buffer->buffer));
+}
+
+/**
+ * @brief Queue as much of a block as the ring has room for.
+ * Only copies and publishes; the recorder keeps what did not fit and
+ * offers it again on the next TzCtrl cycle.
+ */
+traceResult xTraceStreamPortWriteData(void* pvData, uint32_t uiSize, int32_t* piBytesWritten) {
+    uint32_t head = (uint32_t)ring_head;
+    uint32_t space = (TRC_CFG_STREAM_PORT_RING_SIZE) - (head - (uint32_t)ring_tail);
+    uint32_t count = uiSize < space ? uiSize : space;
+    uint32_t start = head & RING_MASK;
+    uint32_t first = count < (TRC_CFG_STREAM_PORT_RING_SIZE) - start ? count : (TRC_CFG_STREAM_PORT_RING_SIZE) - start;
+
+    memcpy(&ring[start], pvData, first);
+    memcpy(&ring[0], (const uint8_t*)pvData + first, count - first);
+
+    // Publish the bytes before the new head
+    InterlockedExchange(&ring_head, (LONG)(head + count));
+
+    *piBytesWritten = (int32_t)count;
+    return TRC_SUCCESS;
+}
+
+// ====================
+// WRITER THREAD
+// ====================
+
+typedef struct {
+    HANDLE file;
+    SOCKET sock;
+} TraceSink;
+
+/**
+ * @brief Open the sink named by TRC_CFG_STREAM_PORT_TARGET_ENV: a file, or
+ * a TCP port to wait on for one Tracealyzer connection.
+ */
+static bool open_trace_sink(TraceSink* sink) {
+    const char* target = getenv(TRC_CFG_STREAM_PORT_TARGET_ENV);
+
+    sink->file = INVALID_HANDLE_VALUE;
+    sink->sock = INVALID_SOCKET;
+    if (target == NULL || *target == '\0') {
+        target = TRC_CFG_STREAM_PORT_DEFAULT_FILE;
+    }
+
+    if (strncmp(target, "tcp:", 4) != 0) {
+        sink->file = CreateFileA(target, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (sink->file == INVALID_HANDLE_VALUE) {
+            printf("ERROR: Cannot create trace file '%s'\n", target);
+            return false;
+        }
+        printf("Streaming trace to %s\n", target);
+        return true;
+    }
+
+    int port = atoi(target + 4);
+    WSADATA wsaData;
+    if (port <= 0 || port > 65535 || WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        printf("ERROR: Invalid trace target '%s'\n", target);
+        return false;
+    }
+
+    SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in service;
+    ZeroMemory(&service, sizeof(service));
+    service.sin_family = AF_INET;
+    service.sin_addr.s_addr = INADDR_ANY;
+    service.sin_port = htons((u_short)port);
+    if (listen_socket == INVALID_SOCKET ||
+        bind(listen_socket, (struct sockaddr*)&service, sizeof(service)) == SOCKET_ERROR ||
+        listen(listen_socket, 1) == SOCKET_ERROR) {
+        printf("ERROR: Trace stream could not listen on port %d\n", port);
+        if (listen_socket != INVALID_SOCKET) {
+            closesocket(listen_socket);
+        }
+        return false;
+    }
+
+    // The ring holds the trace header and early events until Tracealyzer connects
+    printf("Trace stream waiting for Tracealyzer on port %d\n", port);
+    sink->sock = accept(listen_socket, NULL, NULL);
+    closesocket(listen_socket);
+    if (sink->sock == INVALID_SOCKET) {
+        printf("ERROR: Trace stream accept failed\n");
+        return false;
+    }
+    return true;
+}
+
+static bool write_trace_sink(const TraceSink* sink, const uint8_t* data, uint32_t len) {
+    while (len > 0) {
+        if (sink->file != INVALID_HANDLE_VALUE) {
+            DWORD written = 0;
+            if (!WriteFile(sink->file, data, len, &written, NULL) || written == 0) {
+                return false;
+            }
+            data += written;
+            len -= written;
+        } else {
+            int sent = send(sink->sock, (const char*)data, (int)len, 0);
+            if (sent == SOCKET_ERROR || sent == 0) {
+                return false;
+            }
+            data += sent;
+            len -= (uint32_t)sent;
+        }
+    }
+    return true;
+}
+
+/*
+ * Windows thread draining the ring, below normal priority so a busy disk
+ * or network never competes with the simulated RTOS. When the sink fails
+ * it keeps draining so the recorder is never blocked, and the rest of the
+ * trace is discarded.
+ */
+static DWORD WINAPI trace_writer_thread(void* param) {
+    (void)param;
+
+    TraceSink sink;
+    bool sink_ok = open_trace_sink(&sink);
+
+    while (1) {
+        uint32_t tail = (uint32_t)ring_tail;
+        uint32_t avail = (uint32_t)InterlockedCompareExchange(&ring_head, 0, 0) - tail;
+        if (avail == 0) {
+            Sleep(TRC_CFG_STREAM_PORT_WRITER_IDLE_MS);
+            continue;
+        }
+
+        uint32_t start = tail & RING_MASK;
+        uint32_t chunk = avail < (TRC_CFG_STREAM_PORT_RING_SIZE) - start ? avail : (TRC_CFG_STREAM_PORT_RING_SIZE) - start;
+        if (sink_ok && !write_trace_sink(&sink, &ring[start], chunk)) {
+            printf("ERROR: Trace stream write failed, the rest of the trace is discarded\n");
+            sink_ok = false;
+        }
+        InterlockedExchange(&ring_tail, (LONG)(tail + chunk));
+    }
+}
+
+/**
+ * @brief Start the writer thread. Called by xTraceEnable() from main() before
+ * the scheduler starts, so creating a Windows thread here is safe.
+ */
+traceResult xTraceStreamPortOnTraceBegin(void) {
+    static HANDLE writer = NULL;
+
+    if (writer == NULL) {
+        writer = CreateThread(NULL, 0, trace_writer_thread, NULL, 0, NULL);
+        if (writer == NULL) {
+            return TRC_FAIL;
+        }
+        SetThreadPriority(writer, THREAD_PRIORITY_BELOW_NORMAL);
+        // Keep it off the core that runs the FreeRTOS tasks, like the status server's I/O thread
+        SetThreadAffinityMask(writer, ~0x01u);
+    }
+    return TRC_SUCCESS;
+}
+
+traceResult xTraceStreamPortOnTraceEnd(void) {
+    // The writer keeps draining what is queued; the sink stays open for a restart
+    return TRC_SUCCESS;
+}
+
+#endif /* (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING) */
+#endif /* (TRC_USE_TRACEALYZER_RECORDER == 1) */
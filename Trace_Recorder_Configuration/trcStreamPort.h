@@ -0,0 +1,67 @@
+/*
+ * Trace stream port for the Windows simulator build.
+ *
+ * The recorder stages events in its internal buffer; the TzCtrl task moves
+ * them here through xTraceStreamPortWriteData(), which only copies into a
+ * single-producer ring. A native Windows thread drains the ring to a file
+ * or to a Tracealyzer TCP connection. As with the status server, the
+ * native thread never calls FreeRTOS, and no FreeRTOS task calls Windows
+ * I/O, which the simulator cannot preempt safely.
+ */
+
+#ifndef TRC_STREAM_PORT_H
+#define TRC_STREAM_PORT_H
+
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
+
+#include <trcTypes.h>
+#include <trcStreamPortConfig.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRC_USE_INTERNAL_BUFFER (TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER)
+
+#define TRC_INTERNAL_EVENT_BUFFER_OPTION_WRITE_MODE (TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_WRITE_MODE)
+#define TRC_INTERNAL_EVENT_BUFFER_OPTION_TRANSFER_MODE (TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_TRANSFER_MODE)
+#define TRC_INTERNAL_BUFFER_CHUNK_SIZE (TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_SIZE)
+#define TRC_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_SIZE_LIMIT (TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_SIZE_LIMIT)
+#define TRC_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_COUNT_LIMIT (TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_COUNT_LIMIT)
+
+#define TRC_STREAM_PORT_BUFFER_SIZE (TRC_CFG_STREAM_PORT_BUFFER_SIZE)
+
+#if (TRC_USE_INTERNAL_BUFFER != 1)
+#error "trcStreamPort.c must not be written from the traced context; set TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER to 1"
+#endif
+
+typedef struct TraceStreamPortBuffer
+{
+    uint8_t buffer[(TRC_STREAM_PORT_BUFFER_SIZE) + sizeof(TraceUnsignedBaseType_t)];
+} TraceStreamPortBuffer_t;
+
+traceResult xTraceStreamPortInitialize(TraceStreamPortBuffer_t* pxBuffer);
+traceResult xTraceStreamPortWriteData(void* pvData, uint32_t uiSize, int32_t* piBytesWritten);
+traceResult xTraceStreamPortOnTraceBegin(void);
+traceResult xTraceStreamPortOnTraceEnd(void);
+
+#define xTraceStreamPortAllocate(uiSize, ppvData) ((void)(uiSize), xTraceStaticBufferGet(ppvData))
+
+#define xTraceStreamPortCommit(pvData, uiSize, piBytesCommitted) xTraceInternalEventBufferPush(pvData, uiSize, piBytesCommitted)
+
+/* Commands from Tracealyzer are not supported; recording starts at boot. */
+#define xTraceStreamPortReadData(pvData, uiSize, piBytesRead) ((void)(pvData), (void)(uiSize), *(piBytesRead) = 0, TRC_SUCCESS)
+
+#define xTraceStreamPortOnEnable(uiStartOption) ((void)(uiStartOption), TRC_SUCCESS)
+
+#define xTraceStreamPortOnDisable() (TRC_SUCCESS)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING) */
+#endif /* (TRC_USE_TRACEALYZER_RECORDER == 1) */
+
+#endif /* TRC_STREAM_PORT_H */
@@ -0,0 +1,97 @@
+/*
+ * Configuration of the demo's trace stream port (trcStreamPort.c).
+ *
+ * Events are staged in the recorder's internal buffer and moved to the
+ * stream port by the low-priority TzCtrl task (TRC_CFG_CTRL_TASK_PRIORITY),
+ * so tracing never does I/O in the context of the traced task. The stream
+ * port hands the bytes to a native Windows thread that writes the file or
+ * socket.
+ */
+
+#ifndef TRC_STREAM_PORT_CONFIG_H
+#define TRC_STREAM_PORT_CONFIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def TRC_CFG_STREAM_PORT_TARGET_ENV
+ * @brief Environment variable naming where the trace goes: a file path, or
+ * "tcp:<port>" to listen for Tracealyzer on that port.
+ */
+#define TRC_CFG_STREAM_PORT_TARGET_ENV "PETRI_TRACE_STREAM"
+
+/**
+ * @def TRC_CFG_STREAM_PORT_DEFAULT_FILE
+ * @brief File written when TRC_CFG_STREAM_PORT_TARGET_ENV is not set.
+ */
+#define TRC_CFG_STREAM_PORT_DEFAULT_FILE "Trace.psf"
+
+/**
+ * @def TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER
+ * @brief Stage events in the recorder's internal buffer and let TzCtrl
+ * transfer them. Must stay 1: without it every event would be written from
+ * the traced context, including ISRs and critical sections.
+ */
+#define TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER 1
+
+/**
+ * @def TRC_CFG_STREAM_PORT_BUFFER_SIZE
+ * @brief Size of the recorder's internal event buffer in bytes. It must
+ * absorb the events of TRC_CFG_CTRL_TASK_DELAY ticks.
+ */
+#define TRC_CFG_STREAM_PORT_BUFFER_SIZE 65536
+
+/**
+ * @def TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_WRITE_MODE
+ * @brief Drop new events when the internal buffer is full rather than
+ * overwriting unsent ones, so the stream stays in order. The recorder counts
+ * dropped events and reports them in the trace.
+ */
+#define TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_WRITE_MODE TRC_INTERNAL_EVENT_BUFFER_OPTION_WRITE_MODE_SKIP
+
+/**
+ * @def TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_TRANSFER_MODE
+ * @brief Transfer the whole internal buffer on every TzCtrl cycle.
+ */
+#define TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_TRANSFER_MODE TRC_INTERNAL_EVENT_BUFFER_OPTION_TRANSFER_MODE_ALL
+
+/**
+ * @def TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_SIZE
+ * @brief Largest block handed to the stream port in one write.
+ */
+#define TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_SIZE 4096
+
+/**
+ * @def TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_SIZE_LIMIT
+ * @brief Only used in chunk transfer mode.
+ */
+#define TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_SIZE_LIMIT 1024
+
+/**
+ * @def TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_COUNT_LIMIT
+ * @brief Only used in chunk transfer mode.
+ */
+#define TRC_CFG_STREAM_PORT_INTERNAL_BUFFER_CHUNK_TRANSFER_AGAIN_COUNT_LIMIT 5
+
+/**
+ * @def TRC_CFG_STREAM_PORT_RING_SIZE
+ * @brief Bytes queued between TzCtrl and the writer thread. Power of two.
+ * When it is full TzCtrl leaves the rest in the internal buffer and retries
+ * on its next cycle, so a slow disk or a late Tracealyzer connection
+ * applies backpressure instead of cutting the stream.
+ */
+#define TRC_CFG_STREAM_PORT_RING_SIZE (1024 * 1024)
+
+/**
+ * @def TRC_CFG_STREAM_PORT_WRITER_IDLE_MS
+ * @brief How long the writer thread sleeps when the ring is empty.
+ */
+#define TRC_CFG_STREAM_PORT_WRITER_IDLE_MS 10
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_STREAM_PORT_CONFIG_H */
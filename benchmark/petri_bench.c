@@ -0,0 +1,852 @@
+/*
+ * Headless benchmark for the firing engine and the status server.
+ *
+ * Built by benchmark.vcxproj, which compiles main.c with PETRI_BENCHMARK=1
+ * so that main() calls main_benchmark() instead of main_blinky(). Nothing
+ * here sleeps for station timing; every suite runs flat out on nets built
+ * for the purpose, and the results are written as one JSON document so
+ * two builds can be compared run for run.
+ *
+ * Suites (PETRI_BENCH_SUITES, comma-separated, all by default):
+ *  - engine:  is_transition_enabled() and fire_transition() throughput and
+ *             latency percentiles on ring nets of 8 to MAX_PLACES places,
+ *             with 1 to BENCH_MAX_WORKERS tasks contending for one line
+ *  - payload: cost of build_status_payload() against the place count, and
+ *             of the packed and CBOR forms binary clients ask for
+ *  - http:    GET / served to 1 to BENCH_MAX_CLIENTS concurrent clients
+ *             while a driver task keeps the marking moving
+ *
+ * The engine and payload suites run inside the scheduler; the HTTP clients
+ * are native Windows threads, like the server's I/O thread, and never call
+ * into the kernel. The suites' runner task ends the scheduler when it is
+ * done and main_benchmark() writes the results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "petri_net.h"
+#include "metrics.h"
+#include "item_tokens.h"
+#include "status_server.h"
+
+/* Environment variables: where the JSON goes, which suites run, and how
+ * long each measured run lasts. */
+#define BENCH_OUT_ENV "PETRI_BENCH_OUT"
+#define BENCH_SUITES_ENV "PETRI_BENCH_SUITES"
+#define BENCH_RUN_MS_ENV "PETRI_BENCH_RUN_MS"
+
+#define BENCH_DEFAULT_OUT "benchmark.json"
+#define BENCH_DEFAULT_RUN_MS 1000
+
+#define BENCH_MAX_WORKERS 8            // Contending tasks in the largest engine run
+#define BENCH_MAX_CLIENTS 64           // Concurrent clients in the largest HTTP run
+#define BENCH_HTTP_PLACES 32           // Places of the net the HTTP suite serves
+#define BENCH_PAYLOAD_BUFFER (16 * 1024)
+
+#define BENCH_RUNNER_PRIORITY (tskIDLE_PRIORITY + 3)
+#define BENCH_WORKER_PRIORITY (tskIDLE_PRIORITY + 1)
+#define BENCH_WORKER_STACK (configMINIMAL_STACK_SIZE * 2)
+
+// Workers report to the runner here; the runner subscribes to no transition
+#define BENCH_DONE_NOTIFY_INDEX NET_NOTIFY_INDEX
+
+static const int bench_sizes[] = { 8, 16, 32, MAX_PLACES };
+static const int bench_workers[] = { 1, 2, 4, BENCH_MAX_WORKERS };
+static const int bench_clients[] = { 1, 4, 16, BENCH_MAX_CLIENTS };
+
+#define BENCH_NUM_SIZES ((int)(sizeof(bench_sizes) / sizeof(bench_sizes[0])))
+#define BENCH_NUM_WORKER_COUNTS ((int)(sizeof(bench_workers) / sizeof(bench_workers[0])))
+#define BENCH_NUM_CLIENT_COUNTS ((int)(sizeof(bench_clients) / sizeof(bench_clients[0])))
+
+// ====================
+// LATENCY HISTOGRAMS
+// ====================
+
+/*
+ * Log-linear histogram: values below 8 get a bucket each, then every power
+ * of two is split into 8 buckets, so a percentile is within 1/8 of its
+ * true value over the whole 64-bit range. Recording is a bit scan and an
+ * increment, cheap enough to wrap around every call being measured.
+ */
+#define HIST_SUB_BITS 3
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} BenchHistogram;
+
+static inline int hist_msb(uint64_t value) {
+#if defined(_MSC_VER)
+    // _BitScanReverse64 is x64 only
+    unsigned long idx;
+    if ((value >> 32) != 0) {
+        _BitScanReverse(&idx, (unsigned long)(value >> 32));
+        return (int)idx + 32;
+    }
+    _BitScanReverse(&idx, (unsigned long)value);
+    return (int)idx;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+static inline void hist_add(BenchHistogram* hist, uint64_t value) {
+    int bucket;
+
+    if (value < HIST_SUB) {
+        bucket = (int)value;
+    } else {
+        int msb = hist_msb(value);
+        bucket = (msb - HIST_SUB_BITS + 1) * HIST_SUB + (int)((value >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+    }
+    hist->counts[bucket]++;
+    hist->total++;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+static void hist_merge(BenchHistogram* into, const BenchHistogram* from) {
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        into->counts[b] += from->counts[b];
+    }
+    into->total += from->total;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+/**
+ * @brief Value at a quantile, taken as the middle of its bucket.
+ */
+static double hist_quantile(const BenchHistogram* hist, double q) {
+    if (hist->total == 0) {
+        return 0.0;
+    }
+
+    uint64_t rank = (uint64_t)(q * (double)(hist->total - 1));
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist->counts[b];
+        if (seen > rank) {
+            if (b < HIST_SUB) {
+                return (double)b;
+            }
+            int shift = b / HIST_SUB - 1;
+            double low = (double)((uint64_t)(HIST_SUB + b % HIST_SUB) << shift);
+            double mid = low + (double)(1ull << shift) / 2.0;
+            return mid < (double)hist->max ? mid : (double)hist->max;
+        }
+    }
+    return (double)hist->max;
+}
+
+typedef struct {
+    double p50, p90, p99, p999, max;
+} BenchPercentiles;
+
+/**
+ * @brief Summarize a histogram, scaling its values by unit_ns.
+ */
+static BenchPercentiles hist_percentiles(const BenchHistogram* hist, double unit_ns) {
+    BenchPercentiles p;
+
+    p.p50 = hist_quantile(hist, 0.50) * unit_ns;
+    p.p90 = hist_quantile(hist, 0.90) * unit_ns;
+    p.p99 = hist_quantile(hist, 0.99) * unit_ns;
+    p.p999 = hist_quantile(hist, 0.999) * unit_ns;
+    p.max = (double)hist->max * unit_ns;
+    return p;
+}
+
+// ====================
+// RESULTS
+// ====================
+
+typedef struct {
+    int places;
+    int workers;
+    double duration_ms;
+    uint64_t enabled_calls;
+    uint64_t fire_calls;
+    uint64_t fired;
+    BenchPercentiles enabled_ns;
+    BenchPercentiles fire_ns;
+} EngineResult;
+
+typedef struct {
+    int places;
+    int bytes;
+    bool fits;                     // Complete within STATUS_JSON_BUFFER
+    uint64_t renders;
+    double ns_per_render;
+    int packed_bytes;
+    double ns_per_packed;
+    int cbor_bytes;
+    double ns_per_cbor;
+} PayloadResult;
+
+typedef struct {
+    int clients;
+    double duration_ms;
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t bytes;
+    BenchPercentiles latency_us;
+} HttpResult;
+
+static EngineResult engine_results[BENCH_NUM_SIZES * BENCH_NUM_WORKER_COUNTS];
+static int num_engine_results = 0;
+static PayloadResult payload_results[BENCH_NUM_SIZES];
+static int num_payload_results = 0;
+static HttpResult http_results[BENCH_NUM_CLIENT_COUNTS];
+static int num_http_results = 0;
+
+static bool run_engine = true;
+static bool run_payload = true;
+static bool run_http = true;
+static uint32_t run_ms = BENCH_DEFAULT_RUN_MS;
+static double cpu_cycles_per_ns = 0.0;     // Cycle counter rate, as measured by the engine suite
+static bool bench_failed = false;
+
+// ====================
+// TIME
+// ====================
+
+static uint64_t qpc_frequency = 1;
+
+static inline uint64_t qpc_now(void) {
+    LARGE_INTEGER count;
+    QueryPerformanceCounter(&count);
+    return (uint64_t)count.QuadPart;
+}
+
+static inline double qpc_ms(uint64_t ticks) {
+    return (double)ticks * 1000.0 / (double)qpc_frequency;
+}
+
+static inline double per_second(uint64_t count, double ms) {
+    return ms > 0.0 ? (double)count * 1000.0 / ms : 0.0;
+}
+
+// ====================
+// BENCHMARK NETS
+// ====================
+
+/**
+ * @brief Build a ring of n places and n transitions and instantiate one line.
+ * Transition i moves a token from place i to place i + 1; every other
+ * place starts marked, so half the transitions are enabled at any time and
+ * contending tasks keep finding work that a rival may take first.
+ * @return true on success.
+ */
+static bool build_ring_net(int n) {
+    char name[PETRI_NAME_LEN];
+
+    init_petri_net();
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "Benchmark Place %d", i);
+        if (add_place(name, (i % 2 == 0) ? 1 : 0) < 0) {
+            return false;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "Benchmark Step %d", i);
+        int t = add_transition(name);
+        if (t < 0 || !add_arc_input(t, i, 1) || !add_arc_output(t, (i + 1) % n, 1)) {
+            return false;
+        }
+    }
+    if (!build_net_index() || !instantiate_net_lines(1)) {
+        return false;
+    }
+    metrics_init();
+    return true;
+}
+
+// ====================
+// ENGINE SUITE
+// ====================
+
+typedef struct {
+    int first;                     // Transition the worker starts its walk at
+    uint64_t enabled_calls;
+    uint64_t fire_calls;
+    uint64_t fired;
+    BenchHistogram enabled_hist;   // In cycles
+    BenchHistogram fire_hist;
+} EngineWorker;
+
+static EngineWorker engine_workers[BENCH_MAX_WORKERS];
+static volatile bool engine_stop;
+static TaskHandle_t runner_task;
+
+/**
+ * @brief FreeRTOS task: Walks the ring, firing every transition it finds enabled.
+ * Equal-priority workers are time-sliced against each other, so a task is
+ * regularly preempted between the check and the fire and loses the token.
+ */
+static void task_engine_worker(void* params) {
+    EngineWorker* worker = (EngineWorker*)params;
+    PetriNet* net = &petri_lines[0];
+    int n = net->num_transitions;
+    int t = worker->first;
+
+    metrics_register_task("Benchmark Worker");
+    while (!engine_stop) {
+        uint64_t start = __rdtsc();
+        bool enabled = is_transition_enabled(net, t);
+        uint64_t checked = __rdtsc();
+        hist_add(&worker->enabled_hist, checked - start);
+        worker->enabled_calls++;
+
+        if (enabled) {
+            bool fired = fire_transition(net, t);
+            hist_add(&worker->fire_hist, __rdtsc() - checked);
+            worker->fire_calls++;
+            if (fired) {
+                worker->fired++;
+            }
+        }
+        t = (t + 1 < n) ? t + 1 : 0;
+    }
+
+    xTaskNotifyGiveIndexed(runner_task, BENCH_DONE_NOTIFY_INDEX);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief One engine run: n places, the given number of workers, run_ms long.
+ * @return true on success.
+ */
+static bool run_engine_case(int n, int workers) {
+    if (!build_ring_net(n)) {
+        printf("ERROR: Could not build a benchmark net of %d places\n", n);
+        return false;
+    }
+
+    memset(engine_workers, 0, sizeof(engine_workers));
+    engine_stop = false;
+    for (int w = 0; w < workers; w++) {
+        engine_workers[w].first = w * n / workers;
+        if (xTaskCreate(task_engine_worker, "BenchWorker", BENCH_WORKER_STACK,
+                &engine_workers[w], BENCH_WORKER_PRIORITY, NULL) != pdPASS) {
+            printf("ERROR: Failed to create benchmark worker %d\n", w);
+            engine_stop = true;
+            for (int done = 0; done < w; done++) {
+                ulTaskNotifyTakeIndexed(BENCH_DONE_NOTIFY_INDEX, pdFALSE, portMAX_DELAY);
+            }
+            return false;
+        }
+    }
+
+    // The workers run while the runner sleeps
+    uint64_t cycles_start = __rdtsc();
+    uint64_t qpc_start = qpc_now();
+    vTaskDelay(pdMS_TO_TICKS(run_ms));
+    engine_stop = true;
+    uint64_t qpc_elapsed = qpc_now() - qpc_start;
+    uint64_t cycles_elapsed = __rdtsc() - cycles_start;
+    for (int w = 0; w < workers; w++) {
+        ulTaskNotifyTakeIndexed(BENCH_DONE_NOTIFY_INDEX, pdFALSE, portMAX_DELAY);
+    }
+
+    double elapsed_ms = qpc_ms(qpc_elapsed);
+    double cycles_per_ns = elapsed_ms > 0.0 ? (double)cycles_elapsed / (elapsed_ms * 1e6) : 1.0;
+    if (cpu_cycles_per_ns == 0.0) {
+        cpu_cycles_per_ns = cycles_per_ns;
+    }
+
+    EngineResult* result = &engine_results[num_engine_results++];
+    static BenchHistogram enabled_hist;
+    static BenchHistogram fire_hist;
+    memset(&enabled_hist, 0, sizeof(enabled_hist));
+    memset(&fire_hist, 0, sizeof(fire_hist));
+    memset(result, 0, sizeof(*result));
+    result->places = n;
+    result->workers = workers;
+    result->duration_ms = elapsed_ms;
+    for (int w = 0; w < workers; w++) {
+        result->enabled_calls += engine_workers[w].enabled_calls;
+        result->fire_calls += engine_workers[w].fire_calls;
+        result->fired += engine_workers[w].fired;
+        hist_merge(&enabled_hist, &engine_workers[w].enabled_hist);
+        hist_merge(&fire_hist, &engine_workers[w].fire_hist);
+    }
+    result->enabled_ns = hist_percentiles(&enabled_hist, 1.0 / cycles_per_ns);
+    result->fire_ns = hist_percentiles(&fire_hist, 1.0 / cycles_per_ns);
+
+    printf("  engine  %2d places %d task(s): %10.0f fires/s, fire p50 %6.0f ns p99 %7.0f ns\n",
+        n, workers, per_second(result->fired, elapsed_ms), result->fire_ns.p50, result->fire_ns.p99);
+    return true;
+}
+
+// ====================
+// PAYLOAD SUITE
+// ====================
+
+static char payload_buffer[BENCH_PAYLOAD_BUFFER];
+static uint8_t binary_buffer[STATUS_BINARY_BUFFER];
+
+/**
+ * @brief Time one binary encoder of the status payload for a quarter of the case's budget.
+ * @return Nanoseconds per render; the size goes to *bytes.
+ */
+static double time_binary_payload(int (*build)(uint8_t*, size_t, uint32_t, const int32_t*),
+                                  const PetriSnapshot* snapshot, int* bytes) {
+    const uint64_t budget = (uint64_t)run_ms * qpc_frequency / 16000;
+    uint64_t renders = 0;
+    uint64_t start = qpc_now();
+    uint64_t elapsed = 0;
+
+    while (elapsed < budget) {
+        for (int i = 0; i < 64; i++) {
+            *bytes = build(binary_buffer, sizeof(binary_buffer), snapshot->version, snapshot->marking);
+        }
+        renders += 64;
+        elapsed = qpc_now() - start;
+    }
+    return qpc_ms(elapsed) * 1e6 / (double)renders;
+}
+
+/**
+ * @brief Render the status payload of an n-place net for run_ms / 4.
+ * @return true on success.
+ */
+static bool run_payload_case(int n) {
+    PetriSnapshot snapshot;
+
+    if (!build_ring_net(n)) {
+        printf("ERROR: Could not build a benchmark net of %d places\n", n);
+        return false;
+    }
+    petri_snapshot(&petri_lines[0], &snapshot);
+
+    PayloadResult* result = &payload_results[num_payload_results++];
+    memset(result, 0, sizeof(*result));
+    result->places = n;
+
+    // A short run is plenty for a pure function; check the clock every 64 renders
+    const uint64_t budget = (uint64_t)run_ms * qpc_frequency / 4000;
+    uint64_t start = qpc_now();
+    uint64_t elapsed = 0;
+    while (elapsed < budget) {
+        for (int i = 0; i < 64; i++) {
+            result->bytes = build_status_payload(payload_buffer, sizeof(payload_buffer), snapshot.version, snapshot.marking);
+        }
+        result->renders += 64;
+        elapsed = qpc_now() - start;
+    }
+    result->ns_per_render = qpc_ms(elapsed) * 1e6 / (double)result->renders;
+    result->fits = result->bytes < STATUS_JSON_BUFFER - 1;
+    result->ns_per_packed = time_binary_payload(build_status_packed, &snapshot, &result->packed_bytes);
+    result->ns_per_cbor = time_binary_payload(build_status_cbor, &snapshot, &result->cbor_bytes);
+
+    printf("  payload %2d places: %5d bytes%s, %8.0f ns per render; packed %d bytes, %.0f ns; "
+        "CBOR %d bytes, %.0f ns\n",
+        n, result->bytes, result->fits ? "" : " (over STATUS_JSON_BUFFER)", result->ns_per_render,
+        result->packed_bytes, result->ns_per_packed, result->cbor_bytes, result->ns_per_cbor);
+    return true;
+}
+
+// ====================
+// HTTP SUITE
+// ====================
+
+typedef struct {
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t bytes;
+    BenchHistogram latency_hist;   // In performance counter ticks
+} HttpClient;
+
+static HttpClient http_clients[BENCH_MAX_CLIENTS];
+static volatile LONG http_stop;
+static volatile LONG http_clients_done;
+static volatile bool driver_stop;
+
+/**
+ * @brief One request on a fresh connection, as the status viewer makes it.
+ * @return Bytes received, or -1 if the request failed or was not answered.
+ */
+static int http_request(void) {
+    static const char request[] = "GET / HTTP/1.1\r\nHost: localhost\r\nAccept: application/json\r\n\r\n";
+    char chunk[2048];
+    char status[12];
+    int received = 0;
+
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        return -1;
+    }
+
+    // Reset instead of lingering, so thousands of short connections leave no TIME_WAIT behind
+    struct linger no_linger = { 1, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, (const char*)&no_linger, sizeof(no_linger));
+
+    struct sockaddr_in server;
+    ZeroMemory(&server, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons(STATUS_SERVER_PORT);
+
+    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) == SOCKET_ERROR ||
+        send(sock, request, (int)sizeof(request) - 1, 0) == SOCKET_ERROR) {
+        closesocket(sock);
+        return -1;
+    }
+
+    // The server closes the connection after the reply; keep the status line
+    int got;
+    while ((got = recv(sock, chunk, (int)sizeof(chunk), 0)) > 0) {
+        if (received < (int)sizeof(status)) {
+            int take = (int)sizeof(status) - received;
+            memcpy(status + received, chunk, (size_t)(got < take ? got : take));
+        }
+        received += got;
+    }
+    closesocket(sock);
+
+    if (received < (int)sizeof(status) ||
+        (memcmp(status, "HTTP/1.1 200", 12) != 0 && memcmp(status, "HTTP/1.1 304", 12) != 0)) {
+        return -1;
+    }
+    return received;
+}
+
+/*
+ * Windows thread: one client of the load test. It must not call any
+ * FreeRTOS API; the runner task polls http_clients_done.
+ */
+static DWORD WINAPI http_client_thread(void* param) {
+    HttpClient* client = (HttpClient*)param;
+
+    while (http_stop == 0) {
+        uint64_t start = qpc_now();
+        int got = http_request();
+        if (got < 0) {
+            client->errors++;
+            continue;
+        }
+        hist_add(&client->latency_hist, qpc_now() - start);
+        client->requests++;
+        client->bytes += (uint64_t)got;
+    }
+
+    InterlockedIncrement(&http_clients_done);
+    return 0;
+}
+
+/**
+ * @brief FreeRTOS task: Fires one transition per tick so every request sees a
+ * fresh marking and the server re-renders its payload, as on a busy line.
+ */
+static void task_http_driver(void* params) {
+    (void)params;
+    PetriNet* net = &petri_lines[0];
+    int t = 0;
+
+    while (!driver_stop) {
+        int enabled = find_first_enabled_transition(net, t);
+        if (enabled >= 0) {
+            fire_transition(net, enabled);
+            t = enabled + 1 < net->num_transitions ? enabled + 1 : 0;
+        }
+        vTaskDelay(1);
+    }
+
+    xTaskNotifyGiveIndexed(runner_task, BENCH_DONE_NOTIFY_INDEX);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief One HTTP run with the given number of concurrent clients.
+ * @return true on success.
+ */
+static bool run_http_case(int clients) {
+    memset(http_clients, 0, sizeof(http_clients));
+    http_stop = 0;
+    http_clients_done = 0;
+
+    uint64_t start = qpc_now();
+    for (int c = 0; c < clients; c++) {
+        // A Windows call must not be interrupted by a context switch
+        taskENTER_CRITICAL();
+        HANDLE thread = CreateThread(NULL, 0, http_client_thread, &http_clients[c], 0, NULL);
+        if (thread != NULL) {
+            SetThreadAffinityMask(thread, ~0x01u);
+            CloseHandle(thread);
+        }
+        taskEXIT_CRITICAL();
+        if (thread == NULL) {
+            printf("ERROR: Failed to create benchmark client %d\n", c);
+            InterlockedExchange(&http_stop, 1);
+            while (http_clients_done < c) {
+                vTaskDelay(pdMS_TO_TICKS(10));
+            }
+            return false;
+        }
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(run_ms));
+    InterlockedExchange(&http_stop, 1);
+    uint64_t elapsed = qpc_now() - start;
+    while (http_clients_done < clients) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    HttpResult* result = &http_results[num_http_results++];
+    static BenchHistogram latency_hist;
+    memset(&latency_hist, 0, sizeof(latency_hist));
+    memset(result, 0, sizeof(*result));
+    result->clients = clients;
+    result->duration_ms = qpc_ms(elapsed);
+    for (int c = 0; c < clients; c++) {
+        result->requests += http_clients[c].requests;
+        result->errors += http_clients[c].errors;
+        result->bytes += http_clients[c].bytes;
+        hist_merge(&latency_hist, &http_clients[c].latency_hist);
+    }
+    result->latency_us = hist_percentiles(&latency_hist, 1e6 / (double)qpc_frequency);
+
+    printf("  http    %2d client(s): %8.0f req/s, %llu errors, p50 %6.0f us p99 %7.0f us\n",
+        clients, per_second(result->requests, result->duration_ms),
+        (unsigned long long)result->errors, result->latency_us.p50, result->latency_us.p99);
+    return true;
+}
+
+/**
+ * @brief Start the status server on a benchmark net and load it.
+ * Runs last: the server keeps reading the model, so no net is built after it.
+ * @return true on success.
+ */
+static bool run_http_suite(void) {
+    bool ok = true;
+
+    if (!build_ring_net(BENCH_HTTP_PLACES)) {
+        printf("ERROR: Could not build a benchmark net of %d places\n", BENCH_HTTP_PLACES);
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    bool started = status_server_start();
+    taskEXIT_CRITICAL();
+    if (!started) {
+        printf("ERROR: Failed to start status server\n");
+        return false;
+    }
+    driver_stop = false;
+    if (xTaskCreate(task_http_driver, "BenchDriver", BENCH_WORKER_STACK, NULL,
+            BENCH_WORKER_PRIORITY, NULL) != pdPASS) {
+        printf("ERROR: Failed to create benchmark driver task\n");
+        return false;
+    }
+
+    // Give the I/O thread time to start listening
+    vTaskDelay(pdMS_TO_TICKS(200));
+    for (int i = 0; i < BENCH_NUM_CLIENT_COUNTS && ok; i++) {
+        ok = run_http_case(bench_clients[i]);
+    }
+
+    driver_stop = true;
+    ulTaskNotifyTakeIndexed(BENCH_DONE_NOTIFY_INDEX, pdFALSE, portMAX_DELAY);
+    return ok;
+}
+
+// ====================
+// RUNNER
+// ====================
+
+/**
+ * @brief FreeRTOS task: Runs the selected suites, then ends the scheduler.
+ * It outranks every task it creates, which therefore only run while it sleeps.
+ */
+static void task_bench_runner(void* params) {
+    (void)params;
+    bool ok = true;
+
+    if (run_engine) {
+        printf("Engine suite (%lu ms per run):\n", (unsigned long)run_ms);
+        for (int s = 0; s < BENCH_NUM_SIZES && ok; s++) {
+            for (int w = 0; w < BENCH_NUM_WORKER_COUNTS && ok; w++) {
+                ok = run_engine_case(bench_sizes[s], bench_workers[w]);
+            }
+        }
+    }
+    if (run_payload && ok) {
+        printf("Payload suite:\n");
+        for (int s = 0; s < BENCH_NUM_SIZES && ok; s++) {
+            ok = run_payload_case(bench_sizes[s]);
+        }
+    }
+    if (run_http && ok) {
+        printf("HTTP suite (%lu ms per run, %d places):\n", (unsigned long)run_ms, BENCH_HTTP_PLACES);
+        ok = run_http_suite();
+    }
+
+    bench_failed = !ok;
+    vTaskEndScheduler();
+    vTaskDelete(NULL);
+}
+
+// ====================
+// JSON OUTPUT
+// ====================
+
+static void write_percentiles(FILE* out, const char* name, const BenchPercentiles* p) {
+    fprintf(out, "\"%s\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+        name, p->p50, p->p90, p->p99, p->p999, p->max);
+}
+
+/**
+ * @brief Write every result as one JSON document.
+ * @return true on success.
+ */
+static bool write_results(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        printf("ERROR: Cannot write benchmark results to %s\n", path);
+        return false;
+    }
+
+    fprintf(out, "{\"benchmark\":\"petri\",\"format\":1,\"timestamp\":%lld,\"complete\":%s,\n",
+        (long long)time(NULL), bench_failed ? "false" : "true");
+    fprintf(out, "\"config\":{\"run_ms\":%lu,\"cores\":%d,\"metrics\":%s,\"colored_tokens\":%s,"
+        "\"status_json_buffer\":%d,\"cpu_ghz\":%.3f},\n",
+        (unsigned long)run_ms, (int)configNUMBER_OF_CORES,
+        METRICS_ENABLED ? "true" : "false", PETRI_COLORED_TOKENS ? "true" : "false",
+        STATUS_JSON_BUFFER, cpu_cycles_per_ns);
+
+    fprintf(out, "\"engine\":[");
+    for (int i = 0; i < num_engine_results; i++) {
+        const EngineResult* r = &engine_results[i];
+        fprintf(out, "%s\n {\"places\":%d,\"transitions\":%d,\"tasks\":%d,\"duration_ms\":%.1f,"
+            "\"enabled_calls\":%llu,\"fire_calls\":%llu,\"fired\":%llu,\"fires_per_sec\":%.0f,",
+            i > 0 ? "," : "", r->places, r->places, r->workers, r->duration_ms,
+            (unsigned long long)r->enabled_calls, (unsigned long long)r->fire_calls,
+            (unsigned long long)r->fired, per_second(r->fired, r->duration_ms));
+        write_percentiles(out, "enabled_ns", &r->enabled_ns);
+        fprintf(out, ",");
+        write_percentiles(out, "fire_ns", &r->fire_ns);
+        fprintf(out, "}");
+    }
+
+    fprintf(out, "],\n\"payload\":[");
+    for (int i = 0; i < num_payload_results; i++) {
+        const PayloadResult* r = &payload_results[i];
+        fprintf(out, "%s\n {\"places\":%d,\"bytes\":%d,\"fits\":%s,\"renders\":%llu,\"ns_per_render\":%.1f,\"ns_per_place\":%.1f,"
+            "\"packed_bytes\":%d,\"ns_per_packed\":%.1f,\"cbor_bytes\":%d,\"ns_per_cbor\":%.1f}",
+            i > 0 ? "," : "", r->places, r->bytes, r->fits ? "true" : "false",
+            (unsigned long long)r->renders, r->ns_per_render, r->ns_per_render / r->places,
+            r->packed_bytes, r->ns_per_packed, r->cbor_bytes, r->ns_per_cbor);
+    }
+
+    fprintf(out, "],\n\"http\":[");
+    for (int i = 0; i < num_http_results; i++) {
+        const HttpResult* r = &http_results[i];
+        fprintf(out, "%s\n {\"clients\":%d,\"places\":%d,\"duration_ms\":%.1f,\"requests\":%llu,\"errors\":%llu,"
+            "\"requests_per_sec\":%.0f,\"bytes\":%llu,",
+            i > 0 ? "," : "", r->clients, BENCH_HTTP_PLACES, r->duration_ms,
+            (unsigned long long)r->requests, (unsigned long long)r->errors,
+            per_second(r->requests, r->duration_ms), (unsigned long long)r->bytes);
+        write_percentiles(out, "latency_us", &r->latency_us);
+        fprintf(out, "}");
+    }
+    fprintf(out, "]}\n");
+
+    bool ok = ferror(out) == 0;
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        printf("ERROR: Failed writing benchmark results to %s\n", path);
+    }
+    return ok;
+}
+
+/**
+ * @brief Select the suites named in PETRI_BENCH_SUITES.
+ * @return false if a name is not a suite.
+ */
+static bool parse_suites(const char* list) {
+    run_engine = run_payload = run_http = false;
+
+    while (*list != '\0') {
+        size_t len = strcspn(list, ",");
+        if (len == 6 && strncmp(list, "engine", 6) == 0) {
+            run_engine = true;
+        } else if (len == 7 && strncmp(list, "payload", 7) == 0) {
+            run_payload = true;
+        } else if (len == 4 && strncmp(list, "http", 4) == 0) {
+            run_http = true;
+        } else if (len > 0) {
+            printf("ERROR: Unknown benchmark suite '%.*s' (engine, payload, http)\n", (int)len, list);
+            return false;
+        }
+        list += len;
+        if (*list == ',') {
+            list++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Entry point of the benchmark build, called from main().
+ */
+void main_benchmark(void) {
+    LARGE_INTEGER frequency;
+    WSADATA wsaData;
+    const char* out_path = getenv(BENCH_OUT_ENV) != NULL ? getenv(BENCH_OUT_ENV) : BENCH_DEFAULT_OUT;
+    const char* suites = getenv(BENCH_SUITES_ENV);
+    const char* run = getenv(BENCH_RUN_MS_ENV);
+
+    if (suites != NULL && !parse_suites(suites)) {
+        return;
+    }
+    if (run != NULL) {
+        run_ms = (uint32_t)strtoul(run, NULL, 10);
+        if (run_ms == 0) {
+            printf("ERROR: %s must be a positive number of milliseconds\n", BENCH_RUN_MS_ENV);
+            return;
+        }
+    }
+    if (QueryPerformanceFrequency(&frequency) && frequency.QuadPart > 0) {
+        qpc_frequency = (uint64_t)frequency.QuadPart;
+    }
+    // The clients share the Winsock initialization of the process
+    if (run_http && WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        printf("ERROR: Benchmark could not initialize Winsock\n");
+        return;
+    }
+
+    if (xTaskCreate(task_bench_runner, "BenchRunner", configMINIMAL_STACK_SIZE * 4, NULL,
+            BENCH_RUNNER_PRIORITY, &runner_task) != pdPASS) {
+        printf("ERROR: Failed to create benchmark runner task\n");
+        return;
+    }
+
+    vTaskStartScheduler();
+
+    if (write_results(out_path)) {
+        printf("Benchmark %s: results written to %s\n", bench_failed ? "stopped early" : "complete", out_path);
+    }
+}
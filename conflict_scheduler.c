@@ -0,0 +1,314 @@
+/*
+ * Conflict sets fired through a policy. See conflict_scheduler.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "conflict_scheduler.h"
+#include "petri_net.h"
+
+#if CONFLICT_MAX_MEMBERS > 32
+#error "Enabled members are tracked in a 32-bit mask"
+#endif
+
+static ConflictSet conflict_sets[CONFLICT_MAX_SETS];
+static int num_conflict_sets = 0;
+
+static const char* const policy_names[NUM_CONFLICT_POLICIES] = {
+    [CONFLICT_FIXED_PRIORITY]  = "priority",
+    [CONFLICT_WEIGHTED_RANDOM] = "weighted",
+    [CONFLICT_SHORTEST_QUEUE]  = "shortest",
+    [CONFLICT_LONGEST_QUEUE]   = "longest",
+};
+
+// ====================
+// POLICIES
+// ====================
+
+/**
+ * @brief Tokens waiting around a member: in its input places, or in its
+ * output places, leaving out the place the set competes for.
+ * @param member Index in the set.
+ * @param inputs true for the input places, false for the output places.
+ */
+int conflict_member_queue(const ConflictSet* set, int member, bool inputs) {
+    const ConflictMember* m = &set->members[member];
+    const PetriNet* net = m->net;
+    const PetriIndex* start = inputs ? net->in_start : net->out_start;
+    const Arc* arcs = inputs ? net->in_arcs : net->out_arcs;
+    int tokens = 0;
+
+    for (int a = start[m->transition]; a < start[m->transition + 1]; a++) {
+        if (arcs[a].place != set->place) {
+            tokens += get_place_tokens(net, arcs[a].place);
+        }
+    }
+    return tokens;
+}
+
+/**
+ * @brief true if member a should win over member b on priority alone;
+ * the earlier member wins a tie.
+ */
+static inline bool ranks_before(const ConflictSet* set, int a, int b) {
+    return set->members[a].priority > set->members[b].priority;
+}
+
+static int pick_fixed_priority(const ConflictSet* set, uint32_t enabled, RngState* rng) {
+    int best = -1;
+
+    (void)rng;
+    for (int m = 0; m < set->num_members; m++) {
+        if ((enabled & (1u << m)) != 0 && (best < 0 || ranks_before(set, m, best))) {
+            best = m;
+        }
+    }
+    return best;
+}
+
+/*
+ * Members that are not enabled drop out of the draw, so their share goes
+ * to the others in proportion.
+ */
+static int pick_weighted_random(const ConflictSet* set, uint32_t enabled, RngState* rng) {
+    uint32_t total = 0;
+
+    for (int m = 0; m < set->num_members; m++) {
+        if ((enabled & (1u << m)) != 0) {
+            total += set->members[m].weight;
+        }
+    }
+    if (total == 0 || rng == NULL) {
+        return pick_fixed_priority(set, enabled, rng);
+    }
+
+    uint32_t draw = rng_below(rng, total);
+    for (int m = 0; m < set->num_members; m++) {
+        if ((enabled & (1u << m)) == 0) {
+            continue;
+        }
+        if (draw < set->members[m].weight) {
+            return m;
+        }
+        draw -= set->members[m].weight;
+    }
+    return pick_fixed_priority(set, enabled, rng);
+}
+
+/**
+ * @brief The enabled member with the smallest or largest queue, ties broken by priority.
+ */
+static int pick_by_queue(const ConflictSet* set, uint32_t enabled, bool longest) {
+    int best = -1;
+    int best_queue = 0;
+
+    for (int m = 0; m < set->num_members; m++) {
+        if ((enabled & (1u << m)) == 0) {
+            continue;
+        }
+        int queue = conflict_member_queue(set, m, longest);
+        bool better = longest ? queue > best_queue : queue < best_queue;
+        if (best < 0 || better || (queue == best_queue && ranks_before(set, m, best))) {
+            best = m;
+            best_queue = queue;
+        }
+    }
+    return best;
+}
+
+static int pick_shortest_queue(const ConflictSet* set, uint32_t enabled, RngState* rng) {
+    (void)rng;
+    return pick_by_queue(set, enabled, false);
+}
+
+static int pick_longest_queue(const ConflictSet* set, uint32_t enabled, RngState* rng) {
+    (void)rng;
+    return pick_by_queue(set, enabled, true);
+}
+
+static const ConflictPolicyFn policy_fns[NUM_CONFLICT_POLICIES] = {
+    [CONFLICT_FIXED_PRIORITY]  = pick_fixed_priority,
+    [CONFLICT_WEIGHTED_RANDOM] = pick_weighted_random,
+    [CONFLICT_SHORTEST_QUEUE]  = pick_shortest_queue,
+    [CONFLICT_LONGEST_QUEUE]   = pick_longest_queue,
+};
+
+/**
+ * @brief Name of a built-in policy, as PETRI_CONFLICT_POLICY spells it.
+ */
+const char* conflict_policy_name(ConflictPolicy policy) {
+    return policy >= 0 && policy < NUM_CONFLICT_POLICIES ? policy_names[policy] : "custom";
+}
+
+// ====================
+// CONFLICT SETS
+// ====================
+
+/**
+ * @brief Find the input place every member needs.
+ * @return Net index of the place, or -1 if the members share none. Members
+ * on different lines can only compete for a shared place.
+ */
+static int contested_place(const ConflictMember* members, int count) {
+    const ConflictMember* first = &members[0];
+    const PetriNet* net = first->net;
+
+    for (int a = net->in_start[first->transition]; a < net->in_start[first->transition + 1]; a++) {
+        int place = net->in_arcs[a].place;
+        bool common = true;
+
+        for (int m = 1; m < count && common; m++) {
+            const ConflictMember* member = &members[m];
+            bool found = false;
+
+            if (member->net != net && !is_shared_place(place)) {
+                common = false;
+                break;
+            }
+            for (int b = member->net->in_start[member->transition];
+                 b < member->net->in_start[member->transition + 1] && !found; b++) {
+                found = member->net->in_arcs[b].place == place;
+            }
+            common = found;
+        }
+        if (common) {
+            return place;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Look the set's name up in PETRI_CONFLICT_POLICY.
+ * @param policy Left alone unless the variable names the set.
+ * @return false if the variable names an unknown policy for the set.
+ */
+static bool policy_from_environment(const char* name, ConflictPolicy* policy) {
+    const char* spec = getenv(CONFLICT_POLICY_ENV);
+
+    while (spec != NULL && *spec != '\0') {
+        size_t len = strcspn(spec, ",");
+        size_t key_len = strcspn(spec, "=");
+
+        if (key_len < len && strlen(name) == key_len && strncmp(spec, name, key_len) == 0) {
+            const char* value = spec + key_len + 1;
+            size_t value_len = len - key_len - 1;
+            for (int p = 0; p < NUM_CONFLICT_POLICIES; p++) {
+                if (strlen(policy_names[p]) == value_len && strncmp(value, policy_names[p], value_len) == 0) {
+                    *policy = (ConflictPolicy)p;
+                    return true;
+                }
+            }
+            printf("ERROR: " CONFLICT_POLICY_ENV " gives set '%s' the policy '%.*s'; use priority, weighted, "
+                "shortest or longest\n", name, (int)value_len, value);
+            return false;
+        }
+        spec += len + (spec[len] == ',' ? 1 : 0);
+    }
+    return true;
+}
+
+/**
+ * @brief Create a conflict set. PETRI_CONFLICT_POLICY may override the policy.
+ * Call before the scheduler starts.
+ * @param name Name the environment variable refers to; several sets may share one.
+ * @param members Transitions that share an input place; copied.
+ * @param count Number of members, 1 to CONFLICT_MAX_MEMBERS.
+ * @param policy Policy unless the environment says otherwise.
+ * @return The set, or NULL on error.
+ */
+ConflictSet* conflict_set_create(const char* name, const ConflictMember* members, int count,
+                                 ConflictPolicy policy) {
+    if (num_conflict_sets >= CONFLICT_MAX_SETS) {
+        printf("ERROR: More than %d conflict sets\n", CONFLICT_MAX_SETS);
+        return NULL;
+    }
+    if (count < 1 || count > CONFLICT_MAX_MEMBERS) {
+        printf("ERROR: Conflict set '%s' needs 1 to %d members\n", name, CONFLICT_MAX_MEMBERS);
+        return NULL;
+    }
+
+    int place = contested_place(members, count);
+    if (place < 0) {
+        printf("ERROR: The members of conflict set '%s' share no input place\n", name);
+        return NULL;
+    }
+    if (!policy_from_environment(name, &policy)) {
+        return NULL;
+    }
+
+    ConflictSet* set = &conflict_sets[num_conflict_sets++];
+    snprintf(set->name, sizeof(set->name), "%s", name);
+    set->place = place;
+    memcpy(set->members, members, sizeof(ConflictMember) * count);
+    set->num_members = count;
+    set->policy = policy;
+    set->pick = policy_fns[policy];
+
+    // Sets of the same name (one per line) are reported once
+    bool first_of_name = true;
+    for (int s = 0; s < num_conflict_sets - 1; s++) {
+        first_of_name = first_of_name && strcmp(conflict_sets[s].name, set->name) != 0;
+    }
+    if (first_of_name && getenv(CONFLICT_POLICY_ENV) != NULL) {
+        printf("Conflict set %s: %s policy\n", set->name, policy_names[policy]);
+    }
+    return set;
+}
+
+/**
+ * @brief Replace the set's policy with one of the application's own.
+ * Call before any station fires through the set.
+ */
+void conflict_set_use_policy(ConflictSet* set, ConflictPolicyFn pick) {
+    set->policy = NUM_CONFLICT_POLICIES;
+    set->pick = pick;
+}
+
+/**
+ * @brief Subscribe the calling task to every member, so it wakes when any
+ * of them becomes enabled.
+ * @return false if a member had no subscriber slot left.
+ */
+bool conflict_subscribe(const ConflictSet* set) {
+    for (int m = 0; m < set->num_members; m++) {
+        if (!subscribe_transition(set->members[m].net, set->members[m].transition)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Fire one enabled member, chosen by the set's policy.
+ * If another station takes the tokens between the pick and the fire, the
+ * policy picks again among the members still enabled.
+ * @param rng Caller's stream, for the random policies; may be NULL.
+ * @return Index of the member that fired, or -1 if none was enabled.
+ */
+int conflict_fire(ConflictSet* set, RngState* rng) {
+    uint32_t enabled = 0;
+
+    for (int m = 0; m < set->num_members; m++) {
+        if (is_transition_enabled(set->members[m].net, set->members[m].transition)) {
+            enabled |= 1u << m;
+        }
+    }
+
+    while (enabled != 0) {
+        int m = set->pick(set, enabled, rng);
+        if (m < 0 || m >= set->num_members || (enabled & (1u << m)) == 0) {
+            m = pick_fixed_priority(set, enabled, rng);
+        }
+        if (fire_transition(set->members[m].net, set->members[m].transition)) {
+            return m;
+        }
+        enabled &= ~(1u << m);
+    }
+    return -1;
+}
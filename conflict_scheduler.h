@@ -0,0 +1,85 @@
+/*
+ * Conflict sets: transitions that compete for the tokens of one place,
+ * fired through a policy instead of each station's own choice.
+ *
+ * A conflict set lists the transitions a station may take work from when
+ * they share an input place, e.g. Select to Paint and Skip Paint, which
+ * both take the next item from the QC1 buffer, or the QC and rework starts
+ * that all need a Worker token. When the station is free it calls
+ * conflict_fire(): the policy picks one of the members that are enabled
+ * right now and the scheduler fires it, moving on to the next pick if
+ * another station took the tokens first. A station therefore only waits
+ * when no member is enabled at all, so a free Worker never sits idle
+ * while any queue it serves holds work.
+ *
+ * Built-in policies:
+ *  - priority: the enabled member with the highest priority
+ *  - weighted: a random enabled member, in proportion to the weights
+ *  - shortest: the member whose output places hold the fewest tokens,
+ *    i.e. send work where the downstream queue is shortest
+ *  - longest:  the member whose input places (other than the contested
+ *    one) hold the most tokens, i.e. serve the longest backlog first
+ * The queue policies break ties by priority. Any other rule can be
+ * plugged in with conflict_set_use_policy().
+ *
+ * PETRI_CONFLICT_POLICY overrides the policy of sets by name, e.g.
+ * PETRI_CONFLICT_POLICY=router=shortest,qc=longest, so a run can be tuned
+ * without rebuilding. Sets are created before the scheduler starts.
+ */
+
+#ifndef CONFLICT_SCHEDULER_H
+#define CONFLICT_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "petri_net.h"
+#include "rng.h"
+
+/* Environment variable with comma-separated <set>=<policy> overrides. */
+#define CONFLICT_POLICY_ENV "PETRI_CONFLICT_POLICY"
+
+#define CONFLICT_MAX_SETS (2 * PETRI_MAX_LINES)    // A router and a QC pool per line
+#define CONFLICT_MAX_MEMBERS 16        // Members are tracked in a 32-bit mask
+#define CONFLICT_NAME_LEN 16
+
+typedef enum {
+    CONFLICT_FIXED_PRIORITY,
+    CONFLICT_WEIGHTED_RANDOM,
+    CONFLICT_SHORTEST_QUEUE,
+    CONFLICT_LONGEST_QUEUE,
+    NUM_CONFLICT_POLICIES
+} ConflictPolicy;
+
+/* One transition competing for the set's place. */
+typedef struct {
+    PetriNet* net;                 // Line the transition fires on
+    int transition;
+    int priority;                  // Higher wins under priority, and breaks ties otherwise
+    uint32_t weight;               // Share of the picks under weighted
+} ConflictMember;
+
+typedef struct ConflictSet ConflictSet;
+
+/* Pick one member whose bit is set in enabled (never 0); rng may be NULL. */
+typedef int (*ConflictPolicyFn)(const ConflictSet* set, uint32_t enabled, RngState* rng);
+
+struct ConflictSet {
+    char name[CONFLICT_NAME_LEN];  // What PETRI_CONFLICT_POLICY calls the set
+    int place;                     // Input place every member needs
+    ConflictMember members[CONFLICT_MAX_MEMBERS];
+    int num_members;
+    ConflictPolicy policy;
+    ConflictPolicyFn pick;
+};
+
+ConflictSet* conflict_set_create(const char* name, const ConflictMember* members, int count,
+                                 ConflictPolicy policy);
+void conflict_set_use_policy(ConflictSet* set, ConflictPolicyFn pick);
+const char* conflict_policy_name(ConflictPolicy policy);
+
+bool conflict_subscribe(const ConflictSet* set);
+int conflict_fire(ConflictSet* set, RngState* rng);
+int conflict_member_queue(const ConflictSet* set, int member, bool inputs);
+
+#endif /* CONFLICT_SCHEDULER_H */
@@ -0,0 +1,189 @@
+/*
+ * Asynchronous event log: non-blocking producers, one batching writer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "event_log.h"
+#include "static_arena.h"
+
+static QueueHandle_t log_queue;
+static volatile uint32_t dropped_records = 0;
+
+static const char* const* log_station_names;
+static int log_num_stations;
+static const LogEventFormat* log_events;
+static int log_num_events;
+
+static void count_drop(void) {
+    taskENTER_CRITICAL();
+    dropped_records++;
+    taskEXIT_CRITICAL();
+}
+
+static void count_drop_from_isr(void) {
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    dropped_records++;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+/**
+ * @brief Queue an event for the logger task. Never blocks.
+ * @param station Index into the station name table.
+ * @param event Index into the event format table.
+ * @param arg0 First format argument.
+ * @param arg1 Second format argument.
+ */
+void log_event(uint8_t station, uint8_t event, int32_t arg0, int32_t arg1) {
+    // Logging is off until event_log_start(), and stays off in simulation mode
+    if (log_queue == NULL) {
+        return;
+    }
+
+    LogRecord record;
+    record.timestamp = xTaskGetTickCount();
+    record.station = station;
+    record.event = event;
+    record.reserved = 0;
+    record.args[0] = arg0;
+    record.args[1] = arg1;
+
+    if (xQueueSend(log_queue, &record, 0) != pdPASS) {
+        count_drop();
+    }
+}
+
+/**
+ * @brief Interrupt-safe variant of log_event() for simulated interrupt handlers.
+ */
+void log_event_from_isr(uint8_t station, uint8_t event, int32_t arg0, int32_t arg1) {
+    if (log_queue == NULL) {
+        return;
+    }
+
+    LogRecord record;
+    record.timestamp = xTaskGetTickCountFromISR();
+    record.station = station;
+    record.event = event;
+    record.reserved = 0;
+    record.args[0] = arg0;
+    record.args[1] = arg1;
+
+    if (xQueueSendFromISR(log_queue, &record, NULL) != pdPASS) {
+        count_drop_from_isr();
+    }
+}
+
+/**
+ * @brief Number of records discarded because the queue was full.
+ */
+uint32_t event_log_dropped(void) {
+    return dropped_records;
+}
+
+static int format_record(char* buffer, size_t size, const LogRecord* record) {
+    const char* station = (record->station < log_num_stations)
+        ? log_station_names[record->station] : "?";
+
+    if (record->event >= log_num_events) {
+        int written = snprintf(buffer, size, "[%7lu] [%s] Unknown event %u\n",
+            (unsigned long)record->timestamp, station, (unsigned)record->event);
+        return (written < 0 || written >= (int)size) ? -1 : written;
+    }
+
+    const LogEventFormat* desc = &log_events[record->event];
+    int offset = snprintf(buffer, size, "%s[%7lu] [%s] ",
+        desc->color, (unsigned long)record->timestamp, station);
+    if (offset < 0 || offset >= (int)size) {
+        return -1;
+    }
+
+    int written = snprintf(buffer + offset, size - offset, desc->format,
+        (int)record->args[0], (int)record->args[1]);
+    if (written < 0 || offset + written >= (int)size) {
+        return -1;
+    }
+    offset += written;
+
+    written = snprintf(buffer + offset, size - offset, "%s\n", COLOR_RESET);
+    if (written < 0 || offset + written >= (int)size) {
+        return -1;
+    }
+    return offset + written;
+}
+
+/**
+ * @brief FreeRTOS task: Drains the log queue and writes records in batches.
+ *
+ * Blocks for the first record, then takes whatever else is already queued
+ * so a burst of events costs one fwrite and one flush.
+ */
+static void task_logger(void* params) {
+    (void)params;
+
+    static char batch[LOG_BATCH_BUFFER];
+    uint32_t reported_drops = 0;
+    LogRecord record;
+
+    while (1) {
+        xQueueReceive(log_queue, &record, portMAX_DELAY);
+
+        size_t used = 0;
+        do {
+            int len = format_record(batch + used, sizeof(batch) - used, &record);
+            if (len < 0) {
+                // Batch full: flush it and format the record again at the start
+                fwrite(batch, 1, used, stdout);
+                used = 0;
+                len = format_record(batch, sizeof(batch), &record);
+                if (len < 0) {
+                    continue;
+                }
+            }
+            used += (size_t)len;
+        } while (xQueueReceive(log_queue, &record, 0) == pdPASS);
+
+        uint32_t drops = dropped_records;
+        if (drops != reported_drops) {
+            int len = snprintf(batch + used, sizeof(batch) - used,
+                COLOR_RED "[Logger] %lu record(s) dropped, queue full\n" COLOR_RESET,
+                (unsigned long)(drops - reported_drops));
+            if (len > 0 && used + (size_t)len < sizeof(batch)) {
+                used += (size_t)len;
+                reported_drops = drops;
+            }
+        }
+
+        fwrite(batch, 1, used, stdout);
+        fflush(stdout);
+    }
+}
+
+/**
+ * @brief Create the log queue and the logger task.
+ * @param station_names Name of each station id.
+ * @param num_stations Number of entries in station_names.
+ * @param events Color and format of each event id.
+ * @param num_events Number of entries in events.
+ * @return true on success.
+ */
+bool event_log_start(const char* const* station_names, int num_stations,
+                     const LogEventFormat* events, int num_events) {
+    log_station_names = station_names;
+    log_num_stations = num_stations;
+    log_events = events;
+    log_num_events = num_events;
+
+    log_queue = arena_queue_create(LOG_QUEUE_LENGTH, sizeof(LogRecord));
+    if (log_queue == NULL) {
+        return false;
+    }
+
+    return arena_task_create(task_logger, "Logger",
+        configMINIMAL_STACK_SIZE * 2, NULL, LOG_TASK_PRIORITY, ARENA_ANY_CORE) != NULL;
+}
@@ -0,0 +1,52 @@
+/*
+ * Asynchronous event log for the manufacturing process control demo.
+ *
+ * Producers never format text and never block: log_event() packs a small
+ * binary record (timestamp, station id, event id, two arguments) and posts
+ * it to a queue with a zero timeout. A low-priority logger task formats the
+ * records from the application's event table and writes them to the console
+ * in batches. Records that do not fit in the queue are counted and reported
+ * by the logger instead of stalling the caller.
+ */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Windows console color support */
+#define COLOR_RESET   "\x1b[0m"
+#define COLOR_RED     "\x1b[31m"
+#define COLOR_GREEN   "\x1b[32m"
+#define COLOR_YELLOW  "\x1b[33m"
+#define COLOR_BLUE    "\x1b[34m"
+#define COLOR_MAGENTA "\x1b[35m"
+#define COLOR_CYAN    "\x1b[36m"
+
+#define LOG_QUEUE_LENGTH 64
+#define LOG_BATCH_BUFFER 4096
+#define LOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+
+typedef struct {
+    TickType_t timestamp;          // Tick count when the event was raised
+    uint8_t station;               // Index into the station name table
+    uint8_t event;                 // Index into the event format table
+    uint16_t reserved;
+    int32_t args[2];               // Arguments for the event's format string
+} LogRecord;
+
+typedef struct {
+    const char* color;             // ANSI color for the line
+    const char* format;            // printf format taking up to two ints
+} LogEventFormat;
+
+bool event_log_start(const char* const* station_names, int num_stations,
+                     const LogEventFormat* events, int num_events);
+void log_event(uint8_t station, uint8_t event, int32_t arg0, int32_t arg1);
+void log_event_from_isr(uint8_t station, uint8_t event, int32_t arg0, int32_t arg1);
+uint32_t event_log_dropped(void);
+
+#endif /* EVENT_LOG_H */
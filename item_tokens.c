@@ -0,0 +1,730 @@
+/*
+ * Colored tokens: pooled item records that follow the tokens through the
+ * net. See item_tokens.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "item_tokens.h"
+#include "json_writer.h"
+#include "petri_net.h"
+#include "station_clock.h"
+
+#if PETRI_COLORED_TOKENS
+
+#define ITEM_NONE 0xFFFFu
+#define ITEM_NO_TIME UINT32_MAX
+
+#if ITEM_POOL_SIZE >= ITEM_NONE
+#error "Item handles are 16 bits; ITEM_POOL_SIZE must stay below 65535"
+#endif
+
+typedef struct {
+    uint32_t id;
+    uint32_t created_ms;           // For a parent, that of its oldest child
+    uint32_t stage_ms[ITEM_MAX_STAGES];    // First arrival at each stage place, or ITEM_NO_TIME
+    uint16_t next;                 // Next item in the same place, among its siblings, or in the free list
+    uint16_t first_child;
+    uint16_t parent;
+    uint16_t reworks;              // Visits to the rework place, children included
+    uint16_t units;                // Items made from outside the net, children included
+} ItemRecord;
+
+/* Head and tail of the items in one place, oldest first. */
+typedef struct {
+    uint16_t head;
+    uint16_t tail;
+} ItemQueue;
+
+/* A finished item as kept for /items. */
+typedef struct {
+    uint32_t id;
+    uint32_t created_ms;
+    uint32_t done_ms;
+    uint32_t stage_ms[ITEM_MAX_STAGES];
+    uint16_t reworks;
+    uint16_t units;
+    uint16_t num_children;
+    uint32_t children[ITEM_MAX_CHILDREN];
+} ItemSummary;
+
+/*
+ * Totals of one line, written inside its critical section and read by the
+ * status server's I/O thread under the seqlock.
+ */
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t finished;             // Items that reached a sink place
+    uint32_t units;                // Units in them, each with its own lead time
+    uint64_t lead_sum_ms;
+    uint32_t lead_min_ms;
+    uint32_t lead_max_ms;
+    uint32_t reworks;
+    uint64_t stage_sum_ms[ITEM_MAX_STAGES];    // From creation to the stage, over finished items
+    uint32_t stage_count[ITEM_MAX_STAGES];
+    uint32_t history_next;
+    ItemSummary history[ITEM_HISTORY];
+} ItemLineStats;
+
+static ItemRecord pool[ITEM_POOL_SIZE];
+static volatile LONG free_head;        // (tag << 16) | handle of the first free record
+static volatile LONG next_id = 0;
+static volatile LONG in_use = 0;
+static volatile LONG peak_in_use = 0;
+static volatile LONG untracked = 0;    // Tokens made while the pool was empty
+
+static ItemQueue queues[PETRI_MAX_LINES][MAX_PLACES];
+static ItemLineStats line_stats[PETRI_MAX_LINES];
+
+static uint32_t resource_places[PLACE_MASK_WORDS];
+static uint32_t sink_places[PLACE_MASK_WORDS];
+static int8_t stage_of[MAX_PLACES];
+static int stage_places[ITEM_MAX_STAGES];
+static int num_stages = 0;
+static int rework_place = -1;
+static bool configured = false;
+
+static inline bool place_bit(const uint32_t* mask, int place_idx) {
+    return (mask[place_idx >> 5] & (1u << (place_idx & 31))) != 0;
+}
+
+/**
+ * @brief Line whose queue holds a place's items; a shared place uses line 0's.
+ */
+static inline int item_line(const PetriNet* net, int place_idx) {
+    return is_shared_place(place_idx) ? 0 : net->line;
+}
+
+static uint32_t item_now_ms(bool from_isr) {
+    if (from_isr && !station_clock_is_virtual()) {
+        return (uint32_t)(xTaskGetTickCountFromISR() * portTICK_PERIOD_MS);
+    }
+    return station_now_ms();
+}
+
+// ====================
+// RECORD POOL
+// ====================
+
+/*
+ * Treiber stack of free records. The head carries a tag that every push
+ * and pop bumps, so a head that was popped and pushed back in between does
+ * not fool the compare-and-swap. Lines on different cores and the keyboard
+ * interrupt allocate without sharing a lock.
+ */
+static uint16_t item_alloc(void) {
+    for (;;) {
+        LONG head = free_head;
+        uint16_t handle = (uint16_t)((uint32_t)head & 0xFFFFu);
+        if (handle == ITEM_NONE) {
+            InterlockedIncrement(&untracked);
+            return ITEM_NONE;
+        }
+        LONG next = (LONG)((((uint32_t)head & 0xFFFF0000u) + 0x10000u) | pool[handle].next);
+        if (InterlockedCompareExchange(&free_head, next, head) == head) {
+            LONG used = InterlockedIncrement(&in_use);
+            LONG peak = peak_in_use;
+            while (used > peak && InterlockedCompareExchange(&peak_in_use, used, peak) != peak) {
+                peak = peak_in_use;
+            }
+            return handle;
+        }
+    }
+}
+
+static void item_release(uint16_t handle) {
+    for (;;) {
+        LONG head = free_head;
+        pool[handle].next = (uint16_t)((uint32_t)head & 0xFFFFu);
+        LONG next = (LONG)((((uint32_t)head & 0xFFFF0000u) + 0x10000u) | handle);
+        if (InterlockedCompareExchange(&free_head, next, head) == head) {
+            InterlockedDecrement(&in_use);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Take a fresh record for a unit entering the net.
+ * @return Its handle, or ITEM_NONE if the pool is empty.
+ */
+static uint16_t item_create(uint32_t now_ms) {
+    uint16_t handle = item_alloc();
+    if (handle == ITEM_NONE) {
+        return ITEM_NONE;
+    }
+
+    ItemRecord* item = &pool[handle];
+    item->id = (uint32_t)InterlockedIncrement(&next_id);
+    item->created_ms = now_ms;
+    for (int s = 0; s < ITEM_MAX_STAGES; s++) {
+        item->stage_ms[s] = ITEM_NO_TIME;
+    }
+    item->next = ITEM_NONE;
+    item->first_child = ITEM_NONE;
+    item->parent = ITEM_NONE;
+    item->reworks = 0;
+    item->units = 1;
+    return handle;
+}
+
+/**
+ * @brief Return an item and everything linked under it to the pool.
+ */
+static void item_release_tree(uint16_t root) {
+    uint16_t current = root;
+
+    while (current != ITEM_NONE) {
+        uint16_t child = pool[current].first_child;
+        if (child != ITEM_NONE) {
+            pool[current].first_child = pool[child].next;
+            current = child;
+            continue;
+        }
+        uint16_t up = current == root ? ITEM_NONE : pool[current].parent;
+        item_release(current);
+        current = up;
+    }
+}
+
+// ====================
+// MOVING ITEMS
+// ====================
+
+static uint16_t queue_pop_locked(ItemQueue* queue) {
+    uint16_t handle = queue->head;
+
+    if (handle != ITEM_NONE) {
+        queue->head = pool[handle].next;
+        if (queue->head == ITEM_NONE) {
+            queue->tail = ITEM_NONE;
+        }
+        pool[handle].next = ITEM_NONE;
+    }
+    return handle;
+}
+
+static void queue_push_locked(ItemQueue* queue, uint16_t handle) {
+    pool[handle].next = ITEM_NONE;
+    if (queue->tail == ITEM_NONE) {
+        queue->head = handle;
+    } else {
+        pool[queue->tail].next = handle;
+    }
+    queue->tail = handle;
+}
+
+/**
+ * @brief Record an item that reached a sink place and free its records.
+ * Caller must be inside the line's critical section.
+ */
+static void finish_item_locked(int line, uint16_t handle, uint32_t now_ms) {
+    ItemLineStats* stats = &line_stats[line];
+    const ItemRecord* item = &pool[handle];
+
+    stats->seq++;
+    NET_MEMORY_BARRIER();
+
+    stats->finished++;
+    stats->reworks += item->reworks;
+    for (int s = 0; s < num_stages; s++) {
+        if (item->stage_ms[s] != ITEM_NO_TIME) {
+            stats->stage_sum_ms[s] += item->stage_ms[s] - item->created_ms;
+            stats->stage_count[s]++;
+        }
+    }
+
+    ItemSummary* summary = &stats->history[stats->history_next % ITEM_HISTORY];
+    stats->history_next++;
+    summary->id = item->id;
+    summary->created_ms = item->created_ms;
+    summary->done_ms = now_ms;
+    memcpy(summary->stage_ms, item->stage_ms, sizeof(summary->stage_ms));
+    summary->reworks = item->reworks;
+    summary->units = item->units;
+    summary->num_children = 0;
+    for (uint16_t c = item->first_child; c != ITEM_NONE && summary->num_children < ITEM_MAX_CHILDREN;
+            c = pool[c].next) {
+        summary->children[summary->num_children++] = pool[c].id;
+    }
+
+    // Every unit linked under the item has a lead time of its own
+    uint16_t current = handle;
+    while (current != ITEM_NONE) {
+        if (pool[current].first_child != ITEM_NONE) {
+            current = pool[current].first_child;
+            continue;
+        }
+        uint32_t lead = now_ms - pool[current].created_ms;
+        stats->units++;
+        stats->lead_sum_ms += lead;
+        if (stats->units == 1 || lead < stats->lead_min_ms) {
+            stats->lead_min_ms = lead;
+        }
+        if (lead > stats->lead_max_ms) {
+            stats->lead_max_ms = lead;
+        }
+        // Next leaf: the nearest sibling on the way back up
+        while (current != handle && pool[current].next == ITEM_NONE) {
+            current = pool[current].parent;
+        }
+        current = current == handle ? ITEM_NONE : pool[current].next;
+    }
+
+    NET_MEMORY_BARRIER();
+    stats->seq++;
+
+    item_release_tree(handle);
+}
+
+/**
+ * @brief Put an item into a place: stamp its stage, count a rework, or
+ * finish it if nothing consumes from the place.
+ * Caller must be inside the critical section guarding the place.
+ */
+static void item_arrive_locked(const PetriNet* net, int place_idx, uint16_t handle, uint32_t now_ms) {
+    ItemRecord* item = &pool[handle];
+
+    int stage = stage_of[place_idx];
+    if (stage >= 0 && item->stage_ms[stage] == ITEM_NO_TIME) {
+        item->stage_ms[stage] = now_ms;
+    }
+    if (place_idx == rework_place) {
+        item->reworks++;
+    }
+    if (place_bit(sink_places, place_idx)) {
+        finish_item_locked(net->line, handle, now_ms);
+        return;
+    }
+    queue_push_locked(&queues[item_line(net, place_idx)][place_idx], handle);
+}
+
+/**
+ * @brief Link consumed items under one parent, made fresh from the pool or,
+ * if it is empty, the first of them.
+ * @param children First of count items chained through next.
+ */
+static uint16_t item_merge(uint16_t children, int count, uint32_t now_ms) {
+    uint16_t parent = item_alloc();
+    uint16_t child = children;
+
+    if (parent == ITEM_NONE) {
+        parent = children;
+        child = pool[children].next;
+        pool[parent].next = ITEM_NONE;
+        count--;
+    } else {
+        ItemRecord* fresh = &pool[parent];
+        fresh->id = (uint32_t)InterlockedIncrement(&next_id);
+        fresh->created_ms = now_ms;
+        for (int s = 0; s < ITEM_MAX_STAGES; s++) {
+            fresh->stage_ms[s] = ITEM_NO_TIME;
+        }
+        fresh->next = ITEM_NONE;
+        fresh->first_child = ITEM_NONE;
+        fresh->parent = ITEM_NONE;
+        fresh->reworks = 0;
+        fresh->units = 0;
+    }
+
+    // The parent has been wherever its oldest child has
+    ItemRecord* item = &pool[parent];
+    for (int i = 0; i < count && child != ITEM_NONE; i++) {
+        uint16_t next = pool[child].next;
+        const ItemRecord* part = &pool[child];
+        if ((int32_t)(part->created_ms - item->created_ms) < 0) {
+            item->created_ms = part->created_ms;
+        }
+        for (int s = 0; s < num_stages; s++) {
+            if (part->stage_ms[s] < item->stage_ms[s]) {
+                item->stage_ms[s] = part->stage_ms[s];
+            }
+        }
+        item->reworks += part->reworks;
+        item->units += part->units;
+
+        pool[child].parent = parent;
+        pool[child].next = item->first_child;
+        item->first_child = child;
+        child = next;
+    }
+    return parent;
+}
+
+/**
+ * @brief Move the items of count firings of a transition. Called after
+ * the marking update, inside the same critical section.
+ */
+void item_tokens_firing_locked(const PetriNet* net, int trans_idx, int count) {
+    if (!configured) {
+        return;
+    }
+
+    uint32_t now_ms = item_now_ms(false);
+
+    for (int k = 0; k < count; k++) {
+        uint16_t taken = ITEM_NONE;
+        uint16_t* taken_tail = &taken;
+        int in_tokens = 0;
+        int out_tokens = 0;
+
+        // Take the oldest items off every tracked input, in arc order
+        for (int a = net->in_start[trans_idx]; a < net->in_start[trans_idx + 1]; a++) {
+            int place = net->in_arcs[a].place;
+            if (place_bit(resource_places, place)) {
+                continue;
+            }
+            ItemQueue* queue = &queues[item_line(net, place)][place];
+            for (int w = 0; w < net->in_arcs[a].weight; w++) {
+                uint16_t handle = queue_pop_locked(queue);
+                in_tokens++;
+                if (handle != ITEM_NONE) {
+                    *taken_tail = handle;
+                    taken_tail = &pool[handle].next;
+                }
+            }
+        }
+        for (int a = net->out_start[trans_idx]; a < net->out_start[trans_idx + 1]; a++) {
+            if (!place_bit(resource_places, net->out_arcs[a].place)) {
+                out_tokens += net->out_arcs[a].weight;
+            }
+        }
+
+        // Consumed into nothing but resources: the items leave the line here
+        if (out_tokens == 0) {
+            while (taken != ITEM_NONE) {
+                uint16_t next = pool[taken].next;
+                pool[taken].next = ITEM_NONE;
+                finish_item_locked(net->line, taken, now_ms);
+                taken = next;
+            }
+            continue;
+        }
+
+        // Deal the consumed tokens out over the output tokens; the last takes any remainder
+        int group = in_tokens > out_tokens ? in_tokens / out_tokens : 1;
+        int left = in_tokens;
+        int produced = 0;
+        for (int a = net->out_start[trans_idx]; a < net->out_start[trans_idx + 1]; a++) {
+            int place = net->out_arcs[a].place;
+            if (place_bit(resource_places, place)) {
+                continue;
+            }
+            for (int w = 0; w < net->out_arcs[a].weight; w++) {
+                int share = ++produced == out_tokens ? left : (left < group ? left : group);
+                uint16_t handle;
+
+                if (share == 0) {
+                    handle = item_create(now_ms);
+                } else if (share == 1 || taken == ITEM_NONE) {
+                    handle = taken;
+                    if (taken != ITEM_NONE) {
+                        taken = pool[taken].next;
+                        pool[handle].next = ITEM_NONE;
+                    }
+                } else {
+                    // Find the end of this group, cut it off and link it under a parent
+                    uint16_t last = taken;
+                    int found = 1;
+                    while (found < share && pool[last].next != ITEM_NONE) {
+                        last = pool[last].next;
+                        found++;
+                    }
+                    uint16_t rest = pool[last].next;
+                    pool[last].next = ITEM_NONE;
+                    handle = found == 1 ? taken : item_merge(taken, found, now_ms);
+                    taken = rest;
+                    pool[handle].next = ITEM_NONE;
+                }
+                left -= share;
+
+                if (handle != ITEM_NONE) {
+                    item_arrive_locked(net, place, handle, now_ms);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Make an item for each token added from outside the net.
+ * Stops at the first token the pool has no record for and counts the rest
+ * as untracked in one step, so a huge count costs at most ITEM_POOL_SIZE
+ * passes inside the critical section.
+ */
+static void add_items_locked(const PetriNet* net, int place_idx, int count, uint32_t now_ms) {
+    if (place_bit(resource_places, place_idx)) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        uint16_t handle = item_create(now_ms);
+        if (handle == ITEM_NONE) {
+            // item_alloc() already counted this token
+            InterlockedExchangeAdd(&untracked, (LONG)(count - i - 1));
+            return;
+        }
+        item_arrive_locked(net, place_idx, handle, now_ms);
+    }
+}
+
+/**
+ * @brief Drop the oldest items of a place whose tokens were taken out from
+ * outside the net. They never finish, so they leave no lead time behind.
+ * A queue never holds more than ITEM_POOL_SIZE items, so that bounds the
+ * loop whatever the count.
+ */
+static void remove_items_locked(const PetriNet* net, int place_idx, int count) {
+    if (place_bit(resource_places, place_idx)) {
+        return;
+    }
+    ItemQueue* queue = &queues[item_line(net, place_idx)][place_idx];
+    if (count > ITEM_POOL_SIZE) {
+        count = ITEM_POOL_SIZE;
+    }
+    for (int i = 0; i < count; i++) {
+        uint16_t handle = queue_pop_locked(queue);
+        if (handle == ITEM_NONE) {
+            return;
+        }
+        item_release_tree(handle);
+    }
+}
+
+/**
+ * @brief Make items for tokens added from outside the net, or drop items
+ * for a negative count. Called after the marking update, inside the same
+ * critical section.
+ */
+void item_tokens_added_locked(const PetriNet* net, int place_idx, int count, bool from_isr) {
+    if (!configured) {
+        return;
+    }
+    if (count < 0) {
+        remove_items_locked(net, place_idx, -count);
+    } else {
+        add_items_locked(net, place_idx, count, item_now_ms(from_isr));
+    }
+}
+
+// ====================
+// CONFIGURATION
+// ====================
+
+/**
+ * @brief Keep items off a place whose tokens are a resource, such as a worker.
+ * @return true on success.
+ */
+bool item_tokens_set_resource_place(int place_idx) {
+    if (configured || place_idx < 0 || place_idx >= MAX_PLACES) {
+        printf("ERROR: Cannot make place %d a resource place for items\n", place_idx);
+        return false;
+    }
+    resource_places[place_idx >> 5] |= 1u << (place_idx & 31);
+    return true;
+}
+
+/**
+ * @brief Record each item's first arrival at a place.
+ * @return true on success.
+ */
+bool item_tokens_add_stage(int place_idx) {
+    if (configured || place_idx < 0 || place_idx >= MAX_PLACES) {
+        printf("ERROR: Cannot make place %d an item stage\n", place_idx);
+        return false;
+    }
+    if (num_stages >= ITEM_MAX_STAGES) {
+        printf("ERROR: More than %d item stages\n", ITEM_MAX_STAGES);
+        return false;
+    }
+    stage_places[num_stages++] = place_idx;
+    return true;
+}
+
+/**
+ * @brief Count every arrival of an item at a place as one rework loop.
+ * @return true on success.
+ */
+bool item_tokens_set_rework_place(int place_idx) {
+    if (configured || place_idx < 0 || place_idx >= MAX_PLACES) {
+        printf("ERROR: Cannot make place %d the rework place\n", place_idx);
+        return false;
+    }
+    rework_place = place_idx;
+    return true;
+}
+
+/**
+ * @brief Fill the pool and give every token of the initial marking an item.
+ * Call after instantiate_net_lines() and before the scheduler starts.
+ * @return true on success.
+ */
+bool item_tokens_init(void) {
+    const PetriModel* model = &manufacturing_model;
+
+    for (int i = 0; i < ITEM_POOL_SIZE; i++) {
+        pool[i].next = (uint16_t)(i + 1 < ITEM_POOL_SIZE ? (unsigned)(i + 1) : ITEM_NONE);
+    }
+    free_head = 0;
+    next_id = 0;
+    in_use = 0;
+    peak_in_use = 0;
+    untracked = 0;
+
+    for (int p = 0; p < MAX_PLACES; p++) {
+        stage_of[p] = -1;
+    }
+    for (int s = 0; s < num_stages; s++) {
+        stage_of[stage_places[s]] = (int8_t)s;
+    }
+    memset(sink_places, 0, sizeof(sink_places));
+    for (int p = 0; p < model->num_places; p++) {
+        if (model->consumer_start[p] == model->consumer_start[p + 1]) {
+            sink_places[p >> 5] |= 1u << (p & 31);
+        }
+    }
+    for (int l = 0; l < PETRI_MAX_LINES; l++) {
+        for (int p = 0; p < MAX_PLACES; p++) {
+            queues[l][p].head = ITEM_NONE;
+            queues[l][p].tail = ITEM_NONE;
+        }
+        memset(&line_stats[l], 0, sizeof(line_stats[l]));
+    }
+    configured = true;
+
+    for (int l = 0; l < petri_num_lines; l++) {
+        const PetriNet* net = &petri_lines[l];
+        for (int p = 0; p < model->num_places; p++) {
+            // Shared places start with the net's marking once
+            if (is_shared_place(p) && l > 0) {
+                continue;
+            }
+            // Made at time 0, where both the tick count and the virtual clock start
+            add_items_locked(net, p, get_place_tokens(net, p), 0);
+        }
+    }
+    return true;
+}
+
+// ====================
+// READING (I/O THREAD)
+// ====================
+
+/**
+ * @brief Copy a line's totals without blocking the line.
+ */
+static void read_line_stats(int line, ItemLineStats* out) {
+    const ItemLineStats* stats = &line_stats[line];
+    uint32_t before;
+    uint32_t after;
+
+    do {
+        before = stats->seq;
+        NET_MEMORY_BARRIER();
+        memcpy(out, (const void*)stats, sizeof(*out));
+        NET_MEMORY_BARRIER();
+        after = stats->seq;
+    } while ((before & 1u) != 0 || before != after);
+}
+
+static void json_offsets(JsonWriter* out, const uint32_t* stage_ms, uint32_t created_ms) {
+    json_append(out, "[");
+    for (int s = 0; s < num_stages; s++) {
+        if (stage_ms[s] == ITEM_NO_TIME) {
+            json_append(out, "null%s", s + 1 < num_stages ? "," : "");
+        } else {
+            json_append(out, "%lu%s", (unsigned long)(stage_ms[s] - created_ms), s + 1 < num_stages ? "," : "");
+        }
+    }
+    json_append(out, "]");
+}
+
+/**
+ * @brief Render GET /items: pool use, per-line lead times and the newest
+ * finished items. Safe to call from a native thread.
+ * @return Length written, or -1 if the buffer is too small.
+ */
+int item_tokens_render(char* buffer, size_t size) {
+    static ItemLineStats stats;
+    const PetriModel* model = &manufacturing_model;
+    JsonWriter out = { buffer, (int)size, 0 };
+
+    json_append(&out, "{\"pool\":{\"size\":%d,\"in_use\":%ld,\"peak\":%ld,\"untracked\":%ld},\"stages\":[",
+        ITEM_POOL_SIZE, (long)in_use, (long)peak_in_use, (long)untracked);
+    for (int s = 0; s < num_stages; s++) {
+        json_append(&out, "%s", s ? "," : "");
+        json_append_string(&out, model->places[stage_places[s]].name);
+    }
+    json_append(&out, "],\"lines\":[");
+
+    for (int l = 0; l < petri_num_lines; l++) {
+        read_line_stats(l, &stats);
+        json_append(&out, "%s{\"line\":%d,\"finished\":%lu,\"units\":%lu,\"lead_ms\":{\"avg\":%.1f,\"min\":%lu,\"max\":%lu},"
+            "\"reworks\":%lu,\"stage_avg_ms\":[",
+            l > 0 ? "," : "", l + 1, (unsigned long)stats.finished, (unsigned long)stats.units,
+            stats.units > 0 ? (double)stats.lead_sum_ms / stats.units : 0.0,
+            (unsigned long)stats.lead_min_ms, (unsigned long)stats.lead_max_ms, (unsigned long)stats.reworks);
+        for (int s = 0; s < num_stages; s++) {
+            if (stats.stage_count[s] == 0) {
+                json_append(&out, "null%s", s + 1 < num_stages ? "," : "");
+            } else {
+                json_append(&out, "%.1f%s", (double)stats.stage_sum_ms[s] / stats.stage_count[s],
+                    s + 1 < num_stages ? "," : "");
+            }
+        }
+        json_append(&out, "],\"recent\":[");
+
+        // Newest first
+        uint32_t kept = stats.history_next < ITEM_HISTORY ? stats.history_next : ITEM_HISTORY;
+        for (uint32_t i = 0; i < kept; i++) {
+            const ItemSummary* item = &stats.history[(stats.history_next - 1 - i) % ITEM_HISTORY];
+            json_append(&out, "%s{\"id\":%lu,\"units\":%u,\"created_ms\":%lu,\"done_ms\":%lu,\"lead_ms\":%lu,"
+                "\"reworks\":%u,\"stages_ms\":",
+                i > 0 ? "," : "", (unsigned long)item->id, (unsigned)item->units,
+                (unsigned long)item->created_ms, (unsigned long)item->done_ms,
+                (unsigned long)(item->done_ms - item->created_ms), (unsigned)item->reworks);
+            json_offsets(&out, item->stage_ms, item->created_ms);
+            json_append(&out, ",\"children\":[");
+            for (int c = 0; c < item->num_children; c++) {
+                json_append(&out, "%lu%s", (unsigned long)item->children[c], c + 1 < item->num_children ? "," : "");
+            }
+            json_append(&out, "]}");
+        }
+        json_append(&out, "]}");
+    }
+    json_append(&out, "]}");
+
+    return json_complete(&out) ? out.len : -1;
+}
+
+/**
+ * @brief Print lead times per line, e.g. after a simulation.
+ */
+void item_tokens_print_report(void) {
+    static ItemLineStats stats;
+    const PetriModel* model = &manufacturing_model;
+
+    printf("%-8s %8s %8s %10s %10s %10s %8s\n", "Line", "items", "units", "avg lead", "min lead", "max lead", "reworks");
+    for (int l = 0; l < petri_num_lines; l++) {
+        read_line_stats(l, &stats);
+        printf("L%-7d %8lu %8lu %9.1fs %9.1fs %9.1fs %8lu\n", l + 1,
+            (unsigned long)stats.finished, (unsigned long)stats.units,
+            stats.units > 0 ? (double)stats.lead_sum_ms / stats.units / 1000.0 : 0.0,
+            stats.lead_min_ms / 1000.0, stats.lead_max_ms / 1000.0, (unsigned long)stats.reworks);
+        for (int s = 0; s < num_stages; s++) {
+            if (stats.stage_count[s] > 0) {
+                printf("         reaches %-28s after %8.1fs\n", model->places[stage_places[s]].name,
+                    (double)stats.stage_sum_ms[s] / stats.stage_count[s] / 1000.0);
+            }
+        }
+    }
+    printf("Item pool: %ld of %d records in use, peak %ld, %ld tokens untracked\n\n",
+        (long)in_use, ITEM_POOL_SIZE, (long)peak_in_use, (long)untracked);
+    fflush(stdout);
+}
+
+#endif /* PETRI_COLORED_TOKENS */
@@ -0,0 +1,79 @@
+/*
+ * Colored tokens: a record per workpiece that rides on the net's tokens.
+ *
+ * In PETRI_COLORED_TOKENS builds every token of a tracked place carries a
+ * handle to an item record (id, creation time, first arrival at each stage
+ * place, rework count). Records come from a fixed pool with a lock-free
+ * free list, and each place of each line keeps its items in a FIFO linked
+ * through the records, so firing allocates nothing. The hooks run inside
+ * the firing's critical section and move items along the arcs:
+ *
+ *  - as many tokens in as out: items move across in arc order, oldest first
+ *  - more in than out (e.g. two parts assembled into one, five units into a
+ *    bulk package): each output token gets a new parent item with the
+ *    consumed items linked under it; the parent starts at its oldest child
+ *  - fewer in than out, or tokens added from outside: new items are made
+ *
+ * Resource places (item_tokens_set_resource_place(), e.g. Worker) carry no
+ * items. An item that reaches a place no transition consumes from is done:
+ * its lead time and that of every unit linked under it are recorded, it is
+ * kept in a short history, and its records go back to the pool. The
+ * totals and the history are served as JSON at GET /items.
+ *
+ * When the pool runs dry, tokens go on without an item, and the shortfall
+ * is counted. Configure the places before item_tokens_init(), which runs
+ * after the lines are instantiated and before the scheduler starts.
+ */
+
+#ifndef ITEM_TOKENS_H
+#define ITEM_TOKENS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PETRI_COLORED_TOKENS
+#define PETRI_COLORED_TOKENS 0
+#endif
+
+#define ITEM_POOL_SIZE 1024            // Records for every line; 16-bit handles
+#define ITEM_MAX_STAGES 8              // Stage places whose first arrival each item records
+#define ITEM_HISTORY 32                // Finished items kept per line for /items
+#define ITEM_MAX_CHILDREN 8            // Children listed per finished item
+#define ITEM_JSON_BUFFER (32 * 1024)
+
+struct PetriNet;                       // petri_net.h
+
+#if PETRI_COLORED_TOKENS
+
+bool item_tokens_set_resource_place(int place_idx);
+bool item_tokens_add_stage(int place_idx);
+bool item_tokens_set_rework_place(int place_idx);
+bool item_tokens_init(void);
+
+void item_tokens_firing_locked(const struct PetriNet* net, int trans_idx, int count);
+void item_tokens_added_locked(const struct PetriNet* net, int place_idx, int count, bool from_isr);
+
+int item_tokens_render(char* buffer, size_t size);
+void item_tokens_print_report(void);
+
+#else
+
+static inline bool item_tokens_set_resource_place(int place_idx) { (void)place_idx; return true; }
+static inline bool item_tokens_add_stage(int place_idx) { (void)place_idx; return true; }
+static inline bool item_tokens_set_rework_place(int place_idx) { (void)place_idx; return true; }
+static inline bool item_tokens_init(void) { return true; }
+
+static inline void item_tokens_firing_locked(const struct PetriNet* net, int trans_idx, int count) {
+    (void)net; (void)trans_idx; (void)count;
+}
+static inline void item_tokens_added_locked(const struct PetriNet* net, int place_idx, int count, bool from_isr) {
+    (void)net; (void)place_idx; (void)count; (void)from_isr;
+}
+
+static inline int item_tokens_render(char* buffer, size_t size) { (void)buffer; (void)size; return -1; }
+static inline void item_tokens_print_report(void) {}
+
+#endif
+
+#endif /* ITEM_TOKENS_H */
@@ -0,0 +1,54 @@
+/*
+ * Bounded JSON text writer. See json_writer.h.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "json_writer.h"
+
+void json_append(JsonWriter* out, const char* fmt, ...) {
+    if (out->len >= out->size) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(out->buffer + out->len, out->size - out->len, fmt, args);
+    va_end(args);
+    out->len = (written < 0) ? out->size : out->len + written;
+}
+
+void json_append_string(JsonWriter* out, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    char escape[6] = { '\\', 'u', '0', '0', 0, 0 };
+
+    json_append(out, "\"");
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0' && out->len < out->size; c++) {
+        const char* piece = (const char*)c;
+        int piece_len = 1;
+
+        if (*c == '"' || *c == '\\') {
+            escape[1] = (char)*c;
+            piece = escape;
+            piece_len = 2;
+        } else if (*c < 0x20) {
+            escape[1] = 'u';
+            escape[4] = hex[*c >> 4];
+            escape[5] = hex[*c & 0xF];
+            piece = escape;
+            piece_len = 6;
+        }
+
+        if (out->len + piece_len >= out->size) {
+            // Never leave half an escape behind
+            out->buffer[out->len] = '\0';
+            out->len = out->size;
+            return;
+        }
+        for (int i = 0; i < piece_len; i++) {
+            out->buffer[out->len++] = piece[i];
+        }
+        out->buffer[out->len] = '\0';
+    }
+    json_append(out, "\"");
+}
@@ -0,0 +1,46 @@
+/*
+ * Bounded text writer shared by the status server and the modules that
+ * render documents for it: the JSON of analysis and colored tokens, and the
+ * Prometheus text of /metrics, which only uses json_append().
+ *
+ * The writer appends into a caller-owned buffer and never writes past it.
+ * Once the buffer is full further appends are dropped and len stays at or
+ * above size, so a caller checks for truncation once at the end instead of
+ * after every call.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+
+// Longest JSON string, quotes included, that json_append_string() makes of len bytes
+#define JSON_STRING_MAX(len) (6 * (len) + 2)
+
+typedef struct {
+    char* buffer;
+    int size;
+    int len;                           // Bytes written; >= size once anything was dropped
+} JsonWriter;
+
+/**
+ * @brief Append printf-style text. Dropped once the buffer is full.
+ */
+void json_append(JsonWriter* out, const char* fmt, ...);
+
+/**
+ * @brief Append text as a quoted JSON string, escaping quotes, backslashes
+ * and control characters. Bytes from 0x80 up pass through, so UTF-8 names
+ * stay readable.
+ */
+void json_append_string(JsonWriter* out, const char* text);
+
+/**
+ * @brief True if every append so far fit, i.e. buffer holds a complete,
+ * NUL-terminated document of len bytes.
+ */
+static inline bool json_complete(const JsonWriter* out) {
+    return out->len < out->size;
+}
+
+#endif // JSON_WRITER_H
@@ -81,6 +81,14 @@
  * implemented and described in main_full.c. */
 #define mainCREATE_SIMPLE_BLINKY_DEMO_ONLY    1
 
+/* benchmark\benchmark.vcxproj builds this file with PETRI_BENCHMARK set to 1,
+ * in which case main() runs the headless benchmark in benchmark\petri_bench.c
+ * instead of either demo, and the trace recorder is left disabled so that it
+ * does not add to the measured times. */
+#ifndef PETRI_BENCHMARK
+    #define PETRI_BENCHMARK                   0
+#endif
+
 /* This demo uses heap_5.c, and these constants define the sizes of the regions
  * that make up the total heap.  heap_5 is only used for test and example purposes
  * as this demo could easily create one large heap region instead of multiple
@@ -106,6 +114,7 @@
  */
 extern void main_blinky( void );
 extern void main_full( void );
+extern void main_benchmark( void );
 
 /*
  * Only the comprehensive demo uses application hook (callback) functions.  See
@@ -194,17 +203,29 @@ int main( void )
 
     configASSERT( xTraceInitialize() == TRC_SUCCESS );
 
-    /* Start the trace recording - the recording is written to a file if
-     * configASSERT() is called. */
-    printf(
-        "Trace started.\r\n"
-        "The trace will be dumped to the file \"%s\" whenever a call to configASSERT()\r\n"
-        "fails or the \'%c\' key is pressed.\r\n"
-        "Note that the trace output uses the ring buffer mode, meaning that the output trace\r\n"
-        "will only be the most recent data able to fit within the trace recorder buffer.\r\n",
-        mainTRACE_FILE_NAME, mainOUTPUT_TRACE_KEY );
+#if ( PETRI_BENCHMARK == 0 )
+    #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT )
+        /* Start the trace recording - the recording is written to a file if
+         * configASSERT() is called. */
+        printf(
+            "Trace started.\r\n"
+            "The trace will be dumped to the file \"%s\" whenever a call to configASSERT()\r\n"
+            "fails or the \'%c\' key is pressed.\r\n"
+            "Note that the trace output uses the ring buffer mode, meaning that the output trace\r\n"
+            "will only be the most recent data able to fit within the trace recorder buffer.\r\n",
+            mainTRACE_FILE_NAME, mainOUTPUT_TRACE_KEY );
+    #else
+        /* Start the trace recording - the stream port in trcStreamPort.c
+         * writes it continuously to the file or socket named by
+         * PETRI_TRACE_STREAM. */
+        printf(
+            "Trace started.\r\n"
+            "The whole run is streamed to %s (set " TRC_CFG_STREAM_PORT_TARGET_ENV " to a file name or tcp:<port>).\r\n",
+            getenv( TRC_CFG_STREAM_PORT_TARGET_ENV ) != NULL ? getenv( TRC_CFG_STREAM_PORT_TARGET_ENV ) : TRC_CFG_STREAM_PORT_DEFAULT_FILE );
+    #endif
 
     configASSERT( xTraceEnable( TRC_START ) == TRC_SUCCESS );
+#endif /* PETRI_BENCHMARK == 0 */
 
     /* Set interrupt handler for keyboard input. */
     vPortSetInterruptHandler( mainINTERRUPT_NUMBER_KEYBOARD, prvKeyboardInterruptHandler );
@@ -223,7 +244,12 @@ int main( void )
 
     /* The mainCREATE_SIMPLE_BLINKY_DEMO_ONLY setting is described at the top
      * of this file. */
-    #if ( mainCREATE_SIMPLE_BLINKY_DEMO_ONLY == 1 )
+    #if ( PETRI_BENCHMARK == 1 )
+    {
+        printf( "\nStarting the benchmark.\r\n" );
+        main_benchmark();
+    }
+    #elif ( mainCREATE_SIMPLE_BLINKY_DEMO_ONLY == 1 )
     {
         printf( "\nStarting the blinky demo.\r\n" );
         main_blinky();
@@ -233,7 +259,7 @@ int main( void )
         printf( "\nStarting the full demo.\r\n" );
         main_full();
     }
-    #endif /* if ( mainCREATE_SIMPLE_BLINKY_DEMO_ONLY == 1 ) */
+    #endif /* if ( PETRI_BENCHMARK == 1 ) */
 
     return 0;
 }
@@ -361,20 +387,25 @@ void vAssertCalled( unsigned long ulLine,
 
 static void prvSaveTraceFile( void )
 {
-    FILE * pxOutputFile;
+    #if ( TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT )
+        FILE * pxOutputFile;
 
-    fopen_s( &pxOutputFile, mainTRACE_FILE_NAME, "wb" );
+        fopen_s( &pxOutputFile, mainTRACE_FILE_NAME, "wb" );
 
-    if( pxOutputFile != NULL )
-    {
-        fwrite( RecorderDataPtr, sizeof( RecorderDataType ), 1, pxOutputFile );
-        fclose( pxOutputFile );
-        printf( "\r\nTrace output saved to %s\r\n\r\n", mainTRACE_FILE_NAME );
-    }
-    else
-    {
-        printf( "\r\nFailed to create trace dump file\r\n\r\n" );
-    }
+        if( pxOutputFile != NULL )
+        {
+            fwrite( RecorderDataPtr, sizeof( RecorderDataType ), 1, pxOutputFile );
+            fclose( pxOutputFile );
+            printf( "\r\nTrace output saved to %s\r\n\r\n", mainTRACE_FILE_NAME );
+        }
+        else
+        {
+            printf( "\r\nFailed to create trace dump file\r\n\r\n" );
+        }
+    #else
+        /* A streaming trace is already on its way to the stream port. */
+        printf( "\r\nThe trace is being streamed; nothing to save\r\n\r\n" );
+    #endif
 }
 /*-----------------------------------------------------------*/
 
@@ -491,7 +522,7 @@ static uint32_t prvKeyboardInterruptHandler( void )
             break;
 
         default:
-            #if ( mainCREATE_SIMPLE_BLINKY_DEMO_ONLY == 1 )
+            #if ( mainCREATE_SIMPLE_BLINKY_DEMO_ONLY == 1 ) && ( PETRI_BENCHMARK == 0 )
                 /* Call the keyboard interrupt handler for the blinky demo. */
                 vBlinkyKeyboardInterruptHandler( xKeyPressed );
             #endif
@@ -10,24 +10,13 @@
  * - Tokens: Represent workpieces/materials flowing through the system
  */
 
-#if defined(_MSC_VER)
- // MSVC does not support C11 atomics in C mode
-typedef volatile long atomic_bool;
-#define atomic_store(ptr, val) (*(ptr) = (val))
-#define atomic_load(ptr) (*(ptr))
-#else
-#include <stdatomic.h>
-#endif
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <winsock2.h>
-#include <ws2tcpip.h>
 #include <windows.h>
-#include <time.h>
-#include <stdarg.h>
+#include <limits.h>
 
 /* FreeRTOS Windows MSVC port includes */
 #include "FreeRTOS.h"
@@ -35,438 +24,356 @@ typedef volatile long atomic_bool;
 #include "semphr.h"
 #include "queue.h"
 
-/* Windows console color support */
-#define COLOR_RESET   "\x1b[0m"
-#define COLOR_RED     "\x1b[31m"
-#define COLOR_GREEN   "\x1b[32m"
-#define COLOR_YELLOW  "\x1b[33m"
-#define COLOR_BLUE    "\x1b[34m"
-#define COLOR_MAGENTA "\x1b[35m"
-#define COLOR_CYAN    "\x1b[36m"
-#define STATUS_SERVER_PORT 8080
-#define STATUS_JSON_BUFFER 2048
-#define STATUS_RESPONSE_BUFFER (STATUS_JSON_BUFFER + 256)
-#define STATUS_SERVER_BACKLOG 5
+#include "petri_net.h"
+#include "event_log.h"
+#include "rng.h"
+#include "status_server.h"
+#include "pnml_loader.h"
+#include "station_clock.h"
+#include "net_analysis.h"
+#include "metrics.h"
+#include "net_trace.h"
+#include "worker_pool.h"
+#include "conflict_scheduler.h"
+#include "station_executor.h"
+#include "item_tokens.h"
+#include "static_arena.h"
+#include "marking_journal.h"
 
 // ====================
-// PETRI NET STRUCTURE
+// EVENT LOG TABLES
 // ====================
 
-#define MAX_PLACES 15
-#define MAX_TRANSITIONS 20
-#define MAX_ARCS 20
-
-typedef struct {
-    int tokens;                    // Number of tokens in the place
-    char name[32];                 // Place name
-    SemaphoreHandle_t mutex;       // Mutex for thread-safe access
-} Place;
-
-typedef struct {
-    int input_places[5];           // Input place indices (-1 = not used)
-    int output_places[5];          // Output place indices (-1 = not used)
-    int input_weights[5];          // Tokens required from each input
-    int output_weights[5];         // Tokens produced to each output
-    char name[32];                 // Transition name
-    bool enabled;                  // Transition enabled status
-} Transition;
-
-typedef struct {
-    Place places[MAX_PLACES];
-    Transition transitions[MAX_TRANSITIONS];
-    int num_places;
-    int num_transitions;
-    SemaphoreHandle_t net_mutex;   // Global Petri net mutex
-} PetriNet;
-
-// Global Petri Net
-PetriNet manufacturing_net;
+// Station ids carried in log records
+enum Stations {
+    ST_LOADER,
+    ST_PROCESSOR,
+    ST_ASSEMBLER,
+    ST_ROUTER,
+    ST_QC,
+    ST_PACKAGER,
+    ST_KEYBOARD,
+    NUM_STATIONS
+};
 
-// Queue for logging events
-QueueHandle_t log_queue;
+static const char* const station_names[NUM_STATIONS] = {
+    [ST_LOADER]    = "Material Loader",
+    [ST_PROCESSOR] = "Processor",
+    [ST_ASSEMBLER] = "Assembler",
+    [ST_ROUTER]    = "Router",
+    [ST_QC]        = "QC Worker",
+    [ST_PACKAGER]  = "Packager",
+    [ST_KEYBOARD]  = "Keyboard",
+};
 
-// Mutex for console output (prevents interleaved prints)
-SemaphoreHandle_t console_mutex;
-SemaphoreHandle_t rng_mutex;
+/*
+ * Every line has its own copy of each station. Log records and metrics
+ * carry line * NUM_STATIONS + station; with one line the names are the
+ * plain station names, otherwise they are prefixed with the line number.
+ */
+static char line_station_labels[PETRI_MAX_LINES * NUM_STATIONS][PETRI_NAME_LEN];
+static const char* line_station_names[PETRI_MAX_LINES * NUM_STATIONS];
 
-// Atomic flag to signal status updateR
-static atomic_bool status_dirty = false;
+// RNG streams per line: one per station, then one per QC worker
+#define LINE_RNG_STREAMS (NUM_STATIONS + WORKER_POOL_MAX_WORKERS)
 
-// ====================
-// CONSOLE OUTPUT HELPERS
-// ====================
-
-static int thread_safe_rand(void) {
-    int result;
-    xSemaphoreTake(rng_mutex, portMAX_DELAY);
-    result = rand();
-    xSemaphoreGive(rng_mutex);
-    return result;
+/**
+ * @brief Id of a station on a line, as carried in log records.
+ */
+static inline uint8_t line_station(const PetriNet* net, int station) {
+    return (uint8_t)(net->line * NUM_STATIONS + station);
 }
 
 /**
- * @brief Thread-safe printf with color support for Windows console.
- * @param color ANSI color code string.
- * @param format printf-style format string.
- * @param ... Variable arguments for formatting.
+ * @brief Fill in the station names of every line.
+ * @param num_lines Number of lines instantiated.
  */
-void safe_printf(const char* color, const char* format, ...) {
-    va_list args;
-
-    xSemaphoreTake(console_mutex, portMAX_DELAY);
+static void name_line_stations(int num_lines) {
+    for (int l = 0; l < num_lines; l++) {
+        for (int st = 0; st < NUM_STATIONS; st++) {
+            int id = l * NUM_STATIONS + st;
+            if (num_lines == 1) {
+                line_station_names[id] = station_names[st];
+            } else {
+                snprintf(line_station_labels[id], PETRI_NAME_LEN, "L%d %s", l + 1, station_names[st]);
+                line_station_names[id] = line_station_labels[id];
+            }
+        }
+    }
+}
 
-    printf("%s", color);
-    va_start(args, format);
-    vprintf(format, args);
-    va_end(args);
-    printf("%s", COLOR_RESET);
-    fflush(stdout);
+// Event ids carried in log records
+enum LogEvents {
+    EV_MATERIAL_LOADED,
+    EV_PROCESSING_STARTED,
+    EV_PROCESSING_FINISHED,
+    EV_ASSEMBLY_STARTED,
+    EV_ASSEMBLY_FINISHED,
+    EV_PAINT_SELECTED,
+    EV_PAINT_FINISHED,
+    EV_PAINT_SKIPPED,
+    EV_QC_STARTED,
+    EV_QC_COMPLETE_FAILED,
+    EV_QC_FAILED,
+    EV_QC_PASSED,
+    EV_REWORK_STARTED,
+    EV_REWORK_FINISHED,
+    EV_BULK_PACKAGED,
+    EV_INDIVIDUAL_PACKAGED,
+    EV_RAW_MATERIAL_ADDED,
+    NUM_LOG_EVENTS
+};
 
-    xSemaphoreGive(console_mutex);
-}
+// Console rendering of each event; formats take up to two int arguments
+static const LogEventFormat log_event_formats[NUM_LOG_EVENTS] = {
+    [EV_MATERIAL_LOADED]     = { COLOR_CYAN,    "Loaded raw material -> Ready to Process" },
+    [EV_PROCESSING_STARTED]  = { COLOR_BLUE,    "Started processing item #%d" },
+    [EV_PROCESSING_FINISHED] = { COLOR_BLUE,    "Finished processing item #%d" },
+    [EV_ASSEMBLY_STARTED]    = { COLOR_MAGENTA, "Started assembly #%d (combining 2 processed items)" },
+    [EV_ASSEMBLY_FINISHED]   = { COLOR_MAGENTA, "Finished assembly #%d" },
+    [EV_PAINT_SELECTED]      = { COLOR_MAGENTA, "Item #%d selected for custom paint." },
+    [EV_PAINT_FINISHED]      = { COLOR_MAGENTA, "Item #%d finished painting -> Waiting for QC2." },
+    [EV_PAINT_SKIPPED]       = { COLOR_CYAN,    "Item skipped paint -> Direct to Packaging." },
+    [EV_QC_STARTED]          = { COLOR_YELLOW,  "Worker %d performing QC%d check..." },
+    [EV_QC_COMPLETE_FAILED]  = { COLOR_RED,     "ERROR: Worker %d failed to complete QC%d check" },
+    [EV_QC_FAILED]           = { COLOR_RED,     "Worker %d: QC%d FAILED (5%% chance) -> Rework Bin" },
+    [EV_QC_PASSED]           = { COLOR_GREEN,   "Worker %d: QC%d PASSED -> Next Stage" },
+    [EV_REWORK_STARTED]      = { COLOR_BLUE,    "Worker %d started rework -> Back to Processed" },
+    [EV_REWORK_FINISHED]     = { COLOR_BLUE,    "Worker %d finished rework" },
+    [EV_BULK_PACKAGED]       = { COLOR_GREEN,   "BULK PACKAGED %d unit(s) (5 individual units each), total #%d -> READY FOR SHIPMENT" },
+    [EV_INDIVIDUAL_PACKAGED] = { COLOR_BLUE,    "Individually packaged unit #%d. Waiting for 5 to form a bulk package..." },
+    [EV_RAW_MATERIAL_ADDED]  = { COLOR_YELLOW,  "Increased raw materials by 1 (total: %d)" },
+};
 
 // ====================
-// PETRI NET OPERATIONS
+// MANUFACTURING PROCESS DEFINITION
 // ====================
 
-/**
- * @brief Initialize the Petri net structure, places, transitions, and mutexes.
+/*
+ * The net itself is read from a PNML file at startup (see pnml_loader.c).
+ * Stations refer to the places and transitions they work with through the
+ * roles below; bind_stations() looks each role up by name in the loaded net
+ * and fails fast if it is missing, so the file can change freely as long as
+ * these names stay.
  */
-void init_petri_net(void) {
-    manufacturing_net.num_places = 0;
-    manufacturing_net.num_transitions = 0;
-    manufacturing_net.net_mutex = xSemaphoreCreateMutex();
-
-    if (manufacturing_net.net_mutex == NULL) {
-        printf("ERROR: Failed to create net mutex\n");
-        exit(1);
-    }
-
-    for (int i = 0; i < MAX_PLACES; i++) {
-        manufacturing_net.places[i].tokens = 0;
-        manufacturing_net.places[i].mutex = xSemaphoreCreateMutex();
 
-        if (manufacturing_net.places[i].mutex == NULL) {
-            printf("ERROR: Failed to create place mutex %d\n", i);
-            exit(1);
-        }
-    }
-
-    for (int i = 0; i < MAX_TRANSITIONS; i++) {
-        for (int j = 0; j < 5; j++) {
-            manufacturing_net.transitions[i].input_places[j] = -1;
-            manufacturing_net.transitions[i].output_places[j] = -1;
-            manufacturing_net.transitions[i].input_weights[j] = 0;
-            manufacturing_net.transitions[i].output_weights[j] = 0;
-        }
-        manufacturing_net.transitions[i].enabled = false;
-    }
-}
+// Places the stations refer to
+enum Places {
+    P_RAW_MATERIAL,
+    P_FINAL_PACKAGED,
+    P_WORKER,
+    NUM_PLACE_ROLES
+};
 
-/**
- * @brief Add a new place to the Petri net.
- * @param name Name of the place.
- * @param initial_tokens Initial number of tokens in the place.
- * @return Index of the new place.
- */
-int add_place(const char* name, int initial_tokens) {
-    if (manufacturing_net.num_places >= MAX_PLACES) {
-        printf("ERROR: Cannot add place '%s' - max places reached\n", name);
-        return -1;
-    }
+// Transitions the stations fire
+enum Transitions {
+    T_LOAD_MATERIAL,
+    T_START_PROCESSING,
+    T_FINISH_PROCESSING,
+    T_START_ASSEMBLY,
+    T_FINISH_ASSEMBLY,
+    T_START_QC_1,
+    T_PASS_QC_1,
+    T_FAIL_QC_1,
+    T_SELECT_TO_PAINT,
+    T_SKIP_PAINT,
+    T_START_QC_2,
+    T_PASS_QC_2,
+    T_FAIL_QC_2,
+    T_INDIVIDUAL_PACKAGE,
+    T_BULK_PACKAGE,
+    T_REWORK_PROCESS,
+    NUM_TRANSITION_ROLES
+};
 
-    int idx = manufacturing_net.num_places++;
-    snprintf(manufacturing_net.places[idx].name, 32, "%s", name);
-    manufacturing_net.places[idx].tokens = initial_tokens;
-    return idx;
-}
+static const char* const place_role_names[NUM_PLACE_ROLES] = {
+    [P_RAW_MATERIAL]       = "Raw Material",
+    [P_FINAL_PACKAGED]     = "Final Packaged",
+    [P_WORKER]             = "Worker",
+};
 
-/**
- * @brief Add a new transition to the Petri net.
- * @param name Name of the transition.
- * @return Index of the new transition.
- */
-int add_transition(const char* name) {
-    if (manufacturing_net.num_transitions >= MAX_TRANSITIONS) {
-        printf("ERROR: Cannot add transition '%s' - max transitions reached\n", name);
-        return -1;
-    }
+static const char* const transition_role_names[NUM_TRANSITION_ROLES] = {
+    [T_LOAD_MATERIAL]      = "Load Material",
+    [T_START_PROCESSING]   = "Start Processing",
+    [T_FINISH_PROCESSING]  = "Finish Processing",
+    [T_START_ASSEMBLY]     = "Start Assembly",
+    [T_FINISH_ASSEMBLY]    = "Finish Assembly",
+    [T_START_QC_1]         = "Start QC 1",
+    [T_PASS_QC_1]          = "Pass QC 1",
+    [T_FAIL_QC_1]          = "Fail QC 1",
+    [T_SELECT_TO_PAINT]    = "Select to Paint",
+    [T_SKIP_PAINT]         = "Skip Paint",
+    [T_START_QC_2]         = "Start QC 2",
+    [T_PASS_QC_2]          = "Pass QC 2",
+    [T_FAIL_QC_2]          = "Fail QC 2",
+    [T_INDIVIDUAL_PACKAGE] = "Individual Package",
+    [T_BULK_PACKAGE]       = "Bulk Package",
+    [T_REWORK_PROCESS]     = "Rework Process",
+};
 
-    int idx = manufacturing_net.num_transitions++;
-    snprintf(manufacturing_net.transitions[idx].name, 32, "%s", name);
-    return idx;
-}
+// Net index of each role, filled in by bind_stations()
+static int place_index[NUM_PLACE_ROLES];
+static int trans_index[NUM_TRANSITION_ROLES];
 
 /**
- * @brief Add an input arc from a place to a transition.
- * @param trans_idx Index of the transition.
- * @param place_idx Index of the input place.
- * @param weight Number of tokens required from the place.
+ * @brief Resolve every station role to a place or transition of the loaded net.
+ * @return true if all roles were found.
  */
-void add_arc_input(int trans_idx, int place_idx, int weight) {
-    for (int i = 0; i < 5; i++) {
-        if (manufacturing_net.transitions[trans_idx].input_places[i] == -1) {
-            manufacturing_net.transitions[trans_idx].input_places[i] = place_idx;
-            manufacturing_net.transitions[trans_idx].input_weights[i] = weight;
-            break;
+static bool bind_stations(void) {
+    bool ok = true;
+
+    for (int r = 0; r < NUM_PLACE_ROLES; r++) {
+        place_index[r] = find_place(place_role_names[r]);
+        if (place_index[r] < 0) {
+            printf("ERROR: The net has no place named '%s'\n", place_role_names[r]);
+            ok = false;
         }
     }
-}
-
-/**
- * @brief Add an output arc from a transition to a place.
- * @param trans_idx Index of the transition.
- * @param place_idx Index of the output place.
- * @param weight Number of tokens produced to the place.
- */
-void add_arc_output(int trans_idx, int place_idx, int weight) {
-    for (int i = 0; i < 5; i++) {
-        if (manufacturing_net.transitions[trans_idx].output_places[i] == -1) {
-            manufacturing_net.transitions[trans_idx].output_places[i] = place_idx;
-            manufacturing_net.transitions[trans_idx].output_weights[i] = weight;
-            break;
+    for (int r = 0; r < NUM_TRANSITION_ROLES; r++) {
+        trans_index[r] = find_transition(transition_role_names[r]);
+        if (trans_index[r] < 0) {
+            printf("ERROR: The net has no transition named '%s'\n", transition_role_names[r]);
+            ok = false;
         }
     }
+    return ok;
 }
 
-/**
- * @brief Check if a transition is enabled (all input places have required tokens).
- * @param trans_idx Index of the transition.
- * @return true if enabled, false otherwise.
- */
-bool is_transition_enabled(int trans_idx) {
-    Transition* t = &manufacturing_net.transitions[trans_idx];
-
-    for (int i = 0; i < 5; i++) {
-        if (t->input_places[i] == -1) break;
-
-        int place_idx = t->input_places[i];
-        int required = t->input_weights[i];
-
-        xSemaphoreTake(manufacturing_net.places[place_idx].mutex, portMAX_DELAY);
-        int available = manufacturing_net.places[place_idx].tokens;
-        xSemaphoreGive(manufacturing_net.places[place_idx].mutex);
+// ====================
+// STATION TIMING
+// ====================
 
-        if (available < required) {
-            return false;
-        }
-    }
-    return true;
-}
+// Processing times and decision odds, shared by the station tasks and the analyzer
+#define LOADER_PERIOD_MS     800
+#define PROCESS_TIME_MS      1500
+#define ASSEMBLY_TIME_MS     1200
+#define PAINT_TIME_MS        1500
+#define QC_TIME_MS           3000
+#define REWORK_TIME_MS       2500
+#define PACKAGE_TIME_MS      300
+#define PAINT_CHANCE_PERCENT 30
+#define QC_FAIL_PERCENT      5
+
+/*
+ * Which station fires each transition, how long it is busy per firing and
+ * the odds at each decision. The transition field is filled in from
+ * trans_index[] by analyze_net(). A station that works between a start and
+ * a finish transition is charged on the finish, so the token it holds
+ * (e.g. a worker in QC) is accounted for while it waits.
+ */
+static const TransitionTiming station_timing[NUM_TRANSITION_ROLES] = {
+    [T_LOAD_MATERIAL]      = { -1, ST_LOADER,    LOADER_PERIOD_MS, 0 },
+    [T_START_PROCESSING]   = { -1, ST_PROCESSOR, 0,                0 },
+    [T_FINISH_PROCESSING]  = { -1, ST_PROCESSOR, PROCESS_TIME_MS,  0 },
+    [T_START_ASSEMBLY]     = { -1, ST_ASSEMBLER, 0,                0 },
+    [T_FINISH_ASSEMBLY]    = { -1, ST_ASSEMBLER, ASSEMBLY_TIME_MS, 0 },
+    [T_START_QC_1]         = { -1, ST_QC,        0,                0 },
+    [T_PASS_QC_1]          = { -1, ST_QC,        QC_TIME_MS,       100 - QC_FAIL_PERCENT },
+    [T_FAIL_QC_1]          = { -1, ST_QC,        QC_TIME_MS,       QC_FAIL_PERCENT },
+    [T_SELECT_TO_PAINT]    = { -1, ST_ROUTER,    PAINT_TIME_MS,    PAINT_CHANCE_PERCENT },
+    [T_SKIP_PAINT]         = { -1, ST_ROUTER,    0,                100 - PAINT_CHANCE_PERCENT },
+    [T_START_QC_2]         = { -1, ST_QC,        0,                0 },
+    [T_PASS_QC_2]          = { -1, ST_QC,        QC_TIME_MS,       100 - QC_FAIL_PERCENT },
+    [T_FAIL_QC_2]          = { -1, ST_QC,        QC_TIME_MS,       QC_FAIL_PERCENT },
+    [T_INDIVIDUAL_PACKAGE] = { -1, ST_PACKAGER,  PACKAGE_TIME_MS,  0 },
+    [T_BULK_PACKAGE]       = { -1, ST_PACKAGER,  PACKAGE_TIME_MS,  0 },
+    [T_REWORK_PROCESS]     = { -1, ST_QC,        REWORK_TIME_MS,   0 },
+};
 
 /**
- * @brief Fire a transition: consume tokens from input places and produce tokens to output places.
- * @param trans_idx Index of the transition.
- * @return true if fired successfully, false otherwise.
+ * @brief Run the bottleneck and capacity analysis on the loaded net.
+ * @return true on success.
  */
-bool fire_transition(int trans_idx) {
-    Transition* t = &manufacturing_net.transitions[trans_idx];
-
-    xSemaphoreTake(manufacturing_net.net_mutex, portMAX_DELAY);
-
-    // Check if enabled
-    if (!is_transition_enabled(trans_idx)) {
-        xSemaphoreGive(manufacturing_net.net_mutex);
-        return false;
-    }
+static bool analyze_net(void) {
+    TransitionTiming timing[NUM_TRANSITION_ROLES];
+    int capacity[NUM_STATIONS];
 
-    // Remove tokens from input places
-    for (int i = 0; i < 5; i++) {
-        if (t->input_places[i] == -1) break;
-
-        int place_idx = t->input_places[i];
-        int weight = t->input_weights[i];
-
-        xSemaphoreTake(manufacturing_net.places[place_idx].mutex, portMAX_DELAY);
-        manufacturing_net.places[place_idx].tokens -= weight;
-        xSemaphoreGive(manufacturing_net.places[place_idx].mutex);
+    for (int r = 0; r < NUM_TRANSITION_ROLES; r++) {
+        timing[r] = station_timing[r];
+        timing[r].transition = trans_index[r];
     }
-
-    // Add tokens to output places
-    for (int i = 0; i < 5; i++) {
-        if (t->output_places[i] == -1) break;
-
-        int place_idx = t->output_places[i];
-        int weight = t->output_weights[i];
-
-        xSemaphoreTake(manufacturing_net.places[place_idx].mutex, portMAX_DELAY);
-        manufacturing_net.places[place_idx].tokens += weight;
-        xSemaphoreGive(manufacturing_net.places[place_idx].mutex);
+    for (int s = 0; s < NUM_STATIONS; s++) {
+        capacity[s] = 1;
     }
+    // One QC worker task per Worker token, see start_qc_workers(); with a
+    // shared Worker place they are the capacity of all lines together
+    capacity[ST_QC] = worker_pool_size(&petri_lines[0], place_index[P_WORKER]);
+
+    AnalysisModel model = {
+        timing, NUM_TRANSITION_ROLES,
+        station_names, capacity, NUM_STATIONS,
+        trans_index[T_LOAD_MATERIAL]
+    };
+    return net_analysis_run(&model);
+}
 
-    xSemaphoreGive(manufacturing_net.net_mutex);
+// ====================
+// CORE AFFINITY
+// ====================
 
-    // Mark status as dirty for immediate update
-    atomic_store(&status_dirty, true);
+/*
+ * Cores the stations run on in SMP builds (PETRI_SMP_CORES > 1; ignored on
+ * one core). The first entry matching a station's line and station id
+ * wins; ANY_LINE and ANY_STATION match everything, and a station no entry
+ * matches may run on any core. The default spreads the lines over the
+ * cores and leaves a shared QC pool, which serves every line, unpinned.
+ */
+#define ANY_LINE    -1             // Also the line of a pool shared by all lines
+#define ANY_STATION -1
+#define CORE(n) ((UBaseType_t)1u << ((n) % configNUMBER_OF_CORES))
 
-    return true;
-}
+typedef struct {
+    int line;
+    int station;
+    UBaseType_t cores;
+} CoreAssignment;
+
+static const CoreAssignment core_map[] = {
+    { 0, ANY_STATION, CORE(0) },
+    { 1, ANY_STATION, CORE(1) },
+    { 2, ANY_STATION, CORE(2) },
+    { 3, ANY_STATION, CORE(3) },
+};
 
 /**
- * @brief Get the number of tokens in a place.
- * @param place_idx Index of the place.
- * @return Number of tokens in the place.
+ * @brief Cores a station of a line may run on, from core_map.
+ * @param line Line index, or ANY_LINE for a task serving every line.
+ * @param station Station id (ST_*).
  */
-int get_place_tokens(int place_idx) {
-    xSemaphoreTake(manufacturing_net.places[place_idx].mutex, portMAX_DELAY);
-    int tokens = manufacturing_net.places[place_idx].tokens;
-    xSemaphoreGive(manufacturing_net.places[place_idx].mutex);
-    return tokens;
+static UBaseType_t station_cores(int line, int station) {
+    for (size_t i = 0; i < sizeof(core_map) / sizeof(core_map[0]); i++) {
+        const CoreAssignment* entry = &core_map[i];
+        if ((entry->line == ANY_LINE || entry->line == line) &&
+            (entry->station == ANY_STATION || entry->station == station)) {
+            return entry->cores;
+        }
+    }
+    return STATION_ANY_CORE;
 }
 
 // ====================
-// MANUFACTURING PROCESS DEFINITION
+// CONFLICT SETS
 // ====================
 
-// Place indices
-enum Places {
-    P_RAW_MATERIAL,            // P0
-    P_READY_TO_PROCESS,        // P1
-    P_PROCESSING,              // P2
-    P_PROCESSED,               // P3
-    P_READY_TO_ASSEMBLE,       // P4
-    P_ASSEMBLED,               // P5
-    P_QUALITY_CHECK_1,         // P6
-    P_POST_QC1_BUFFER,         // P7
-    P_READY_FOR_INDIVIDUAL_PACKAGE, // P8
-    P_INDIVIDUALLY_PACKAGED,   // P9
-    P_FINAL_PACKAGED,          // P10
-    P_PAINTED,                 // P11
-    P_QUALITY_CHECK_2,         // P12
-    P_WORKER,                  // P13 - QC worker resource token
-    P_REWORK_BIN               // P14
-};
+// Members of each line's router set: the two routes out of the QC1 buffer
+enum { ROUTE_PAINT, ROUTE_SKIP };
 
-// Transition indices
-enum Transitions {
-    T_LOAD_MATERIAL,
-    T_START_PROCESSING,
-    T_FINISH_PROCESSING,
-    T_START_ASSEMBLY,
-    T_FINISH_ASSEMBLY,
-    T_START_QC_1,
-    T_PASS_QC_1,
-    T_FAIL_QC_1,
-    T_SELECT_TO_PAINT,
-    T_SKIP_PAINT,
-    T_START_QC_2,
-    T_PASS_QC_2,
-    T_FAIL_QC_2,
-    T_INDIVIDUAL_PACKAGE,
-    T_BULK_PACKAGE,
-    T_REWORK_PROCESS
-};
+static ConflictSet* router_sets[PETRI_MAX_LINES];
 
 /**
- * @brief Set up the manufacturing process Petri net: places, transitions, and arcs.
+ * @brief Create the router conflict set of one line. By default it is a
+ * weighted draw that sends PAINT_CHANCE_PERCENT of the items to painting;
+ * PETRI_CONFLICT_POLICY=router=<policy> routes them another way.
+ * @return true on success.
  */
-void setup_manufacturing_process(void) {
-    // Create places
-    add_place("Raw Material", 20);                     // P0
-    add_place("Ready to Process", 0);                  // P1
-    add_place("Processing", 0);                        // P2
-    add_place("Processed", 0);                         // P3
-    add_place("Ready to Assemble", 0);                 // P4
-    add_place("Assembled", 0);                         // P5
-    add_place("QC Active 1", 0);                       // P6
-    add_place("Passed QC1 / Decision", 0);             // P7
-    add_place("Ready for Individual Package", 0);      // P8
-    add_place("Individually Packaged", 0);             // P9
-    add_place("Final Packaged", 0);                     // P10
-    add_place("Painted", 0);                           // P11
-    add_place("QC Active 2", 0);                       // P12
-    add_place("Worker", 3);                            // P13
-    add_place("Rework Bin", 0);                        // P14
-
-    // Transitions (order must match enum indices)
-
-    // T0: Load Material
-    add_transition("Load Material");
-    add_arc_input(T_LOAD_MATERIAL, P_RAW_MATERIAL, 1);
-    add_arc_output(T_LOAD_MATERIAL, P_READY_TO_PROCESS, 1);
-
-    // T1: Start Processing
-    add_transition("Start Processing");
-    add_arc_input(T_START_PROCESSING, P_READY_TO_PROCESS, 1);
-    add_arc_output(T_START_PROCESSING, P_PROCESSING, 1);
-
-    // T2: Finish Processing
-    add_transition("Finish Processing");
-    add_arc_input(T_FINISH_PROCESSING, P_PROCESSING, 1);
-    add_arc_output(T_FINISH_PROCESSING, P_PROCESSED, 1);
-
-    // T3: Start Assembly
-    add_transition("Start Assembly");
-    add_arc_input(T_START_ASSEMBLY, P_PROCESSED, 2);
-    add_arc_output(T_START_ASSEMBLY, P_READY_TO_ASSEMBLE, 2);
-
-    // T4: Finish Assembly
-    add_transition("Finish Assembly");
-    add_arc_input(T_FINISH_ASSEMBLY, P_READY_TO_ASSEMBLE, 2);
-    add_arc_output(T_FINISH_ASSEMBLY, P_ASSEMBLED, 1);
-
-    // T5: Start QC1
-    add_transition("Start QC 1");
-    add_arc_input(T_START_QC_1, P_ASSEMBLED, 1);
-    add_arc_input(T_START_QC_1, P_WORKER, 1);
-    add_arc_output(T_START_QC_1, P_QUALITY_CHECK_1, 1);
-
-    // T6: Pass QC1
-    add_transition("Pass QC 1");
-    add_arc_input(T_PASS_QC_1, P_QUALITY_CHECK_1, 1);
-    add_arc_output(T_PASS_QC_1, P_POST_QC1_BUFFER, 1);
-    add_arc_output(T_PASS_QC_1, P_WORKER, 1);
-
-    // T7: Fail QC1
-    add_transition("Fail QC 1");
-    add_arc_input(T_FAIL_QC_1, P_QUALITY_CHECK_1, 1);
-    add_arc_output(T_FAIL_QC_1, P_REWORK_BIN, 1);
-    add_arc_output(T_FAIL_QC_1, P_WORKER, 1);
-
-    // T8: Select to Paint
-    add_transition("Select to Paint");
-    add_arc_input(T_SELECT_TO_PAINT, P_POST_QC1_BUFFER, 1);
-    add_arc_output(T_SELECT_TO_PAINT, P_PAINTED, 1);
-
-    // T9: Skip Paint
-    add_transition("Skip Paint");
-    add_arc_input(T_SKIP_PAINT, P_POST_QC1_BUFFER, 1);
-    add_arc_output(T_SKIP_PAINT, P_READY_FOR_INDIVIDUAL_PACKAGE, 1);
-
-    // T10: Start QC2
-    add_transition("Start QC 2");
-    add_arc_input(T_START_QC_2, P_PAINTED, 1);
-    add_arc_input(T_START_QC_2, P_WORKER, 1);
-    add_arc_output(T_START_QC_2, P_QUALITY_CHECK_2, 1);
-
-    // T11: Pass QC2
-    add_transition("Pass QC 2");
-    add_arc_input(T_PASS_QC_2, P_QUALITY_CHECK_2, 1);
-    add_arc_output(T_PASS_QC_2, P_READY_FOR_INDIVIDUAL_PACKAGE, 1);
-    add_arc_output(T_PASS_QC_2, P_WORKER, 1);
-
-    // T12: Fail QC2
-    add_transition("Fail QC 2");
-    add_arc_input(T_FAIL_QC_2, P_QUALITY_CHECK_2, 1);
-    add_arc_output(T_FAIL_QC_2, P_REWORK_BIN, 1);
-    add_arc_output(T_FAIL_QC_2, P_WORKER, 1);
-
-    // T13: Individual Package
-    add_transition("Individual Package");
-    add_arc_input(T_INDIVIDUAL_PACKAGE, P_READY_FOR_INDIVIDUAL_PACKAGE, 1);
-    add_arc_output(T_INDIVIDUAL_PACKAGE, P_INDIVIDUALLY_PACKAGED, 1);
-
-    // T14: Bulk Package (requires 5 individual packages)
-    add_transition("Bulk Package");
-    add_arc_input(T_BULK_PACKAGE, P_INDIVIDUALLY_PACKAGED, 5);
-    add_arc_output(T_BULK_PACKAGE, P_FINAL_PACKAGED, 1);
-
-    // T15: Rework Process
-    add_transition("Rework Process");
-    add_arc_input(T_REWORK_PROCESS, P_REWORK_BIN, 1);
-    add_arc_input(T_REWORK_PROCESS, P_WORKER, 1);
-    add_arc_output(T_REWORK_PROCESS, P_PROCESSED, 1);
-    add_arc_output(T_REWORK_PROCESS, P_WORKER, 1);
+static bool create_router_set(PetriNet* net) {
+    const ConflictMember routes[] = {
+        [ROUTE_PAINT] = { net, trans_index[T_SELECT_TO_PAINT], 1, PAINT_CHANCE_PERCENT },
+        [ROUTE_SKIP]  = { net, trans_index[T_SKIP_PAINT],      0, 100 - PAINT_CHANCE_PERCENT },
+    };
+
+    router_sets[net->line] = conflict_set_create("router", routes, 2, CONFLICT_WEIGHTED_RANDOM);
+    return router_sets[net->line] != NULL;
 }
 
 // ====================
@@ -475,318 +382,540 @@ void setup_manufacturing_process(void) {
 
 /**
  * @brief FreeRTOS task: Loads raw material into the process.
- * @param params Unused task parameter.
+ * @param params Line (PetriNet*) the station belongs to.
  */
 void task_material_loader(void* params) {
-    TickType_t last_wake = xTaskGetTickCount();
+    PetriNet* net = (PetriNet*)params;
+    uint8_t station = line_station(net, ST_LOADER);
+
+    metrics_register_task(line_station_names[station]);
+    bool subscribed = subscribe_transition(net, trans_index[T_LOAD_MATERIAL]);
+    configASSERT(subscribed);
+    uint32_t last_wake = station_now_ms();
 
     while (1) {
-        if (fire_transition(T_LOAD_MATERIAL)) {
-            safe_printf(COLOR_CYAN, "[Material Loader] Loaded raw material -> Ready to Process\n");
+        if (fire_transition(net, trans_index[T_LOAD_MATERIAL])) {
+            log_event(station, EV_MATERIAL_LOADED, 0, 0);
+            // The loader feeds at most one unit per period
+            station_delay_until(&last_wake, LOADER_PERIOD_MS);
+        } else {
+            wait_for_transition_event(portMAX_DELAY);
+            last_wake = station_now_ms();
         }
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(800));
     }
 }
 
 /**
  * @brief FreeRTOS task: Processes raw material.
- * @param params Unused task parameter.
+ * @param params Line (PetriNet*) the station belongs to.
  */
 void task_processor(void* params) {
-    TickType_t last_wake = xTaskGetTickCount();
+    PetriNet* net = (PetriNet*)params;
+    uint8_t station = line_station(net, ST_PROCESSOR);
+
+    metrics_register_task(line_station_names[station]);
+    bool subscribed = subscribe_transition(net, trans_index[T_START_PROCESSING]);
+    configASSERT(subscribed);
     int processed_count = 0;
 
     while (1) {
-        if (fire_transition(T_START_PROCESSING)) {
+        if (fire_transition(net, trans_index[T_START_PROCESSING])) {
             processed_count++;
-            safe_printf(COLOR_BLUE, "[Processor] Started processing item #%d\n", processed_count);
+            log_event(station, EV_PROCESSING_STARTED, processed_count, 0);
 
             // Simulate processing time
-            vTaskDelay(pdMS_TO_TICKS(1500));
+            station_work(PROCESS_TIME_MS);
 
-            if (fire_transition(T_FINISH_PROCESSING)) {
-                safe_printf(COLOR_BLUE, "[Processor] Finished processing item #%d\n", processed_count);
+            if (fire_transition(net, trans_index[T_FINISH_PROCESSING])) {
+                log_event(station, EV_PROCESSING_FINISHED, processed_count, 0);
             }
+        } else {
+            wait_for_transition_event(portMAX_DELAY);
         }
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(300));
     }
 }
 
 /**
  * @brief FreeRTOS task: Assembles processed items.
- * @param params Unused task parameter.
+ * @param params Line (PetriNet*) the station belongs to.
  */
 void task_assembler(void* params) {
-    TickType_t last_wake = xTaskGetTickCount();
+    PetriNet* net = (PetriNet*)params;
+    uint8_t station = line_station(net, ST_ASSEMBLER);
+
+    metrics_register_task(line_station_names[station]);
+    bool subscribed = subscribe_transition(net, trans_index[T_START_ASSEMBLY]);
+    configASSERT(subscribed);
     int assembled_count = 0;
 
     while (1) {
-        if (fire_transition(T_START_ASSEMBLY)) {
+        if (fire_transition(net, trans_index[T_START_ASSEMBLY])) {
             assembled_count++;
-            safe_printf(COLOR_MAGENTA, "[Assembler] Started assembly #%d (combining 2 processed items)\n",
-                assembled_count);
+            log_event(station, EV_ASSEMBLY_STARTED, assembled_count, 0);
 
             // Simulate assembly time
-            vTaskDelay(pdMS_TO_TICKS(1200));
+            station_work(ASSEMBLY_TIME_MS);
 
-            if (fire_transition(T_FINISH_ASSEMBLY)) {
-                safe_printf(COLOR_MAGENTA, "[Assembler] Finished assembly #%d\n", assembled_count);
+            if (fire_transition(net, trans_index[T_FINISH_ASSEMBLY])) {
+                log_event(station, EV_ASSEMBLY_FINISHED, assembled_count, 0);
             }
+        } else {
+            wait_for_transition_event(portMAX_DELAY);
         }
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(300));
     }
 }
 /**
- * @brief FreeRTOS task: Routes product after QC1, randomly selecting some for painting.
- * FIXED VERSION: Eliminates TOCTOU race condition
+ * @brief FreeRTOS task: Routes product after QC1, sending some to painting.
+ * The line's router conflict set decides which of the two routes each item takes.
+ * @param params Line (PetriNet*) the station belongs to.
  */
 void task_painter_router(void* params) {
-    const int paint_chance_percent = 30; // 30% chance to be selected for paint
-    TickType_t last_wake = xTaskGetTickCount();
+    PetriNet* net = (PetriNet*)params;
+    uint8_t station = line_station(net, ST_ROUTER);
+    ConflictSet* routes = router_sets[net->line];
     int paint_count = 0;
+    RngState rng;
+
+    metrics_register_task(line_station_names[station]);
+    rng_init_stream(&rng, (uint32_t)(net->line * LINE_RNG_STREAMS + ST_ROUTER));
+    bool subscribed = conflict_subscribe(routes);
+    configASSERT(subscribed);
 
     while (1) {
-        // Check if paint selection is possible (eliminates race condition)
-        if (is_transition_enabled(T_SELECT_TO_PAINT)) {
-            // Random Decision: Paint or Skip
-            if ((thread_safe_rand() % 100) < paint_chance_percent) {
-                // Decision: Paint
-                if (fire_transition(T_SELECT_TO_PAINT)) {
-                    paint_count++;
-                    safe_printf(COLOR_MAGENTA, "[Router] Item #%d selected for custom paint.\n", paint_count);
-                    vTaskDelay(pdMS_TO_TICKS(1500)); // Simulate Painting Time
-                    safe_printf(COLOR_MAGENTA, "[Router] Item #%d finished painting -> Waiting for QC2.\n", paint_count);
-                } else {
-                    safe_printf(COLOR_RED, "[Router] ERROR: Failed to select item for painting\n");
-                }
-            } else {
-                // Decision: Skip Paint - check if skip is enabled
-                if (is_transition_enabled(T_SKIP_PAINT)) {
-                    if (fire_transition(T_SKIP_PAINT)) {
-                        safe_printf(COLOR_CYAN, "[Router] Item skipped paint -> Direct to Packaging.\n");
-                    } else {
-                        safe_printf(COLOR_RED, "[Router] ERROR: Failed to skip painting\n");
-                    }
-                }
-            }
+        int route = conflict_fire(routes, &rng);
+        if (route == ROUTE_PAINT) {
+            paint_count++;
+            log_event(station, EV_PAINT_SELECTED, paint_count, 0);
+            station_work(PAINT_TIME_MS); // Simulate Painting Time
+            log_event(station, EV_PAINT_FINISHED, paint_count, 0);
+        } else if (route == ROUTE_SKIP) {
+            log_event(station, EV_PAINT_SKIPPED, 0, 0);
+        } else {
+            wait_for_transition_event(portMAX_DELAY);
         }
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(400));
     }
 }
 /**
- * @brief FreeRTOS task: Performs quality control on assembled items.
- * @param params Unused task parameter.
-  * @brief FreeRTOS task: Performs quality control (both QC1 and QC2).
-  */
-void task_quality_control(void* params) {
-    const TickType_t qc_duration = pdMS_TO_TICKS(3000);
-    const int fail_chance_percent = 5;
-    TickType_t last_wake = xTaskGetTickCount();
-    int qc_count = 0;
+ * @brief FreeRTOS task: Packages products that passed quality control.
+ * @param params Line (PetriNet*) the station belongs to.
+ */
+void task_packager(void* params) {
+    PetriNet* net = (PetriNet*)params;
+    uint8_t station = line_station(net, ST_PACKAGER);
+    int individual_count = 0;
+    int bulk_count = 0;
+
+    metrics_register_task(line_station_names[station]);
+    bool subscribed = subscribe_transition(net, trans_index[T_BULK_PACKAGE]) &&
+        subscribe_transition(net, trans_index[T_INDIVIDUAL_PACKAGE]);
+    configASSERT(subscribed);
 
     while (1) {
         bool worked = false;
-        int start_transition = -1;
-        int pass_transition = -1;
-        int fail_transition = -1;
-
-        // PRIORITY 1: Post-paint QC2 takes precedence
-        if (is_transition_enabled(T_START_QC_2)) {
-            start_transition = T_START_QC_2;
-            pass_transition = T_PASS_QC_2;
-            fail_transition = T_FAIL_QC_2;
+
+        // Form every bulk package the individual units allow in one firing
+        int bulks = fire_transition_n(net, trans_index[T_BULK_PACKAGE], INT_MAX);
+        if (bulks > 0) {
+            bulk_count += bulks;
+            log_event(station, EV_BULK_PACKAGED, bulks, bulk_count);
             worked = true;
-        }
-        // PRIORITY 2: Pre-paint QC1
-        else if (is_transition_enabled(T_START_QC_1)) {
-            start_transition = T_START_QC_1;
-            pass_transition = T_PASS_QC_1;
-            fail_transition = T_FAIL_QC_1;
+        } else if (fire_transition(net, trans_index[T_INDIVIDUAL_PACKAGE])) {
+            individual_count++;
+            log_event(station, EV_INDIVIDUAL_PACKAGED, individual_count, 0);
             worked = true;
         }
 
         if (worked) {
-            // Fire the start transition
-            if (!fire_transition(start_transition)) {
-                safe_printf(COLOR_RED, "[QC Worker] ERROR: Failed to start QC check\n");
-                continue;
-            }
+            station_work(PACKAGE_TIME_MS);
+        } else {
+            wait_for_transition_event(portMAX_DELAY);
+        }
+    }
+}
 
-            qc_count++;
-            safe_printf(COLOR_YELLOW, "[QC Worker] Performing check #%d...\n", qc_count);
-            vTaskDelay(qc_duration);
+// ====================
+// STATION MACHINES
+// ====================
 
-            // Determine pass/fail and fire appropriate transition
-            int result_transition = ((thread_safe_rand() % 100) < fail_chance_percent) ? fail_transition : pass_transition;
+/*
+ * The same stations as the tasks above, as machines for the timer-wheel
+ * executor (PETRI_TIMER_WHEEL). Each begin function does what one pass of
+ * the task loop does up to its station_work() call; the work itself and
+ * the finish transition are left to the executor.
+ */
 
-            if (!fire_transition(result_transition)) {
-                safe_printf(COLOR_RED, "[QC Worker] ERROR: Failed to complete QC check #%d\n", qc_count);
-                continue;
-            }
+/* A station that works between a start and a finish transition. */
+typedef struct {
+    int start_role;
+    int finish_role;
+    uint32_t time_ms;
+    uint8_t started_event;
+    uint8_t finished_event;
+} TimedOperation;
+
+static const TimedOperation processing = {
+    T_START_PROCESSING, T_FINISH_PROCESSING, PROCESS_TIME_MS, EV_PROCESSING_STARTED, EV_PROCESSING_FINISHED
+};
+static const TimedOperation assembly = {
+    T_START_ASSEMBLY, T_FINISH_ASSEMBLY, ASSEMBLY_TIME_MS, EV_ASSEMBLY_STARTED, EV_ASSEMBLY_FINISHED
+};
 
-            if (result_transition == fail_transition) {
-                safe_printf(COLOR_RED, "[QC Worker] Check #%d FAILED (5%% chance) -> Rework Bin\n", qc_count);
-            } else {
-                safe_printf(COLOR_GREEN, "[QC Worker] Check #%d PASSED -> Next Stage\n", qc_count);
-            }
-        }
+/* State of one station machine, kept in its context. */
+typedef struct {
+    uint8_t station;               // Log id, see line_station()
+    const TimedOperation* operation;
+    int count;                     // Jobs started (individual units for the packager)
+    int bulk_count;
+    RngState rng;                  // Draws of the router's conflict set
+} MachineState;
+
+#define MACHINES_PER_LINE 5
+
+static StationMachine line_machines[PETRI_MAX_LINES][MACHINES_PER_LINE];
+static MachineState machine_states[PETRI_MAX_LINES][MACHINES_PER_LINE];
 
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(worked ? 200 : 500));
+static bool begin_load(StationMachine* machine, StationJob* job) {
+    MachineState* state = (MachineState*)machine->context;
+
+    if (!fire_transition(machine->net, trans_index[T_LOAD_MATERIAL])) {
+        return false;
     }
+    log_event(state->station, EV_MATERIAL_LOADED, 0, 0);
+    // The loader feeds at most one unit per period
+    *job = (StationJob){ LOADER_PERIOD_MS, -1, 0 };
+    return true;
 }
 
-void task_reworker(void* params) {
-    TickType_t last_wake = xTaskGetTickCount();
-    int rework_count = 0;
-    const TickType_t rework_duration = pdMS_TO_TICKS(2500);
+static bool begin_timed(StationMachine* machine, StationJob* job) {
+    MachineState* state = (MachineState*)machine->context;
+    const TimedOperation* operation = state->operation;
 
-    while (1) {
-        if (fire_transition(T_REWORK_PROCESS)) {
-            rework_count++;
-            safe_printf(COLOR_BLUE, "[Reworker] Started rework #%d -> Back to Processed\n", rework_count);
-            vTaskDelay(rework_duration);
-            safe_printf(COLOR_BLUE, "[Reworker] Finished rework #%d\n", rework_count);
-        }
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(1000));
+    if (!fire_transition(machine->net, trans_index[operation->start_role])) {
+        return false;
     }
+    state->count++;
+    log_event(state->station, operation->started_event, state->count, 0);
+    *job = (StationJob){ operation->time_ms, trans_index[operation->finish_role], state->count };
+    return true;
 }
 
-/**
- * @brief FreeRTOS task: Packages products that passed quality control.
- * @param params Unused task parameter.
- */
-void task_packager(void* params) {
-    TickType_t last_wake = xTaskGetTickCount();
-    int individual_count = 0;
-    int bulk_count = 0;
+static void end_timed(StationMachine* machine, const StationJob* job, bool finished) {
+    MachineState* state = (MachineState*)machine->context;
 
-    while (1) {
-        bool worked = false;
+    if (finished) {
+        log_event(state->station, state->operation->finished_event, job->arg, 0);
+    }
+}
 
-        if (fire_transition(T_BULK_PACKAGE)) {
-            bulk_count++;
-            safe_printf(COLOR_GREEN, "[Packager] BULK PACKAGED unit #%d (5 individual units combined) -> READY FOR SHIPMENT\n", bulk_count);
-            worked = true;
-        } else if (fire_transition(T_INDIVIDUAL_PACKAGE)) {
-            individual_count++;
-            safe_printf(COLOR_BLUE, "[Packager] Individually packaged unit #%d. Waiting for 5 to form a bulk package...\n", individual_count);
-            worked = true;
-        }
+static bool begin_route(StationMachine* machine, StationJob* job) {
+    MachineState* state = (MachineState*)machine->context;
 
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(worked ? 300 : 600));
+    int route = conflict_fire(router_sets[machine->net->line], &state->rng);
+    if (route == ROUTE_PAINT) {
+        state->count++;
+        log_event(state->station, EV_PAINT_SELECTED, state->count, 0);
+        *job = (StationJob){ PAINT_TIME_MS, -1, state->count };
+        return true;
+    }
+    if (route == ROUTE_SKIP) {
+        log_event(state->station, EV_PAINT_SKIPPED, 0, 0);
+        *job = (StationJob){ 0, -1, 0 };
+        return true;
     }
+    return false;
 }
 
-// ====================
-// JSON STATUS SERVER
-// ====================
+static void end_route(StationMachine* machine, const StationJob* job, bool finished) {
+    MachineState* state = (MachineState*)machine->context;
+    (void)finished;
 
-static int build_status_payload(char* buffer, size_t size) {
-    if (size == 0) {
-        return 0;
-    }
-
-    int offset = snprintf(buffer, size, "{\"places\":[");
-    for (int i = 0; i < manufacturing_net.num_places && offset < (int)size; i++) {
-        int tokens = get_place_tokens(i);
-        int written = snprintf(buffer + offset, size - offset,
-            "{\"name\":\"%s\",\"tokens\":%d}%s",
-            manufacturing_net.places[i].name,
-            tokens,
-            (i + 1 < manufacturing_net.num_places) ? "," : "");
-        if (written < 0) {
-            break;
-        }
-        offset += written;
+    // Skipped items take no time and have nothing more to report
+    if (job->duration_ms > 0) {
+        log_event(state->station, EV_PAINT_FINISHED, job->arg, 0);
     }
+}
 
-    if (offset < (int)size) {
-        offset += snprintf(buffer + offset, size - offset, "]}");
+static bool begin_package(StationMachine* machine, StationJob* job) {
+    MachineState* state = (MachineState*)machine->context;
+
+    // Form every bulk package the individual units allow in one firing
+    int bulks = fire_transition_n(machine->net, trans_index[T_BULK_PACKAGE], INT_MAX);
+    if (bulks > 0) {
+        state->bulk_count += bulks;
+        log_event(state->station, EV_BULK_PACKAGED, bulks, state->bulk_count);
+    } else if (fire_transition(machine->net, trans_index[T_INDIVIDUAL_PACKAGE])) {
+        state->count++;
+        log_event(state->station, EV_INDIVIDUAL_PACKAGED, state->count, 0);
+    } else {
+        return false;
     }
+    *job = (StationJob){ PACKAGE_TIME_MS, -1, 0 };
+    return true;
+}
 
-    // After building payload, clear dirty flag
-    atomic_store(&status_dirty, false);
-    return offset >= (int)size ? (int)size - 1 : offset;
+/**
+ * @brief Register the station machines of one line with the executor.
+ * @param net Line the stations work on.
+ * @return true on success.
+ */
+static bool add_line_machines(PetriNet* net) {
+    const struct {
+        int station;
+        StationBeginFn begin;
+        StationEndFn end;
+        const TimedOperation* operation;
+        int triggers[STATION_MAX_TRIGGERS];
+        int num_triggers;
+    } machines[MACHINES_PER_LINE] = {
+        { ST_LOADER,    begin_load,    NULL,      NULL,        { trans_index[T_LOAD_MATERIAL] }, 1 },
+        { ST_PROCESSOR, begin_timed,   end_timed, &processing, { trans_index[T_START_PROCESSING] }, 1 },
+        { ST_ASSEMBLER, begin_timed,   end_timed, &assembly,   { trans_index[T_START_ASSEMBLY] }, 1 },
+        { ST_ROUTER,    begin_route,   end_route, NULL,
+            { trans_index[T_SELECT_TO_PAINT], trans_index[T_SKIP_PAINT] }, 2 },
+        { ST_PACKAGER,  begin_package, NULL,      NULL,
+            { trans_index[T_BULK_PACKAGE], trans_index[T_INDIVIDUAL_PACKAGE] }, 2 },
+    };
+
+    for (int m = 0; m < MACHINES_PER_LINE; m++) {
+        MachineState* state = &machine_states[net->line][m];
+        StationMachine* machine = &line_machines[net->line][m];
+
+        *state = (MachineState){ .station = line_station(net, machines[m].station), .operation = machines[m].operation };
+        rng_init_stream(&state->rng, (uint32_t)(net->line * LINE_RNG_STREAMS + machines[m].station));
+
+        *machine = (StationMachine){
+            .net = net,
+            .triggers = { machines[m].triggers[0], machines[m].triggers[1] },
+            .num_triggers = machines[m].num_triggers,
+            .begin = machines[m].begin,
+            .end = machines[m].end,
+            .context = state,
+            .station = line_station_names[state->station],
+        };
+        if (!station_executor_add(machine)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-static void task_status_server(void* params) {
-    (void)params;
+// ====================
+// QC WORKER POOL
+// ====================
 
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        vTaskDelete(NULL);
-        return;
-    }
+/* Roles of one quality check; the worker pool has already fired the start. */
+typedef struct {
+    int level;                     // 1 before painting, 2 after
+    int pass_role;
+    int fail_role;
+} QcCheck;
+
+static const QcCheck qc_checks[] = {
+    { 1, T_PASS_QC_1, T_FAIL_QC_1 },
+    { 2, T_PASS_QC_2, T_FAIL_QC_2 },
+};
+
+/**
+ * @brief Worker pool job: inspect one item and pass or fail it.
+ * @param stage Stage whose context is the QcCheck.
+ * @param worker Worker doing the check.
+ */
+static void run_qc_check(const WorkerStage* stage, WorkerContext* worker) {
+    const QcCheck* check = (const QcCheck*)stage->context;
+    uint8_t station = line_station(stage->net, ST_QC);
+    int number = worker->index + 1;
+
+    log_event(station, EV_QC_STARTED, number, check->level);
+    station_work(QC_TIME_MS);
 
-    SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (listen_socket == INVALID_SOCKET) {
-        WSACleanup();
-        vTaskDelete(NULL);
+    bool failed = rng_below(&worker->rng, 100) < (uint32_t)QC_FAIL_PERCENT;
+    if (!fire_transition(stage->net, trans_index[failed ? check->fail_role : check->pass_role])) {
+        log_event(station, EV_QC_COMPLETE_FAILED, number, check->level);
         return;
     }
+    log_event(station, failed ? EV_QC_FAILED : EV_QC_PASSED, number, check->level);
+}
 
-    int opt = 1;
-    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+/**
+ * @brief Worker pool job: rework one failed item.
+ * Rework Process borrows and returns a Worker token in the same firing, so
+ * the item is already back in Processed while the worker is busy.
+ */
+static void run_rework(const WorkerStage* stage, WorkerContext* worker) {
+    uint8_t station = line_station(stage->net, ST_QC);
 
-    struct sockaddr_in service;
-    ZeroMemory(&service, sizeof(service));
-    service.sin_family = AF_INET;
-    // Bind to all network interfaces for external access
-    service.sin_addr.s_addr = INADDR_ANY;
-    service.sin_port = htons(STATUS_SERVER_PORT);
+    log_event(station, EV_REWORK_STARTED, worker->index + 1, 0);
+    station_work(REWORK_TIME_MS);
+    log_event(station, EV_REWORK_FINISHED, worker->index + 1, 0);
+}
 
-    if (bind(listen_socket, (struct sockaddr*)&service, sizeof(service)) == SOCKET_ERROR) {
-        closesocket(listen_socket);
-        WSACleanup();
-        vTaskDelete(NULL);
-        return;
+#define QC_STAGES_PER_LINE 3
+
+/**
+ * @brief Start one QC worker per Worker token, serving QC2, QC1 and rework.
+ * By default QC2 comes first because its items are closest to shipping;
+ * PETRI_CONFLICT_POLICY=qc=<policy> picks the stages another way.
+ * Each line gets its own pool, unless the Worker place is shared, in which
+ * case one pool serves the stages of every line.
+ * @param first First line to serve.
+ * @param count Number of lines to serve.
+ * @return true if every worker task was created.
+ */
+static bool start_qc_workers(int first, int count) {
+    WorkerStage stages[PETRI_MAX_LINES * QC_STAGES_PER_LINE];
+    int num_stages = 0;
+
+    for (int l = first; l < first + count; l++) {
+        PetriNet* net = &petri_lines[l];
+        stages[num_stages++] = (WorkerStage){ net, trans_index[T_START_QC_2],     3, 3, run_qc_check, &qc_checks[1] };
+        stages[num_stages++] = (WorkerStage){ net, trans_index[T_START_QC_1],     2, 2, run_qc_check, &qc_checks[0] };
+        stages[num_stages++] = (WorkerStage){ net, trans_index[T_REWORK_PROCESS], 1, 1, run_rework,   NULL };
     }
 
-    if (listen(listen_socket, STATUS_SERVER_BACKLOG) == SOCKET_ERROR) {
-        closesocket(listen_socket);
-        WSACleanup();
-        vTaskDelete(NULL);
-        return;
+    const PetriNet* owner = &petri_lines[first];
+    WorkerPoolConfig config = {
+        line_station_names[line_station(owner, ST_QC)], owner, place_index[P_WORKER],
+        stages, num_stages,
+        4, configMINIMAL_STACK_SIZE * 2,
+        (uint32_t)(first * LINE_RNG_STREAMS + NUM_STATIONS),   // Past the line's per-station streams
+        station_cores(count == 1 ? first : ANY_LINE, ST_QC),
+        "qc", CONFLICT_FIXED_PRIORITY
+    };
+    return worker_pool_start(&config) > 0;
+}
+
+/**
+ * @brief Create the station tasks of one line, or register its station
+ * machines when the timer-wheel executor runs them.
+ * @param net Line the stations work on.
+ * @param use_wheel Whether PETRI_TIMER_WHEEL selected the executor.
+ * @return true if every task was created.
+ */
+static bool start_line_stations(PetriNet* net, bool use_wheel) {
+    static const struct {
+        TaskFunction_t task;
+        const char* name;
+        int station;
+    } stations[] = {
+        { task_material_loader, "MaterialLoader", ST_LOADER },
+        { task_processor,       "Processor",      ST_PROCESSOR },
+        { task_assembler,       "Assembler",      ST_ASSEMBLER },
+        { task_painter_router,  "PainterRouter",  ST_ROUTER },
+        { task_packager,        "Packager",       ST_PACKAGER },
+    };
+
+    if (!create_router_set(net)) {
+        return false;
     }
+    for (size_t s = 0; !use_wheel && s < sizeof(stations) / sizeof(stations[0]); s++) {
+        char name[PETRI_NAME_LEN];
+        if (petri_num_lines == 1) {
+            snprintf(name, sizeof(name), "%s", stations[s].name);
+        } else {
+            snprintf(name, sizeof(name), "L%d %s", net->line + 1, stations[s].name);
+        }
 
-    while (1) {
-        SOCKET client = accept(listen_socket, NULL, NULL);
-        if (client == INVALID_SOCKET) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            continue;
+        // Using appropriate stack sizes for Windows port
+        if (!station_task_create(stations[s].task, name, configMINIMAL_STACK_SIZE * 2, net, 3,
+                station_cores(net->line, stations[s].station))) {
+            printf("ERROR: Failed to create %s task\n", name);
+            return false;
         }
+    }
+    if (use_wheel && !add_line_machines(net)) {
+        return false;
+    }
 
-        // Always respond immediately with the latest state
-        char request[128];
-        recv(client, request, sizeof(request) - 1, 0);
+    // Without a shared Worker place every line has its own QC workers
+    if (!is_shared_place(place_index[P_WORKER])) {
+        return start_qc_workers(net->line, 1);
+    }
+    return true;
+}
+
+/**
+ * @brief Instantiate the lines named by PETRI_LINES, sharing the places
+ * listed in PETRI_SHARED_PLACES.
+ * @return true on success.
+ */
+static bool create_lines(void) {
+    int num_lines = 1;
+    const char* lines = getenv(PETRI_LINES_ENV);
+    if (lines != NULL && *lines != '\0') {
+        char* end;
+        long value = strtol(lines, &end, 10);
+        if (*end != '\0' || value < 1 || value > PETRI_MAX_LINES) {
+            printf("ERROR: " PETRI_LINES_ENV " must be a number of lines between 1 and %d, got '%s'\n",
+                PETRI_MAX_LINES, lines);
+            return false;
+        }
+        num_lines = (int)value;
+    }
 
-        char payload[STATUS_JSON_BUFFER];
-        int payload_len = build_status_payload(payload, sizeof(payload));
-        if (payload_len < 0) {
-            payload_len = 0;
-            payload[0] = '\0';
+    // Comma-separated place names, e.g. PETRI_SHARED_PLACES=Worker
+    const char* shared = getenv(PETRI_SHARED_PLACES_ENV);
+    while (shared != NULL && *shared != '\0') {
+        char name[PETRI_NAME_LEN];
+        size_t len = strcspn(shared, ",");
+        snprintf(name, sizeof(name), "%.*s", (int)len, shared);
+        shared += len + (shared[len] == ',' ? 1 : 0);
+
+        int place = find_place(name);
+        if (place < 0) {
+            printf("ERROR: " PETRI_SHARED_PLACES_ENV " names '%s', which is not a place of the net\n", name);
+            return false;
+        }
+        if (!share_place(place)) {
+            return false;
         }
+    }
 
-        char response[STATUS_RESPONSE_BUFFER];
-        int response_len = snprintf(response, sizeof(response),
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: application/json\r\n"
-            "Connection: close\r\n"
-            "Access-Control-Allow-Origin: *\r\n" // CORS header
-            "Content-Length: %d\r\n"
-            "\r\n"
-            "%s",
-            payload_len,
-            payload);
-
-        send(client, response, response_len, 0);
-        shutdown(client, SD_BOTH);
-        closesocket(client);
-    }
-
-    closesocket(listen_socket);
-    WSACleanup();
-    vTaskDelete(NULL);
+    if (!instantiate_net_lines(num_lines)) {
+        return false;
+    }
+    name_line_stations(num_lines);
+    return true;
+}
+
+// ====================
+// ITEM TRACKING
+// ====================
+
+// Places whose first arrival every item records, in line order; Final
+// Packaged needs no entry, as nothing consumes from it and items end there
+static const char* const item_stage_names[] = {
+    "Processing",
+    "Processed",
+    "Assembled",
+    "Passed QC1 / Decision",
+    "Individually Packaged",
+};
+
+/**
+ * @brief Set up the records that follow each workpiece in colored-token
+ * builds (PETRI_COLORED_TOKENS); a no-op otherwise.
+ * @return true on success.
+ */
+static bool track_items(void) {
+    // Worker tokens are people, not parts
+    if (!item_tokens_set_resource_place(place_index[P_WORKER])) {
+        return false;
+    }
+
+    int rework_bin = find_place("Rework Bin");
+    if (rework_bin >= 0 && !item_tokens_set_rework_place(rework_bin)) {
+        return false;
+    }
+    for (size_t s = 0; s < sizeof(item_stage_names) / sizeof(item_stage_names[0]); s++) {
+        int place = find_place(item_stage_names[s]);
+        if (place < 0) {
+            continue;
+        }
+        if (!item_tokens_add_stage(place)) {
+            return false;
+        }
+    }
+    return item_tokens_init();
 }
 
 // ====================
@@ -811,112 +940,145 @@ void main_blinky(void) {
     printf(COLOR_GREEN "===========================================================\n" COLOR_RESET);
     printf("\n");
 
-    // Create console mutex
-    console_mutex = xSemaphoreCreateMutex();
-    if (console_mutex == NULL) {
-        printf("ERROR: Failed to create console mutex\n");
+    init_petri_net();
+#if PETRI_NET_GENERATED
+    // The net was compiled in from PIPE.pnml by tools/pnml_codegen
+    const char* net_file = "the compiled-in net";
+    bool loaded = load_generated_net();
+#else
+    // Load the Petri net; PETRI_NET_FILE selects another line layout
+    const char* net_file = getenv(PNML_FILE_ENV);
+    if (net_file == NULL || *net_file == '\0') {
+        net_file = PNML_DEFAULT_FILE;
+    }
+    bool loaded = pnml_load_file(net_file) && build_net_index();
+#endif
+    if (!loaded || !bind_stations()) {
+        printf("ERROR: Failed to load the Petri net from %s\n", net_file);
         return;
     }
+    printf(COLOR_YELLOW "Loaded %s: %d places, %d transitions\n" COLOR_RESET,
+        net_file, manufacturing_model.num_places, manufacturing_model.num_transitions);
 
-    rng_mutex = xSemaphoreCreateMutex();
-    if (rng_mutex == NULL) {
-        printf("ERROR: Failed to create RNG mutex\n");
+    // PETRI_LINES runs several copies of the line side by side
+    if (!create_lines()) {
+        printf("ERROR: Failed to create the production lines\n");
         return;
     }
 
-    // Initialize Petri net
-    init_petri_net();
-    setup_manufacturing_process();
-
-    srand((unsigned int)time(NULL));
-
-    printf(COLOR_YELLOW "System initialized with 20 raw materials\n" COLOR_RESET);
-    printf(COLOR_YELLOW "Starting manufacturing tasks...\n\n" COLOR_RESET);
-
-    // Create log queue
-    log_queue = xQueueCreate(50, sizeof(char[64]));
-
-    // Create FreeRTOS tasks for each manufacturing station
-    // Using appropriate stack sizes for Windows port
-    BaseType_t result;
-
-    result = xTaskCreate(task_material_loader, "MaterialLoader",
-        configMINIMAL_STACK_SIZE * 2, NULL, 3, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create MaterialLoader task\n");
+    // PETRI_JOURNAL=<file> picks up the marking where a crashed run left it
+    const char* journal_file = getenv(JOURNAL_ENV);
+    if (journal_file != NULL && *journal_file != '\0' && !marking_journal_open(journal_file)) {
+        printf("ERROR: Failed to open the marking journal %s\n", journal_file);
         return;
     }
 
-    result = xTaskCreate(task_processor, "Processor",
-        configMINIMAL_STACK_SIZE * 2, NULL, 3, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create Processor task\n");
+    // Item records served at /items start from the loaded marking as well
+    if (!track_items()) {
+        printf("ERROR: Failed to set up item tracking\n");
         return;
     }
 
-    result = xTaskCreate(task_assembler, "Assembler",
-        configMINIMAL_STACK_SIZE * 2, NULL, 3, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create Assembler task\n");
+    // Counters served at /metrics start from the loaded marking
+    metrics_init();
+    net_trace_init();
+
+    // Replay a run by setting PETRI_SEED to the value printed here
+    uint64_t seed = rng_seed_from_environment();
+    printf(COLOR_YELLOW "Run seed: %llu (set " RNG_SEED_ENV " to replay)\n" COLOR_RESET,
+        (unsigned long long)seed);
+
+    // Bottleneck and capacity analysis, served at /analysis; PETRI_ANALYZE prints it and exits
+    if (!analyze_net()) {
+        printf("ERROR: Failed to analyze the Petri net\n");
         return;
     }
-
-    result = xTaskCreate(task_painter_router, "PainterRouter",
-        configMINIMAL_STACK_SIZE * 2, NULL, 3, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create PainterRouter task\n");
+    const char* analyze = getenv(ANALYSIS_ENV);
+    if (analyze != NULL && *analyze != '\0') {
+        net_analysis_print();
         return;
     }
 
-    result = xTaskCreate(task_quality_control, "QualityControl",
-        configMINIMAL_STACK_SIZE * 2, NULL, 4, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create QualityControl task\n");
-        return;
+    printf(COLOR_YELLOW "System initialized with %d line(s), %d raw materials each\n" COLOR_RESET,
+        petri_num_lines, get_place_tokens(&petri_lines[0], place_index[P_RAW_MATERIAL]));
+
+    // PETRI_SIMULATE=<hours> runs the same stations on a virtual clock
+    const char* sim_hours = getenv(SIM_HOURS_ENV);
+    if (sim_hours != NULL && *sim_hours != '\0') {
+        char* end;
+        double hours = strtod(sim_hours, &end);
+        if (*end != '\0' || !(hours > 0.0 && hours <= 1000.0)) {
+            printf("ERROR: " SIM_HOURS_ENV " must be a number of hours between 0 and 1000, got '%s'\n", sim_hours);
+            return;
+        }
+
+        SimReportPlaces report = { place_index[P_WORKER], place_index[P_FINAL_PACKAGED] };
+        if (!simulation_start((uint32_t)(hours * 3600000.0), &report)) {
+            printf("ERROR: Failed to start the simulation clock\n");
+            return;
+        }
+        printf(COLOR_YELLOW "Simulating %.2f hours of production...\n\n" COLOR_RESET, hours);
+    } else {
+        printf(COLOR_YELLOW "Starting manufacturing tasks...\n\n" COLOR_RESET);
+
+        // Start the logger before any station can raise events
+        if (!event_log_start(line_station_names, petri_num_lines * NUM_STATIONS,
+                log_event_formats, NUM_LOG_EVENTS)) {
+            printf("ERROR: Failed to start event logger\n");
+            return;
+        }
     }
 
-    result = xTaskCreate(task_packager, "Packager",
-        configMINIMAL_STACK_SIZE * 2, NULL, 3, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create Packager task\n");
+    // Create FreeRTOS tasks for each manufacturing station of every line;
+    // PETRI_TIMER_WHEEL runs them all from one executor task instead
+    const char* wheel = getenv(STATION_WHEEL_ENV);
+    bool use_wheel = wheel != NULL && *wheel != '\0';
+    for (int l = 0; l < petri_num_lines; l++) {
+        if (!start_line_stations(&petri_lines[l], use_wheel)) {
+            return;
+        }
+    }
+    if (is_shared_place(place_index[P_WORKER]) && !start_qc_workers(0, petri_num_lines)) {
         return;
     }
-
-    result = xTaskCreate(task_reworker, "Reworker",
-        configMINIMAL_STACK_SIZE * 2, NULL, 2, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create Reworker task\n");
+    if (use_wheel && !station_executor_start(3, STATION_ANY_CORE)) {
         return;
     }
 
-    result = xTaskCreate(task_status_server, "StatusServer",
-        configMINIMAL_STACK_SIZE * 3, NULL, 2, NULL);
-    if (result != pdPASS) {
-        printf("ERROR: Failed to create StatusServer task\n");
+    // A simulation finishes in seconds; nothing to watch live
+    if (!station_clock_is_virtual() && !status_server_start()) {
+        printf("ERROR: Failed to start status server\n");
         return;
     }
 
+    arena_print_usage();
+
     // Start FreeRTOS scheduler
     printf(COLOR_GREEN "Starting FreeRTOS scheduler...\n\n" COLOR_RESET);
     vTaskStartScheduler();
 
+    // The simulation clock ends the scheduler once the report is printed
+    if (station_clock_is_virtual()) {
+        item_tokens_print_report();
+        return;
+    }
+
     // Should never reach here unless there's insufficient heap
     printf(COLOR_RED "ERROR: Scheduler failed to start - insufficient heap memory?\n" COLOR_RESET);
 }
 // Stub for vBlinkyKeyboardInterruptHandler to resolve linker error
 void vBlinkyKeyboardInterruptHandler(int xKeyPressed) {
     // Handle keyboard input to increase raw materials
-    if (xKeyPressed == '+') {
-        // Increase raw materials by 1
-        xSemaphoreTake(manufacturing_net.places[P_RAW_MATERIAL].mutex, portMAX_DELAY);
-        manufacturing_net.places[P_RAW_MATERIAL].tokens += 1;
-        xSemaphoreGive(manufacturing_net.places[P_RAW_MATERIAL].mutex);
-
-        // Mark status as dirty for update
-        atomic_store(&status_dirty, true);
-
-        // Print confirmation (thread-safe)
-        safe_printf(COLOR_YELLOW, "[Keyboard] Increased raw materials by 1 (total: %d)\n",
-            get_place_tokens(P_RAW_MATERIAL));
+    static int next_line = 0;
+
+    if (xKeyPressed == '+' && petri_num_lines > 0) {
+        // Increase raw materials by 1 (runs as a simulated interrupt), one line after another
+        PetriNet* net = &petri_lines[next_line];
+        next_line = (next_line + 1) % petri_num_lines;
+        add_place_tokens_from_isr(net, place_index[P_RAW_MATERIAL], 1);
+
+        // Queue the confirmation; the logger task prints it
+        log_event_from_isr(line_station(net, ST_KEYBOARD), EV_RAW_MATERIAL_ADDED,
+            get_place_tokens(net, place_index[P_RAW_MATERIAL]), 0);
     }
 }
\ No newline at end of file
@@ -0,0 +1,447 @@
+/*
+ * Marking journal: a memory-mapped ring of firings with periodic marking
+ * checkpoints. See marking_journal.h.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "marking_journal.h"
+#include "petri_net.h"
+
+#if MARKING_JOURNAL_ENABLED
+
+#define JOURNAL_MAGIC 0x4C4E524Au      // "JRNL"
+#define JOURNAL_FORMAT 2               // 2: 32-bit counts, one record per change
+#define JOURNAL_MASK (JOURNAL_RECORDS - 1u)
+
+#if (JOURNAL_RECORDS & (JOURNAL_RECORDS - 1)) != 0
+#error "JOURNAL_RECORDS must be a power of two"
+#endif
+
+// Kind of record, in the top bit of JournalRecord.what; the line is in the rest
+#define RECORD_FIRE 0x00u
+#define RECORD_ADD 0x80u
+#define RECORD_LINE_MASK 0x7Fu
+
+// JournalRecord keeps the transition or place in a byte and the line in seven bits
+#if MAX_PLACES > 256 || MAX_TRANSITIONS > 256
+#error "JournalRecord.index holds one byte; widen it before raising MAX_PLACES or MAX_TRANSITIONS past 256"
+#endif
+#if PETRI_MAX_LINES > 128
+#error "JournalRecord.what holds the line in seven bits; PETRI_MAX_LINES must not exceed 128"
+#endif
+
+/*
+ * x86 keeps stores in program order, so a record's stamp can only become
+ * visible after its payload as long as the compiler does not reorder them.
+ */
+#if defined(_MSC_VER)
+#define JOURNAL_STORE_BARRIER() _ReadWriteBarrier()
+#else
+#define JOURNAL_STORE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* One firing, batch of firings or token addition. */
+typedef struct {
+    uint32_t stamp;                // Position in the journal, from 1; written last
+    uint32_t line_version;         // Line's own marking version after the change
+    uint32_t shared_version;       // Shared places' version after the change
+    int32_t count;                 // Firings or tokens; any change fits in one record
+    uint8_t index;                 // Transition fired or place added to
+    uint8_t what;                  // RECORD_FIRE or RECORD_ADD, plus the line
+    uint16_t unused;               // Pads the record to 20 bytes
+} JournalRecord;
+
+/* The marking of every line at one moment, with the versions it was read at. */
+typedef struct {
+    uint32_t generation;           // The valid slot with the highest one is restored
+    uint32_t position;             // First record the checkpoint may not contain
+    uint32_t shared_version;
+    uint32_t line_version[PETRI_MAX_LINES];
+    int32_t shared_marking[MAX_PLACES];
+    int32_t line_marking[PETRI_MAX_LINES][MAX_PLACES];
+    uint32_t checksum;             // Of everything above
+} JournalCheckpoint;
+
+/* Layout of the mapped file. */
+typedef struct {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t fingerprint;          // Net, lines and shared places the journal was written for
+    uint32_t num_records;
+    JournalCheckpoint checkpoints[2];
+    JournalRecord records[JOURNAL_RECORDS];
+} JournalFile;
+
+static JournalFile* journal = NULL;    // The mapped file
+static volatile bool journal_recording = false;    // Set once the marking has been restored
+static volatile LONG journal_last_stamp;
+static uint32_t checkpoint_generation;
+static uint32_t checkpoint_position;
+
+// ====================
+// RECORDING
+// ====================
+
+/**
+ * @brief Append a change of one line to the ring.
+ * Caller must be inside the critical section of the change, after its
+ * marking write has ended, so the versions include it.
+ */
+static void journal_append_locked(const PetriNet* net, uint8_t what, int index, int count) {
+    if (count == 0) {
+        return;
+    }
+
+    uint32_t line_version = net->marking_seq >> 1;
+    uint32_t shared_version = net->shared != NULL ? net->shared->marking_seq >> 1 : 0;
+    uint32_t stamp = (uint32_t)InterlockedIncrement(&journal_last_stamp);
+    JournalRecord* record = &journal->records[stamp & JOURNAL_MASK];
+
+    record->line_version = line_version;
+    record->shared_version = shared_version;
+    record->count = (int32_t)count;
+    record->index = (uint8_t)index;
+    record->what = (uint8_t)(what | (uint8_t)net->line);
+    JOURNAL_STORE_BARRIER();
+    record->stamp = stamp;
+}
+
+/**
+ * @brief Journal hook: a transition of a line has fired count times.
+ * Caller must be inside NET_ENTER_CRITICAL(net).
+ */
+void journal_firing_locked(const PetriNet* net, int trans_idx, int count) {
+    if (journal_recording) {
+        journal_append_locked(net, RECORD_FIRE, trans_idx, count);
+    }
+}
+
+/**
+ * @brief Journal hook: tokens have been added to a place from outside the net.
+ * Caller must be inside NET_ENTER_CRITICAL(net).
+ */
+void journal_tokens_added_locked(const PetriNet* net, int place_idx, int count) {
+    if (journal_recording) {
+        journal_append_locked(net, RECORD_ADD, place_idx, count);
+    }
+}
+
+// ====================
+// CHECKPOINTS
+// ====================
+
+/**
+ * @brief FNV-1a hash, continuing from hash.
+ */
+static uint32_t hash_bytes(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t checkpoint_checksum(const JournalCheckpoint* checkpoint) {
+    return hash_bytes(2166136261u, checkpoint, offsetof(JournalCheckpoint, checksum));
+}
+
+/**
+ * @brief Identify what the journal's records refer to: the places, the
+ * transitions and their arcs, the number of lines and the shared places.
+ */
+static uint32_t net_fingerprint(void) {
+    const PetriModel* model = &manufacturing_model;
+    uint32_t hash = 2166136261u;
+    int32_t counts[3] = { model->num_places, model->num_transitions, petri_num_lines };
+
+    hash = hash_bytes(hash, counts, sizeof(counts));
+    for (int p = 0; p < model->num_places; p++) {
+        uint8_t shared = is_shared_place(p) ? 1 : 0;
+        hash = hash_bytes(hash, model->places[p].name, strlen(model->places[p].name));
+        hash = hash_bytes(hash, &shared, 1);
+    }
+    for (int t = 0; t < model->num_transitions; t++) {
+        hash = hash_bytes(hash, model->transitions[t].name, strlen(model->transitions[t].name));
+        hash = hash_bytes(hash, &model->in_arcs[model->in_start[t]],
+            (size_t)(model->in_start[t + 1] - model->in_start[t]) * sizeof(Arc));
+        hash = hash_bytes(hash, &model->out_arcs[model->out_start[t]],
+            (size_t)(model->out_start[t + 1] - model->out_start[t]) * sizeof(Arc));
+    }
+    return hash;
+}
+
+/**
+ * @brief Copy the current marking into the older checkpoint slot.
+ * Safe to call while the lines fire: only records appended after the stamp
+ * read here can be missing from the copy, and replay starts from there.
+ */
+static void write_checkpoint(void) {
+    uint32_t generation = checkpoint_generation + 1;
+    JournalCheckpoint* slot = &journal->checkpoints[generation & 1];
+
+    slot->position = (uint32_t)journal_last_stamp + 1;
+    NET_MEMORY_BARRIER();
+    slot->generation = generation;
+    slot->shared_version = petri_read_shared_marking(slot->shared_marking);
+    for (int l = 0; l < petri_num_lines; l++) {
+        slot->line_version[l] = petri_read_line_marking(&petri_lines[l], slot->line_marking[l]);
+    }
+    slot->checksum = checkpoint_checksum(slot);
+
+    checkpoint_generation = generation;
+    checkpoint_position = slot->position;
+}
+
+/**
+ * @brief Native thread: checkpoints the marking while the ring fills up.
+ */
+static DWORD WINAPI journal_checkpoint_thread(void* param) {
+    DWORD last_ms = GetTickCount();
+
+    (void)param;
+    while (1) {
+        Sleep(JOURNAL_POLL_MS);
+
+        uint32_t pending = (uint32_t)journal_last_stamp + 1 - checkpoint_position;
+        DWORD now = GetTickCount();
+        if (pending >= JOURNAL_RECORDS / 4 || (pending > 0 && now - last_ms >= JOURNAL_CHECKPOINT_MS)) {
+            write_checkpoint();
+            last_ms = now;
+        }
+    }
+    return 0;
+}
+
+// ====================
+// RESTORING
+// ====================
+
+/**
+ * @brief true if version a is later than version b, allowing for wraparound.
+ */
+static inline bool version_after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+/**
+ * @brief Apply the part of a record's token change the checkpoint does not contain yet.
+ */
+static void replay_tokens(const JournalRecord* record, const JournalCheckpoint* checkpoint,
+                          JournalCheckpoint* marking, int line, int place, int32_t delta) {
+    if (is_shared_place(place)) {
+        if (version_after(record->shared_version, checkpoint->shared_version)) {
+            marking->shared_marking[place] += delta;
+        }
+    } else if (version_after(record->line_version, checkpoint->line_version[line])) {
+        marking->line_marking[line][place] += delta;
+    }
+}
+
+/**
+ * @brief Replay the records after a checkpoint onto a copy of it.
+ * @param marking Starts as a copy of checkpoint and receives the result.
+ * @param next Receives the position after the last record replayed.
+ * @return Number of records replayed, or -1 if the ring has been overrun
+ * since the checkpoint.
+ */
+static int replay_journal(const JournalCheckpoint* checkpoint, JournalCheckpoint* marking, uint32_t* next) {
+    const PetriModel* model = &manufacturing_model;
+    uint32_t stamp = checkpoint->position;
+    int replayed = 0;
+
+    for (; replayed < JOURNAL_RECORDS; replayed++, stamp++) {
+        const JournalRecord* record = &journal->records[stamp & JOURNAL_MASK];
+        if (record->stamp != stamp) {
+            break;
+        }
+
+        int line = record->what & RECORD_LINE_MASK;
+        int index = record->index;
+        if (line >= petri_num_lines) {
+            break;
+        }
+        if ((record->what & RECORD_ADD) != 0) {
+            if (index < model->num_places) {
+                replay_tokens(record, checkpoint, marking, line, index, record->count);
+            }
+            continue;
+        }
+        if (index >= model->num_transitions) {
+            break;
+        }
+        for (int a = model->in_start[index]; a < model->in_start[index + 1]; a++) {
+            replay_tokens(record, checkpoint, marking, line, model->in_arcs[a].place,
+                -(int32_t)model->in_arcs[a].weight * record->count);
+        }
+        for (int a = model->out_start[index]; a < model->out_start[index + 1]; a++) {
+            replay_tokens(record, checkpoint, marking, line, model->out_arcs[a].place,
+                (int32_t)model->out_arcs[a].weight * record->count);
+        }
+    }
+    *next = stamp;
+
+    // A newer record where the next one belongs means the ring wrapped past it
+    const JournalRecord* after = &journal->records[stamp & JOURNAL_MASK];
+    if (after->stamp != 0 && version_after(after->stamp, stamp)) {
+        return -1;
+    }
+    return replayed;
+}
+
+/**
+ * @brief The newest checkpoint slot whose checksum holds, or NULL.
+ */
+static const JournalCheckpoint* latest_checkpoint(void) {
+    const JournalCheckpoint* latest = NULL;
+
+    for (int i = 0; i < 2; i++) {
+        const JournalCheckpoint* slot = &journal->checkpoints[i];
+        if (slot->generation != 0 && slot->checksum == checkpoint_checksum(slot) &&
+            (latest == NULL || version_after(slot->generation, latest->generation))) {
+            latest = slot;
+        }
+    }
+    return latest;
+}
+
+/**
+ * @brief Restore the marking from the mapped journal.
+ * @return Number of records replayed, or -1 if the journal held no usable marking.
+ */
+static int restore_marking(const char* path) {
+    static JournalCheckpoint marking;
+    const JournalCheckpoint* checkpoint = latest_checkpoint();
+    uint32_t next;
+
+    if (checkpoint == NULL) {
+        printf("ERROR: Journal %s has no valid checkpoint; starting afresh\n", path);
+        return -1;
+    }
+
+    marking = *checkpoint;
+    int replayed = replay_journal(checkpoint, &marking, &next);
+    if (replayed < 0) {
+        printf("ERROR: Journal %s overran its last checkpoint; restoring the checkpoint only\n", path);
+        marking = *checkpoint;
+        replayed = 0;
+    }
+
+    int num_places = manufacturing_model.num_places;
+    for (int p = 0; p < num_places; p++) {
+        bool negative = marking.shared_marking[p] < 0;
+        for (int l = 0; l < petri_num_lines; l++) {
+            negative = negative || marking.line_marking[l][p] < 0;
+        }
+        if (negative) {
+            printf("ERROR: Journal %s replays to a negative marking at %s; starting afresh\n",
+                path, manufacturing_model.places[p].name);
+            return -1;
+        }
+    }
+
+    for (int l = 0; l < petri_num_lines; l++) {
+        restore_line_marking(&petri_lines[l], marking.line_marking[l]);
+    }
+    restore_shared_marking(marking.shared_marking);
+    checkpoint_generation = checkpoint->generation;
+    journal_last_stamp = (LONG)(next - 1);
+    return replayed;
+}
+
+/**
+ * @brief Map the journal file, restore the marking it holds and start
+ * journaling. A missing file is created. Call after instantiate_net_lines()
+ * and before anything reads the marking to set itself up (metrics, item
+ * tracking) or the scheduler starts.
+ * @param path Journal file.
+ * @return true on success.
+ */
+bool marking_journal_open(const char* path) {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("ERROR: Cannot open journal %s (error %lu)\n", path, (unsigned long)GetLastError());
+        return false;
+    }
+
+    // Mapping a larger size than the file grows it, with zeros
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)sizeof(JournalFile), NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        printf("ERROR: Cannot map journal %s (error %lu)\n", path, (unsigned long)GetLastError());
+        return false;
+    }
+    JournalFile* mapped = (JournalFile*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(JournalFile));
+    CloseHandle(mapping);
+    if (mapped == NULL) {
+        printf("ERROR: Cannot map journal %s (error %lu)\n", path, (unsigned long)GetLastError());
+        return false;
+    }
+
+    journal = mapped;
+    journal_recording = false;
+    journal_last_stamp = 0;
+    checkpoint_generation = 0;
+
+    uint32_t fingerprint = net_fingerprint();
+    int replayed = -1;
+    if (journal->magic == JOURNAL_MAGIC && journal->format == JOURNAL_FORMAT &&
+        journal->num_records == JOURNAL_RECORDS && journal->fingerprint == fingerprint) {
+        replayed = restore_marking(path);
+    } else if (journal->magic != 0) {
+        printf("Journal %s was written for another net or line layout; starting afresh\n", path);
+    }
+
+    if (replayed < 0) {
+        memset(journal, 0, sizeof(*journal));
+        journal->format = JOURNAL_FORMAT;
+        journal->num_records = JOURNAL_RECORDS;
+        journal->fingerprint = fingerprint;
+        NET_MEMORY_BARRIER();
+        journal->magic = JOURNAL_MAGIC;
+        journal_last_stamp = 0;
+        checkpoint_generation = 0;
+    }
+
+    // Checkpoint the starting marking, then drop the records it now contains
+    // so that none of them can be taken for a later one
+    write_checkpoint();
+    memset(journal->records, 0, sizeof(journal->records));
+
+    HANDLE thread = CreateThread(NULL, 0, journal_checkpoint_thread, NULL, 0, NULL);
+    if (thread == NULL) {
+        printf("ERROR: Failed to start the journal checkpoint thread\n");
+        return false;
+    }
+    // Keep the checkpoints off the core the FreeRTOS tasks run on
+    SetThreadAffinityMask(thread, ~0x01u);
+
+    QueryPerformanceCounter(&end);
+    double elapsed_ms = (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+    if (replayed < 0) {
+        printf("Journal %s: started from the initial marking (%.2f ms)\n", path, elapsed_ms);
+    } else {
+        printf("Journal %s: restored the checkpoint and %d later record(s) in %.2f ms\n",
+            path, replayed, elapsed_ms);
+    }
+
+    journal_recording = true;
+    return true;
+}
+
+#endif /* MARKING_JOURNAL_ENABLED */
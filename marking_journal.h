@@ -0,0 +1,70 @@
+/*
+ * Marking journal: restart where a crashed run left off.
+ *
+ * With PETRI_JOURNAL=<file> set, the marking survives a crash of the
+ * process. The file is mapped into memory and holds a ring of compact
+ * records, one per firing (or batch of firings of one transition) and per
+ * token addition, plus two checkpoint slots. The hooks run inside the
+ * firing's critical section: one interlocked increment reserves a record
+ * and four stores fill it in, so the fire path never makes a system call;
+ * the operating system writes the dirty pages back on its own, also after
+ * the process has died.
+ *
+ * A native thread copies the marking into the older checkpoint slot every
+ * JOURNAL_CHECKPOINT_MS, or sooner if a quarter of the ring has been used
+ * since the last one, using the seqlock snapshots so it never stops a
+ * line. Every checkpoint and record carries the marking versions of its
+ * line and of the shared places, so startup restores the newest checkpoint
+ * and replays only the records after it, skipping the parts of any firing
+ * the checkpoint already contains. That takes milliseconds whatever the
+ * length of the run before.
+ *
+ * The journal protects against a crash of the process, not against power
+ * loss: nothing is flushed to disk from the firing path. A journal written
+ * by a different net, or with a different number of lines or set of
+ * shared places, is started afresh.
+ */
+
+#ifndef MARKING_JOURNAL_H
+#define MARKING_JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Set to 0 to compile the hooks in the firing path out. */
+#ifndef MARKING_JOURNAL_ENABLED
+#define MARKING_JOURNAL_ENABLED 1
+#endif
+
+/* Environment variable naming the journal file, e.g. PETRI_JOURNAL=line.journal. */
+#define JOURNAL_ENV "PETRI_JOURNAL"
+
+#define JOURNAL_RECORDS 65536          // Ring size, a power of two; 20 bytes each
+#define JOURNAL_CHECKPOINT_MS 1000     // Checkpoint at least this often while firings happen
+#define JOURNAL_POLL_MS 50             // How often the checkpoint thread looks at the ring
+
+struct PetriNet;                       // petri_net.h
+
+#if MARKING_JOURNAL_ENABLED
+
+bool marking_journal_open(const char* path);
+bool marking_journal_start(void);
+
+void journal_firing_locked(const struct PetriNet* net, int trans_idx, int count);
+void journal_tokens_added_locked(const struct PetriNet* net, int place_idx, int count);
+
+#else
+
+static inline bool marking_journal_open(const char* path) { (void)path; return false; }
+static inline bool marking_journal_start(void) { return true; }
+
+static inline void journal_firing_locked(const struct PetriNet* net, int trans_idx, int count) {
+    (void)net; (void)trans_idx; (void)count;
+}
+static inline void journal_tokens_added_locked(const struct PetriNet* net, int place_idx, int count) {
+    (void)net; (void)place_idx; (void)count;
+}
+
+#endif
+
+#endif /* MARKING_JOURNAL_H */
@@ -0,0 +1,483 @@
+/*
+ * Performance metrics: per-task shards, token sojourn tracking and the
+ * Prometheus text rendering for /metrics. See metrics.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "json_writer.h"
+#include "petri_net.h"
+#include "metrics.h"
+
+#if METRICS_ENABLED
+
+/*
+ * 64-bit counters are written by one task and read by the I/O thread.
+ * Aligned 64-bit loads and stores are single instructions on x64; the
+ * 32-bit build goes through the interlocked helpers so the reader never
+ * sees a torn value.
+ */
+#if defined(_MSC_VER) && !defined(_WIN64)
+#define COUNTER_ADD(p, v)   InterlockedExchangeAdd64((volatile LONGLONG*)(p), (LONGLONG)(v))
+#define COUNTER_LOAD(p)     ((uint64_t)InterlockedCompareExchange64((volatile LONGLONG*)(p), 0, 0))
+#else
+#define COUNTER_ADD(p, v)   (*(p) += (v))
+#define COUNTER_LOAD(p)     (*(p))
+#endif
+
+#define SHARD_COMMON 0                 // Tasks that never registered
+
+struct MetricsShard {
+    const char* station;           // Label for busy/idle time, NULL for the common shard
+    volatile uint64_t fires[MAX_TRANSITIONS];
+    volatile uint64_t failed[MAX_TRANSITIONS];
+    volatile uint64_t lock_wait[MAX_TRANSITIONS];   // Cycle counter ticks
+    volatile uint32_t sojourn[MAX_PLACES][METRICS_SOJOURN_BUCKETS];
+    volatile uint64_t sojourn_sum[MAX_PLACES];      // Cycle counter ticks
+    volatile uint64_t busy;
+    volatile uint64_t idle;
+};
+
+static MetricsShard shards[METRICS_MAX_SHARDS];
+static volatile LONG num_shards = SHARD_COMMON + 1;
+
+// Sojourn bucket bounds in milliseconds; the last bucket is +Inf
+static const uint32_t sojourn_bounds_ms[METRICS_SOJOURN_BUCKETS - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000, 300000, 900000
+};
+static uint64_t sojourn_bounds[METRICS_SOJOURN_BUCKETS - 1];   // In counter ticks
+static uint64_t ticks_per_second = 1;
+
+/*
+ * Arrival times of the tokens in each place of each line, oldest first,
+ * kept as runs of tokens that arrived together. Only touched inside the
+ * line's critical section; a shared place uses line 0's queue under the
+ * shared places' lock. When a place runs out of runs, new arrivals join
+ * the newest run and are aged from its start.
+ */
+typedef struct {
+    uint64_t since;
+    int32_t count;
+} ArrivalRun;
+
+typedef struct {
+    ArrivalRun runs[METRICS_ARRIVAL_RUNS];
+    int head;
+    int len;
+} ArrivalQueue;
+
+static ArrivalQueue arrivals[PETRI_MAX_LINES][MAX_PLACES];
+static volatile int32_t high_water[PETRI_MAX_LINES][MAX_PLACES];
+
+/**
+ * @brief Line whose arrival queue and high-water mark track a place.
+ */
+static inline int metrics_line(const PetriNet* net, int place_idx) {
+    return is_shared_place(place_idx) ? 0 : net->line;
+}
+
+// ====================
+// RECORDING (RTOS SIDE)
+// ====================
+
+/**
+ * @brief Current high-resolution timestamp in cycle counter ticks.
+ * A single instruction that never calls into Windows, so the firing path
+ * may take it inside the net's lock.
+ */
+uint64_t metrics_now(void) {
+    return __rdtsc();
+}
+
+static void arrivals_push_locked(int line, int place_idx, int count, uint64_t now) {
+    ArrivalQueue* q = &arrivals[line][place_idx];
+
+    if (q->len > 0) {
+        ArrivalRun* last = &q->runs[(q->head + q->len - 1) % METRICS_ARRIVAL_RUNS];
+        if (last->since == now || q->len == METRICS_ARRIVAL_RUNS) {
+            last->count += count;
+            return;
+        }
+    }
+    ArrivalRun* run = &q->runs[(q->head + q->len) % METRICS_ARRIVAL_RUNS];
+    run->since = now;
+    run->count = count;
+    q->len++;
+}
+
+static void record_sojourn(MetricsShard* shard, int place_idx, uint64_t ticks, int count) {
+    int b = 0;
+    while (b < METRICS_SOJOURN_BUCKETS - 1 && ticks > sojourn_bounds[b]) {
+        b++;
+    }
+    shard->sojourn[place_idx][b] += (uint32_t)count;
+    COUNTER_ADD(&shard->sojourn_sum[place_idx], ticks * (uint64_t)count);
+}
+
+/**
+ * @brief Take the oldest tokens out of a place's arrival queue and record how long they stayed.
+ * @param shard Shard to record the sojourns in, or NULL to drop the tokens unrecorded.
+ */
+static void arrivals_pop_locked(MetricsShard* shard, int line, int place_idx, int count, uint64_t now) {
+    ArrivalQueue* q = &arrivals[line][place_idx];
+
+    while (count > 0 && q->len > 0) {
+        ArrivalRun* run = &q->runs[q->head];
+        int taken = run->count < count ? run->count : count;
+
+        if (shard != NULL) {
+            record_sojourn(shard, place_idx, now - run->since, taken);
+        }
+        run->count -= taken;
+        count -= taken;
+        if (run->count == 0) {
+            q->head = (q->head + 1) % METRICS_ARRIVAL_RUNS;
+            q->len--;
+        }
+    }
+}
+
+/**
+ * @brief Rate of the cycle counter, measured against the performance
+ * counter over METRICS_CALIBRATION_MS.
+ */
+static uint64_t measure_ticks_per_second(void) {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+
+    if (!QueryPerformanceFrequency(&frequency) || frequency.QuadPart <= 0) {
+        return 1;
+    }
+    QueryPerformanceCounter(&start);
+    uint64_t cycles_start = __rdtsc();
+    do {
+        QueryPerformanceCounter(&end);
+    } while (end.QuadPart - start.QuadPart < frequency.QuadPart * METRICS_CALIBRATION_MS / 1000);
+    uint64_t cycles = __rdtsc() - cycles_start;
+
+    return cycles * (uint64_t)frequency.QuadPart / (uint64_t)(end.QuadPart - start.QuadPart);
+}
+
+/**
+ * @brief Reset all metrics and start the sojourn clocks of the current marking.
+ * Call once the lines are instantiated, before the scheduler starts.
+ */
+void metrics_init(void) {
+    ticks_per_second = measure_ticks_per_second();
+    for (int b = 0; b < METRICS_SOJOURN_BUCKETS - 1; b++) {
+        sojourn_bounds[b] = (uint64_t)sojourn_bounds_ms[b] * ticks_per_second / 1000;
+    }
+
+    memset(shards, 0, sizeof(shards));
+    memset(arrivals, 0, sizeof(arrivals));
+    num_shards = SHARD_COMMON + 1;
+
+    uint64_t now = metrics_now();
+    for (int l = 0; l < petri_num_lines; l++) {
+        for (int p = 0; p < manufacturing_model.num_places; p++) {
+            if (is_shared_place(p) && l > 0) {
+                continue;
+            }
+            int tokens = get_place_tokens(&petri_lines[l], p);
+            high_water[l][p] = tokens;
+            if (tokens > 0) {
+                arrivals_push_locked(l, p, tokens, now);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Take a shard of its own for a station, whether or not it has a task.
+ * @param station Label for the station's busy and idle time.
+ * @return The shard, or NULL once all METRICS_MAX_SHARDS are taken.
+ */
+MetricsShard* metrics_add_shard(const char* station) {
+    MetricsShard* shard = NULL;
+
+    taskENTER_CRITICAL();
+    if (num_shards < METRICS_MAX_SHARDS) {
+        shard = &shards[num_shards];
+        shard->station = station;
+        // Publish the label before the count so the scraper never sees a half-made shard
+        NET_MEMORY_BARRIER();
+        num_shards++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (shard == NULL) {
+        printf("ERROR: More than %d metrics shards, %s uses the common one\n", METRICS_MAX_SHARDS, station);
+    }
+    return shard;
+}
+
+/**
+ * @brief Give the calling task its own shard. Call once at the top of a station task.
+ * @param station Label for the station's busy and idle time.
+ */
+void metrics_register_task(const char* station) {
+    MetricsShard* shard = metrics_add_shard(station);
+
+    if (shard != NULL) {
+        vTaskSetThreadLocalStoragePointer(NULL, METRICS_TLS_INDEX, shard);
+    }
+}
+
+/**
+ * @brief Shard of the calling task, or the common shard if it has none.
+ */
+MetricsShard* metrics_shard(void) {
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        MetricsShard* shard = (MetricsShard*)pvTaskGetThreadLocalStoragePointer(NULL, METRICS_TLS_INDEX);
+        if (shard != NULL) {
+            return shard;
+        }
+    }
+    return &shards[SHARD_COMMON];
+}
+
+/**
+ * @brief Count one fire call and the time it waited for the net's critical section.
+ */
+void metrics_attempt(MetricsShard* shard, int trans_idx, bool fired, uint64_t lock_wait) {
+    if (!fired) {
+        COUNTER_ADD(&shard->failed[trans_idx], 1);
+    }
+    COUNTER_ADD(&shard->lock_wait[trans_idx], lock_wait);
+}
+
+/**
+ * @brief Account for count firings of a transition whose marking update is done.
+ * Caller must hold the same locks as the firing.
+ */
+void metrics_firing_locked(MetricsShard* shard, const PetriNet* net, int trans_idx, int count, uint64_t now) {
+    COUNTER_ADD(&shard->fires[trans_idx], count);
+    for (PetriIndex a = net->in_start[trans_idx]; a < net->in_start[trans_idx + 1]; a++) {
+        int place = net->in_arcs[a].place;
+        arrivals_pop_locked(shard, metrics_line(net, place), place, net->in_arcs[a].weight * count, now);
+    }
+    for (PetriIndex a = net->out_start[trans_idx]; a < net->out_start[trans_idx + 1]; a++) {
+        metrics_tokens_added_locked(net, net->out_arcs[a].place, net->out_arcs[a].weight * count, now);
+    }
+}
+
+/**
+ * @brief Account for tokens added to a place whose marking is already updated;
+ * a negative count takes tokens out. Caller must be inside the line's critical section (task or ISR variant),
+ * and the shared places' one for a shared place.
+ */
+void metrics_tokens_added_locked(const PetriNet* net, int place_idx, int count, uint64_t now) {
+    int line = metrics_line(net, place_idx);
+    int tokens = get_place_tokens(net, place_idx);
+
+    if (count < 0) {
+        // Taken out from outside the net: the oldest go, without a sojourn
+        arrivals_pop_locked(NULL, line, place_idx, -count, now);
+        return;
+    }
+    arrivals_push_locked(line, place_idx, count, now);
+    if (tokens > high_water[line][place_idx]) {
+        high_water[line][place_idx] = tokens;
+    }
+}
+
+/**
+ * @brief Add time the calling station spent working.
+ */
+void metrics_busy(uint64_t ticks) {
+    metrics_shard_busy(metrics_shard(), ticks);
+}
+
+/**
+ * @brief Add time the calling station spent waiting for an enabled transition.
+ */
+void metrics_idle(uint64_t ticks) {
+    metrics_shard_idle(metrics_shard(), ticks);
+}
+
+/**
+ * @brief Add working time to a station's shard, e.g. one the station executor
+ * runs; NULL counts it in the common shard. Only one task may write a shard.
+ */
+void metrics_shard_busy(MetricsShard* shard, uint64_t ticks) {
+    if (shard == NULL) {
+        shard = &shards[SHARD_COMMON];
+    }
+    COUNTER_ADD(&shard->busy, ticks);
+}
+
+/**
+ * @brief Add waiting time to a station's shard, see metrics_shard_busy().
+ */
+void metrics_shard_idle(MetricsShard* shard, uint64_t ticks) {
+    if (shard == NULL) {
+        shard = &shards[SHARD_COMMON];
+    }
+    COUNTER_ADD(&shard->idle, ticks);
+}
+
+// ====================
+// PROMETHEUS RENDERING (I/O THREAD)
+// ====================
+
+/**
+ * @brief Append one sample line: name{key="value"[,le="..."]} value.
+ * The label value is escaped as the text format requires.
+ */
+static void text_sample(JsonWriter* out, const char* name, const char* key, const char* value,
+        const char* le, const char* number) {
+    json_append(out, "%s{%s=\"", name, key);
+    for (const char* c = value; *c != '\0'; c++) {
+        if (*c == '\\' || *c == '"') {
+            json_append(out, "\\%c", *c);
+        } else if (*c == '\n') {
+            json_append(out, "\\n");
+        } else {
+            json_append(out, "%c", *c);
+        }
+    }
+    json_append(out, "\"");
+    if (le != NULL) {
+        json_append(out, ",le=\"%s\"", le);
+    }
+    json_append(out, "} %s\n", number);
+}
+
+static void text_header(JsonWriter* out, const char* name, const char* type, const char* help) {
+    json_append(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void format_count(char* number, size_t size, uint64_t value) {
+    snprintf(number, size, "%llu", (unsigned long long)value);
+}
+
+static void format_seconds(char* number, size_t size, uint64_t ticks) {
+    snprintf(number, size, "%.6f", (double)ticks / (double)ticks_per_second);
+}
+
+typedef enum {
+    TRANSITION_FIRES,
+    TRANSITION_FAILED,
+    TRANSITION_LOCK_WAIT
+} TransitionCounter;
+
+static uint64_t sum_transition(int shard_count, int trans_idx, TransitionCounter which) {
+    uint64_t total = 0;
+    for (int s = 0; s < shard_count; s++) {
+        const MetricsShard* shard = &shards[s];
+        if (which == TRANSITION_FIRES) {
+            total += COUNTER_LOAD(&shard->fires[trans_idx]);
+        } else if (which == TRANSITION_FAILED) {
+            total += COUNTER_LOAD(&shard->failed[trans_idx]);
+        } else {
+            total += COUNTER_LOAD(&shard->lock_wait[trans_idx]);
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Render every metric in the Prometheus text exposition format.
+ * Runs on the I/O thread: it sums the shards and takes a marking snapshot
+ * without calling into the kernel.
+ * @return Length written, or -1 if the buffer is too small.
+ */
+int metrics_render(char* buffer, size_t size) {
+    static const char* const transition_metrics[] = {
+        "petri_transition_fires_total",
+        "petri_transition_failed_total",
+        "petri_transition_lock_wait_seconds_total"
+    };
+    static const char* const transition_help[] = {
+        "Successful firings.",
+        "Fire calls that found the transition disabled.",
+        "Time fire calls waited for the net critical section."
+    };
+    const PetriModel* net = &manufacturing_model;
+    JsonWriter out = { buffer, (int)size, 0 };
+    PetriSnapshot snapshot;
+    char number[32];
+    int shard_count = (int)num_shards;
+
+    NET_MEMORY_BARRIER();
+    petri_snapshot_all(&snapshot);
+
+    for (int m = TRANSITION_FIRES; m <= TRANSITION_LOCK_WAIT; m++) {
+        text_header(&out, transition_metrics[m], "counter", transition_help[m]);
+        for (int t = 0; t < net->num_transitions; t++) {
+            uint64_t total = sum_transition(shard_count, t, (TransitionCounter)m);
+            if (m == TRANSITION_LOCK_WAIT) {
+                format_seconds(number, sizeof(number), total);
+            } else {
+                format_count(number, sizeof(number), total);
+            }
+            text_sample(&out, transition_metrics[m], "transition", net->transitions[t].name, NULL, number);
+        }
+    }
+
+    text_header(&out, "petri_place_tokens", "gauge", "Tokens in the place, summed over the lines.");
+    for (int p = 0; p < snapshot.num_places; p++) {
+        snprintf(number, sizeof(number), "%ld", (long)snapshot.marking[p]);
+        text_sample(&out, "petri_place_tokens", "place", net->places[p].name, NULL, number);
+    }
+
+    text_header(&out, "petri_place_tokens_max", "gauge", "Most tokens the place has held on any line since startup.");
+    for (int p = 0; p < net->num_places; p++) {
+        int32_t most = 0;
+        for (int l = 0; l < petri_num_lines; l++) {
+            if (high_water[l][p] > most) {
+                most = high_water[l][p];
+            }
+        }
+        snprintf(number, sizeof(number), "%ld", (long)most);
+        text_sample(&out, "petri_place_tokens_max", "place", net->places[p].name, NULL, number);
+    }
+
+    text_header(&out, "petri_place_sojourn_seconds", "histogram",
+        "Time tokens spent in the place, assuming they leave in arrival order.");
+    for (int p = 0; p < net->num_places; p++) {
+        uint64_t cumulative = 0;
+        uint64_t sum = 0;
+        for (int b = 0; b < METRICS_SOJOURN_BUCKETS; b++) {
+            char le[16];
+            for (int s = 0; s < shard_count; s++) {
+                cumulative += shards[s].sojourn[p][b];
+            }
+            if (b < METRICS_SOJOURN_BUCKETS - 1) {
+                snprintf(le, sizeof(le), "%g", sojourn_bounds_ms[b] / 1000.0);
+            } else {
+                snprintf(le, sizeof(le), "+Inf");
+            }
+            format_count(number, sizeof(number), cumulative);
+            text_sample(&out, "petri_place_sojourn_seconds_bucket", "place", net->places[p].name, le, number);
+        }
+        for (int s = 0; s < shard_count; s++) {
+            sum += COUNTER_LOAD(&shards[s].sojourn_sum[p]);
+        }
+        format_seconds(number, sizeof(number), sum);
+        text_sample(&out, "petri_place_sojourn_seconds_sum", "place", net->places[p].name, NULL, number);
+        format_count(number, sizeof(number), cumulative);
+        text_sample(&out, "petri_place_sojourn_seconds_count", "place", net->places[p].name, NULL, number);
+    }
+
+    text_header(&out, "petri_station_busy_seconds_total", "counter", "Time the station spent working.");
+    for (int s = SHARD_COMMON + 1; s < shard_count; s++) {
+        format_seconds(number, sizeof(number), COUNTER_LOAD(&shards[s].busy));
+        text_sample(&out, "petri_station_busy_seconds_total", "station", shards[s].station, NULL, number);
+    }
+    text_header(&out, "petri_station_idle_seconds_total", "counter", "Time the station spent waiting for work.");
+    for (int s = SHARD_COMMON + 1; s < shard_count; s++) {
+        format_seconds(number, sizeof(number), COUNTER_LOAD(&shards[s].idle));
+        text_sample(&out, "petri_station_idle_seconds_total", "station", shards[s].station, NULL, number);
+    }
+
+    return json_complete(&out) ? out.len : -1;
+}
+
+#endif /* METRICS_ENABLED */
@@ -0,0 +1,86 @@
+/*
+ * Performance metrics for the manufacturing process control demo.
+ *
+ * Every task that fires transitions registers a shard: a private block of
+ * counters that only it writes, found through a thread local storage
+ * pointer, so recording a firing shares no cache lines and takes no extra
+ * lock. Tasks that never register share one common shard, and stations
+ * without a task of their own (the station executor's) hold theirs
+ * directly. Shards
+ * are only summed when /metrics is scraped, on the status server's I/O
+ * thread, which reads them without calling into the kernel.
+ *
+ * Recorded:
+ *  - per transition: firings, failed attempts, time spent waiting for the
+ *    net's critical section in the fire calls
+ *  - per place: high-water mark and a histogram of token sojourn times
+ *    (tokens are assumed to leave a place in arrival order)
+ *  - per station: time busy in station_work() and idle waiting for work
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Set to 0 to compile the hooks in the firing path out. */
+#ifndef METRICS_ENABLED
+#define METRICS_ENABLED 1
+#endif
+
+#define METRICS_MAX_SHARDS 40            // Every station and worker of PETRI_MAX_LINES lines
+#define METRICS_TLS_INDEX 0            // Thread local storage slot holding the task's shard
+#define METRICS_ARRIVAL_RUNS 32        // Arrival batches remembered per place for sojourn times
+#define METRICS_SOJOURN_BUCKETS 12     // Finite bounds in metrics.c plus +Inf
+#define METRICS_TEXT_BUFFER (128 * 1024)
+#define METRICS_CALIBRATION_MS 20      // Time metrics_init() spends measuring the cycle counter
+
+typedef struct MetricsShard MetricsShard;
+struct PetriNet;                       // petri_net.h
+
+#if METRICS_ENABLED
+
+void metrics_init(void);
+void metrics_register_task(const char* station);
+MetricsShard* metrics_add_shard(const char* station);
+int metrics_render(char* buffer, size_t size);
+
+MetricsShard* metrics_shard(void);
+uint64_t metrics_now(void);
+void metrics_attempt(MetricsShard* shard, int trans_idx, bool fired, uint64_t lock_wait);
+void metrics_firing_locked(MetricsShard* shard, const struct PetriNet* net, int trans_idx, int count, uint64_t now);
+void metrics_tokens_added_locked(const struct PetriNet* net, int place_idx, int count, uint64_t now);
+void metrics_busy(uint64_t ticks);
+void metrics_idle(uint64_t ticks);
+void metrics_shard_busy(MetricsShard* shard, uint64_t ticks);
+void metrics_shard_idle(MetricsShard* shard, uint64_t ticks);
+
+#else
+
+static inline void metrics_init(void) {}
+static inline void metrics_register_task(const char* station) { (void)station; }
+static inline MetricsShard* metrics_add_shard(const char* station) { (void)station; return NULL; }
+static inline int metrics_render(char* buffer, size_t size) { (void)buffer; (void)size; return -1; }
+
+static inline MetricsShard* metrics_shard(void) { return NULL; }
+static inline uint64_t metrics_now(void) { return 0; }
+static inline void metrics_attempt(MetricsShard* shard, int trans_idx, bool fired, uint64_t lock_wait) {
+    (void)shard; (void)trans_idx; (void)fired; (void)lock_wait;
+}
+static inline void metrics_firing_locked(MetricsShard* shard, const struct PetriNet* net, int trans_idx, int count,
+                                         uint64_t now) {
+    (void)shard; (void)net; (void)trans_idx; (void)count; (void)now;
+}
+static inline void metrics_tokens_added_locked(const struct PetriNet* net, int place_idx, int count, uint64_t now) {
+    (void)net; (void)place_idx; (void)count; (void)now;
+}
+static inline void metrics_busy(uint64_t ticks) { (void)ticks; }
+static inline void metrics_idle(uint64_t ticks) { (void)ticks; }
+static inline void metrics_shard_busy(MetricsShard* shard, uint64_t ticks) { (void)shard; (void)ticks; }
+static inline void metrics_shard_idle(MetricsShard* shard, uint64_t ticks) { (void)shard; (void)ticks; }
+
+#endif
+
+#endif /* METRICS_H */
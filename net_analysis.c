@@ -0,0 +1,1003 @@
+/*
+ * Steady-state analysis of the manufacturing Petri net.
+ * See net_analysis.h for what is computed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "net_analysis.h"
+#include "json_writer.h"
+
+#define ANALYSIS_MAX_DIM (MAX_PLACES > MAX_TRANSITIONS ? MAX_PLACES : MAX_TRANSITIONS)
+#define ANALYSIS_EPSILON 1e-9
+#define MS_PER_HOUR 3600000.0
+
+typedef struct {
+    int32_t weight[ANALYSIS_MAX_DIM];  // Per place (P-invariant) or per transition (T-invariant)
+    int64_t tokens;                    // P-invariants: weighted initial marking
+} NetInvariant;
+
+typedef enum {
+    CONSTRAINT_STATION,            // Each task of a station fires one transition at a time
+    CONSTRAINT_POOL                // A marked P-invariant, e.g. the worker pool
+} ConstraintKind;
+
+typedef struct {
+    ConstraintKind kind;
+    int index;                     // Server, or P-invariant
+    int home_place;                // Pool: place that holds the idle tokens
+    double capacity;               // Tasks per station, tokens per pool
+    double demand_ms;              // Busy (token-)milliseconds per reference firing
+    double max_per_hour;           // Reference firings per hour this constraint alone allows
+    double utilization;            // At the bottleneck rate
+    double scaled_per_hour[ANALYSIS_SCALE_STEPS + 1]; // Pool: throughput with 0..N extra tokens
+    int scaled_limit[ANALYSIS_SCALE_STEPS + 1];       // Constraint that binds at each step
+} AnalysisConstraint;
+
+typedef struct {
+    uint32_t states;               // Distinct markings stored
+    bool complete;                 // The whole reachability set fit in the bound
+    bool overflow;                 // Some successor had a place above 32767 tokens and was cut
+    const char* skipped;           // Why the search did not run, or NULL
+    uint32_t dead_markings;
+    uint32_t dead_example[ANALYSIS_MAX_DEAD_MARKINGS];
+    int num_dead_examples;
+    int32_t bound[MAX_PLACES];     // Largest token count seen per place
+    uint32_t ever_enabled[TRANSITION_MASK_WORDS];
+} ReachabilityResult;
+
+typedef struct {
+    bool valid;
+    const char* const* server_names;
+    int server_capacity[ANALYSIS_MAX_SERVERS];
+    int num_servers;
+    int reference;
+
+    NetInvariant p_invariants[ANALYSIS_MAX_INVARIANTS];
+    int num_p_invariants;          // Found; only the first ANALYSIS_MAX_INVARIANTS are kept
+    bool p_truncated;              // Search gave up at ANALYSIS_MAX_ROWS
+    NetInvariant t_invariants[ANALYSIS_MAX_INVARIANTS];
+    int num_t_invariants;
+    bool t_truncated;
+
+    double visits[MAX_TRANSITIONS];
+    const char* visits_problem;    // Why the visit ratios are unreliable, or NULL
+
+    AnalysisConstraint constraints[ANALYSIS_MAX_SERVERS + ANALYSIS_MAX_INVARIANTS];
+    int num_constraints;
+    int bottleneck;                // Index into constraints, or -1 if nothing is timed
+    double max_per_hour;           // Reference firings per hour at the bottleneck
+
+    ReachabilityResult reach;
+
+    char json[ANALYSIS_JSON_BUFFER];
+    int json_len;
+} AnalysisResult;
+
+static AnalysisResult analysis;
+
+// Dense copy of the arc weights, [place][transition]
+static int32_t arc_in[MAX_PLACES][MAX_TRANSITIONS];
+static int32_t arc_out[MAX_PLACES][MAX_TRANSITIONS];
+
+static uint32_t service_ms[MAX_TRANSITIONS];
+static int server_of[MAX_TRANSITIONS];
+static uint16_t route_weight[MAX_TRANSITIONS];
+
+// ====================
+// INVARIANTS
+// ====================
+
+/*
+ * Farkas working rows: the first m columns hold the row of the matrix
+ * being eliminated, the next n columns the combination of original rows
+ * it came from. Two buffers, swapped after every eliminated column.
+ */
+static int32_t farkas_rows[2][ANALYSIS_MAX_ROWS][2 * ANALYSIS_MAX_DIM];
+
+static int64_t gcd64(int64_t a, int64_t b) {
+    a = a < 0 ? -a : a;
+    b = b < 0 ? -b : b;
+    while (b != 0) {
+        int64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/**
+ * @brief Whether every non-zero column of b in [from, to) is non-zero in a.
+ */
+static bool support_covers(const int32_t* a, const int32_t* b, int from, int to) {
+    for (int i = from; i < to; i++) {
+        if (b[i] != 0 && a[i] == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int32_t incidence(int place, int trans) {
+    return arc_out[place][trans] - arc_in[place][trans];
+}
+
+/**
+ * @brief Minimal-support semi-positive invariants of the incidence matrix.
+ * @param by_place true for P-invariants (y.C = 0), false for T-invariants (C.x = 0).
+ * @param truncated Set when the working set outgrew ANALYSIS_MAX_ROWS; no
+ *        invariants are returned then.
+ * @return Number of invariants found (may exceed ANALYSIS_MAX_INVARIANTS).
+ */
+static int find_invariants(bool by_place, NetInvariant* out, bool* truncated) {
+    const PetriModel* net = &manufacturing_model;
+    int n = by_place ? net->num_places : net->num_transitions;
+    int m = by_place ? net->num_transitions : net->num_places;
+    int width = m + n;
+    int cur = 0;
+    int rows = n;
+
+    *truncated = false;
+    for (int i = 0; i < n; i++) {
+        int32_t* row = farkas_rows[cur][i];
+        memset(row, 0, sizeof(farkas_rows[cur][i]));
+        for (int j = 0; j < m; j++) {
+            row[j] = by_place ? incidence(i, j) : incidence(j, i);
+        }
+        row[m + i] = 1;
+    }
+
+    for (int col = 0; col < m; col++) {
+        int32_t (*src)[2 * ANALYSIS_MAX_DIM] = farkas_rows[cur];
+        int32_t (*dst)[2 * ANALYSIS_MAX_DIM] = farkas_rows[cur ^ 1];
+        int kept = 0;
+
+        for (int r = 0; r < rows; r++) {
+            if (src[r][col] == 0) {
+                memcpy(dst[kept++], src[r], sizeof(src[r]));
+            }
+        }
+
+        // Cancel the column in every pair of rows with opposite signs
+        for (int a = 0; a < rows; a++) {
+            if (src[a][col] <= 0) {
+                continue;
+            }
+            for (int b = 0; b < rows; b++) {
+                if (src[b][col] >= 0) {
+                    continue;
+                }
+                if (kept == ANALYSIS_MAX_ROWS) {
+                    *truncated = true;
+                    return 0;
+                }
+
+                int64_t combined[2 * ANALYSIS_MAX_DIM];
+                int64_t divisor = 0;
+                for (int k = 0; k < width; k++) {
+                    combined[k] = (int64_t)-src[b][col] * src[a][k] + (int64_t)src[a][col] * src[b][k];
+                    divisor = gcd64(divisor, combined[k]);
+                }
+
+                int32_t* row = dst[kept];
+                bool fits = divisor != 0;
+                memset(row, 0, sizeof(dst[kept]));
+                for (int k = 0; k < width && fits; k++) {
+                    int64_t v = combined[k] / divisor;
+                    fits = v <= INT32_MAX && v >= -INT32_MAX;
+                    row[k] = (int32_t)v;
+                }
+                if (!fits) {
+                    *truncated = true;
+                    return 0;
+                }
+
+                // A row whose support covers another's can only yield non-minimal invariants
+                bool redundant = false;
+                for (int k = 0; k < kept && !redundant; k++) {
+                    redundant = support_covers(row, dst[k], m, width);
+                }
+                if (!redundant) {
+                    kept++;
+                }
+            }
+        }
+
+        cur ^= 1;
+        rows = kept;
+    }
+
+    // Keep the rows of minimal support, once each
+    int found = 0;
+    for (int r = 0; r < rows; r++) {
+        const int32_t* row = farkas_rows[cur][r];
+        bool minimal = true;
+        for (int k = 0; k < rows && minimal; k++) {
+            if (k == r || !support_covers(row, farkas_rows[cur][k], m, width)) {
+                continue;
+            }
+            // Row k's support is inside this one: drop this row, unless
+            // the supports are equal and this is the first of them
+            if (!support_covers(farkas_rows[cur][k], row, m, width) || k < r) {
+                minimal = false;
+            }
+        }
+        if (!minimal) {
+            continue;
+        }
+
+        if (found < ANALYSIS_MAX_INVARIANTS) {
+            NetInvariant* inv = &out[found];
+            memset(inv, 0, sizeof(*inv));
+            for (int i = 0; i < n; i++) {
+                inv->weight[i] = row[m + i];
+                if (by_place) {
+                    inv->tokens += (int64_t)row[m + i] * manufacturing_model.initial_marking[i];
+                }
+            }
+        }
+        found++;
+    }
+    return found;
+}
+
+// ====================
+// VISIT RATIOS
+// ====================
+
+// Flow balance, routing and normalization rows, augmented with the right-hand side
+static double flow_rows[MAX_PLACES + MAX_TRANSITIONS + 1][MAX_TRANSITIONS + 1];
+
+/**
+ * @brief Solve for the firings of every transition per reference firing.
+ *
+ * Every place with both producers and consumers must see as many tokens
+ * leave as arrive; transitions that share an input place and carry a
+ * route_weight split its tokens in proportion to their weights; the
+ * reference transition fires once.
+ */
+static void solve_visit_ratios(void) {
+    const PetriModel* net = &manufacturing_model;
+    int nt = net->num_transitions;
+    int rows = 0;
+
+    analysis.visits_problem = NULL;
+    memset(flow_rows, 0, sizeof(flow_rows));
+
+    for (int p = 0; p < net->num_places; p++) {
+        bool produced = false;
+        bool consumed = false;
+        for (int t = 0; t < nt; t++) {
+            produced |= arc_out[p][t] > 0;
+            consumed |= arc_in[p][t] > 0;
+        }
+        if (!produced || !consumed) {
+            continue;              // Source or sink of the line
+        }
+        for (int t = 0; t < nt; t++) {
+            flow_rows[rows][t] = incidence(p, t);
+        }
+        rows++;
+
+        // Routing decision at this place: x_a / w_a == x_b / w_b
+        int first = -1;
+        for (int t = 0; t < nt; t++) {
+            if (arc_in[p][t] == 0 || route_weight[t] == 0) {
+                continue;
+            }
+            if (first < 0) {
+                first = t;
+                continue;
+            }
+            flow_rows[rows][first] = route_weight[t];
+            flow_rows[rows][t] = -(double)route_weight[first];
+            rows++;
+        }
+    }
+
+    flow_rows[rows][analysis.reference] = 1.0;
+    flow_rows[rows][nt] = 1.0;
+    rows++;
+
+    // Gauss-Jordan elimination with partial pivoting
+    int pivot_row[MAX_TRANSITIONS];
+    int rank = 0;
+    for (int col = 0; col < nt; col++) {
+        int best = -1;
+        double best_abs = ANALYSIS_EPSILON;
+        for (int r = rank; r < rows; r++) {
+            double v = flow_rows[r][col] < 0 ? -flow_rows[r][col] : flow_rows[r][col];
+            if (v > best_abs) {
+                best = r;
+                best_abs = v;
+            }
+        }
+        pivot_row[col] = -1;
+        if (best < 0) {
+            continue;
+        }
+
+        if (best != rank) {
+            for (int k = 0; k <= nt; k++) {
+                double tmp = flow_rows[rank][k];
+                flow_rows[rank][k] = flow_rows[best][k];
+                flow_rows[best][k] = tmp;
+            }
+        }
+        double scale = flow_rows[rank][col];
+        for (int k = 0; k <= nt; k++) {
+            flow_rows[rank][k] /= scale;
+        }
+        for (int r = 0; r < rows; r++) {
+            double factor = flow_rows[r][col];
+            if (r == rank || factor == 0.0) {
+                continue;
+            }
+            for (int k = 0; k <= nt; k++) {
+                flow_rows[r][k] -= factor * flow_rows[rank][k];
+            }
+        }
+        pivot_row[col] = rank++;
+    }
+
+    for (int r = rank; r < rows; r++) {
+        double rhs = flow_rows[r][nt];
+        if (rhs > 1e-6 || rhs < -1e-6) {
+            analysis.visits_problem = "flow cannot balance: some internal place fills up or drains at any firing rate";
+        }
+    }
+
+    for (int t = 0; t < nt; t++) {
+        analysis.visits[t] = pivot_row[t] >= 0 ? flow_rows[pivot_row[t]][nt] : 0.0;
+        if (analysis.visits[t] > -ANALYSIS_EPSILON && analysis.visits[t] < ANALYSIS_EPSILON) {
+            analysis.visits[t] = 0.0;
+        }
+        if (pivot_row[t] < 0 && analysis.visits_problem == NULL) {
+            analysis.visits_problem = "some firing ratios are not fixed by the net; give the decisions route weights";
+        }
+        if (analysis.visits[t] < 0.0 && analysis.visits_problem == NULL) {
+            analysis.visits_problem = "negative firing ratio; check the route weights";
+        }
+    }
+}
+
+// ====================
+// THROUGHPUT BOUNDS
+// ====================
+
+/**
+ * @brief Reference firings per hour allowed by every constraint, with the
+ *        capacity of one of them overridden.
+ * @param limit Set to the constraint that binds, or -1 if none is timed.
+ */
+static double bound_throughput(int override, double override_capacity, int* limit) {
+    double best = -1.0;
+
+    *limit = -1;
+    for (int c = 0; c < analysis.num_constraints; c++) {
+        const AnalysisConstraint* con = &analysis.constraints[c];
+        double capacity = (c == override) ? override_capacity : con->capacity;
+        double rate = capacity / con->demand_ms * MS_PER_HOUR;
+        if (*limit < 0 || rate < best) {
+            best = rate;
+            *limit = c;
+        }
+    }
+    return best;
+}
+
+static void add_constraint(ConstraintKind kind, int index, int home_place, double capacity, double demand_ms) {
+    if (demand_ms <= 0.0 || capacity <= 0.0) {
+        return;                    // Never busy, so never a limit
+    }
+
+    AnalysisConstraint* con = &analysis.constraints[analysis.num_constraints++];
+    memset(con, 0, sizeof(*con));
+    con->kind = kind;
+    con->index = index;
+    con->home_place = home_place;
+    con->capacity = capacity;
+    con->demand_ms = demand_ms;
+    con->max_per_hour = capacity / demand_ms * MS_PER_HOUR;
+}
+
+/**
+ * @brief One constraint per timed station and per marked P-invariant.
+ *
+ * A station is busy for service_ms per firing. A pool token is held while
+ * a timed transition waits to consume it, so an invariant is charged the
+ * service time of each transition that takes tokens out of its places
+ * without putting them straight back.
+ */
+static void compute_bounds(void) {
+    const PetriModel* net = &manufacturing_model;
+
+    analysis.num_constraints = 0;
+    for (int s = 0; s < analysis.num_servers; s++) {
+        double demand = 0.0;
+        for (int t = 0; t < net->num_transitions; t++) {
+            if (server_of[t] == s) {
+                demand += analysis.visits[t] * service_ms[t];
+            }
+        }
+        add_constraint(CONSTRAINT_STATION, s, -1, (double)analysis.server_capacity[s], demand);
+    }
+
+    int stored = analysis.num_p_invariants < ANALYSIS_MAX_INVARIANTS ?
+        analysis.num_p_invariants : ANALYSIS_MAX_INVARIANTS;
+    for (int i = 0; i < stored; i++) {
+        const NetInvariant* inv = &analysis.p_invariants[i];
+        if (inv->tokens <= 0) {
+            continue;
+        }
+
+        double demand = 0.0;
+        int home = -1;
+        for (int p = 0; p < net->num_places; p++) {
+            if (inv->weight[p] == 0) {
+                continue;
+            }
+            if (home < 0 || net->initial_marking[p] > net->initial_marking[home]) {
+                home = p;
+            }
+            for (int t = 0; t < net->num_transitions; t++) {
+                int held = arc_in[p][t] - arc_out[p][t];
+                if (held > 0) {
+                    demand += (double)inv->weight[p] * held * analysis.visits[t] * service_ms[t];
+                }
+            }
+        }
+        add_constraint(CONSTRAINT_POOL, i, home, (double)inv->tokens, demand);
+    }
+
+    analysis.max_per_hour = bound_throughput(-1, 0.0, &analysis.bottleneck);
+    for (int c = 0; c < analysis.num_constraints; c++) {
+        AnalysisConstraint* con = &analysis.constraints[c];
+        con->utilization = analysis.max_per_hour * con->demand_ms / (con->capacity * MS_PER_HOUR);
+
+        if (con->kind == CONSTRAINT_POOL) {
+            double per_token = analysis.p_invariants[con->index].weight[con->home_place];
+            for (int k = 0; k <= ANALYSIS_SCALE_STEPS; k++) {
+                con->scaled_per_hour[k] = bound_throughput(c, con->capacity + per_token * k,
+                    &con->scaled_limit[k]);
+            }
+        }
+    }
+}
+
+// ====================
+// REACHABILITY
+// ====================
+
+// Explored markings, num_places tokens each, in discovery order
+static int16_t reach_markings[ANALYSIS_ARENA_BYTES / sizeof(int16_t)];
+static uint32_t reach_hash[ANALYSIS_HASH_SLOTS];   // Marking id + 1, or 0 when free
+
+// Depth-first search stack: marking id and next transition to try
+static uint32_t dfs_state[ANALYSIS_MAX_STATES];
+static uint16_t dfs_next[ANALYSIS_MAX_STATES];
+
+static const int16_t* stored_marking(uint32_t id) {
+    return &reach_markings[(size_t)id * manufacturing_model.num_places];
+}
+
+static uint32_t hash_marking(const int16_t* marking, int num_places) {
+    uint32_t h = 2166136261u;      // FNV-1a
+    for (int p = 0; p < num_places; p++) {
+        h = (h ^ (uint16_t)marking[p]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Find a marking in the table, adding it if new.
+ * @return Its id, or -1 if it is new and the table is full.
+ */
+static int32_t intern_marking(const int16_t* marking, uint32_t capacity, bool* added) {
+    int np = manufacturing_model.num_places;
+    uint32_t slot = hash_marking(marking, np) & (ANALYSIS_HASH_SLOTS - 1);
+
+    *added = false;
+    while (reach_hash[slot] != 0) {
+        uint32_t id = reach_hash[slot] - 1;
+        if (memcmp(stored_marking(id), marking, np * sizeof(int16_t)) == 0) {
+            return (int32_t)id;
+        }
+        slot = (slot + 1) & (ANALYSIS_HASH_SLOTS - 1);
+    }
+
+    if (analysis.reach.states == capacity) {
+        return -1;
+    }
+    uint32_t id = analysis.reach.states++;
+    memcpy(&reach_markings[(size_t)id * np], marking, np * sizeof(int16_t));
+    reach_hash[slot] = id + 1;
+    *added = true;
+    return (int32_t)id;
+}
+
+static bool enabled_in(const int16_t* marking, int trans) {
+    const PetriModel* net = &manufacturing_model;
+    for (PetriIndex a = net->in_start[trans]; a < net->in_start[trans + 1]; a++) {
+        if (marking[net->in_arcs[a].place] < net->in_arcs[a].weight) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Record bounds, enabled transitions and deadness of a new marking.
+ */
+static void visit_marking(uint32_t id) {
+    const PetriModel* net = &manufacturing_model;
+    ReachabilityResult* r = &analysis.reach;
+    const int16_t* marking = stored_marking(id);
+    bool any = false;
+
+    for (int p = 0; p < net->num_places; p++) {
+        if (marking[p] > r->bound[p]) {
+            r->bound[p] = marking[p];
+        }
+    }
+    for (int t = 0; t < net->num_transitions; t++) {
+        if (enabled_in(marking, t)) {
+            r->ever_enabled[t / 32] |= 1u << (t % 32);
+            any = true;
+        }
+    }
+    if (!any) {
+        if (r->num_dead_examples < ANALYSIS_MAX_DEAD_MARKINGS) {
+            r->dead_example[r->num_dead_examples++] = id;
+        }
+        r->dead_markings++;
+    }
+}
+
+/**
+ * @brief Depth-first search of the markings reachable from the current one.
+ *
+ * Depth first reaches the end of a production run, where dead markings
+ * live, long before a breadth-first search would have stored the early
+ * interleavings.
+ */
+static void explore_reachability(void) {
+    const PetriModel* net = &manufacturing_model;
+    ReachabilityResult* r = &analysis.reach;
+    int np = net->num_places;
+    int16_t next[MAX_PLACES];
+    bool added;
+
+    memset(r, 0, sizeof(*r));
+    memset(reach_hash, 0, sizeof(reach_hash));
+
+    uint32_t capacity = (uint32_t)(ANALYSIS_ARENA_BYTES / sizeof(int16_t) / (np > 0 ? np : 1));
+    if (capacity > ANALYSIS_MAX_STATES) {
+        capacity = ANALYSIS_MAX_STATES;
+    }
+
+    for (int p = 0; p < np; p++) {
+        if (net->initial_marking[p] > INT16_MAX || net->initial_marking[p] < 0) {
+            r->skipped = "an initial marking is outside 0..32767 tokens";
+            return;
+        }
+        next[p] = (int16_t)net->initial_marking[p];
+    }
+
+    dfs_state[0] = (uint32_t)intern_marking(next, capacity, &added);
+    dfs_next[0] = 0;
+    visit_marking(dfs_state[0]);
+    int depth = 1;
+
+    while (depth > 0) {
+        const int16_t* marking = stored_marking(dfs_state[depth - 1]);
+        int t = dfs_next[depth - 1];
+        while (t < net->num_transitions && !enabled_in(marking, t)) {
+            t++;
+        }
+        if (t == net->num_transitions) {
+            depth--;
+            continue;
+        }
+        dfs_next[depth - 1] = (uint16_t)(t + 1);
+
+        bool fits = true;
+        memcpy(next, marking, np * sizeof(int16_t));
+        for (PetriIndex a = net->in_start[t]; a < net->in_start[t + 1]; a++) {
+            next[net->in_arcs[a].place] -= net->in_arcs[a].weight;
+        }
+        for (PetriIndex a = net->out_start[t]; a < net->out_start[t + 1]; a++) {
+            int32_t v = next[net->out_arcs[a].place] + net->out_arcs[a].weight;
+            fits &= v <= INT16_MAX;
+            next[net->out_arcs[a].place] = (int16_t)v;
+        }
+        if (!fits) {
+            r->overflow = true;
+            continue;
+        }
+
+        int32_t id = intern_marking(next, capacity, &added);
+        if (id < 0) {
+            return;                // Bound reached; r->complete stays false
+        }
+        if (added) {
+            visit_marking((uint32_t)id);
+            dfs_state[depth] = (uint32_t)id;
+            dfs_next[depth] = 0;
+            depth++;
+        }
+    }
+    r->complete = !r->overflow;
+}
+
+// ====================
+// REPORTING
+// ====================
+
+static const char* constraint_name(const AnalysisConstraint* con) {
+    if (con->kind == CONSTRAINT_STATION) {
+        return analysis.server_names[con->index];
+    }
+    return manufacturing_model.places[con->home_place].name;
+}
+
+static const char* constraint_kind(const AnalysisConstraint* con) {
+    return con->kind == CONSTRAINT_STATION ? "station" : "pool";
+}
+
+/**
+ * @brief Whether a place belongs to a marked P-invariant (a resource pool).
+ */
+static bool place_in_pool(int place) {
+    int stored = analysis.num_p_invariants < ANALYSIS_MAX_INVARIANTS ?
+        analysis.num_p_invariants : ANALYSIS_MAX_INVARIANTS;
+    for (int i = 0; i < stored; i++) {
+        if (analysis.p_invariants[i].tokens > 0 && analysis.p_invariants[i].weight[place] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Whether a dead marking leaves work behind: tokens in a place some
+ *        transition consumes from, other than an idle resource pool.
+ */
+static bool marking_strands_work(const int16_t* marking) {
+    const PetriModel* net = &manufacturing_model;
+    for (int p = 0; p < net->num_places; p++) {
+        if (marking[p] > 0 && net->consumer_start[p] != net->consumer_start[p + 1] && !place_in_pool(p)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void json_invariants(JsonWriter* out, const char* key, const NetInvariant* invs, int found,
+        bool truncated, bool by_place) {
+    const PetriModel* net = &manufacturing_model;
+    int n = by_place ? net->num_places : net->num_transitions;
+    int stored = found < ANALYSIS_MAX_INVARIANTS ? found : ANALYSIS_MAX_INVARIANTS;
+
+    json_append(out, "\"%s\":{\"count\":%d,\"truncated\":%s,\"list\":[", key, found, truncated ? "true" : "false");
+    for (int i = 0; i < stored; i++) {
+        json_append(out, "%s{", i ? "," : "");
+        if (by_place) {
+            json_append(out, "\"tokens\":%lld,", (long long)invs[i].tokens);
+        }
+        json_append(out, "\"weights\":{");
+        bool first = true;
+        for (int k = 0; k < n; k++) {
+            if (invs[i].weight[k] != 0) {
+                json_append(out, "%s", first ? "" : ",");
+                json_append_string(out, by_place ? net->places[k].name : net->transitions[k].name);
+                json_append(out, ":%ld", (long)invs[i].weight[k]);
+                first = false;
+            }
+        }
+        json_append(out, "}}");
+    }
+    json_append(out, "]}");
+}
+
+/**
+ * @brief Pre-render the results for GET /analysis.
+ */
+static void render_json(void) {
+    const PetriModel* net = &manufacturing_model;
+    const ReachabilityResult* r = &analysis.reach;
+    JsonWriter out = { analysis.json, (int)sizeof(analysis.json), 0 };
+
+    json_append(&out, "{\"reference\":");
+    json_append_string(&out, net->transitions[analysis.reference].name);
+    if (analysis.bottleneck >= 0) {
+        json_append(&out, ",\"max_per_hour\":%.2f,\"bottleneck\":", analysis.max_per_hour);
+        json_append_string(&out, constraint_name(&analysis.constraints[analysis.bottleneck]));
+        json_append(&out, ",");
+    } else {
+        json_append(&out, ",\"max_per_hour\":null,\"bottleneck\":null,");
+    }
+    if (analysis.visits_problem != NULL) {
+        json_append(&out, "\"warning\":\"%s\",", analysis.visits_problem);
+    }
+
+    json_append(&out, "\"transitions\":[");
+    for (int t = 0; t < net->num_transitions; t++) {
+        json_append(&out, "%s{\"name\":", t ? "," : "");
+        json_append_string(&out, net->transitions[t].name);
+        json_append(&out, ",\"visits\":%.4f,\"service_ms\":%lu,\"max_per_hour\":",
+            analysis.visits[t], (unsigned long)service_ms[t]);
+        if (analysis.bottleneck >= 0) {
+            json_append(&out, "%.2f}", analysis.visits[t] * analysis.max_per_hour);
+        } else {
+            json_append(&out, "null}");
+        }
+    }
+
+    json_append(&out, "],\"constraints\":[");
+    for (int c = 0; c < analysis.num_constraints; c++) {
+        const AnalysisConstraint* con = &analysis.constraints[c];
+        json_append(&out, "%s{\"name\":", c ? "," : "");
+        json_append_string(&out, constraint_name(con));
+        json_append(&out, ",\"kind\":\"%s\",\"capacity\":%.0f,\"demand_ms\":%.2f,"
+            "\"max_per_hour\":%.2f,\"utilization\":%.4f",
+            constraint_kind(con), con->capacity, con->demand_ms, con->max_per_hour, con->utilization);
+        if (con->kind == CONSTRAINT_POOL) {
+            json_append(&out, ",\"scaling\":[");
+            for (int k = 0; k <= ANALYSIS_SCALE_STEPS; k++) {
+                double per_token = analysis.p_invariants[con->index].weight[con->home_place];
+                json_append(&out, "%s{\"tokens\":%.0f,\"max_per_hour\":%.2f,\"limit\":",
+                    k ? "," : "", con->capacity + per_token * k, con->scaled_per_hour[k]);
+                json_append_string(&out, constraint_name(&analysis.constraints[con->scaled_limit[k]]));
+                json_append(&out, "}");
+            }
+            json_append(&out, "]");
+        }
+        json_append(&out, "}");
+    }
+    json_append(&out, "],");
+
+    json_invariants(&out, "p_invariants", analysis.p_invariants, analysis.num_p_invariants,
+        analysis.p_truncated, true);
+    json_append(&out, ",");
+    json_invariants(&out, "t_invariants", analysis.t_invariants, analysis.num_t_invariants,
+        analysis.t_truncated, false);
+
+    json_append(&out, ",\"reachability\":{");
+    if (r->skipped != NULL) {
+        json_append(&out, "\"skipped\":\"%s\"}}", r->skipped);
+    } else {
+        json_append(&out, "\"states\":%lu,\"complete\":%s,\"dead_markings\":%lu,\"examples\":[",
+            (unsigned long)r->states, r->complete ? "true" : "false", (unsigned long)r->dead_markings);
+        for (int d = 0; d < r->num_dead_examples; d++) {
+            const int16_t* marking = stored_marking(r->dead_example[d]);
+            bool first = true;
+            json_append(&out, "%s{\"stranded\":%s,\"marking\":{", d ? "," : "",
+                marking_strands_work(marking) ? "true" : "false");
+            for (int p = 0; p < net->num_places; p++) {
+                if (marking[p] != 0) {
+                    json_append(&out, "%s", first ? "" : ",");
+                    json_append_string(&out, net->places[p].name);
+                    json_append(&out, ":%d", marking[p]);
+                    first = false;
+                }
+            }
+            json_append(&out, "}}");
+        }
+        json_append(&out, "],\"never_enabled\":[");
+        bool first = true;
+        for (int t = 0; t < net->num_transitions; t++) {
+            if (!(r->ever_enabled[t / 32] & (1u << (t % 32)))) {
+                json_append(&out, "%s", first ? "" : ",");
+                json_append_string(&out, net->transitions[t].name);
+                first = false;
+            }
+        }
+        json_append(&out, "],\"bounds\":{");
+        for (int p = 0; p < net->num_places; p++) {
+            json_append(&out, "%s", p ? "," : "");
+            json_append_string(&out, net->places[p].name);
+            json_append(&out, ":%ld", (long)r->bound[p]);
+        }
+        json_append(&out, "}}}");
+    }
+
+    if (!json_complete(&out)) {
+        out.len = snprintf(analysis.json, sizeof(analysis.json),
+            "{\"error\":\"analysis does not fit in ANALYSIS_JSON_BUFFER\"}");
+    }
+    analysis.json_len = out.len;
+}
+
+// ====================
+// PUBLIC API
+// ====================
+
+/**
+ * @brief Analyze one line of manufacturing_model from its initial marking.
+ * Call after the net is loaded.
+ * @return false if the model refers to transitions or stations that do not exist.
+ */
+bool net_analysis_run(const AnalysisModel* model) {
+    const PetriModel* net = &manufacturing_model;
+
+    analysis.valid = false;
+    if (model->reference_transition < 0 || model->reference_transition >= net->num_transitions ||
+        model->num_servers > ANALYSIS_MAX_SERVERS) {
+        printf("ERROR: Invalid analysis model\n");
+        return false;
+    }
+
+    memset(service_ms, 0, sizeof(service_ms));
+    memset(route_weight, 0, sizeof(route_weight));
+    for (int t = 0; t < MAX_TRANSITIONS; t++) {
+        server_of[t] = -1;
+    }
+    for (int i = 0; i < model->num_timing; i++) {
+        const TransitionTiming* timing = &model->timing[i];
+        if (timing->transition < 0 || timing->transition >= net->num_transitions ||
+            timing->server >= model->num_servers) {
+            printf("ERROR: Invalid timing entry %d in the analysis model\n", i);
+            return false;
+        }
+        service_ms[timing->transition] = timing->service_ms;
+        server_of[timing->transition] = timing->server;
+        route_weight[timing->transition] = timing->route_weight;
+    }
+
+    memset(arc_in, 0, sizeof(arc_in));
+    memset(arc_out, 0, sizeof(arc_out));
+    for (int t = 0; t < net->num_transitions; t++) {
+        for (PetriIndex a = net->in_start[t]; a < net->in_start[t + 1]; a++) {
+            arc_in[net->in_arcs[a].place][t] += net->in_arcs[a].weight;
+        }
+        for (PetriIndex a = net->out_start[t]; a < net->out_start[t + 1]; a++) {
+            arc_out[net->out_arcs[a].place][t] += net->out_arcs[a].weight;
+        }
+    }
+
+    analysis.server_names = model->server_names;
+    for (int s = 0; s < model->num_servers; s++) {
+        analysis.server_capacity[s] = model->server_capacity != NULL ? model->server_capacity[s] : 1;
+    }
+    analysis.num_servers = model->num_servers;
+    analysis.reference = model->reference_transition;
+
+    analysis.num_p_invariants = find_invariants(true, analysis.p_invariants, &analysis.p_truncated);
+    analysis.num_t_invariants = find_invariants(false, analysis.t_invariants, &analysis.t_truncated);
+    solve_visit_ratios();
+    compute_bounds();
+    explore_reachability();
+    render_json();
+
+    analysis.valid = true;
+    return true;
+}
+
+static void print_invariants(const char* title, const NetInvariant* invs, int found, bool truncated, bool by_place) {
+    const PetriModel* net = &manufacturing_model;
+    int n = by_place ? net->num_places : net->num_transitions;
+    int stored = found < ANALYSIS_MAX_INVARIANTS ? found : ANALYSIS_MAX_INVARIANTS;
+
+    if (truncated) {
+        printf("%s: search gave up after %d rows\n", title, ANALYSIS_MAX_ROWS);
+        return;
+    }
+    printf("%s: %d\n", title, found);
+    for (int i = 0; i < stored; i++) {
+        printf("  ");
+        bool first = true;
+        for (int k = 0; k < n; k++) {
+            if (invs[i].weight[k] == 0) {
+                continue;
+            }
+            printf("%s", first ? "" : " + ");
+            if (invs[i].weight[k] != 1) {
+                printf("%ld*", (long)invs[i].weight[k]);
+            }
+            printf("%s", by_place ? net->places[k].name : net->transitions[k].name);
+            first = false;
+        }
+        if (by_place) {
+            printf(" = %lld", (long long)invs[i].tokens);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Print the results of the last net_analysis_run().
+ */
+void net_analysis_print(void) {
+    const PetriModel* net = &manufacturing_model;
+    const ReachabilityResult* r = &analysis.reach;
+
+    if (!analysis.valid) {
+        printf("ERROR: No analysis results\n");
+        return;
+    }
+
+    printf("\n===========================================================\n");
+    printf(" NET ANALYSIS (throughput in '%s' firings per hour)\n", net->transitions[analysis.reference].name);
+    printf("===========================================================\n");
+
+    print_invariants("P-invariants", analysis.p_invariants, analysis.num_p_invariants, analysis.p_truncated, true);
+    print_invariants("T-invariants", analysis.t_invariants, analysis.num_t_invariants, analysis.t_truncated, false);
+
+    if (analysis.visits_problem != NULL) {
+        printf("\nWARNING: %s\n", analysis.visits_problem);
+    }
+
+    printf("\n%-24s %-8s %5s %12s %10s %6s\n", "Constraint", "kind", "cap", "busy ms/unit", "max/h", "util");
+    for (int c = 0; c < analysis.num_constraints; c++) {
+        const AnalysisConstraint* con = &analysis.constraints[c];
+        printf("%-24s %-8s %5.0f %12.1f %10.1f %5.1f%%%s\n", constraint_name(con), constraint_kind(con),
+            con->capacity, con->demand_ms, con->max_per_hour, 100.0 * con->utilization,
+            c == analysis.bottleneck ? "  <- bottleneck" : "");
+    }
+    if (analysis.bottleneck < 0) {
+        printf("No timed transitions: throughput is unbounded\n");
+    }
+
+    printf("\n%-30s %8s %8s %10s\n", "Transition", "visits", "ms", "max/h");
+    for (int t = 0; t < net->num_transitions; t++) {
+        printf("%-30s %8.3f %8lu %10.1f\n", net->transitions[t].name, analysis.visits[t],
+            (unsigned long)service_ms[t], analysis.bottleneck >= 0 ? analysis.visits[t] * analysis.max_per_hour : 0.0);
+    }
+
+    for (int c = 0; c < analysis.num_constraints; c++) {
+        const AnalysisConstraint* con = &analysis.constraints[c];
+        if (con->kind != CONSTRAINT_POOL) {
+            continue;
+        }
+        double per_token = analysis.p_invariants[con->index].weight[con->home_place];
+        printf("\nAdding tokens to %s:\n", constraint_name(con));
+        for (int k = 0; k <= ANALYSIS_SCALE_STEPS; k++) {
+            printf("  %3.0f tokens: %10.1f/h, limited by %s\n", con->capacity + per_token * k,
+                con->scaled_per_hour[k], constraint_name(&analysis.constraints[con->scaled_limit[k]]));
+        }
+    }
+
+    printf("\nReachability: ");
+    if (r->skipped != NULL) {
+        printf("skipped, %s\n", r->skipped);
+    } else {
+        printf("%lu markings%s", (unsigned long)r->states,
+            r->complete ? " (complete)\n" : " (bound reached, results are partial)\n");
+        if (r->overflow) {
+            printf("  Some place exceeds 32767 tokens; the net may be unbounded\n");
+        }
+        printf("  Dead markings: %lu\n", (unsigned long)r->dead_markings);
+        for (int d = 0; d < r->num_dead_examples; d++) {
+            const int16_t* marking = stored_marking(r->dead_example[d]);
+            printf("   %s:", marking_strands_work(marking) ? "strands work" : "drained");
+            for (int p = 0; p < net->num_places; p++) {
+                if (marking[p] != 0) {
+                    printf(" %s=%d", net->places[p].name, marking[p]);
+                }
+            }
+            printf("\n");
+        }
+        for (int t = 0; t < net->num_transitions; t++) {
+            if (!(r->ever_enabled[t / 32] & (1u << (t % 32)))) {
+                printf("  Never enabled: %s\n", net->transitions[t].name);
+            }
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * @brief JSON rendering of the last net_analysis_run(), for GET /analysis.
+ * @param len Set to the length of the returned string.
+ * @return The JSON document, or NULL if no analysis has run.
+ */
+const char* net_analysis_json(int* len) {
+    if (!analysis.valid) {
+        return NULL;
+    }
+    *len = analysis.json_len;
+    return analysis.json;
+}
@@ -0,0 +1,69 @@
+/*
+ * Steady-state analysis of the manufacturing Petri net.
+ *
+ * Works on the net structure plus a timing model that says, for each
+ * transition, which station fires it, how long that station is busy per
+ * firing and how likely each branch of a decision is. From that it derives:
+ *
+ *  - P- and T-invariants of the incidence matrix (Farkas algorithm)
+ *  - visit ratios: firings of each transition per firing of a reference
+ *    transition, from flow balance in every internal place
+ *  - an upper bound on throughput from every station (one firing at a time
+ *    per task serving it) and every marked P-invariant (a resource pool whose tokens are held
+ *    while a timed transition waits), the smallest of which is the bottleneck
+ *  - the predicted throughput as tokens are added to each resource pool
+ *  - bounded reachability from the initial marking, with explored markings
+ *    kept in a hash table, to find dead markings and starved transitions
+ *
+ * The analysis only reads the net and never touches the live marking, so it
+ * can run before the scheduler starts. Results are kept for
+ * net_analysis_print() and pre-rendered as JSON for the status server.
+ */
+
+#ifndef NET_ANALYSIS_H
+#define NET_ANALYSIS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "petri_net.h"
+
+/* Environment variable that prints the analysis and exits instead of
+ * running the line. */
+#define ANALYSIS_ENV "PETRI_ANALYZE"
+
+#define ANALYSIS_MAX_SERVERS 16
+#define ANALYSIS_MAX_INVARIANTS 32      // Kept per kind; more are counted but not listed
+#define ANALYSIS_MAX_ROWS 256           // Farkas working set; the search gives up beyond this
+#define ANALYSIS_SCALE_STEPS 4          // Extra tokens tried per resource pool
+#define ANALYSIS_MAX_DEAD_MARKINGS 4    // Dead markings listed in the report
+
+#define ANALYSIS_MAX_STATES 65536
+#define ANALYSIS_ARENA_BYTES (1024 * 1024)  // Stored markings, 16 bits per place
+#define ANALYSIS_HASH_SLOTS (1u << 17)      // Power of two, at least twice ANALYSIS_MAX_STATES
+
+#define ANALYSIS_JSON_BUFFER 16384
+
+/* Timing of one transition. */
+typedef struct {
+    int transition;                // Net index of the transition
+    int server;                    // Station that fires it, or -1 if untimed
+    uint32_t service_ms;           // Time the station is busy per firing
+    uint16_t route_weight;         // Relative odds among transitions that consume from the same
+                                   // place, or 0 when it is not a routing decision
+} TransitionTiming;
+
+typedef struct {
+    const TransitionTiming* timing;
+    int num_timing;
+    const char* const* server_names;
+    const int* server_capacity;    // Tasks serving each station, or NULL for one each
+    int num_servers;
+    int reference_transition;      // Throughput is counted in firings of this transition
+} AnalysisModel;
+
+bool net_analysis_run(const AnalysisModel* model);
+void net_analysis_print(void);
+const char* net_analysis_json(int* len);
+
+#endif /* NET_ANALYSIS_H */
@@ -0,0 +1,111 @@
+/*
+ * Petri net user events for the streaming trace recorder. See net_trace.h.
+ */
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "petri_net.h"
+#include "net_trace.h"
+
+#if PETRI_TRACE_STREAMING
+
+#if NET_TRACE_MAX_DELTAS != 6
+#error "net_trace_firing() passes exactly six deltas"
+#endif
+
+typedef struct {
+    char format[NET_TRACE_FORMAT_LEN];
+    int num_deltas;
+    int16_t delta[NET_TRACE_MAX_DELTAS];   // Token change per firing, in format order
+} TransitionTraceFormat;
+
+static TraceStringHandle_t net_channel;
+static TransitionTraceFormat trace_formats[MAX_TRANSITIONS];
+static bool trace_ready = false;
+
+/**
+ * @brief Fold an arc into the per-place changes of a transition.
+ */
+static void add_delta(PetriIndex* places, int32_t* deltas, int* count, PetriIndex place, int32_t change) {
+    for (int i = 0; i < *count; i++) {
+        if (places[i] == place) {
+            deltas[i] += change;
+            return;
+        }
+    }
+    places[*count] = place;
+    deltas[*count] = change;
+    (*count)++;
+}
+
+/**
+ * @brief Register the channel and build one format string per transition.
+ * Call once the net is loaded, after xTraceInitialize().
+ */
+void net_trace_init(void) {
+    const PetriModel* net = &manufacturing_model;
+
+    if (xTraceStringRegister(NET_TRACE_CHANNEL, &net_channel) != TRC_SUCCESS) {
+        printf("ERROR: Could not register the trace channel '%s'\n", NET_TRACE_CHANNEL);
+        return;
+    }
+
+    for (int t = 0; t < net->num_transitions; t++) {
+        TransitionTraceFormat* f = &trace_formats[t];
+        PetriIndex places[2 * MAX_PLACES];
+        int32_t deltas[2 * MAX_PLACES];
+        int touched = 0;
+
+        for (PetriIndex a = net->in_start[t]; a < net->in_start[t + 1]; a++) {
+            add_delta(places, deltas, &touched, net->in_arcs[a].place, -(int32_t)net->in_arcs[a].weight);
+        }
+        for (PetriIndex a = net->out_start[t]; a < net->out_start[t + 1]; a++) {
+            add_delta(places, deltas, &touched, net->out_arcs[a].place, net->out_arcs[a].weight);
+        }
+
+        // Self-loops such as the worker token on rework cancel out and are not listed
+        int len = snprintf(f->format, sizeof(f->format), "L%%d T%d", t);
+        f->num_deltas = 0;
+        for (int i = 0; i < touched && f->num_deltas < NET_TRACE_MAX_DELTAS; i++) {
+            if (deltas[i] == 0) {
+                continue;
+            }
+            len += snprintf(f->format + len, sizeof(f->format) - len, " P%d:%%d", (int)places[i]);
+            f->delta[f->num_deltas++] = (int16_t)deltas[i];
+        }
+    }
+    trace_ready = true;
+}
+
+/**
+ * @brief Emit the user event for count firings of a transition.
+ * Call after the net's critical section so the event lands before the
+ * wakeups it causes.
+ */
+void net_trace_firing(int line, int trans_idx, int count) {
+    if (!trace_ready) {
+        return;
+    }
+
+    // The recorder reads only as many arguments as the format names
+    const TransitionTraceFormat* f = &trace_formats[trans_idx];
+    xTracePrintF(net_channel, f->format, line + 1,
+        f->delta[0] * count, f->delta[1] * count, f->delta[2] * count,
+        f->delta[3] * count, f->delta[4] * count, f->delta[5] * count);
+}
+
+/**
+ * @brief Emit a user event for tokens added from outside the net (keyboard
+ * interrupt or status server), or taken out for a negative count.
+ */
+void net_trace_tokens_added(int line, int place_idx, int count) {
+    if (trace_ready) {
+        xTracePrintF(net_channel, count < 0 ? "L%d P%d -%d" : "L%d P%d +%d", line + 1, place_idx,
+            count < 0 ? -count : count);
+    }
+}
+
+#endif /* PETRI_TRACE_STREAMING */
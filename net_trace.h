@@ -0,0 +1,46 @@
+/*
+ * Petri net firings as trace recorder user events.
+ *
+ * In streaming trace builds (PETRI_TRACE_STREAMING, see
+ * trcKernelPortConfig.h) every firing emits one user event on the
+ * "Petri net" channel, so Tracealyzer shows net activity on the same
+ * timeline as the kernel's scheduling events. The event names the line
+ * and the transition and carries the token change of every place it
+ * touches, e.g. "L%d T5 P5:%d P13:%d P6:%d" with 1, -1, -1, 1 on the
+ * first line. The format strings are built once from the net, so a firing
+ * only passes integers.
+ *
+ * Snapshot builds keep their ring buffer for kernel events and compile the
+ * hooks out.
+ */
+
+#ifndef NET_TRACE_H
+#define NET_TRACE_H
+
+#ifndef PETRI_TRACE_STREAMING
+#define PETRI_TRACE_STREAMING 0
+#endif
+
+#define NET_TRACE_CHANNEL "Petri net"
+#define NET_TRACE_MAX_DELTAS 6         // Places listed per event; the rest are left out
+#define NET_TRACE_FORMAT_LEN 64
+
+#if PETRI_TRACE_STREAMING
+
+void net_trace_init(void);
+void net_trace_firing(int line, int trans_idx, int count);
+void net_trace_tokens_added(int line, int place_idx, int count);
+
+#else
+
+static inline void net_trace_init(void) {}
+static inline void net_trace_firing(int line, int trans_idx, int count) {
+    (void)line; (void)trans_idx; (void)count;
+}
+static inline void net_trace_tokens_added(int line, int place_idx, int count) {
+    (void)line; (void)place_idx; (void)count;
+}
+
+#endif
+
+#endif /* NET_TRACE_H */
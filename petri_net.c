@@ -0,0 +1,1373 @@
+/*
+ * Petri net engine for the manufacturing process control demo.
+ * See petri_net.h for the storage layout.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "petri_net.h"
+#include "item_tokens.h"
+#include "marking_journal.h"
+#include "metrics.h"
+#include "net_trace.h"
+#if PETRI_NET_GENERATED
+#include "petri_net_generated.h"
+#endif
+
+// The model every line is instantiated from
+PetriModel manufacturing_model;
+
+// Lines and the places they share
+PetriNet petri_lines[PETRI_MAX_LINES];
+int petri_num_lines = 0;
+static PetriShared shared_places;
+
+// Atomic flag to signal status update
+atomic_bool status_dirty = false;
+
+// Task notified on NET_OBSERVER_NOTIFY_INDEX after every marking change
+static TaskHandle_t marking_observer = NULL;
+
+/*
+ * Arcs are staged here while the net is being described, in whatever order
+ * add_arc_input()/add_arc_output() are called, and grouped per transition
+ * into the CSR arrays by build_net_index().
+ */
+typedef struct {
+    PetriIndex trans;
+    Arc arc;
+} StagedArc;
+
+static StagedArc staged_in[MAX_ARCS];
+static StagedArc staged_out[MAX_ARCS];
+
+// Topology tables built by build_net_index()
+static PetriIndex net_in_start[MAX_TRANSITIONS + 1];
+static PetriIndex net_out_start[MAX_TRANSITIONS + 1];
+static Arc net_in_arcs[MAX_ARCS];
+static Arc net_out_arcs[MAX_ARCS];
+static PetriIndex net_consumer_start[MAX_PLACES + 1];
+static PetriIndex net_consumers[MAX_ARCS];
+
+// ====================
+// INTERNAL HELPERS
+// ====================
+
+/**
+ * @brief Index of the lowest set bit of a non-zero word.
+ */
+static inline int bit_scan_forward(uint32_t value) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, value);
+    return (int)idx;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+static inline bool mask_test(const uint32_t* mask, int idx) {
+    return (mask[idx >> 5] & (1u << (idx & 31))) != 0;
+}
+
+/**
+ * @brief true if the transition has an arc to a place shared between lines.
+ */
+static inline bool touches_shared(const PetriNet* net, int trans_idx) {
+    return net->shared != NULL && mask_test(net->shared->transitions, trans_idx);
+}
+
+/**
+ * @brief Token count of a place, in the line or in the shared places.
+ */
+static inline int32_t* place_tokens(PetriNet* net, int place_idx) {
+    if (net->shared != NULL && mask_test(net->shared->places, place_idx)) {
+        return &net->shared->marking[place_idx];
+    }
+    return &net->marking[place_idx];
+}
+
+/**
+ * @brief Check the line's own places against a transition's input arcs.
+ * Shared input places are left to shared_inputs_marked(), so this only
+ * depends on state guarded by the line's lock.
+ * Caller must be inside NET_ENTER_CRITICAL(net).
+ * @param trans_idx Index of the transition.
+ * @return true if every such input place holds at least the arc weight.
+ */
+static bool transition_enabled_locked(const PetriNet* net, int trans_idx) {
+#if PETRI_NET_GENERATED
+    if (!touches_shared(net, trans_idx)) {
+        return petri_gen_enabled(trans_idx, net->marking);
+    }
+#endif
+    for (int a = net->in_start[trans_idx]; a < net->in_start[trans_idx + 1]; a++) {
+        int place = net->in_arcs[a].place;
+        if (net->shared != NULL && mask_test(net->shared->places, place)) {
+            continue;
+        }
+        if (net->marking[place] < net->in_arcs[a].weight) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check a transition's shared input places.
+ * Exact inside SHARED_ENTER_CRITICAL(shared); elsewhere each count is read
+ * atomically and may be stale by the time the caller acts on it.
+ */
+static bool shared_inputs_marked(const PetriNet* net, int trans_idx) {
+    const PetriShared* shared = net->shared;
+
+    for (int a = net->in_start[trans_idx]; a < net->in_start[trans_idx + 1]; a++) {
+        int place = net->in_arcs[a].place;
+        if (mask_test(shared->places, place) &&
+            *(volatile const int32_t*)&shared->marking[place] < net->in_arcs[a].weight) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Re-evaluate one transition and update the enabled bitmap.
+ * Caller must be inside NET_ENTER_CRITICAL(net).
+ * @param trans_idx Index of the transition.
+ * @param rising Bitmap that collects transitions that just became enabled.
+ */
+static void refresh_transition_locked(PetriNet* net, int trans_idx, uint32_t rising[TRANSITION_MASK_WORDS]) {
+    uint32_t bit = 1u << (trans_idx & 31);
+    uint32_t* word = &net->enabled_mask[trans_idx >> 5];
+
+    if (transition_enabled_locked(net, trans_idx)) {
+        if ((*word & bit) == 0) {
+            rising[trans_idx >> 5] |= bit;
+        }
+        *word |= bit;
+    } else {
+        *word &= ~bit;
+    }
+}
+
+/**
+ * @brief Re-evaluate only the transitions that consume from a place.
+ * A shared place is not in any line's bitmap; when it gains tokens the
+ * place goes into shared_rising for notify_shared_consumers() instead.
+ * Caller must be inside NET_ENTER_CRITICAL(net).
+ * @param place_idx Index of the place whose marking changed.
+ * @param rising Bitmap that collects transitions that just became enabled.
+ * @param shared_rising Bitmap of shared places, or NULL if the place only lost tokens.
+ */
+static void refresh_place_consumers_locked(PetriNet* net, int place_idx, uint32_t rising[TRANSITION_MASK_WORDS],
+                                           uint32_t shared_rising[PLACE_MASK_WORDS]) {
+    if (net->shared != NULL && mask_test(net->shared->places, place_idx)) {
+        if (shared_rising != NULL) {
+            shared_rising[place_idx >> 5] |= 1u << (place_idx & 31);
+        }
+        return;
+    }
+    for (int c = net->consumer_start[place_idx]; c < net->consumer_start[place_idx + 1]; c++) {
+        refresh_transition_locked(net, net->consumers[c], rising);
+    }
+}
+
+/**
+ * @brief Wake a task from task or interrupt context.
+ */
+static void wake_subscriber(TaskHandle_t task, bool from_isr) {
+    if (from_isr) {
+        vTaskNotifyGiveIndexedFromISR(task, NET_NOTIFY_INDEX, NULL);
+    } else {
+        xTaskNotifyGiveIndexed(task, NET_NOTIFY_INDEX);
+    }
+}
+
+/**
+ * @brief Wake the subscribers of every transition set in a bitmap.
+ * Subscriber lists are append-only, so they are read without the net lock.
+ * The calling task is skipped: it always retries its own transitions before
+ * it blocks, so a notification to itself would only cause a spurious wakeup.
+ * @param rising Bitmap of transitions that just became enabled.
+ */
+static void notify_subscribers(const PetriNet* net, const uint32_t rising[TRANSITION_MASK_WORDS]) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    for (int w = 0; w < TRANSITION_MASK_WORDS; w++) {
+        uint32_t bits = rising[w];
+        while (bits != 0) {
+            const SubscriberList* list = &net->subscribers[(w << 5) + bit_scan_forward(bits)];
+            int count = *(volatile int*)&list->count;
+            for (int s = 0; s < count; s++) {
+                if (list->tasks[s] != self) {
+                    xTaskNotifyGiveIndexed(list->tasks[s], NET_NOTIFY_INDEX);
+                }
+            }
+            bits &= bits - 1;
+        }
+    }
+}
+
+/**
+ * @brief ISR-safe variant of notify_subscribers().
+ * @param rising Bitmap of transitions that just became enabled.
+ * @param higher_priority_woken Set to pdTRUE if a context switch is needed (may be NULL).
+ */
+static void notify_subscribers_from_isr(const PetriNet* net, const uint32_t rising[TRANSITION_MASK_WORDS],
+                                        BaseType_t* higher_priority_woken) {
+    for (int w = 0; w < TRANSITION_MASK_WORDS; w++) {
+        uint32_t bits = rising[w];
+        while (bits != 0) {
+            const SubscriberList* list = &net->subscribers[(w << 5) + bit_scan_forward(bits)];
+            int count = *(volatile int*)&list->count;
+            for (int s = 0; s < count; s++) {
+                vTaskNotifyGiveIndexedFromISR(list->tasks[s], NET_NOTIFY_INDEX, higher_priority_woken);
+            }
+            bits &= bits - 1;
+        }
+    }
+}
+
+/**
+ * @brief Wake the subscribers, on every line, of the transitions that
+ * consume from shared places that just gained tokens.
+ * Only transitions whose own-line inputs are marked can have become
+ * enabled; the enabled bits are read without the lines' locks, which at
+ * worst costs a spurious wakeup.
+ * @param places Bitmap of shared places.
+ * @param from_isr true when called from interrupt context.
+ */
+static void notify_shared_consumers(const uint32_t places[PLACE_MASK_WORDS], bool from_isr) {
+    TaskHandle_t self = from_isr ? NULL : xTaskGetCurrentTaskHandle();
+
+    for (int w = 0; w < PLACE_MASK_WORDS; w++) {
+        for (uint32_t bits = places[w]; bits != 0; bits &= bits - 1) {
+            int place = (w << 5) + bit_scan_forward(bits);
+            for (int l = 0; l < petri_num_lines; l++) {
+                const PetriNet* net = &petri_lines[l];
+                for (int c = net->consumer_start[place]; c < net->consumer_start[place + 1]; c++) {
+                    int t = net->consumers[c];
+                    if (!mask_test((const uint32_t*)net->enabled_mask, t)) {
+                        continue;
+                    }
+                    const SubscriberList* list = &net->subscribers[t];
+                    int count = *(volatile int*)&list->count;
+                    for (int s = 0; s < count; s++) {
+                        if (list->tasks[s] != self) {
+                            wake_subscriber(list->tasks[s], from_isr);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Open a seqlock write section. Caller must be inside NET_ENTER_CRITICAL(net).
+ */
+static inline void marking_write_begin_locked(PetriNet* net) {
+    net->marking_seq++;
+    NET_MEMORY_BARRIER();
+}
+
+/**
+ * @brief Close a seqlock write section. Caller must be inside NET_ENTER_CRITICAL(net).
+ */
+static inline void marking_write_end_locked(PetriNet* net) {
+    NET_MEMORY_BARRIER();
+    net->marking_seq++;
+}
+
+/**
+ * @brief Open a write section on the shared places too, if the firing
+ * touches them. Caller must be inside SHARED_ENTER_CRITICAL(shared).
+ */
+static inline void shared_write_begin_locked(PetriShared* shared) {
+    shared->marking_seq++;
+    NET_MEMORY_BARRIER();
+}
+
+static inline void shared_write_end_locked(PetriShared* shared) {
+    NET_MEMORY_BARRIER();
+    shared->marking_seq++;
+}
+
+/**
+ * @brief Flag the status as dirty and wake the marking observer, if any.
+ */
+static void publish_marking_change(void) {
+    TaskHandle_t observer = marking_observer;
+
+    atomic_store(&status_dirty, true);
+    if (observer != NULL) {
+        xTaskNotifyGiveIndexed(observer, NET_OBSERVER_NOTIFY_INDEX);
+    }
+}
+
+/**
+ * @brief ISR-safe variant of publish_marking_change().
+ */
+static void publish_marking_change_from_isr(BaseType_t* higher_priority_woken) {
+    TaskHandle_t observer = marking_observer;
+
+    atomic_store(&status_dirty, true);
+    if (observer != NULL) {
+        vTaskNotifyGiveIndexedFromISR(observer, NET_OBSERVER_NOTIFY_INDEX, higher_priority_woken);
+    }
+}
+
+/**
+ * @brief Largest number of consecutive firings of a transition the current
+ * marking allows, capped at max_k. A place that is both an input and an
+ * output (such as a returned worker token) only limits k by its net
+ * consumption per firing. Caller must be inside NET_ENTER_CRITICAL(net),
+ * and SHARED_ENTER_CRITICAL(shared) if the transition touches a shared place.
+ * @param trans_idx Index of the transition.
+ * @param max_k Upper bound on the result.
+ * @return Number of firings possible, 0 if the transition is disabled.
+ */
+static int max_firings_locked(PetriNet* net, int trans_idx, int max_k) {
+    int k = max_k;
+
+    for (int a = net->in_start[trans_idx]; a < net->in_start[trans_idx + 1] && k > 0; a++) {
+        int place = net->in_arcs[a].place;
+        int weight = net->in_arcs[a].weight;
+        int available = *place_tokens(net, place);
+        int returned = 0;
+
+        if (available < weight) {
+            return 0;
+        }
+        for (int o = net->out_start[trans_idx]; o < net->out_start[trans_idx + 1]; o++) {
+            if (net->out_arcs[o].place == place) {
+                returned += net->out_arcs[o].weight;
+            }
+        }
+
+        // The first firing needs `weight` tokens, each further one `weight - returned`
+        int net_use = weight - returned;
+        if (net_use > 0) {
+            int limit = (available - weight) / net_use + 1;
+            if (limit < k) {
+                k = limit;
+            }
+        }
+    }
+    return k;
+}
+
+/**
+ * @brief Fire a transition k times, which the caller has checked the
+ * marking allows, and re-evaluate the consumers of the touched places.
+ * Caller must be inside NET_ENTER_CRITICAL(net), and
+ * SHARED_ENTER_CRITICAL(shared) if the transition touches a shared place.
+ * @param rising Bitmap that collects transitions that just became enabled.
+ * @param shared_rising Bitmap that collects shared places that gained tokens.
+ */
+static void apply_firings_locked(PetriNet* net, int trans_idx, int k, uint32_t rising[TRANSITION_MASK_WORDS],
+                                 uint32_t shared_rising[PLACE_MASK_WORDS]) {
+    bool shared = touches_shared(net, trans_idx);
+
+#if PETRI_NET_GENERATED
+    if (k == 1 && !shared) {
+        // Straight-line update of the places whose count changes, then the
+        // transitions that consume from them
+        marking_write_begin_locked(net);
+        petri_gen_fire(trans_idx, net->marking);
+        marking_write_end_locked(net);
+
+        for (int a = petri_gen_affected_start[trans_idx]; a < petri_gen_affected_start[trans_idx + 1]; a++) {
+            refresh_transition_locked(net, petri_gen_affected[a], rising);
+        }
+        return;
+    }
+#endif
+
+    const Arc* in_begin = &net->in_arcs[net->in_start[trans_idx]];
+    const Arc* in_end = &net->in_arcs[net->in_start[trans_idx + 1]];
+    const Arc* out_begin = &net->out_arcs[net->out_start[trans_idx]];
+    const Arc* out_end = &net->out_arcs[net->out_start[trans_idx + 1]];
+
+    // Remove tokens from input places, then add tokens to output places
+    marking_write_begin_locked(net);
+    if (shared) {
+        shared_write_begin_locked(net->shared);
+        for (const Arc* a = in_begin; a < in_end; a++) {
+            *place_tokens(net, a->place) -= (int32_t)a->weight * k;
+        }
+        for (const Arc* a = out_begin; a < out_end; a++) {
+            *place_tokens(net, a->place) += (int32_t)a->weight * k;
+        }
+        shared_write_end_locked(net->shared);
+    } else {
+        for (const Arc* a = in_begin; a < in_end; a++) {
+            net->marking[a->place] -= (int32_t)a->weight * k;
+        }
+        for (const Arc* a = out_begin; a < out_end; a++) {
+            net->marking[a->place] += (int32_t)a->weight * k;
+        }
+    }
+    marking_write_end_locked(net);
+
+    for (const Arc* a = in_begin; a < in_end; a++) {
+        refresh_place_consumers_locked(net, a->place, rising, NULL);
+    }
+    for (const Arc* a = out_begin; a < out_end; a++) {
+        refresh_place_consumers_locked(net, a->place, rising, shared_rising);
+    }
+}
+
+/**
+ * @brief Stage an arc for build_net_index(), validating its endpoints.
+ * @return true if the arc was staged, false (with an error printed) otherwise.
+ */
+static bool stage_arc(StagedArc* staged, int* count, const char* kind,
+                      int trans_idx, int place_idx, int weight) {
+    if (trans_idx < 0 || trans_idx >= manufacturing_model.num_transitions ||
+        place_idx < 0 || place_idx >= manufacturing_model.num_places) {
+        printf("ERROR: Cannot add %s arc T%d/P%d - unknown transition or place\n",
+            kind, trans_idx, place_idx);
+        return false;
+    }
+    if (weight <= 0 || weight > UINT16_MAX) {
+        printf("ERROR: Cannot add %s arc T%d/P%d - invalid weight %d\n",
+            kind, trans_idx, place_idx, weight);
+        return false;
+    }
+    if (*count >= MAX_ARCS) {
+        printf("ERROR: Cannot add %s arc T%d/P%d - max arcs reached\n",
+            kind, trans_idx, place_idx);
+        return false;
+    }
+
+    staged[*count].trans = (PetriIndex)trans_idx;
+    staged[*count].arc.place = (PetriIndex)place_idx;
+    staged[*count].arc.weight = (uint16_t)weight;
+    (*count)++;
+    return true;
+}
+
+/**
+ * @brief Group staged arcs by transition into a CSR start/arc array pair.
+ * The counting sort is stable, so arcs keep the order they were added in.
+ */
+static void compact_arcs(const StagedArc* staged, int count, PetriIndex* start, Arc* arcs) {
+    int num_transitions = manufacturing_model.num_transitions;
+    PetriIndex fill[MAX_TRANSITIONS];
+
+    memset(start, 0, sizeof(PetriIndex) * (MAX_TRANSITIONS + 1));
+    for (int i = 0; i < count; i++) {
+        start[staged[i].trans + 1]++;
+    }
+    for (int t = 0; t < num_transitions; t++) {
+        start[t + 1] = (PetriIndex)(start[t + 1] + start[t]);
+        fill[t] = start[t];
+    }
+    for (int i = 0; i < count; i++) {
+        arcs[fill[staged[i].trans]++] = staged[i].arc;
+    }
+}
+
+/**
+ * @brief Compute a line's enabled bitmap from scratch.
+ */
+static void refresh_all_transitions(PetriNet* net) {
+    uint32_t rising[TRANSITION_MASK_WORDS] = { 0 };
+
+    NET_ENTER_CRITICAL(net);
+    for (int t = 0; t < net->num_transitions; t++) {
+        refresh_transition_locked(net, t, rising);
+    }
+    NET_EXIT_CRITICAL(net);
+}
+
+// ====================
+// BUILDING THE MODEL
+// ====================
+
+/**
+ * @brief Clear the model, the lines and the shared places.
+ */
+void init_petri_net(void) {
+    memset(&manufacturing_model, 0, sizeof(manufacturing_model));
+    memset(petri_lines, 0, sizeof(petri_lines));
+    memset(&shared_places, 0, sizeof(shared_places));
+    petri_num_lines = 0;
+}
+
+/**
+ * @brief Add a new place to the Petri net.
+ * @param name Name of the place.
+ * @param initial_tokens Initial number of tokens in the place.
+ * @return Index of the new place.
+ */
+int add_place(const char* name, int initial_tokens) {
+    if (manufacturing_model.num_places >= MAX_PLACES) {
+        printf("ERROR: Cannot add place '%s' - max places reached\n", name);
+        return -1;
+    }
+
+    int idx = manufacturing_model.num_places++;
+    snprintf(manufacturing_model.places[idx].name, PETRI_NAME_LEN, "%s", name);
+    manufacturing_model.initial_marking[idx] = initial_tokens;
+    return idx;
+}
+
+/**
+ * @brief Add a new transition to the Petri net.
+ * @param name Name of the transition.
+ * @return Index of the new transition.
+ */
+int add_transition(const char* name) {
+    if (manufacturing_model.num_transitions >= MAX_TRANSITIONS) {
+        printf("ERROR: Cannot add transition '%s' - max transitions reached\n", name);
+        return -1;
+    }
+
+    int idx = manufacturing_model.num_transitions++;
+    snprintf(manufacturing_model.transitions[idx].name, PETRI_NAME_LEN, "%s", name);
+    return idx;
+}
+
+/**
+ * @brief Add an input arc from a place to a transition.
+ * @param trans_idx Index of the transition.
+ * @param place_idx Index of the input place.
+ * @param weight Number of tokens required from the place.
+ * @return true if the arc was added.
+ */
+bool add_arc_input(int trans_idx, int place_idx, int weight) {
+    return stage_arc(staged_in, &manufacturing_model.num_in_arcs, "input",
+        trans_idx, place_idx, weight);
+}
+
+/**
+ * @brief Add an output arc from a transition to a place.
+ * @param trans_idx Index of the transition.
+ * @param place_idx Index of the output place.
+ * @param weight Number of tokens produced to the place.
+ * @return true if the arc was added.
+ */
+bool add_arc_output(int trans_idx, int place_idx, int weight) {
+    return stage_arc(staged_out, &manufacturing_model.num_out_arcs, "output",
+        trans_idx, place_idx, weight);
+}
+
+/**
+ * @brief Build the CSR arc tables and the place->transition consumer index.
+ * Call once after all places, transitions and arcs have been added, and
+ * before the lines are instantiated.
+ * @return true on success.
+ */
+bool build_net_index(void) {
+    PetriModel* model = &manufacturing_model;
+    PetriIndex fill[MAX_PLACES];
+
+    compact_arcs(staged_in, model->num_in_arcs, net_in_start, net_in_arcs);
+    compact_arcs(staged_out, model->num_out_arcs, net_out_start, net_out_arcs);
+
+    // Count the consumers of each place, then lay them out back to back
+    memset(net_consumer_start, 0, sizeof(net_consumer_start));
+    for (int a = 0; a < model->num_in_arcs; a++) {
+        net_consumer_start[net_in_arcs[a].place + 1]++;
+    }
+    for (int p = 0; p < model->num_places; p++) {
+        net_consumer_start[p + 1] = (PetriIndex)(net_consumer_start[p + 1] + net_consumer_start[p]);
+        fill[p] = net_consumer_start[p];
+    }
+    for (int t = 0; t < model->num_transitions; t++) {
+        for (int a = net_in_start[t]; a < net_in_start[t + 1]; a++) {
+            net_consumers[fill[net_in_arcs[a].place]++] = (PetriIndex)t;
+        }
+    }
+
+    model->in_start = net_in_start;
+    model->out_start = net_out_start;
+    model->in_arcs = net_in_arcs;
+    model->out_arcs = net_out_arcs;
+    model->consumer_start = net_consumer_start;
+    model->consumers = net_consumers;
+    return true;
+}
+
+#if PETRI_NET_GENERATED
+/**
+ * @brief Install the net compiled into petri_net_generated.h. Use instead of
+ * loading a PNML file and build_net_index(), after init_petri_net().
+ * @return true on success.
+ */
+bool load_generated_net(void) {
+    PetriModel* model = &manufacturing_model;
+
+    for (int p = 0; p < PETRI_GEN_NUM_PLACES; p++) {
+        if (add_place(petri_gen_place_names[p], petri_gen_initial_marking[p]) < 0) {
+            return false;
+        }
+    }
+    for (int t = 0; t < PETRI_GEN_NUM_TRANSITIONS; t++) {
+        if (add_transition(petri_gen_transition_names[t]) < 0) {
+            return false;
+        }
+    }
+
+    model->num_in_arcs = PETRI_GEN_NUM_IN_ARCS;
+    model->num_out_arcs = PETRI_GEN_NUM_OUT_ARCS;
+    model->in_start = petri_gen_in_start;
+    model->out_start = petri_gen_out_start;
+    model->in_arcs = petri_gen_in_arcs;
+    model->out_arcs = petri_gen_out_arcs;
+    model->consumer_start = petri_gen_consumer_start;
+    model->consumers = petri_gen_consumers;
+    return true;
+}
+#endif
+
+/**
+ * @brief Look up a place by name.
+ * @return Index of the place, or -1 if there is none with that name.
+ */
+int find_place(const char* name) {
+    for (int p = 0; p < manufacturing_model.num_places; p++) {
+        if (strcmp(manufacturing_model.places[p].name, name) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Look up a transition by name.
+ * @return Index of the transition, or -1 if there is none with that name.
+ */
+int find_transition(const char* name) {
+    for (int t = 0; t < manufacturing_model.num_transitions; t++) {
+        if (strcmp(manufacturing_model.transitions[t].name, name) == 0) {
+            return t;
+        }
+    }
+    return -1;
+}
+
+// ====================
+// INSTANTIATING LINES
+// ====================
+
+/**
+ * @brief Make a place common to all lines, e.g. a worker pool for the whole
+ * plant. It starts with the model's initial marking once, not once per line.
+ * Call after the model is built and before instantiate_net_lines().
+ * @param place_idx Index of the place.
+ * @return true on success.
+ */
+bool share_place(int place_idx) {
+    if (petri_num_lines > 0 || place_idx < 0 || place_idx >= manufacturing_model.num_places) {
+        printf("ERROR: Cannot share place %d\n", place_idx);
+        return false;
+    }
+    shared_places.places[place_idx >> 5] |= 1u << (place_idx & 31);
+    return true;
+}
+
+/**
+ * @brief Create the lines, each starting from the model's initial marking.
+ * Call once, before the stations start firing.
+ * @param count Number of lines, 1 to PETRI_MAX_LINES.
+ * @return true on success.
+ */
+bool instantiate_net_lines(int count) {
+    const PetriModel* model = &manufacturing_model;
+    bool any_shared = false;
+
+    if (petri_num_lines > 0 || count < 1 || count > PETRI_MAX_LINES) {
+        printf("ERROR: Cannot create %d lines (1 to %d, once)\n", count, PETRI_MAX_LINES);
+        return false;
+    }
+
+    for (int p = 0; p < model->num_places; p++) {
+        if (mask_test(shared_places.places, p)) {
+            shared_places.marking[p] = model->initial_marking[p];
+            any_shared = true;
+        }
+    }
+    for (int t = 0; t < model->num_transitions; t++) {
+        for (int a = model->in_start[t]; a < model->in_start[t + 1]; a++) {
+            if (mask_test(shared_places.places, model->in_arcs[a].place)) {
+                shared_places.transitions[t >> 5] |= 1u << (t & 31);
+            }
+        }
+        for (int a = model->out_start[t]; a < model->out_start[t + 1]; a++) {
+            if (mask_test(shared_places.places, model->out_arcs[a].place)) {
+                shared_places.transitions[t >> 5] |= 1u << (t & 31);
+            }
+        }
+    }
+
+    for (int l = 0; l < count; l++) {
+        PetriNet* net = &petri_lines[l];
+
+        memset(net, 0, sizeof(*net));
+        net->in_start = model->in_start;
+        net->out_start = model->out_start;
+        net->in_arcs = model->in_arcs;
+        net->out_arcs = model->out_arcs;
+        net->consumer_start = model->consumer_start;
+        net->consumers = model->consumers;
+        net->num_places = model->num_places;
+        net->num_transitions = model->num_transitions;
+        net->shared = any_shared ? &shared_places : NULL;
+        net->line = l;
+        for (int p = 0; p < model->num_places; p++) {
+            net->marking[p] = mask_test(shared_places.places, p) ? 0 : model->initial_marking[p];
+        }
+        refresh_all_transitions(net);
+    }
+    petri_num_lines = count;
+    return true;
+}
+
+/**
+ * @brief Replace a line's token counts, e.g. with a marking restored from the
+ * journal. Shared places are left alone; see restore_shared_marking().
+ * Call after instantiate_net_lines() and before the scheduler starts.
+ * @param marking Token count of every place of the model.
+ */
+void restore_line_marking(PetriNet* net, const int32_t* marking) {
+    NET_ENTER_CRITICAL(net);
+    marking_write_begin_locked(net);
+    for (int p = 0; p < net->num_places; p++) {
+        if (!mask_test(shared_places.places, p)) {
+            net->marking[p] = marking[p];
+        }
+    }
+    marking_write_end_locked(net);
+    NET_EXIT_CRITICAL(net);
+    refresh_all_transitions(net);
+}
+
+/**
+ * @brief Replace the token counts of the shared places. Call when
+ * restore_line_marking() may be called.
+ * @param marking Token count of every place of the model; only the shared ones are used.
+ */
+void restore_shared_marking(const int32_t* marking) {
+    SHARED_ENTER_CRITICAL(&shared_places);
+    shared_write_begin_locked(&shared_places);
+    for (int p = 0; p < manufacturing_model.num_places; p++) {
+        if (mask_test(shared_places.places, p)) {
+            shared_places.marking[p] = marking[p];
+        }
+    }
+    shared_write_end_locked(&shared_places);
+    SHARED_EXIT_CRITICAL(&shared_places);
+}
+
+// ====================
+// PETRI NET OPERATIONS
+// ====================
+
+/**
+ * @brief Register the calling task's interest in a transition of a line.
+ * The task receives a NET_NOTIFY_INDEX notification whenever the transition
+ * goes from disabled to enabled.
+ * @param trans_idx Index of the transition.
+ * @return false if the transition already has MAX_TRANSITION_SUBSCRIBERS
+ *         subscribers; the task would then never be woken for it.
+ */
+bool subscribe_transition(PetriNet* net, int trans_idx) {
+    SubscriberList* list = &net->subscribers[trans_idx];
+    bool subscribed = false;
+
+    NET_ENTER_CRITICAL(net);
+    if (list->count < MAX_TRANSITION_SUBSCRIBERS) {
+        // Publish the handle before the count so lock-free readers never see a stale slot
+        list->tasks[list->count] = xTaskGetCurrentTaskHandle();
+        list->count++;
+        subscribed = true;
+    }
+    NET_EXIT_CRITICAL(net);
+
+    if (!subscribed) {
+        printf("ERROR: Cannot subscribe '%s' to transition '%s' on line %d - max subscribers (%d) reached\n",
+            pcTaskGetName(NULL), manufacturing_model.transitions[trans_idx].name, net->line,
+            MAX_TRANSITION_SUBSCRIBERS);
+    }
+    return subscribed;
+}
+
+/**
+ * @brief Register the task to notify on NET_OBSERVER_NOTIFY_INDEX after every
+ * change to the marking of any line. Only one observer is supported; NULL
+ * removes it.
+ * @param task Observer task handle.
+ */
+void set_marking_observer(TaskHandle_t task) {
+    marking_observer = task;
+}
+
+/**
+ * @brief Block the calling task until a subscribed transition may be enabled.
+ * Notifications that arrive between a failed fire attempt and this call are
+ * latched by the kernel, so no wakeup is lost.
+ * @param timeout Maximum time to wait.
+ * @return true if woken by a notification, false on timeout.
+ */
+bool wait_for_transition_event(TickType_t timeout) {
+    uint64_t started = metrics_now();
+    bool woken = ulTaskNotifyTakeIndexed(NET_NOTIFY_INDEX, pdTRUE, timeout) != 0;
+
+    metrics_idle(metrics_now() - started);
+    return woken;
+}
+
+/**
+ * @brief Check if a transition is enabled (all input places have required tokens).
+ * Reads the maintained bitmap, so it costs one load and takes no lock;
+ * transitions on shared places also read those token counts.
+ * @param trans_idx Index of the transition.
+ * @return true if enabled, false otherwise.
+ */
+bool is_transition_enabled(const PetriNet* net, int trans_idx) {
+    uint32_t word = *(volatile const uint32_t*)&net->enabled_mask[trans_idx >> 5];
+    if ((word & (1u << (trans_idx & 31))) == 0) {
+        return false;
+    }
+    return !touches_shared(net, trans_idx) || shared_inputs_marked(net, trans_idx);
+}
+
+/**
+ * @brief Find the lowest-numbered enabled transition at or after a start index.
+ * @param from Index to start scanning from.
+ * @return Index of the transition, or -1 if none is enabled.
+ */
+int find_first_enabled_transition(const PetriNet* net, int from) {
+    if (from < 0) {
+        from = 0;
+    }
+
+    for (int w = from >> 5; w < TRANSITION_MASK_WORDS; w++) {
+        uint32_t bits = *(volatile const uint32_t*)&net->enabled_mask[w];
+        if (w == (from >> 5)) {
+            bits &= ~0u << (from & 31);
+        }
+        for (; bits != 0; bits &= bits - 1) {
+            int idx = (w << 5) + bit_scan_forward(bits);
+            if (idx >= net->num_transitions) {
+                return -1;
+            }
+            if (!touches_shared(net, idx) || shared_inputs_marked(net, idx)) {
+                return idx;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Copy the enabled-transition bitmap.
+ * @param out Destination with room for TRANSITION_MASK_WORDS words.
+ */
+void get_enabled_transitions(PetriNet* net, uint32_t out[TRANSITION_MASK_WORDS]) {
+    NET_ENTER_CRITICAL(net);
+    memcpy(out, net->enabled_mask, sizeof(net->enabled_mask));
+    NET_EXIT_CRITICAL(net);
+
+    if (net->shared != NULL) {
+        for (int w = 0; w < TRANSITION_MASK_WORDS; w++) {
+            for (uint32_t bits = out[w] & net->shared->transitions[w]; bits != 0; bits &= bits - 1) {
+                int t = (w << 5) + bit_scan_forward(bits);
+                if (!shared_inputs_marked(net, t)) {
+                    out[w] &= ~(1u << (t & 31));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Fire a transition: consume tokens from input places and produce tokens to output places.
+ * The enable check and the marking update happen in one critical section, and
+ * only the consumers of the touched places are re-evaluated.
+ * @param trans_idx Index of the transition.
+ * @return true if fired successfully, false otherwise.
+ */
+bool fire_transition(PetriNet* net, int trans_idx) {
+    uint32_t rising[TRANSITION_MASK_WORDS] = { 0 };
+    uint32_t shared_rising[PLACE_MASK_WORDS] = { 0 };
+    bool shared = touches_shared(net, trans_idx);
+    MetricsShard* shard = metrics_shard();
+    uint64_t wait_start = metrics_now();
+
+    NET_ENTER_CRITICAL(net);
+    if (shared) {
+        SHARED_ENTER_CRITICAL(net->shared);
+    }
+    uint64_t now = metrics_now();
+
+    if (!mask_test(net->enabled_mask, trans_idx) || (shared && !shared_inputs_marked(net, trans_idx))) {
+        if (shared) {
+            SHARED_EXIT_CRITICAL(net->shared);
+        }
+        NET_EXIT_CRITICAL(net);
+        metrics_attempt(shard, trans_idx, false, now - wait_start);
+        return false;
+    }
+
+    apply_firings_locked(net, trans_idx, 1, rising, shared_rising);
+    metrics_firing_locked(shard, net, trans_idx, 1, now);
+    item_tokens_firing_locked(net, trans_idx, 1);
+    journal_firing_locked(net, trans_idx, 1);
+
+    if (shared) {
+        SHARED_EXIT_CRITICAL(net->shared);
+    }
+    NET_EXIT_CRITICAL(net);
+    metrics_attempt(shard, trans_idx, true, now - wait_start);
+    net_trace_firing(net->line, trans_idx, 1);
+
+    // Wake the stations whose transitions have just become enabled
+    notify_subscribers(net, rising);
+    if (shared) {
+        notify_shared_consumers(shared_rising, false);
+    }
+
+    // Mark status as dirty for immediate update
+    publish_marking_change();
+
+    return true;
+}
+
+/**
+ * @brief Fire a transition as many times as the marking allows, up to max_k,
+ * in one critical section with a single wakeup and status update.
+ * @param trans_idx Index of the transition.
+ * @param max_k Maximum number of firings.
+ * @return Number of times the transition fired.
+ */
+int fire_transition_n(PetriNet* net, int trans_idx, int max_k) {
+    uint32_t rising[TRANSITION_MASK_WORDS] = { 0 };
+    uint32_t shared_rising[PLACE_MASK_WORDS] = { 0 };
+    bool shared = touches_shared(net, trans_idx);
+
+    if (max_k <= 0) {
+        return 0;
+    }
+
+    MetricsShard* shard = metrics_shard();
+    uint64_t wait_start = metrics_now();
+
+    NET_ENTER_CRITICAL(net);
+    if (shared) {
+        SHARED_ENTER_CRITICAL(net->shared);
+    }
+    uint64_t now = metrics_now();
+
+    int k = max_firings_locked(net, trans_idx, max_k);
+    if (k > 0) {
+        apply_firings_locked(net, trans_idx, k, rising, shared_rising);
+        metrics_firing_locked(shard, net, trans_idx, k, now);
+        item_tokens_firing_locked(net, trans_idx, k);
+        journal_firing_locked(net, trans_idx, k);
+    }
+
+    if (shared) {
+        SHARED_EXIT_CRITICAL(net->shared);
+    }
+    NET_EXIT_CRITICAL(net);
+    metrics_attempt(shard, trans_idx, k > 0, now - wait_start);
+    if (k == 0) {
+        return 0;
+    }
+    net_trace_firing(net->line, trans_idx, k);
+
+    notify_subscribers(net, rising);
+    if (shared) {
+        notify_shared_consumers(shared_rising, false);
+    }
+    publish_marking_change();
+
+    return k;
+}
+
+/**
+ * @brief Fire a set of transitions as one step in a single critical section.
+ * Every member is checked against the marking before the step, minus what
+ * earlier members of the list have already consumed; tokens produced by the
+ * step only become available after it. When members conflict, the earlier
+ * one in the list wins. A line with shared places holds their lock for the
+ * whole step.
+ * @param trans Transition indices, in priority order.
+ * @param count Number of entries in trans.
+ * @param fired Optional bitmap that receives the transitions that fired.
+ * @return Number of transitions that fired.
+ */
+int fire_step(PetriNet* net, const int* trans, int count, uint32_t fired[TRANSITION_MASK_WORDS]) {
+    uint32_t rising[TRANSITION_MASK_WORDS] = { 0 };
+    uint32_t shared_rising[PLACE_MASK_WORDS] = { 0 };
+    uint32_t taken[TRANSITION_MASK_WORDS] = { 0 };
+    int num_fired = 0;
+    MetricsShard* shard = metrics_shard();
+    uint64_t wait_start = metrics_now();
+
+    NET_ENTER_CRITICAL(net);
+    if (net->shared != NULL) {
+        SHARED_ENTER_CRITICAL(net->shared);
+    }
+    uint64_t now = metrics_now();
+
+    // Consume phase: take inputs for every member the remaining marking covers
+    for (int i = 0; i < count; i++) {
+        int t = trans[i];
+        uint32_t bit = 1u << (t & 31);
+
+        if ((taken[t >> 5] & bit) != 0 || !transition_enabled_locked(net, t) ||
+            (touches_shared(net, t) && !shared_inputs_marked(net, t))) {
+            continue;
+        }
+        if (num_fired == 0) {
+            marking_write_begin_locked(net);
+            if (net->shared != NULL) {
+                shared_write_begin_locked(net->shared);
+            }
+        }
+        for (int a = net->in_start[t]; a < net->in_start[t + 1]; a++) {
+            *place_tokens(net, net->in_arcs[a].place) -= net->in_arcs[a].weight;
+        }
+        taken[t >> 5] |= bit;
+        num_fired++;
+    }
+
+    // Produce phase, then re-evaluate everything the step touched
+    for (int w = 0; w < TRANSITION_MASK_WORDS; w++) {
+        for (uint32_t bits = taken[w]; bits != 0; bits &= bits - 1) {
+            int t = (w << 5) + bit_scan_forward(bits);
+            for (int a = net->out_start[t]; a < net->out_start[t + 1]; a++) {
+                *place_tokens(net, net->out_arcs[a].place) += net->out_arcs[a].weight;
+            }
+        }
+    }
+    if (num_fired > 0) {
+        if (net->shared != NULL) {
+            shared_write_end_locked(net->shared);
+        }
+        marking_write_end_locked(net);
+    }
+    for (int w = 0; w < TRANSITION_MASK_WORDS; w++) {
+        for (uint32_t bits = taken[w]; bits != 0; bits &= bits - 1) {
+            int t = (w << 5) + bit_scan_forward(bits);
+            for (int a = net->in_start[t]; a < net->in_start[t + 1]; a++) {
+                refresh_place_consumers_locked(net, net->in_arcs[a].place, rising, NULL);
+            }
+            for (int a = net->out_start[t]; a < net->out_start[t + 1]; a++) {
+                refresh_place_consumers_locked(net, net->out_arcs[a].place, rising, shared_rising);
+            }
+            metrics_firing_locked(shard, net, t, 1, now);
+            item_tokens_firing_locked(net, t, 1);
+            journal_firing_locked(net, t, 1);
+        }
+    }
+
+    if (net->shared != NULL) {
+        SHARED_EXIT_CRITICAL(net->shared);
+    }
+    NET_EXIT_CRITICAL(net);
+
+    // The lock wait is charged to the first member; members that lost count as failed
+    for (int i = 0; i < count; i++) {
+        int t = trans[i];
+        bool member_fired = (taken[t >> 5] & (1u << (t & 31))) != 0;
+        metrics_attempt(shard, t, member_fired, i == 0 ? now - wait_start : 0);
+        if (member_fired) {
+            net_trace_firing(net->line, t, 1);
+        }
+    }
+
+    if (fired != NULL) {
+        memcpy(fired, taken, sizeof(taken));
+    }
+    if (num_fired > 0) {
+        notify_subscribers(net, rising);
+        if (net->shared != NULL) {
+            notify_shared_consumers(shared_rising, false);
+        }
+        publish_marking_change();
+    }
+
+    return num_fired;
+}
+
+/**
+ * @brief Add tokens to a place from interrupt context and wake any station
+ * whose transition becomes enabled as a result.
+ * @param net Line to add to; for a shared place, any line.
+ * @param place_idx Index of the place.
+ * @param count Number of tokens to add.
+ */
+void add_place_tokens_from_isr(PetriNet* net, int place_idx, int count) {
+    uint32_t rising[TRANSITION_MASK_WORDS] = { 0 };
+    uint32_t shared_rising[PLACE_MASK_WORDS] = { 0 };
+    bool shared = is_shared_place(place_idx);
+    uint64_t now = metrics_now();
+
+    UBaseType_t saved = NET_ENTER_CRITICAL_FROM_ISR(net);
+    if (shared) {
+        UBaseType_t shared_saved = SHARED_ENTER_CRITICAL_FROM_ISR(net->shared);
+        shared_write_begin_locked(net->shared);
+        net->shared->marking[place_idx] += count;
+        shared_write_end_locked(net->shared);
+        refresh_place_consumers_locked(net, place_idx, rising, shared_rising);
+        metrics_tokens_added_locked(net, place_idx, count, now);
+        item_tokens_added_locked(net, place_idx, count, true);
+        journal_tokens_added_locked(net, place_idx, count);
+        SHARED_EXIT_CRITICAL_FROM_ISR(net->shared, shared_saved);
+    } else {
+        marking_write_begin_locked(net);
+        net->marking[place_idx] += count;
+        marking_write_end_locked(net);
+        refresh_place_consumers_locked(net, place_idx, rising, shared_rising);
+        metrics_tokens_added_locked(net, place_idx, count, now);
+        item_tokens_added_locked(net, place_idx, count, true);
+        journal_tokens_added_locked(net, place_idx, count);
+    }
+    NET_EXIT_CRITICAL_FROM_ISR(net, saved);
+    net_trace_tokens_added(net->line, place_idx, count);
+
+    // The keyboard interrupt never requests a yield, so woken stations run on the next tick
+    notify_subscribers_from_isr(net, rising, NULL);
+    if (shared) {
+        notify_shared_consumers(shared_rising, true);
+    }
+    publish_marking_change_from_isr(NULL);
+}
+
+/**
+ * @brief Change the token counts of several places of a line from interrupt
+ * context, all or nothing: if any count would drop below zero the marking
+ * is left as it was. The whole batch is one write of the marking, so no
+ * station or snapshot ever sees part of it. A place may appear more than
+ * once; its changes add up.
+ * @param net Line to change; shared places in the batch change for every line.
+ * @param adjustments Places and the tokens to add to them, negative to take away.
+ * @param count Number of adjustments.
+ * @return true if the batch was applied, false if it would leave a place
+ *         below zero or above INT32_MAX, or names a place the net lacks.
+ */
+bool adjust_marking_from_isr(PetriNet* net, const PetriAdjustment* adjustments, int count) {
+    int64_t change[MAX_PLACES] = { 0 };
+    uint32_t touched[PLACE_MASK_WORDS] = { 0 };
+    uint32_t rising[TRANSITION_MASK_WORDS] = { 0 };
+    uint32_t shared_rising[PLACE_MASK_WORDS] = { 0 };
+    bool own = false;
+    bool shared = false;
+
+    for (int i = 0; i < count; i++) {
+        int p = adjustments[i].place;
+        if (p < 0 || p >= net->num_places) {
+            return false;
+        }
+        change[p] += adjustments[i].delta;
+        touched[p >> 5] |= 1u << (p & 31);
+        if (is_shared_place(p)) {
+            shared = true;
+        } else {
+            own = true;
+        }
+    }
+
+    uint64_t now = metrics_now();
+    UBaseType_t saved = NET_ENTER_CRITICAL_FROM_ISR(net);
+    UBaseType_t shared_saved = 0;
+    if (shared) {
+        shared_saved = SHARED_ENTER_CRITICAL_FROM_ISR(net->shared);
+    }
+
+    bool valid = true;
+    for (int w = 0; w < PLACE_MASK_WORDS && valid; w++) {
+        for (uint32_t bits = touched[w]; bits != 0 && valid; bits &= bits - 1) {
+            int p = (w << 5) + bit_scan_forward(bits);
+            int64_t tokens = *place_tokens(net, p) + change[p];
+            valid = tokens >= 0 && tokens <= INT32_MAX;
+        }
+    }
+
+    if (valid) {
+        if (own) {
+            marking_write_begin_locked(net);
+        }
+        if (shared) {
+            shared_write_begin_locked(net->shared);
+        }
+        for (int w = 0; w < PLACE_MASK_WORDS; w++) {
+            for (uint32_t bits = touched[w]; bits != 0; bits &= bits - 1) {
+                int p = (w << 5) + bit_scan_forward(bits);
+                *place_tokens(net, p) += (int32_t)change[p];
+            }
+        }
+        if (shared) {
+            shared_write_end_locked(net->shared);
+        }
+        if (own) {
+            marking_write_end_locked(net);
+        }
+
+        for (int w = 0; w < PLACE_MASK_WORDS; w++) {
+            for (uint32_t bits = touched[w]; bits != 0; bits &= bits - 1) {
+                int p = (w << 5) + bit_scan_forward(bits);
+                int delta = (int)change[p];
+                if (delta == 0) {
+                    continue;
+                }
+                refresh_place_consumers_locked(net, p, rising, delta > 0 ? shared_rising : NULL);
+                metrics_tokens_added_locked(net, p, delta, now);
+                item_tokens_added_locked(net, p, delta, true);
+                journal_tokens_added_locked(net, p, delta);
+            }
+        }
+    }
+
+    if (shared) {
+        SHARED_EXIT_CRITICAL_FROM_ISR(net->shared, shared_saved);
+    }
+    NET_EXIT_CRITICAL_FROM_ISR(net, saved);
+    if (!valid) {
+        return false;
+    }
+
+    for (int w = 0; w < PLACE_MASK_WORDS; w++) {
+        for (uint32_t bits = touched[w]; bits != 0; bits &= bits - 1) {
+            int p = (w << 5) + bit_scan_forward(bits);
+            if (change[p] != 0) {
+                net_trace_tokens_added(net->line, p, (int)change[p]);
+            }
+        }
+    }
+    notify_subscribers_from_isr(net, rising, NULL);
+    if (shared) {
+        notify_shared_consumers(shared_rising, true);
+    }
+    publish_marking_change_from_isr(NULL);
+    return true;
+}
+
+/**
+ * @brief Get the number of tokens in a place of a line.
+ * A single aligned int is read atomically, so no lock is taken.
+ * @param place_idx Index of the place.
+ * @return Number of tokens in the place; for a shared place, the common count.
+ */
+int get_place_tokens(const PetriNet* net, int place_idx) {
+    return *(volatile int32_t*)place_tokens((PetriNet*)net, place_idx);
+}
+
+/**
+ * @brief true if the place's tokens are common to all lines.
+ */
+bool is_shared_place(int place_idx) {
+    return mask_test(shared_places.places, place_idx);
+}
+
+/**
+ * @brief Current marking version of a line, including the shared places.
+ * It changes whenever any of its token counts does, so callers can tell
+ * that a cached view of the marking is stale.
+ * @return Marking version.
+ */
+uint32_t get_marking_version(const PetriNet* net) {
+    uint32_t version = net->marking_seq >> 1;
+    if (net->shared != NULL) {
+        version += net->shared->marking_seq >> 1;
+    }
+    return version;
+}
+
+/**
+ * @brief Copy a seqlock-guarded marking without blocking its writers.
+ * @return The version the copy belongs to.
+ */
+static uint32_t read_marking(const volatile uint32_t* seq, const int32_t* marking, int32_t* out, int count) {
+    uint32_t before;
+    uint32_t after;
+
+    do {
+        before = *seq;
+        NET_MEMORY_BARRIER();
+        memcpy(out, (const void*)marking, (size_t)count * sizeof(marking[0]));
+        NET_MEMORY_BARRIER();
+        after = *seq;
+    } while ((before & 1u) != 0 || before != after);
+
+    return before >> 1;
+}
+
+/**
+ * @brief Take a consistent copy of a line's marking without blocking writers.
+ * Safe to call from any task or native thread; it retries while a firing is
+ * in progress. Shared places are copied under their own seqlock, so they
+ * may be a firing older or newer than the line's places.
+ * @param out Receives the token counts and the version they belong to.
+ */
+void petri_snapshot(const PetriNet* net, PetriSnapshot* out) {
+    out->num_places = net->num_places;
+    out->version = read_marking(&net->marking_seq, net->marking, out->marking, out->num_places);
+
+    if (net->shared != NULL) {
+        int32_t shared[MAX_PLACES];
+        out->version += read_marking(&net->shared->marking_seq, net->shared->marking, shared, out->num_places);
+        for (int p = 0; p < out->num_places; p++) {
+            if (mask_test(net->shared->places, p)) {
+                out->marking[p] = shared[p];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Total tokens per place over every line, counting shared places once.
+ * Each line is copied under its own seqlock without stopping any of them,
+ * so the total may combine lines at slightly different moments. The
+ * version is the sum of the lines', so it moves whenever any line does.
+ * @param out Receives the totals.
+ */
+void petri_snapshot_all(PetriSnapshot* out) {
+    PetriSnapshot line;
+
+    memset(out, 0, sizeof(*out));
+    out->num_places = manufacturing_model.num_places;
+    for (int l = 0; l < petri_num_lines; l++) {
+        const PetriNet* net = &petri_lines[l];
+        out->version += read_marking(&net->marking_seq, net->marking, line.marking, out->num_places);
+        for (int p = 0; p < out->num_places; p++) {
+            out->marking[p] += line.marking[p];
+        }
+    }
+    if (petri_num_lines > 0 && petri_lines[0].shared != NULL) {
+        const PetriShared* shared = petri_lines[0].shared;
+        out->version += read_marking(&shared->marking_seq, shared->marking, line.marking, out->num_places);
+        for (int p = 0; p < out->num_places; p++) {
+            if (mask_test(shared->places, p)) {
+                out->marking[p] = line.marking[p];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Copy a line's own token counts without blocking its writers.
+ * Shared places read 0; their counts come from petri_read_shared_marking().
+ * @param out Receives the token count of every place of the model.
+ * @return The line's own marking version, without the shared places'.
+ */
+uint32_t petri_read_line_marking(const PetriNet* net, int32_t* out) {
+    return read_marking(&net->marking_seq, net->marking, out, net->num_places);
+}
+
+/**
+ * @brief Copy the shared places' token counts without blocking their writers.
+ * @param out Receives a count for every place of the model; only the shared ones are meaningful.
+ * @return The shared places' marking version.
+ */
+uint32_t petri_read_shared_marking(int32_t* out) {
+    return read_marking(&shared_places.marking_seq, shared_places.marking, out, manufacturing_model.num_places);
+}
@@ -0,0 +1,320 @@
+/*
+ * Petri net engine for the manufacturing process control demo.
+ *
+ * The net is stored in a compressed sparse row (CSR) layout: every
+ * transition owns a contiguous slice of one shared input arc array and one
+ * shared output arc array, so firing walks exactly the arcs it has without
+ * sentinel checks. Token counts live in their own dense marking array,
+ * away from the place and transition names, so the firing path only
+ * touches a few cache lines.
+ *
+ * The structure (PetriModel) is separate from the state (PetriNet): one
+ * model is loaded, then instantiate_net_lines() creates up to
+ * PETRI_MAX_LINES lines, each with its own marking and lock, and every
+ * firing call names the line it acts on. Places passed to share_place()
+ * beforehand, such as a common worker pool, hold one set of tokens for
+ * all lines.
+ */
+
+#ifndef PETRI_NET_H
+#define PETRI_NET_H
+
+#if defined(_MSC_VER)
+ // MSVC does not support C11 atomics in C mode
+typedef volatile long atomic_bool;
+#define atomic_store(ptr, val) (*(ptr) = (val))
+#define atomic_load(ptr) (*(ptr))
+#include <intrin.h>
+#else
+#include <stdatomic.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// ====================
+// PETRI NET STRUCTURE
+// ====================
+
+#define MAX_PLACES 64
+#define MAX_TRANSITIONS 64
+#define MAX_ARCS 256                   // Input and output arcs are counted separately
+#define MAX_TRANSITION_SUBSCRIBERS 4   // Every task of a full worker pool
+#define PETRI_MAX_LINES 4              // Lines instantiated from one model
+#define PETRI_NAME_LEN 32
+
+/* Environment variables read by the application: the number of lines to
+ * run, and a comma-separated list of places all lines share. */
+#define PETRI_LINES_ENV "PETRI_LINES"
+#define PETRI_SHARED_PLACES_ENV "PETRI_SHARED_PLACES"
+
+/* Set to 1 to run on the net compiled into petri_net_generated.h by
+ * tools/pnml_codegen (call load_generated_net() instead of loading the
+ * PNML file): the arc tables live in read-only memory and each transition
+ * fires through its own straight-line code. */
+#ifndef PETRI_NET_GENERATED
+#define PETRI_NET_GENERATED 0
+#endif
+
+/* Number of 32-bit words in a transition or place bitmap. */
+#define TRANSITION_MASK_WORDS ((MAX_TRANSITIONS + 31) / 32)
+#define PLACE_MASK_WORDS ((MAX_PLACES + 31) / 32)
+
+/* Task notification array slot used to wake stations when tokens arrive.
+ * Slot 0 is left free for the kernel's stream/message buffer helpers. */
+#define NET_NOTIFY_INDEX 1
+
+/* Slot used to tell the marking observer (the status server) that the
+ * marking has changed. */
+#define NET_OBSERVER_NOTIFY_INDEX 2
+
+/* Arc endpoints and CSR offsets are stored in 16 bits. */
+typedef uint16_t PetriIndex;
+
+typedef struct {
+    PetriIndex place;              // Place at the other end of the arc
+    uint16_t weight;               // Tokens consumed or produced
+} Arc;
+
+typedef struct {
+    char name[PETRI_NAME_LEN];     // Place name
+} Place;
+
+typedef struct {
+    char name[PETRI_NAME_LEN];     // Transition name
+} Transition;
+
+/*
+ * The net's structure: names, initial marking and arc tables. It is built
+ * once at startup and never changes afterwards, so any number of lines can
+ * be instantiated from it.
+ */
+typedef struct {
+    // Arcs of transition t are in_arcs[in_start[t]] .. in_arcs[in_start[t + 1] - 1]
+    // (and likewise for out_arcs). The tables are filled by
+    // build_net_index(), or are the const generated tables.
+    const PetriIndex* in_start;
+    const PetriIndex* out_start;
+    const Arc* in_arcs;
+    const Arc* out_arcs;
+
+    // Reverse index: transitions consuming from place p are
+    // consumers[consumer_start[p]] .. consumers[consumer_start[p + 1] - 1]
+    const PetriIndex* consumer_start;
+    const PetriIndex* consumers;
+
+    int num_places;
+    int num_transitions;
+    int num_in_arcs;
+    int num_out_arcs;
+
+    int32_t initial_marking[MAX_PLACES];
+    Place places[MAX_PLACES];
+    Transition transitions[MAX_TRANSITIONS];
+} PetriModel;
+
+typedef struct {
+    TaskHandle_t tasks[MAX_TRANSITION_SUBSCRIBERS];
+    int count;
+} SubscriberList;
+
+#if ( configNUMBER_OF_CORES > 1 )
+/* Spinlock taken with interrupts masked on the calling core, so a holder
+ * is never preempted and an ISR on the same core cannot spin on it. */
+typedef struct {
+    volatile long held;
+    UBaseType_t saved_mask;        // Interrupt mask to restore, written by the holder
+} PetriLock;
+#endif
+
+/*
+ * Places shared by every line, e.g. one worker pool for the whole plant.
+ * Their tokens live here instead of in the lines' markings, under a lock
+ * of their own that is always taken after the line's.
+ */
+typedef struct {
+    int32_t marking[MAX_PLACES];                   // Only the shared places are used
+    volatile uint32_t marking_seq;                 // Seqlock, as for a line
+    uint32_t places[PLACE_MASK_WORDS];             // Bit p is set if place p is shared
+    uint32_t transitions[TRANSITION_MASK_WORDS];   // Bit t is set if transition t has an arc to one
+#if ( configNUMBER_OF_CORES > 1 )
+    PetriLock lock;
+#endif
+} PetriShared;
+
+/*
+ * One production line: a marking of the model with its own lock, enabled
+ * bitmap and subscribers. Stations address their line through a handle,
+ * so lines never wait for each other except on shared places.
+ */
+typedef struct PetriNet {
+    // Hot data touched by every firing
+    int32_t marking[MAX_PLACES];                   // Token count of each place
+    uint32_t enabled_mask[TRANSITION_MASK_WORDS];  // Bit t is set while transition t's own-line inputs are marked
+    volatile uint32_t marking_seq;                 // Seqlock: odd while the marking is being written
+
+    // Copied from the model so the firing path dereferences only the line
+    const PetriIndex* in_start;
+    const PetriIndex* out_start;
+    const Arc* in_arcs;
+    const Arc* out_arcs;
+    const PetriIndex* consumer_start;
+    const PetriIndex* consumers;
+    int num_places;
+    int num_transitions;
+
+    PetriShared* shared;           // NULL when no place is shared
+    int line;                      // Index in petri_lines[]
+#if ( configNUMBER_OF_CORES > 1 )
+    PetriLock lock;
+#endif
+
+    // Cold data: subscriptions
+    SubscriberList subscribers[MAX_TRANSITIONS];
+} PetriNet;
+
+/*
+ * Each line is guarded by its own lock, and the shared places by another,
+ * instead of one lock for the whole plant. A lock covers the marking update
+ * and the bookkeeping that must stay in step with it: the metrics' arrival
+ * runs and sojourn counters, the colored tokens' item queues and the
+ * journal record, all bounded integer work. Nothing inside it may block or
+ * call into Windows; timestamps come from the cycle counter (__rdtsc()).
+ * On a single core both are the kernel critical section, which is cheaper
+ * than a semaphore take/give and never triggers priority inheritance;
+ * since only one task runs at a time the lines still never wait for each
+ * other. SMP builds give every line and the shared places a spinlock of
+ * their own, so lines on different cores fire in parallel and only meet
+ * on the shared places. The shared lock is always taken after the line's.
+ */
+#if ( configNUMBER_OF_CORES > 1 )
+
+#if defined(_MSC_VER)
+#define PETRI_LOCK_EXCHANGE(ptr, val)   InterlockedExchange((ptr), (val))
+#define PETRI_LOCK_RELEASE(ptr)         InterlockedExchange((ptr), 0)
+#define PETRI_CPU_RELAX()               YieldProcessor()
+#else
+#define PETRI_LOCK_EXCHANGE(ptr, val)   __atomic_exchange_n((ptr), (val), __ATOMIC_ACQUIRE)
+#define PETRI_LOCK_RELEASE(ptr)         __atomic_store_n((ptr), 0, __ATOMIC_RELEASE)
+#define PETRI_CPU_RELAX()               ((void)0)
+#endif
+
+static inline UBaseType_t petri_lock_take(PetriLock* lock) {
+    UBaseType_t saved = portSET_INTERRUPT_MASK_FROM_ISR();
+    while (PETRI_LOCK_EXCHANGE(&lock->held, 1) != 0) {
+        while (lock->held != 0) {
+            PETRI_CPU_RELAX();
+        }
+    }
+    return saved;
+}
+
+static inline void petri_lock_give(PetriLock* lock, UBaseType_t saved) {
+    PETRI_LOCK_RELEASE(&lock->held);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(saved);
+}
+
+#define NET_ENTER_CRITICAL(net)            do { UBaseType_t saved_ = petri_lock_take(&(net)->lock); (net)->lock.saved_mask = saved_; } while (0)
+#define NET_EXIT_CRITICAL(net)             petri_lock_give(&(net)->lock, (net)->lock.saved_mask)
+#define NET_ENTER_CRITICAL_FROM_ISR(net)   petri_lock_take(&(net)->lock)
+#define NET_EXIT_CRITICAL_FROM_ISR(net, saved) petri_lock_give(&(net)->lock, (saved))
+
+#else
+
+#define NET_ENTER_CRITICAL(net)            do { (void)(net); taskENTER_CRITICAL(); } while (0)
+#define NET_EXIT_CRITICAL(net)             do { (void)(net); taskEXIT_CRITICAL(); } while (0)
+#define NET_ENTER_CRITICAL_FROM_ISR(net)   ((void)(net), taskENTER_CRITICAL_FROM_ISR())
+#define NET_EXIT_CRITICAL_FROM_ISR(net, saved) do { (void)(net); taskEXIT_CRITICAL_FROM_ISR(saved); } while (0)
+
+#endif
+
+// The shared places' lock works like a line's
+#define SHARED_ENTER_CRITICAL(shared)      NET_ENTER_CRITICAL(shared)
+#define SHARED_EXIT_CRITICAL(shared)       NET_EXIT_CRITICAL(shared)
+#define SHARED_ENTER_CRITICAL_FROM_ISR(shared) NET_ENTER_CRITICAL_FROM_ISR(shared)
+#define SHARED_EXIT_CRITICAL_FROM_ISR(shared, saved) NET_EXIT_CRITICAL_FROM_ISR(shared, saved)
+
+/*
+ * Marking snapshots use a seqlock. Writers (already serialized by the
+ * line's lock) make marking_seq odd, update the marking and make it
+ * even again; readers copy the marking between two reads of marking_seq
+ * and retry if either was odd or they differ. Readers never block the
+ * firing path and may run anywhere, including native Windows threads.
+ * The marking version is marking_seq / 2.
+ */
+#if defined(_MSC_VER)
+#define NET_MEMORY_BARRIER()    MemoryBarrier()
+#else
+#define NET_MEMORY_BARRIER()    atomic_thread_fence(memory_order_seq_cst)
+#endif
+
+typedef struct {
+    uint32_t version;              // Marking version the copy was taken at
+    int num_places;
+    int32_t marking[MAX_PLACES];
+} PetriSnapshot;
+
+/* One change of a batch applied by adjust_marking_from_isr(). */
+typedef struct {
+    int place;
+    int32_t delta;                 // Tokens to add, negative to take away
+} PetriAdjustment;
+
+// The model every line is instantiated from
+extern PetriModel manufacturing_model;
+
+// Lines created by instantiate_net_lines()
+extern PetriNet petri_lines[PETRI_MAX_LINES];
+extern int petri_num_lines;
+
+// Atomic flag to signal status update
+extern atomic_bool status_dirty;
+
+// ====================
+// PETRI NET OPERATIONS
+// ====================
+
+// Building the model, before any line exists
+void init_petri_net(void);
+int add_place(const char* name, int initial_tokens);
+int add_transition(const char* name);
+bool add_arc_input(int trans_idx, int place_idx, int weight);
+bool add_arc_output(int trans_idx, int place_idx, int weight);
+bool build_net_index(void);
+#if PETRI_NET_GENERATED
+bool load_generated_net(void);
+#endif
+int find_place(const char* name);
+int find_transition(const char* name);
+
+// Instantiating lines
+bool share_place(int place_idx);
+bool instantiate_net_lines(int count);
+void restore_line_marking(PetriNet* net, const int32_t* marking);
+void restore_shared_marking(const int32_t* marking);
+
+bool subscribe_transition(PetriNet* net, int trans_idx);
+void set_marking_observer(TaskHandle_t task);
+bool wait_for_transition_event(TickType_t timeout);
+
+bool is_transition_enabled(const PetriNet* net, int trans_idx);
+int find_first_enabled_transition(const PetriNet* net, int from);
+void get_enabled_transitions(PetriNet* net, uint32_t out[TRANSITION_MASK_WORDS]);
+
+bool fire_transition(PetriNet* net, int trans_idx);
+int fire_transition_n(PetriNet* net, int trans_idx, int max_k);
+int fire_step(PetriNet* net, const int* trans, int count, uint32_t fired[TRANSITION_MASK_WORDS]);
+void add_place_tokens_from_isr(PetriNet* net, int place_idx, int count);
+bool adjust_marking_from_isr(PetriNet* net, const PetriAdjustment* adjustments, int count);
+int get_place_tokens(const PetriNet* net, int place_idx);
+bool is_shared_place(int place_idx);
+uint32_t get_marking_version(const PetriNet* net);
+void petri_snapshot(const PetriNet* net, PetriSnapshot* out);
+void petri_snapshot_all(PetriSnapshot* out);
+uint32_t petri_read_line_marking(const PetriNet* net, int32_t* out);
+uint32_t petri_read_shared_marking(int32_t* out);
+
+#endif /* PETRI_NET_H */
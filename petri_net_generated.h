@@ -0,0 +1,356 @@
+/*
+ * Generated by tools/pnml_codegen from PIPE.pnml. Do not edit: change the PNML
+ * file and rebuild instead.
+ */
+
+#ifndef PETRI_NET_GENERATED_H
+#define PETRI_NET_GENERATED_H
+
+#define PETRI_GEN_SOURCE "PIPE.pnml"
+#define PETRI_GEN_NUM_PLACES 15
+#define PETRI_GEN_NUM_TRANSITIONS 16
+#define PETRI_GEN_NUM_IN_ARCS 19
+#define PETRI_GEN_NUM_OUT_ARCS 21
+
+static const char* const petri_gen_place_names[PETRI_GEN_NUM_PLACES] = {
+    "Raw Material",
+    "Ready to Process",
+    "Processing",
+    "Processed",
+    "Ready to Assemble",
+    "Assembled",
+    "QC Active 1",
+    "Passed QC1 / Decision",
+    "Ready for Individual Package",
+    "Individually Packaged",
+    "Final Packaged",
+    "Painted",
+    "QC Active 2",
+    "Worker",
+    "Rework Bin",
+};
+
+static const int32_t petri_gen_initial_marking[PETRI_GEN_NUM_PLACES] = {
+    20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0,
+};
+
+static const char* const petri_gen_transition_names[PETRI_GEN_NUM_TRANSITIONS] = {
+    "Load Material",
+    "Start Processing",
+    "Finish Processing",
+    "Start Assembly",
+    "Finish Assembly",
+    "Start QC 1",
+    "Pass QC 1",
+    "Fail QC 1",
+    "Select to Paint",
+    "Skip Paint",
+    "Start QC 2",
+    "Pass QC 2",
+    "Fail QC 2",
+    "Individual Package",
+    "Bulk Package",
+    "Rework Process",
+};
+
+static const PetriIndex petri_gen_in_start[PETRI_GEN_NUM_TRANSITIONS + 1] = {
+    0, 1, 2, 3, 4, 5, 7, 8, 9, 10, 11, 13, 14, 15, 16, 17,
+    19
+};
+
+static const Arc petri_gen_in_arcs[] = {
+    { 0, 1 },     /* T0 */
+    { 1, 1 },     /* T1 */
+    { 2, 1 },     /* T2 */
+    { 3, 2 },     /* T3 */
+    { 4, 2 },     /* T4 */
+    { 5, 1 },     /* T5 */
+    { 13, 1 },    /* T5 */
+    { 6, 1 },     /* T6 */
+    { 6, 1 },     /* T7 */
+    { 7, 1 },     /* T8 */
+    { 7, 1 },     /* T9 */
+    { 11, 1 },    /* T10 */
+    { 13, 1 },    /* T10 */
+    { 12, 1 },    /* T11 */
+    { 12, 1 },    /* T12 */
+    { 8, 1 },     /* T13 */
+    { 9, 5 },     /* T14 */
+    { 14, 1 },    /* T15 */
+    { 13, 1 },    /* T15 */
+};
+
+static const PetriIndex petri_gen_out_start[PETRI_GEN_NUM_TRANSITIONS + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 8, 10, 11, 12, 13, 15, 17, 18, 19,
+    21
+};
+
+static const Arc petri_gen_out_arcs[] = {
+    { 1, 1 },     /* T0 */
+    { 2, 1 },     /* T1 */
+    { 3, 1 },     /* T2 */
+    { 4, 2 },     /* T3 */
+    { 5, 1 },     /* T4 */
+    { 6, 1 },     /* T5 */
+    { 7, 1 },     /* T6 */
+    { 13, 1 },    /* T6 */
+    { 14, 1 },    /* T7 */
+    { 13, 1 },    /* T7 */
+    { 11, 1 },    /* T8 */
+    { 8, 1 },     /* T9 */
+    { 12, 1 },    /* T10 */
+    { 8, 1 },     /* T11 */
+    { 13, 1 },    /* T11 */
+    { 14, 1 },    /* T12 */
+    { 13, 1 },    /* T12 */
+    { 9, 1 },     /* T13 */
+    { 10, 1 },    /* T14 */
+    { 3, 1 },     /* T15 */
+    { 13, 1 },    /* T15 */
+};
+
+static const PetriIndex petri_gen_consumer_start[PETRI_GEN_NUM_PLACES + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 8, 10, 11, 12, 12, 13, 15, 18, 19
+};
+
+static const PetriIndex petri_gen_consumers[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 14, 10, 11, 12, 5,
+    10, 15, 15,
+};
+
+/* Transitions re-evaluated after each transition fires */
+static const PetriIndex petri_gen_affected_start[PETRI_GEN_NUM_TRANSITIONS + 1] = {
+    0, 2, 4, 6, 8, 10, 15, 22, 27, 30, 33, 38, 44, 49, 51, 52,
+    54
+};
+
+static const PetriIndex petri_gen_affected[] = {
+    0, 1,   /* T0 */
+    1, 2,   /* T1 */
+    2, 3,   /* T2 */
+    3, 4,   /* T3 */
+    4, 5,   /* T4 */
+    5, 6, 7, 10, 15,   /* T5 */
+    5, 6, 7, 8, 9, 10, 15,   /* T6 */
+    5, 6, 7, 10, 15,   /* T7 */
+    8, 9, 10,   /* T8 */
+    8, 9, 13,   /* T9 */
+    5, 10, 11, 12, 15,   /* T10 */
+    5, 10, 11, 12, 13, 15,   /* T11 */
+    5, 10, 11, 12, 15,   /* T12 */
+    13, 14,   /* T13 */
+    14,   /* T14 */
+    3, 15,   /* T15 */
+};
+
+/* T0: Load Material */
+static inline bool petri_gen_enabled_t0(const int32_t* m) {
+    return m[0] >= 1;
+}
+
+static inline void petri_gen_fire_t0(int32_t* m) {
+    m[0] -= 1;
+    m[1] += 1;
+}
+
+/* T1: Start Processing */
+static inline bool petri_gen_enabled_t1(const int32_t* m) {
+    return m[1] >= 1;
+}
+
+static inline void petri_gen_fire_t1(int32_t* m) {
+    m[1] -= 1;
+    m[2] += 1;
+}
+
+/* T2: Finish Processing */
+static inline bool petri_gen_enabled_t2(const int32_t* m) {
+    return m[2] >= 1;
+}
+
+static inline void petri_gen_fire_t2(int32_t* m) {
+    m[2] -= 1;
+    m[3] += 1;
+}
+
+/* T3: Start Assembly */
+static inline bool petri_gen_enabled_t3(const int32_t* m) {
+    return m[3] >= 2;
+}
+
+static inline void petri_gen_fire_t3(int32_t* m) {
+    m[3] -= 2;
+    m[4] += 2;
+}
+
+/* T4: Finish Assembly */
+static inline bool petri_gen_enabled_t4(const int32_t* m) {
+    return m[4] >= 2;
+}
+
+static inline void petri_gen_fire_t4(int32_t* m) {
+    m[4] -= 2;
+    m[5] += 1;
+}
+
+/* T5: Start QC 1 */
+static inline bool petri_gen_enabled_t5(const int32_t* m) {
+    return m[5] >= 1 && m[13] >= 1;
+}
+
+static inline void petri_gen_fire_t5(int32_t* m) {
+    m[5] -= 1;
+    m[13] -= 1;
+    m[6] += 1;
+}
+
+/* T6: Pass QC 1 */
+static inline bool petri_gen_enabled_t6(const int32_t* m) {
+    return m[6] >= 1;
+}
+
+static inline void petri_gen_fire_t6(int32_t* m) {
+    m[6] -= 1;
+    m[7] += 1;
+    m[13] += 1;
+}
+
+/* T7: Fail QC 1 */
+static inline bool petri_gen_enabled_t7(const int32_t* m) {
+    return m[6] >= 1;
+}
+
+static inline void petri_gen_fire_t7(int32_t* m) {
+    m[6] -= 1;
+    m[13] += 1;
+    m[14] += 1;
+}
+
+/* T8: Select to Paint */
+static inline bool petri_gen_enabled_t8(const int32_t* m) {
+    return m[7] >= 1;
+}
+
+static inline void petri_gen_fire_t8(int32_t* m) {
+    m[7] -= 1;
+    m[11] += 1;
+}
+
+/* T9: Skip Paint */
+static inline bool petri_gen_enabled_t9(const int32_t* m) {
+    return m[7] >= 1;
+}
+
+static inline void petri_gen_fire_t9(int32_t* m) {
+    m[7] -= 1;
+    m[8] += 1;
+}
+
+/* T10: Start QC 2 */
+static inline bool petri_gen_enabled_t10(const int32_t* m) {
+    return m[11] >= 1 && m[13] >= 1;
+}
+
+static inline void petri_gen_fire_t10(int32_t* m) {
+    m[11] -= 1;
+    m[13] -= 1;
+    m[12] += 1;
+}
+
+/* T11: Pass QC 2 */
+static inline bool petri_gen_enabled_t11(const int32_t* m) {
+    return m[12] >= 1;
+}
+
+static inline void petri_gen_fire_t11(int32_t* m) {
+    m[12] -= 1;
+    m[8] += 1;
+    m[13] += 1;
+}
+
+/* T12: Fail QC 2 */
+static inline bool petri_gen_enabled_t12(const int32_t* m) {
+    return m[12] >= 1;
+}
+
+static inline void petri_gen_fire_t12(int32_t* m) {
+    m[12] -= 1;
+    m[13] += 1;
+    m[14] += 1;
+}
+
+/* T13: Individual Package */
+static inline bool petri_gen_enabled_t13(const int32_t* m) {
+    return m[8] >= 1;
+}
+
+static inline void petri_gen_fire_t13(int32_t* m) {
+    m[8] -= 1;
+    m[9] += 1;
+}
+
+/* T14: Bulk Package */
+static inline bool petri_gen_enabled_t14(const int32_t* m) {
+    return m[9] >= 5;
+}
+
+static inline void petri_gen_fire_t14(int32_t* m) {
+    m[9] -= 5;
+    m[10] += 1;
+}
+
+/* T15: Rework Process */
+static inline bool petri_gen_enabled_t15(const int32_t* m) {
+    return m[14] >= 1 && m[13] >= 1;
+}
+
+static inline void petri_gen_fire_t15(int32_t* m) {
+    m[14] -= 1;
+    m[3] += 1;
+}
+
+static inline bool petri_gen_enabled(int t, const int32_t* m) {
+    switch (t) {
+    case 0: return petri_gen_enabled_t0(m);
+    case 1: return petri_gen_enabled_t1(m);
+    case 2: return petri_gen_enabled_t2(m);
+    case 3: return petri_gen_enabled_t3(m);
+    case 4: return petri_gen_enabled_t4(m);
+    case 5: return petri_gen_enabled_t5(m);
+    case 6: return petri_gen_enabled_t6(m);
+    case 7: return petri_gen_enabled_t7(m);
+    case 8: return petri_gen_enabled_t8(m);
+    case 9: return petri_gen_enabled_t9(m);
+    case 10: return petri_gen_enabled_t10(m);
+    case 11: return petri_gen_enabled_t11(m);
+    case 12: return petri_gen_enabled_t12(m);
+    case 13: return petri_gen_enabled_t13(m);
+    case 14: return petri_gen_enabled_t14(m);
+    case 15: return petri_gen_enabled_t15(m);
+    default: return false;
+    }
+}
+
+static inline void petri_gen_fire(int t, int32_t* m) {
+    switch (t) {
+    case 0: petri_gen_fire_t0(m); break;
+    case 1: petri_gen_fire_t1(m); break;
+    case 2: petri_gen_fire_t2(m); break;
+    case 3: petri_gen_fire_t3(m); break;
+    case 4: petri_gen_fire_t4(m); break;
+    case 5: petri_gen_fire_t5(m); break;
+    case 6: petri_gen_fire_t6(m); break;
+    case 7: petri_gen_fire_t7(m); break;
+    case 8: petri_gen_fire_t8(m); break;
+    case 9: petri_gen_fire_t9(m); break;
+    case 10: petri_gen_fire_t10(m); break;
+    case 11: petri_gen_fire_t11(m); break;
+    case 12: petri_gen_fire_t12(m); break;
+    case 13: petri_gen_fire_t13(m); break;
+    case 14: petri_gen_fire_t14(m); break;
+    case 15: petri_gen_fire_t15(m); break;
+    default: break;
+    }
+}
+
+#endif /* PETRI_NET_GENERATED_H */
@@ -0,0 +1,704 @@
+/*
+ * Streaming PNML loader: one pass over the file, no heap allocation.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "petri_net.h"
+#include "pnml_loader.h"
+
+typedef enum {
+    EL_OTHER,
+    EL_NET,
+    EL_PLACE,
+    EL_TRANSITION,
+    EL_ARC,
+    EL_NAME,
+    EL_INITIAL_MARKING,
+    EL_INSCRIPTION,
+    EL_TEXT
+} PnmlElement;
+
+typedef struct {
+    PnmlElement element;
+    char tag[PNML_ID_LEN];         // Qualified tag name, checked against the end tag
+} PnmlOpenTag;
+
+/* Place, transition or arc whose end tag has not been seen yet. */
+typedef struct {
+    PnmlElement element;           // EL_OTHER while no node is open
+    int line;
+    char id[PNML_ID_LEN];
+    char source[PNML_ID_LEN];
+    char target[PNML_ID_LEN];
+    char name[PETRI_NAME_LEN];
+    int value;                     // Initial marking or arc weight
+} PnmlNode;
+
+/* Arcs are resolved after the whole file is read, since PNML does not
+ * require places and transitions to come before the arcs that use them. */
+typedef struct {
+    char source[PNML_ID_LEN];
+    char target[PNML_ID_LEN];
+    int weight;
+    int line;
+} PnmlArc;
+
+typedef struct {
+    FILE* file;
+    const char* path;
+    char buffer[PNML_READ_BUFFER];
+    size_t pos;
+    size_t len;
+    int line;
+    bool failed;
+
+    PnmlOpenTag stack[PNML_MAX_DEPTH];
+    int depth;
+    int num_nets;
+
+    PnmlNode node;
+    char text[PNML_TEXT_LEN];
+    int text_len;
+    bool text_overflow;
+} PnmlReader;
+
+static PnmlReader reader;
+static PnmlArc staged_arcs[2 * MAX_ARCS];
+static int num_staged_arcs;
+static char place_ids[MAX_PLACES][PNML_ID_LEN];
+static char transition_ids[MAX_TRANSITIONS][PNML_ID_LEN];
+
+// ====================
+// INPUT
+// ====================
+
+/**
+ * @brief Report a problem at the current line. Only the first error is printed.
+ */
+static void pnml_error_at(int line, const char* format, ...) {
+    if (reader.failed) {
+        return;
+    }
+    reader.failed = true;
+
+    va_list args;
+    va_start(args, format);
+    printf("ERROR: %s:%d: ", reader.path, line);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+#define pnml_error(...) pnml_error_at(reader.line, __VA_ARGS__)
+
+static int peek_char(void) {
+    if (reader.pos == reader.len) {
+        reader.len = fread(reader.buffer, 1, sizeof(reader.buffer), reader.file);
+        reader.pos = 0;
+        if (reader.len == 0) {
+            return EOF;
+        }
+    }
+    return (unsigned char)reader.buffer[reader.pos];
+}
+
+static int next_char(void) {
+    int c = peek_char();
+    if (c != EOF) {
+        reader.pos++;
+        if (c == '\n') {
+            reader.line++;
+        }
+    }
+    return c;
+}
+
+static bool is_space(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_name_char(int c) {
+    return c != EOF && !is_space(c) && c != '>' && c != '/' && c != '=' && c != '<';
+}
+
+static void skip_spaces(void) {
+    while (is_space(peek_char())) {
+        next_char();
+    }
+}
+
+/**
+ * @brief Skip input up to and including a terminator such as "-->".
+ */
+static void skip_past(const char* terminator) {
+    size_t n = strlen(terminator);
+    size_t matched = 0;
+    int c;
+
+    while (matched < n && (c = next_char()) != EOF) {
+        if (c == terminator[matched]) {
+            matched++;
+        } else {
+            matched = (c == terminator[0]) ? 1 : 0;
+        }
+    }
+    if (matched < n) {
+        pnml_error("unterminated markup, expected '%s'", terminator);
+    }
+}
+
+/**
+ * @brief Read a name (tag or attribute) into buf. Over-long names are an error.
+ */
+static bool read_name(char* buf, size_t size) {
+    size_t len = 0;
+
+    while (is_name_char(peek_char())) {
+        int c = next_char();
+        if (len + 1 >= size) {
+            pnml_error("name too long");
+            return false;
+        }
+        buf[len++] = (char)c;
+    }
+    buf[len] = '\0';
+
+    if (len == 0) {
+        pnml_error("expected a name");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Decode an entity reference after the '&' has been consumed.
+ * @return The decoded character, or -1 if unsupported.
+ */
+static int read_entity(void) {
+    char entity[12];
+    size_t len = 0;
+    int c;
+
+    while ((c = next_char()) != ';') {
+        if (c == EOF || len + 1 >= sizeof(entity)) {
+            pnml_error("malformed entity reference");
+            return -1;
+        }
+        entity[len++] = (char)c;
+    }
+    entity[len] = '\0';
+
+    if (strcmp(entity, "amp") == 0) return '&';
+    if (strcmp(entity, "lt") == 0) return '<';
+    if (strcmp(entity, "gt") == 0) return '>';
+    if (strcmp(entity, "quot") == 0) return '"';
+    if (strcmp(entity, "apos") == 0) return '\'';
+    if (entity[0] == '#') {
+        long code = (entity[1] == 'x') ? strtol(entity + 2, NULL, 16) : strtol(entity + 1, NULL, 10);
+        // Names are stored as plain chars; anything outside ASCII is rejected
+        if (code > 0 && code < 128) {
+            return (int)code;
+        }
+    }
+
+    pnml_error("unsupported entity '&%s;'", entity);
+    return -1;
+}
+
+/**
+ * @brief Read a quoted attribute value, decoding entities.
+ * @param must_fit Whether a value longer than buf is an error; otherwise it
+ *                 is truncated (for attributes the loader does not use).
+ */
+static bool read_attribute_value(char* buf, size_t size, bool must_fit) {
+    int quote = next_char();
+    size_t len = 0;
+    bool too_long = false;
+
+    if (quote != '"' && quote != '\'') {
+        pnml_error("expected a quoted attribute value");
+        return false;
+    }
+
+    int c;
+    while ((c = next_char()) != quote) {
+        if (c == EOF || c == '<') {
+            pnml_error("unterminated attribute value");
+            return false;
+        }
+        if (c == '&' && (c = read_entity()) < 0) {
+            return false;
+        }
+        if (len + 1 < size) {
+            buf[len++] = (char)c;
+        } else {
+            too_long = true;
+        }
+    }
+    buf[len] = '\0';
+
+    if (too_long && must_fit) {
+        pnml_error("attribute value '%s...' too long", buf);
+        return false;
+    }
+    return true;
+}
+
+// ====================
+// DOCUMENT STRUCTURE
+// ====================
+
+static PnmlElement classify_tag(const char* tag) {
+    // Ignore a namespace prefix such as "pnml:place"
+    const char* local = strchr(tag, ':');
+    local = (local != NULL) ? local + 1 : tag;
+
+    if (strcmp(local, "net") == 0) return EL_NET;
+    if (strcmp(local, "place") == 0) return EL_PLACE;
+    if (strcmp(local, "transition") == 0) return EL_TRANSITION;
+    if (strcmp(local, "arc") == 0) return EL_ARC;
+    if (strcmp(local, "name") == 0) return EL_NAME;
+    if (strcmp(local, "initialMarking") == 0) return EL_INITIAL_MARKING;
+    if (strcmp(local, "inscription") == 0) return EL_INSCRIPTION;
+    if (strcmp(local, "text") == 0) return EL_TEXT;
+    return EL_OTHER;
+}
+
+static PnmlElement element_at(int from_top) {
+    int i = reader.depth - 1 - from_top;
+    return (i >= 0) ? reader.stack[i].element : EL_OTHER;
+}
+
+/**
+ * @brief Whether character data is the <text> of a label of the open node,
+ * e.g. place/name/text or arc/inscription/text.
+ */
+static bool in_node_label_text(void) {
+    return reader.node.element != EL_OTHER &&
+        element_at(0) == EL_TEXT &&
+        element_at(2) == reader.node.element;
+}
+
+static void append_text(int c) {
+    if (reader.text_len + 1 < PNML_TEXT_LEN) {
+        reader.text[reader.text_len++] = (char)c;
+    } else {
+        reader.text_overflow = true;
+    }
+}
+
+/**
+ * @brief Parse a non-negative integer label. PIPE writes markings and
+ * inscriptions as "Default,N", so only the part after the last comma counts.
+ * @param max Largest value the net can hold for this label.
+ */
+static bool parse_count(const char* text, const char* what, long max, int* out) {
+    const char* comma = strrchr(text, ',');
+    const char* digits = (comma != NULL) ? comma + 1 : text;
+    char* end;
+
+    while (is_space((unsigned char)*digits)) {
+        digits++;
+    }
+    // strtol() would also take a sign; a count is digits only
+    if (*digits < '0' || *digits > '9') {
+        pnml_error("invalid %s '%s'", what, text);
+        return false;
+    }
+
+    errno = 0;
+    long value = strtol(digits, &end, 10);
+    bool overflow = (errno == ERANGE);
+    while (is_space((unsigned char)*end)) {
+        end++;
+    }
+
+    if (*end != '\0') {
+        pnml_error("invalid %s '%s'", what, text);
+        return false;
+    }
+    if (overflow || value > max) {
+        pnml_error("%s '%s' is larger than %ld", what, text, max);
+        return false;
+    }
+    *out = (int)value;
+    return true;
+}
+
+/**
+ * @brief Store the finished <text> of the open node's label.
+ */
+static void finish_label_text(void) {
+    PnmlNode* node = &reader.node;
+    PnmlElement label = element_at(1);
+
+    reader.text[reader.text_len] = '\0';
+
+    // Trim surrounding whitespace
+    char* text = reader.text;
+    while (is_space((unsigned char)*text)) {
+        text++;
+    }
+    for (size_t len = strlen(text); len > 0 && is_space((unsigned char)text[len - 1]); len--) {
+        text[len - 1] = '\0';
+    }
+
+    if (label == EL_NAME && node->element != EL_ARC) {
+        if (reader.text_overflow || strlen(text) >= PETRI_NAME_LEN) {
+            pnml_error("name of '%s' is longer than %d characters", node->id, PETRI_NAME_LEN - 1);
+            return;
+        }
+        strcpy(node->name, text);
+    } else if (label == EL_INITIAL_MARKING && node->element == EL_PLACE) {
+        parse_count(text, "initial marking", INT32_MAX, &node->value);
+    } else if (label == EL_INSCRIPTION && node->element == EL_ARC) {
+        if (parse_count(text, "arc weight", UINT16_MAX, &node->value) && node->value == 0) {
+            pnml_error("arc '%s' has weight 0", node->id);
+        }
+    }
+}
+
+static bool id_in_use(const char* id) {
+    for (int p = 0; p < manufacturing_model.num_places; p++) {
+        if (strcmp(place_ids[p], id) == 0) {
+            return true;
+        }
+    }
+    for (int t = 0; t < manufacturing_model.num_transitions; t++) {
+        if (strcmp(transition_ids[t], id) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Add the place, transition or arc whose end tag was just read.
+ */
+static void commit_node(void) {
+    PnmlNode* node = &reader.node;
+    const char* name = (node->name[0] != '\0') ? node->name : node->id;
+
+    if (node->element == EL_ARC) {
+        if (num_staged_arcs >= 2 * MAX_ARCS) {
+            pnml_error_at(node->line, "too many arcs (limit %d)", 2 * MAX_ARCS);
+            return;
+        }
+        PnmlArc* arc = &staged_arcs[num_staged_arcs++];
+        strcpy(arc->source, node->source);
+        strcpy(arc->target, node->target);
+        arc->weight = node->value;
+        arc->line = node->line;
+        return;
+    }
+
+    if (id_in_use(node->id)) {
+        pnml_error_at(node->line, "duplicate id '%s'", node->id);
+        return;
+    }
+    if (strlen(name) >= PETRI_NAME_LEN) {
+        pnml_error_at(node->line, "name of '%s' is longer than %d characters", node->id, PETRI_NAME_LEN - 1);
+        return;
+    }
+
+    // Stations look places and transitions up by name, so names must be unique
+    if (node->element == EL_PLACE) {
+        if (find_place(name) >= 0) {
+            pnml_error_at(node->line, "duplicate place name '%s'", name);
+            return;
+        }
+        int idx = add_place(name, node->value);
+        if (idx < 0) {
+            reader.failed = true;
+            return;
+        }
+        strcpy(place_ids[idx], node->id);
+    } else {
+        if (find_transition(name) >= 0) {
+            pnml_error_at(node->line, "duplicate transition name '%s'", name);
+            return;
+        }
+        int idx = add_transition(name);
+        if (idx < 0) {
+            reader.failed = true;
+            return;
+        }
+        strcpy(transition_ids[idx], node->id);
+    }
+}
+
+static void open_node(PnmlElement element) {
+    if (reader.node.element != EL_OTHER) {
+        pnml_error("nested <%s> inside '%s'", reader.stack[reader.depth - 1].tag, reader.node.id);
+        return;
+    }
+    memset(&reader.node, 0, sizeof(reader.node));
+    reader.node.element = element;
+    reader.node.line = reader.line;
+    reader.node.value = (element == EL_ARC) ? 1 : 0;   // PNML default arc weight is 1
+}
+
+/**
+ * @brief Pop the innermost element. Label texts and whole nodes are
+ * validated and stored when their end tag is reached.
+ */
+static void close_element(void) {
+    if (in_node_label_text()) {
+        finish_label_text();
+    }
+
+    PnmlElement element = reader.stack[--reader.depth].element;
+    PnmlNode* node = &reader.node;
+    if (element != node->element || element == EL_OTHER) {
+        return;
+    }
+
+    if (node->id[0] == '\0') {
+        pnml_error_at(node->line, "%s without an id",
+            element == EL_PLACE ? "place" : element == EL_TRANSITION ? "transition" : "arc");
+    } else if (element == EL_ARC && (node->source[0] == '\0' || node->target[0] == '\0')) {
+        pnml_error_at(node->line, "arc '%s' needs a source and a target", node->id);
+    } else {
+        commit_node();
+    }
+    node->element = EL_OTHER;
+}
+
+/**
+ * @brief Parse a start tag after its '<', including attributes.
+ */
+static void parse_start_tag(void) {
+    char tag[PNML_ID_LEN];
+    char attribute[PNML_ID_LEN];
+    char value[PNML_ID_LEN];
+
+    if (!read_name(tag, sizeof(tag))) {
+        return;
+    }
+    if (reader.depth >= PNML_MAX_DEPTH) {
+        pnml_error("elements nested deeper than %d", PNML_MAX_DEPTH);
+        return;
+    }
+
+    PnmlElement element = classify_tag(tag);
+    if (element == EL_NET && ++reader.num_nets > 1) {
+        pnml_error("only one <net> per file is supported");
+        return;
+    }
+    bool is_node = (element == EL_PLACE || element == EL_TRANSITION || element == EL_ARC);
+    if (is_node) {
+        open_node(element);
+    }
+
+    if (element == EL_TEXT) {
+        reader.text_len = 0;
+        reader.text_overflow = false;
+    }
+
+    PnmlOpenTag* open = &reader.stack[reader.depth++];
+    open->element = element;
+    strcpy(open->tag, tag);
+
+    while (!reader.failed) {
+        skip_spaces();
+        int c = peek_char();
+        if (c == '>') {
+            next_char();
+            return;
+        }
+        if (c == '/') {
+            next_char();
+            if (next_char() != '>') {
+                pnml_error("expected '>' after '/' in <%s>", tag);
+                return;
+            }
+            close_element();
+            return;
+        }
+
+        if (!read_name(attribute, sizeof(attribute))) {
+            return;
+        }
+        skip_spaces();
+        if (next_char() != '=') {
+            pnml_error("expected '=' after attribute '%s'", attribute);
+            return;
+        }
+        skip_spaces();
+        if (!read_attribute_value(value, sizeof(value), is_node)) {
+            return;
+        }
+
+        if (is_node) {
+            if (strcmp(attribute, "id") == 0) {
+                strcpy(reader.node.id, value);
+            } else if (element == EL_ARC && strcmp(attribute, "source") == 0) {
+                strcpy(reader.node.source, value);
+            } else if (element == EL_ARC && strcmp(attribute, "target") == 0) {
+                strcpy(reader.node.target, value);
+            }
+        }
+    }
+}
+
+static void parse_end_tag(void) {
+    char tag[PNML_ID_LEN];
+
+    if (!read_name(tag, sizeof(tag))) {
+        return;
+    }
+    skip_spaces();
+    if (next_char() != '>') {
+        pnml_error("expected '>' in </%s>", tag);
+        return;
+    }
+    if (reader.depth == 0 || strcmp(reader.stack[reader.depth - 1].tag, tag) != 0) {
+        pnml_error("unexpected </%s>", tag);
+        return;
+    }
+    close_element();
+}
+
+/**
+ * @brief Parse the markup following a '<'.
+ */
+static void parse_markup(void) {
+    int c = peek_char();
+
+    if (c == '?') {
+        skip_past("?>");
+    } else if (c == '!') {
+        next_char();
+        if (peek_char() == '-') {
+            skip_past("-->");
+        } else if (peek_char() == '[') {
+            // CDATA section: its content is character data
+            skip_past("[CDATA[");
+            int brackets = 0;
+            bool closed = false;
+            while (!closed && (c = next_char()) != EOF) {
+                if (c == ']') {
+                    brackets++;
+                    continue;
+                }
+                closed = (c == '>' && brackets >= 2);
+                int keep = closed ? brackets - 2 : brackets;
+                if (in_node_label_text()) {
+                    while (keep-- > 0) {
+                        append_text(']');
+                    }
+                    if (!closed) {
+                        append_text(c);
+                    }
+                }
+                brackets = 0;
+            }
+            if (!closed) {
+                pnml_error("unterminated CDATA section");
+            }
+        } else {
+            skip_past(">");
+        }
+    } else if (c == '/') {
+        next_char();
+        parse_end_tag();
+    } else {
+        parse_start_tag();
+    }
+}
+
+// ====================
+// NET CONSTRUCTION
+// ====================
+
+static int find_id(char ids[][PNML_ID_LEN], int count, const char* id) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(ids[i], id) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Resolve the staged arcs against the place and transition ids and
+ * add them to the net.
+ */
+static void add_staged_arcs(void) {
+    for (int i = 0; i < num_staged_arcs && !reader.failed; i++) {
+        const PnmlArc* arc = &staged_arcs[i];
+        int source_place = find_id(place_ids, manufacturing_model.num_places, arc->source);
+        int target_place = find_id(place_ids, manufacturing_model.num_places, arc->target);
+        int source_trans = find_id(transition_ids, manufacturing_model.num_transitions, arc->source);
+        int target_trans = find_id(transition_ids, manufacturing_model.num_transitions, arc->target);
+
+        if (source_place < 0 && source_trans < 0) {
+            pnml_error_at(arc->line, "arc source '%s' is not a place or transition", arc->source);
+        } else if (target_place < 0 && target_trans < 0) {
+            pnml_error_at(arc->line, "arc target '%s' is not a place or transition", arc->target);
+        } else if (source_place >= 0 && target_trans >= 0) {
+            if (!add_arc_input(target_trans, source_place, arc->weight)) {
+                reader.failed = true;
+            }
+        } else if (source_trans >= 0 && target_place >= 0) {
+            if (!add_arc_output(source_trans, target_place, arc->weight)) {
+                reader.failed = true;
+            }
+        } else {
+            pnml_error_at(arc->line, "arc '%s' -> '%s' must join a place and a transition",
+                arc->source, arc->target);
+        }
+    }
+}
+
+/**
+ * @brief Load a place/transition net from a PNML file into manufacturing_model.
+ * Call after init_petri_net() and before build_net_index().
+ * @param path File to read.
+ * @return true if the whole net was read and is consistent. On failure the
+ *         first problem found is printed and the net must not be used.
+ */
+bool pnml_load_file(const char* path) {
+    memset(&reader, 0, sizeof(reader));
+    reader.path = path;
+    reader.line = 1;
+    num_staged_arcs = 0;
+
+    reader.file = fopen(path, "rb");
+    if (reader.file == NULL) {
+        printf("ERROR: Cannot open Petri net file '%s'\n", path);
+        return false;
+    }
+
+    int c;
+    while (!reader.failed && (c = next_char()) != EOF) {
+        if (c == '<') {
+            parse_markup();
+        } else if (in_node_label_text()) {
+            if (c == '&' && (c = read_entity()) < 0) {
+                break;
+            }
+            append_text(c);
+        }
+    }
+    fclose(reader.file);
+    reader.file = NULL;
+
+    if (!reader.failed && reader.depth != 0) {
+        pnml_error("<%s> is not closed", reader.stack[reader.depth - 1].tag);
+    }
+    if (!reader.failed && reader.num_nets == 0) {
+        pnml_error("no <net> element found");
+    }
+    if (!reader.failed && manufacturing_model.num_places == 0) {
+        pnml_error("the net has no places");
+    }
+    add_staged_arcs();
+
+    return !reader.failed;
+}
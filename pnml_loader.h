@@ -0,0 +1,28 @@
+/*
+ * PNML loader for the manufacturing process control demo.
+ *
+ * Reads a place/transition net (places, initial markings, transitions and
+ * weighted arcs) from a PNML file and adds it to manufacturing_model. The file
+ * is tokenized in a single pass through a fixed read buffer and every
+ * element is kept in static storage, so loading never touches the heap.
+ * Any malformed or inconsistent input is reported with its line number and
+ * rejects the whole file.
+ */
+
+#ifndef PNML_LOADER_H
+#define PNML_LOADER_H
+
+#include <stdbool.h>
+
+/* Environment variable that overrides the net file. */
+#define PNML_FILE_ENV "PETRI_NET_FILE"
+#define PNML_DEFAULT_FILE "PIPE.pnml"
+
+#define PNML_READ_BUFFER 4096
+#define PNML_ID_LEN 32
+#define PNML_TEXT_LEN 64
+#define PNML_MAX_DEPTH 32
+
+bool pnml_load_file(const char* path);
+
+#endif /* PNML_LOADER_H */
@@ -0,0 +1,112 @@
+/*
+ * xoshiro128** streams seeded through splitmix64.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "rng.h"
+
+static uint64_t run_seed = 0;
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/**
+ * @brief Set the seed every stream is derived from. Call before tasks start.
+ * @param seed Run seed.
+ */
+void rng_set_run_seed(uint64_t seed) {
+    run_seed = seed;
+}
+
+/**
+ * @brief Pick the run seed from RNG_SEED_ENV, or from the clock if unset.
+ * @return The seed that was installed.
+ */
+uint64_t rng_seed_from_environment(void) {
+    const char* text = getenv(RNG_SEED_ENV);
+    uint64_t seed;
+
+    if (text != NULL && *text != '\0') {
+        seed = strtoull(text, NULL, 0);
+    } else {
+        seed = (uint64_t)time(NULL);
+    }
+
+    rng_set_run_seed(seed);
+    return seed;
+}
+
+/**
+ * @brief Seed in use for this run.
+ */
+uint64_t rng_run_seed(void) {
+    return run_seed;
+}
+
+/**
+ * @brief Initialize an independent stream from the run seed.
+ * @param rng State owned by the calling task.
+ * @param stream_id Stable id of the stream (e.g. the station id), so the same
+ *                  seed gives every task the same sequence on replay.
+ */
+void rng_init_stream(RngState* rng, uint32_t stream_id) {
+    uint64_t x = run_seed ^ ((uint64_t)stream_id * 0xD1B54A32D192ED03ull);
+
+    for (int i = 0; i < 4; i += 2) {
+        uint64_t z = splitmix64(&x);
+        rng->s[i] = (uint32_t)z;
+        rng->s[i + 1] = (uint32_t)(z >> 32);
+    }
+
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;
+    }
+}
+
+/**
+ * @brief Next 32-bit value of the stream.
+ */
+uint32_t rng_next(RngState* rng) {
+    uint32_t* s = rng->s;
+    const uint32_t result = rotl(s[1] * 5, 7) * 9;
+    const uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+
+    return result;
+}
+
+/**
+ * @brief Uniform value in [0, bound) without modulo bias.
+ * @param rng Stream to draw from.
+ * @param bound Exclusive upper bound, must be non-zero.
+ */
+uint32_t rng_below(RngState* rng, uint32_t bound) {
+    uint64_t m = (uint64_t)rng_next(rng) * bound;
+    uint32_t low = (uint32_t)m;
+
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (uint64_t)rng_next(rng) * bound;
+            low = (uint32_t)m;
+        }
+    }
+
+    return (uint32_t)(m >> 32);
+}
@@ -0,0 +1,112 @@
+/*
+ * Compile-time sized arena for tasks and queues. See static_arena.h.
+ */
+
+#include <stdio.h>
+
+#include "static_arena.h"
+
+#if PETRI_STATIC_ALLOCATION
+
+static StaticTask_t arena_tcbs[ARENA_MAX_TASKS];
+static StackType_t arena_stacks[ARENA_STACK_WORDS];
+static StaticQueue_t arena_queues[ARENA_MAX_QUEUES];
+static uint8_t arena_queue_storage[ARENA_QUEUE_BYTES];
+
+// Bump allocators; nothing is ever given back
+static int tcbs_used = 0;
+static uint32_t stack_words_used = 0;
+static int queues_used = 0;
+static size_t queue_bytes_used = 0;
+
+#endif
+
+/**
+ * @brief Create a task that may only run on the given cores.
+ * Call before the scheduler starts. Single-core builds ignore the mask.
+ * @param cores Bit n allows core n; ARENA_ANY_CORE allows all of them.
+ * @return The task, or NULL (with an error printed) if it does not fit.
+ */
+TaskHandle_t arena_task_create(TaskFunction_t code, const char* name, uint32_t stack_words,
+                               void* params, UBaseType_t priority, UBaseType_t cores) {
+    TaskHandle_t task = NULL;
+
+#if ( configNUMBER_OF_CORES > 1 )
+    const UBaseType_t all_cores = (UBaseType_t)((1u << configNUMBER_OF_CORES) - 1u);
+    if ((cores & all_cores) == 0) {
+        // A table written for more cores than this target has
+        cores = all_cores;
+    }
+    cores &= all_cores;
+#else
+    (void)cores;
+#endif
+
+#if PETRI_STATIC_ALLOCATION
+    if (tcbs_used >= ARENA_MAX_TASKS || stack_words > ARENA_STACK_WORDS - stack_words_used) {
+        printf("ERROR: Static arena has no room for task %s (%d tasks, %lu stack words used)\n",
+            name, tcbs_used, (unsigned long)stack_words_used);
+        return NULL;
+    }
+    StaticTask_t* tcb = &arena_tcbs[tcbs_used];
+    StackType_t* stack = &arena_stacks[stack_words_used];
+
+#if ( configNUMBER_OF_CORES > 1 )
+    task = xTaskCreateStaticAffinitySet(code, name, stack_words, params, priority, stack, tcb, cores);
+#else
+    task = xTaskCreateStatic(code, name, stack_words, params, priority, stack, tcb);
+#endif
+    if (task != NULL) {
+        tcbs_used++;
+        stack_words_used += stack_words;
+    }
+#else
+#if ( configNUMBER_OF_CORES > 1 )
+    if (xTaskCreateAffinitySet(code, name, stack_words, params, priority, cores, &task) != pdPASS) {
+        task = NULL;
+    }
+#else
+    if (xTaskCreate(code, name, stack_words, params, priority, &task) != pdPASS) {
+        task = NULL;
+    }
+#endif
+#endif
+    return task;
+}
+
+/**
+ * @brief Create a queue. Call before the scheduler starts.
+ * @return The queue, or NULL (with an error printed) if it does not fit.
+ */
+QueueHandle_t arena_queue_create(UBaseType_t length, UBaseType_t item_size) {
+#if PETRI_STATIC_ALLOCATION
+    size_t bytes = (size_t)length * item_size;
+
+    if (queues_used >= ARENA_MAX_QUEUES || bytes > ARENA_QUEUE_BYTES - queue_bytes_used) {
+        printf("ERROR: Static arena has no room for a queue of %lu bytes\n", (unsigned long)bytes);
+        return NULL;
+    }
+    QueueHandle_t queue = xQueueCreateStatic(length, item_size,
+        &arena_queue_storage[queue_bytes_used], &arena_queues[queues_used]);
+    if (queue != NULL) {
+        queues_used++;
+        queue_bytes_used += bytes;
+    }
+    return queue;
+#else
+    return xQueueCreate(length, item_size);
+#endif
+}
+
+/**
+ * @brief Print how much of the arena the started tasks and queues take.
+ */
+void arena_print_usage(void) {
+#if PETRI_STATIC_ALLOCATION
+    printf("Static arena: %d/%d tasks, %lu/%lu stack words, %d/%d queues (%lu bytes total)\n",
+        tcbs_used, ARENA_MAX_TASKS,
+        (unsigned long)stack_words_used, (unsigned long)ARENA_STACK_WORDS,
+        queues_used, ARENA_MAX_QUEUES,
+        (unsigned long)(sizeof(arena_tcbs) + sizeof(arena_stacks) + sizeof(arena_queues) + sizeof(arena_queue_storage)));
+#endif
+}
@@ -0,0 +1,51 @@
+/*
+ * Static arena for the application's tasks and queues.
+ *
+ * With PETRI_STATIC_ALLOCATION set to 1, every station, worker and service
+ * task gets its TCB and stack, and the event log its queue, from arrays
+ * sized at compile time from PETRI_MAX_LINES, the stations per line and
+ * WORKER_POOL_MAX_WORKERS. Nothing the demo creates touches the heap, so
+ * the footprint is fixed at link time and a long run cannot fragment it.
+ * The net's own tables are static arrays sized by MAX_PLACES,
+ * MAX_TRANSITIONS and MAX_ARCS in either mode.
+ *
+ * With PETRI_STATIC_ALLOCATION 0 (the default) the same calls create the
+ * objects on the heap, so callers have one code path. All objects are
+ * created before the scheduler starts and never deleted, so the arena only
+ * grows.
+ */
+
+#ifndef STATIC_ARENA_H
+#define STATIC_ARENA_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "event_log.h"
+#include "petri_net.h"
+#include "worker_pool.h"
+
+#ifndef PETRI_STATIC_ALLOCATION
+#define PETRI_STATIC_ALLOCATION 0
+#endif
+
+#define ARENA_ANY_CORE ((UBaseType_t)~0u)      // Core mask letting the scheduler pick
+
+#define ARENA_STATIONS_PER_LINE 5      // Station tasks start_line_stations() creates per line
+#define ARENA_SERVICE_TASKS 4          // Logger, status publisher, simulation clock and station wheel
+#define ARENA_MAX_TASKS (PETRI_MAX_LINES * (ARENA_STATIONS_PER_LINE + WORKER_POOL_MAX_WORKERS) + ARENA_SERVICE_TASKS)
+#define ARENA_TASK_STACK_WORDS (configMINIMAL_STACK_SIZE * 2)  // What every application task asks for
+#define ARENA_STACK_WORDS (ARENA_MAX_TASKS * ARENA_TASK_STACK_WORDS)
+
+#define ARENA_MAX_QUEUES 1             // The event log
+#define ARENA_QUEUE_BYTES (LOG_QUEUE_LENGTH * sizeof(LogRecord))
+
+TaskHandle_t arena_task_create(TaskFunction_t code, const char* name, uint32_t stack_words,
+                               void* params, UBaseType_t priority, UBaseType_t cores);
+QueueHandle_t arena_queue_create(UBaseType_t length, UBaseType_t item_size);
+void arena_print_usage(void);
+
+#endif /* STATIC_ARENA_H */
@@ -0,0 +1,372 @@
+/*
+ * Real-time and virtual-time station clock with a discrete-event driver.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "metrics.h"
+#include "petri_net.h"
+#include "station_clock.h"
+
+#define SIM_CLOCK_PRIORITY tskIDLE_PRIORITY
+
+/* A station waiting for its virtual work to finish. */
+typedef struct {
+    uint32_t due_ms;
+    uint32_t order;                // Tie-break: equal due times complete in FIFO order
+    TaskHandle_t task;
+    UBaseType_t notify_index;      // Slot the completion is given on
+} SimWaiter;
+
+static bool virtual_mode = false;
+static volatile uint32_t virtual_now_ms = 0;
+
+// Binary min-heap of pending completions, guarded by a critical section
+static SimWaiter waiters[STATION_CLOCK_MAX_WAITERS];
+static int num_waiters = 0;
+static uint32_t next_order = 0;
+
+static uint32_t sim_duration_ms;
+static SimReportPlaces sim_report;
+
+// Time-weighted token totals (token-milliseconds) and peaks per place, summed over the lines
+static uint64_t place_area[MAX_PLACES];
+static int32_t place_peak[MAX_PLACES];
+static int32_t initial_marking[MAX_PLACES];
+
+// ====================
+// COMPLETION QUEUE
+// ====================
+
+static bool waiter_before(const SimWaiter* a, const SimWaiter* b) {
+    return a->due_ms != b->due_ms ? a->due_ms < b->due_ms : a->order < b->order;
+}
+
+/**
+ * @brief Insert a completion. Caller must be inside a critical section.
+ */
+static bool push_waiter_locked(uint32_t due_ms, TaskHandle_t task, UBaseType_t notify_index) {
+    if (num_waiters >= STATION_CLOCK_MAX_WAITERS) {
+        return false;
+    }
+
+    int i = num_waiters++;
+    SimWaiter item = { due_ms, next_order++, task, notify_index };
+    while (i > 0 && waiter_before(&item, &waiters[(i - 1) / 2])) {
+        waiters[i] = waiters[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    waiters[i] = item;
+    return true;
+}
+
+/**
+ * @brief Place an item at slot i or below it. Caller must be inside a critical section.
+ */
+static void sift_down_locked(int i, SimWaiter last) {
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= num_waiters) {
+            break;
+        }
+        if (child + 1 < num_waiters && waiter_before(&waiters[child + 1], &waiters[child])) {
+            child++;
+        }
+        if (!waiter_before(&waiters[child], &last)) {
+            break;
+        }
+        waiters[i] = waiters[child];
+        i = child;
+    }
+    waiters[i] = last;
+}
+
+/**
+ * @brief Remove the earliest completion. Caller must be inside a critical section.
+ */
+static bool pop_waiter_locked(SimWaiter* out) {
+    if (num_waiters == 0) {
+        return false;
+    }
+
+    *out = waiters[0];
+    SimWaiter last = waiters[--num_waiters];
+    if (num_waiters > 0) {
+        sift_down_locked(0, last);
+    }
+    return true;
+}
+
+/**
+ * @brief Drop a task's pending completion, if any. Caller must be inside a critical section.
+ */
+static void remove_waiter_locked(TaskHandle_t task) {
+    for (int i = 0; i < num_waiters; i++) {
+        if (waiters[i].task != task) {
+            continue;
+        }
+
+        SimWaiter last = waiters[--num_waiters];
+        if (i < num_waiters) {
+            while (i > 0 && waiter_before(&last, &waiters[(i - 1) / 2])) {
+                waiters[i] = waiters[(i - 1) / 2];
+                i = (i - 1) / 2;
+            }
+            sift_down_locked(i, last);
+        }
+        return;
+    }
+}
+
+// ====================
+// STATION API
+// ====================
+
+/**
+ * @brief Whether stations run on the virtual simulation clock.
+ */
+bool station_clock_is_virtual(void) {
+    return virtual_mode;
+}
+
+/**
+ * @brief Current station time in milliseconds (virtual in simulation mode).
+ */
+uint32_t station_now_ms(void) {
+    if (virtual_mode) {
+        return virtual_now_ms;
+    }
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+/**
+ * @brief Spend time on an operation: a delay in real time, or a timed
+ * completion on the virtual clock. Must be called from a station task.
+ * @param ms Duration of the operation.
+ */
+void station_work(uint32_t ms) {
+    uint64_t started = metrics_now();
+
+    if (!virtual_mode) {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+        metrics_busy(metrics_now() - started);
+        return;
+    }
+    if (ms == 0) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    bool queued = push_waiter_locked(virtual_now_ms + ms, xTaskGetCurrentTaskHandle(), STATION_CLOCK_NOTIFY_INDEX);
+    taskEXIT_CRITICAL();
+
+    if (!queued) {
+        printf("ERROR: More than %d stations working at once\n", STATION_CLOCK_MAX_WAITERS);
+        return;
+    }
+    ulTaskNotifyTakeIndexed(STATION_CLOCK_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+    metrics_busy(metrics_now() - started);
+}
+
+/**
+ * @brief Periodic variant of station_work(), like vTaskDelayUntil().
+ * @param last_ms Start of the previous period; advanced by period_ms.
+ * @param period_ms Period length. Returns at once if the period is already over.
+ */
+void station_delay_until(uint32_t* last_ms, uint32_t period_ms) {
+    *last_ms += period_ms;
+
+    int32_t remaining = (int32_t)(*last_ms - station_now_ms());
+    if (remaining > 0) {
+        station_work((uint32_t)remaining);
+    }
+}
+
+/**
+ * @brief Block until ms have passed on the station clock or a subscribed
+ * transition may be enabled, whichever comes first. For a task that serves
+ * several stations and so cannot sit out one station's work.
+ * @param ms Longest wait, or STATION_WAIT_FOREVER to wait for a transition only.
+ */
+void station_wait_event(uint32_t ms) {
+    if (ms == 0) {
+        return;
+    }
+    if (!virtual_mode) {
+        wait_for_transition_event(ms == STATION_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(ms));
+        return;
+    }
+    if (ms == STATION_WAIT_FOREVER) {
+        wait_for_transition_event(portMAX_DELAY);
+        return;
+    }
+
+    // The clock wakes the task on the net's slot, so either event ends the wait
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    taskENTER_CRITICAL();
+    bool queued = push_waiter_locked(virtual_now_ms + ms, self, NET_NOTIFY_INDEX);
+    taskEXIT_CRITICAL();
+
+    if (!queued) {
+        printf("ERROR: More than %d stations working at once\n", STATION_CLOCK_MAX_WAITERS);
+        return;
+    }
+    wait_for_transition_event(portMAX_DELAY);
+
+    taskENTER_CRITICAL();
+    remove_waiter_locked(self);
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Create a task that may only run on the given cores.
+ * Single-core builds ignore the mask; in simulation mode every station
+ * runs on STATION_SIM_CORE. Call after simulation_start(), if at all.
+ * The task comes from the static arena in PETRI_STATIC_ALLOCATION builds.
+ * @param cores Bit n allows core n; STATION_ANY_CORE allows all of them.
+ * @return true if the task was created.
+ */
+bool station_task_create(TaskFunction_t code, const char* name, uint32_t stack_words,
+                         void* params, UBaseType_t priority, UBaseType_t cores) {
+    if (virtual_mode) {
+        cores = (UBaseType_t)1u << STATION_SIM_CORE;
+    }
+    return arena_task_create(code, name, stack_words, params, priority, cores) != NULL;
+}
+
+// ====================
+// SIMULATION DRIVER
+// ====================
+
+/**
+ * @brief Add the marking held since the last clock advance to the totals.
+ */
+static void account_interval(uint32_t elapsed_ms) {
+    PetriSnapshot snapshot;
+
+    petri_snapshot_all(&snapshot);
+    for (int p = 0; p < snapshot.num_places; p++) {
+        place_area[p] += (uint64_t)(snapshot.marking[p] > 0 ? snapshot.marking[p] : 0) * elapsed_ms;
+        if (snapshot.marking[p] > place_peak[p]) {
+            place_peak[p] = snapshot.marking[p];
+        }
+    }
+}
+
+static void print_report(uint32_t end_ms, bool ran_dry, TickType_t real_ticks) {
+    const PetriModel* net = &manufacturing_model;
+    double hours = end_ms / 3600000.0;
+    PetriSnapshot final_marking;
+
+    petri_snapshot_all(&final_marking);
+
+    printf("\n===========================================================\n");
+    printf(" SIMULATION REPORT: %.2f virtual hours in %.2f s\n",
+        hours, real_ticks * portTICK_PERIOD_MS / 1000.0);
+    if (ran_dry) {
+        printf(" The line ran out of work at %.2f h\n", hours);
+    }
+    if (petri_num_lines > 1) {
+        printf(" Totals over %d lines\n", petri_num_lines);
+    }
+    printf("===========================================================\n");
+
+    if (sim_report.output_place >= 0) {
+        int shipped = final_marking.marking[sim_report.output_place] - initial_marking[sim_report.output_place];
+        printf("Shipped (%s): %d", net->places[sim_report.output_place].name, shipped);
+        if (hours > 0) {
+            printf(" (%.1f per hour)", shipped / hours);
+        }
+        printf("\n");
+    }
+    if (sim_report.resource_place >= 0 && end_ms > 0) {
+        int capacity = initial_marking[sim_report.resource_place];
+        double idle = (double)place_area[sim_report.resource_place] / end_ms;
+        if (capacity > 0) {
+            printf("%s utilization: %.1f%% of %d\n", net->places[sim_report.resource_place].name,
+                100.0 * (capacity - idle) / capacity, capacity);
+        }
+    }
+
+    printf("\n%-30s %8s %6s %6s\n", "Place", "avg", "max", "end");
+    for (int p = 0; p < net->num_places; p++) {
+        double average = end_ms > 0 ? (double)place_area[p] / end_ms : 0.0;
+        printf("%-30s %8.2f %6ld %6d\n", net->places[p].name, average,
+            (long)place_peak[p], (int)final_marking.marking[p]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * @brief FreeRTOS task: Discrete-event driver for simulation mode.
+ *
+ * Runs at the lowest priority, so it only gets the CPU when every station
+ * is blocked, either on a completion or on a transition. It then advances
+ * the virtual clock to the earliest completion and wakes that station,
+ * which runs (and wakes any station it enables) before control returns here.
+ */
+static void task_sim_clock(void* params) {
+    (void)params;
+
+    TickType_t started = xTaskGetTickCount();
+    bool ran_dry = false;
+    SimWaiter next;
+
+    while (1) {
+        taskENTER_CRITICAL();
+        bool have_next = pop_waiter_locked(&next);
+        taskEXIT_CRITICAL();
+
+        if (!have_next) {
+            ran_dry = true;
+            break;
+        }
+        if (next.due_ms > sim_duration_ms) {
+            break;
+        }
+
+        account_interval(next.due_ms - virtual_now_ms);
+        virtual_now_ms = next.due_ms;
+        xTaskNotifyGiveIndexed(next.task, next.notify_index);
+    }
+
+    uint32_t end_ms = ran_dry ? virtual_now_ms : sim_duration_ms;
+    account_interval(end_ms - virtual_now_ms);
+    virtual_now_ms = end_ms;
+
+    print_report(end_ms, ran_dry, xTaskGetTickCount() - started);
+    vTaskEndScheduler();
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Switch the stations to the virtual clock and create the driver.
+ * Call after the lines are instantiated and before the station tasks start.
+ * @param duration_ms Virtual time to simulate.
+ * @param report Places to single out in the final report.
+ * @return true on success.
+ */
+bool simulation_start(uint32_t duration_ms, const SimReportPlaces* report) {
+    sim_duration_ms = duration_ms;
+    sim_report = *report;
+    virtual_now_ms = 0;
+    num_waiters = 0;
+    next_order = 0;
+
+    PetriSnapshot snapshot;
+    petri_snapshot_all(&snapshot);
+    memset(place_area, 0, sizeof(place_area));
+    for (int p = 0; p < snapshot.num_places; p++) {
+        initial_marking[p] = snapshot.marking[p];
+        place_peak[p] = initial_marking[p];
+    }
+
+    virtual_mode = true;
+    return station_task_create(task_sim_clock, "SimClock",
+        configMINIMAL_STACK_SIZE * 2, NULL, SIM_CLOCK_PRIORITY, STATION_ANY_CORE);
+}
@@ -0,0 +1,63 @@
+/*
+ * Station clock for the manufacturing process control demo.
+ *
+ * Stations model their processing times through station_work() instead of
+ * calling vTaskDelay() directly. In the default real-time mode that is just
+ * a delay. In simulation mode (simulation_start()) time is virtual: a
+ * station that starts work parks itself in a priority queue of timed
+ * completions, and a clock task at the lowest priority, which only runs
+ * once every station is blocked, jumps the clock to the earliest completion
+ * and wakes that station. A whole shift then takes as long as the firings
+ * themselves, and the same station code runs in both modes.
+ *
+ * Station tasks are created through station_task_create(), which pins them
+ * to their cores in SMP builds. The virtual clock relies on running only
+ * when every station is blocked, so in simulation mode all of them share
+ * the clock task's core.
+ *
+ * A task that serves several stations (see station_executor.h) waits with
+ * station_wait_event() instead, which also ends on a net notification.
+ */
+
+#ifndef STATION_CLOCK_H
+#define STATION_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "static_arena.h"
+
+/* Environment variable that selects simulation mode: the number of
+ * virtual hours to run, e.g. PETRI_SIMULATE=8 for one shift. */
+#define SIM_HOURS_ENV "PETRI_SIMULATE"
+
+/* Task notification slot used to wake a station when its virtual work is
+ * done (slots 1 and 2 belong to the Petri net, see petri_net.h). */
+#define STATION_CLOCK_NOTIFY_INDEX 3
+
+#define STATION_CLOCK_MAX_WAITERS 48   // Stations that can be working at once, on every line
+
+#define STATION_ANY_CORE ARENA_ANY_CORE        // Core mask letting the scheduler pick
+#define STATION_WAIT_FOREVER UINT32_MAX        // station_wait_event() without a time limit
+#define STATION_SIM_CORE 0                     // Core of the clock task and every station in simulation mode
+
+/* Places the simulation report singles out. */
+typedef struct {
+    int resource_place;            // Shared resource whose utilization is reported, or -1
+    int output_place;              // Place collecting finished units, or -1
+} SimReportPlaces;
+
+bool station_clock_is_virtual(void);
+uint32_t station_now_ms(void);
+void station_work(uint32_t ms);
+void station_delay_until(uint32_t* last_ms, uint32_t period_ms);
+void station_wait_event(uint32_t ms);
+bool station_task_create(TaskFunction_t code, const char* name, uint32_t stack_words,
+                         void* params, UBaseType_t priority, UBaseType_t cores);
+
+bool simulation_start(uint32_t duration_ms, const SimReportPlaces* report);
+
+#endif /* STATION_CLOCK_H */
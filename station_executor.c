@@ -0,0 +1,268 @@
+/*
+ * Timer-wheel station executor. See station_executor.h.
+ */
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "metrics.h"
+#include "petri_net.h"
+#include "station_clock.h"
+#include "station_executor.h"
+
+/*
+ * Three levels of 64 slots at 1 ms per slot: level 0 holds jobs due in the
+ * next 64 ms, level 1 the next 4.1 s and level 2 the next 4.4 min. Every
+ * 64 ms one level-1 slot is cascaded down, and every 4.1 s one level-2
+ * slot, so adding or expiring a job is O(1) whatever the number of
+ * stations. Longer jobs wait in the last level-2 slot and are re-filed
+ * each time it comes round.
+ */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1u)
+#define WHEEL_LEVELS 3
+
+static StationMachine* machines[STATION_EXECUTOR_MAX_MACHINES];
+static int num_machines = 0;
+
+// Only the executor task touches the wheel, so it takes no lock
+static StationMachine* wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static int wheel_count[WHEEL_LEVELS];
+static uint32_t wheel_now_ms;
+
+// Jobs whose time is up, in the order they expired
+static StationMachine* expired_head;
+static StationMachine** expired_tail = &expired_head;
+
+// ====================
+// TIMER WHEEL
+// ====================
+
+/**
+ * @brief File a busy machine under its due time.
+ * Its due time must be later than wheel_now_ms.
+ */
+static void wheel_insert(StationMachine* machine) {
+    uint32_t delta = machine->due_ms - wheel_now_ms;
+    int level;
+    uint32_t slot;
+
+    if (delta < WHEEL_SLOTS) {
+        level = 0;
+        slot = machine->due_ms & WHEEL_MASK;
+    } else if (delta < (1u << (2 * WHEEL_BITS))) {
+        level = 1;
+        slot = (machine->due_ms >> WHEEL_BITS) & WHEEL_MASK;
+    } else if (delta < (1u << (3 * WHEEL_BITS))) {
+        level = 2;
+        slot = (machine->due_ms >> (2 * WHEEL_BITS)) & WHEEL_MASK;
+    } else {
+        // Beyond the wheel: the slot that comes round last
+        level = 2;
+        slot = (wheel_now_ms >> (2 * WHEEL_BITS)) & WHEEL_MASK;
+    }
+
+    machine->wheel_next = wheel[level][slot];
+    wheel[level][slot] = machine;
+    wheel_count[level]++;
+}
+
+/**
+ * @brief Re-file the jobs of one slot against the current time.
+ */
+static void wheel_cascade(int level, uint32_t slot) {
+    StationMachine* machine = wheel[level][slot];
+
+    wheel[level][slot] = NULL;
+    while (machine != NULL) {
+        StationMachine* next = machine->wheel_next;
+        wheel_count[level]--;
+        wheel_insert(machine);
+        machine = next;
+    }
+}
+
+/**
+ * @brief Advance the wheel by one millisecond, queueing the jobs that expire.
+ */
+static void wheel_step(void) {
+    wheel_now_ms++;
+
+    uint32_t slot = wheel_now_ms & WHEEL_MASK;
+    if (slot == 0) {
+        uint32_t slot1 = (wheel_now_ms >> WHEEL_BITS) & WHEEL_MASK;
+        if (slot1 == 0) {
+            wheel_cascade(2, (wheel_now_ms >> (2 * WHEEL_BITS)) & WHEEL_MASK);
+        }
+        wheel_cascade(1, slot1);
+    }
+
+    StationMachine* machine = wheel[0][slot];
+    wheel[0][slot] = NULL;
+    while (machine != NULL) {
+        StationMachine* next = machine->wheel_next;
+        wheel_count[0]--;
+        machine->wheel_next = NULL;
+        *expired_tail = machine;
+        expired_tail = &machine->wheel_next;
+        machine = next;
+    }
+}
+
+/**
+ * @brief Bring the wheel up to the station clock.
+ */
+static void wheel_advance(uint32_t now_ms) {
+    if (wheel_count[0] + wheel_count[1] + wheel_count[2] == 0) {
+        wheel_now_ms = now_ms;
+        return;
+    }
+    while ((int32_t)(now_ms - wheel_now_ms) > 0) {
+        wheel_step();
+    }
+}
+
+/**
+ * @brief Time the wheel next needs attention: the first level-0 job, or the
+ * next cascade if that comes sooner and there is anything to cascade.
+ * @param due_ms Set to that time.
+ * @return false if the wheel is empty.
+ */
+static bool wheel_next_due(uint32_t* due_ms) {
+    uint32_t horizon = WHEEL_SLOTS;
+    bool found = false;
+
+    if (wheel_count[1] + wheel_count[2] > 0) {
+        horizon = WHEEL_SLOTS - (wheel_now_ms & WHEEL_MASK);
+        *due_ms = wheel_now_ms + horizon;
+        found = true;
+    }
+    if (wheel_count[0] > 0) {
+        for (uint32_t d = 1; d <= horizon; d++) {
+            if (wheel[0][(wheel_now_ms + d) & WHEEL_MASK] != NULL) {
+                *due_ms = wheel_now_ms + d;
+                return true;
+            }
+        }
+    }
+    return found;
+}
+
+// ====================
+// MACHINES
+// ====================
+
+static void finish_job(StationMachine* machine) {
+    bool finished = machine->job.finish < 0 || fire_transition(machine->net, machine->job.finish);
+    uint64_t now = metrics_now();
+
+    metrics_shard_busy(machine->metrics, now - machine->since);
+    machine->since = now;
+    machine->busy = false;
+    if (machine->end != NULL) {
+        machine->end(machine, &machine->job, finished);
+    }
+}
+
+/**
+ * @brief Let an idle machine take jobs until one keeps it busy.
+ */
+static void start_jobs(StationMachine* machine) {
+    while (machine->begin(machine, &machine->job)) {
+        uint64_t now = metrics_now();
+        metrics_shard_idle(machine->metrics, now - machine->since);
+        machine->since = now;
+
+        if (machine->job.duration_ms == 0) {
+            finish_job(machine);
+            continue;
+        }
+        machine->busy = true;
+        machine->due_ms = wheel_now_ms + machine->job.duration_ms;
+        wheel_insert(machine);
+        return;
+    }
+}
+
+/**
+ * @brief FreeRTOS task: Runs every registered station machine.
+ */
+static void task_station_executor(void* params) {
+    (void)params;
+
+    metrics_register_task("Station Wheel");
+    for (int m = 0; m < num_machines; m++) {
+        machines[m]->metrics = metrics_add_shard(machines[m]->station);
+        machines[m]->since = metrics_now();
+        for (int t = 0; t < machines[m]->num_triggers; t++) {
+            bool subscribed = subscribe_transition(machines[m]->net, machines[m]->triggers[t]);
+            configASSERT(subscribed);
+        }
+    }
+    wheel_now_ms = station_now_ms();
+
+    while (1) {
+        wheel_advance(station_now_ms());
+
+        while (expired_head != NULL) {
+            StationMachine* machine = expired_head;
+            expired_head = machine->wheel_next;
+            if (expired_head == NULL) {
+                expired_tail = &expired_head;
+            }
+            finish_job(machine);
+        }
+
+        // A completion or a notification may have enabled any idle machine
+        for (int m = 0; m < num_machines; m++) {
+            if (!machines[m]->busy) {
+                start_jobs(machines[m]);
+            }
+        }
+
+        uint32_t due_ms;
+        if (wheel_next_due(&due_ms)) {
+            station_wait_event(due_ms - wheel_now_ms);
+        } else {
+            station_wait_event(STATION_WAIT_FOREVER);
+        }
+    }
+}
+
+/**
+ * @brief Register a station machine with the executor.
+ * @return true on success.
+ */
+bool station_executor_add(StationMachine* machine) {
+    if (num_machines >= STATION_EXECUTOR_MAX_MACHINES) {
+        printf("ERROR: More than %d station machines\n", STATION_EXECUTOR_MAX_MACHINES);
+        return false;
+    }
+    if (machine->num_triggers < 1 || machine->num_triggers > STATION_MAX_TRIGGERS) {
+        printf("ERROR: A station machine needs 1 to %d triggers\n", STATION_MAX_TRIGGERS);
+        return false;
+    }
+
+    machine->busy = false;
+    machine->wheel_next = NULL;
+    machines[num_machines++] = machine;
+    return true;
+}
+
+/**
+ * @brief Create the executor task for the registered machines.
+ * Call after simulation_start(), if at all.
+ * @param cores Cores the executor may run on, see station_task_create().
+ * @return true if the task was created.
+ */
+bool station_executor_start(UBaseType_t priority, UBaseType_t cores) {
+    if (!station_task_create(task_station_executor, "StationWheel",
+            configMINIMAL_STACK_SIZE * 2, NULL, priority, cores)) {
+        printf("ERROR: Failed to create StationWheel task\n");
+        return false;
+    }
+    return true;
+}
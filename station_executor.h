@@ -0,0 +1,78 @@
+/*
+ * Timer-wheel executor that runs stations as state machines in one task.
+ *
+ * A station task spends nearly all its life blocked in station_work(), yet
+ * each one costs a full stack and a context switch per job. A station
+ * machine describes the same station as a few words of state: begin()
+ * tries to take a job (firing the start transition) and says how long the
+ * station is then busy and which transition finishes the job; end()
+ * follows the finish. One executor task keeps every busy machine in a
+ * hierarchical timer wheel, fires the finish transitions as they come due,
+ * and offers idle machines new work whenever a completion or a subscribed
+ * transition may have enabled some.
+ *
+ * Time comes from the station clock, so the executor follows the virtual
+ * clock in simulation mode like any station task. Each machine reports
+ * busy time from the start of a job to its finish, and idle time until it
+ * takes the next, under its own station label. Machines are registered
+ * with station_executor_add() before station_executor_start(); both must
+ * be called before the scheduler starts.
+ */
+
+#ifndef STATION_EXECUTOR_H
+#define STATION_EXECUTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "metrics.h"
+#include "petri_net.h"
+
+/* Environment variable that selects the executor over one task per station,
+ * e.g. PETRI_TIMER_WHEEL=1. */
+#define STATION_WHEEL_ENV "PETRI_TIMER_WHEEL"
+
+#define STATION_EXECUTOR_MAX_MACHINES 256
+#define STATION_MAX_TRIGGERS 2         // Transitions whose enabling wakes one machine
+
+/* A job a machine has taken. */
+typedef struct {
+    uint32_t duration_ms;          // Time the station is busy; 0 finishes at once
+    int finish;                    // Transition fired when the time is up, or -1
+    int32_t arg;                   // Passed back to end(), e.g. the job number
+} StationJob;
+
+typedef struct StationMachine StationMachine;
+
+/* Try to take a job; return false (having fired nothing) if there is none. */
+typedef bool (*StationBeginFn)(StationMachine* machine, StationJob* job);
+
+/* Called after a job's time is up; finished tells whether its finish fired. */
+typedef void (*StationEndFn)(StationMachine* machine, const StationJob* job, bool finished);
+
+struct StationMachine {
+    // Filled in by the application
+    PetriNet* net;                 // Line the station belongs to
+    int triggers[STATION_MAX_TRIGGERS];
+    int num_triggers;
+    StationBeginFn begin;
+    StationEndFn end;              // May be NULL
+    void* context;                 // Station state kept by the application
+    const char* station;           // Label for its busy and idle time in /metrics
+
+    // Executor state
+    StationJob job;
+    uint32_t due_ms;
+    bool busy;
+    MetricsShard* metrics;         // Own shard for busy and idle time
+    uint64_t since;                // metrics_now() at the last start or finish
+    StationMachine* wheel_next;
+};
+
+bool station_executor_add(StationMachine* machine);
+bool station_executor_start(UBaseType_t priority, UBaseType_t cores);
+
+#endif /* STATION_EXECUTOR_H */
@@ -0,0 +1,1681 @@
+/*
+ * HTTP status server: native Windows I/O thread plus RTOS publisher task.
+ * See status_server.h for the threading model.
+ */
+
+#include "status_server.h"
+
+/* Winsock's fd_set holds 64 sockets unless told otherwise */
+#define FD_SETSIZE (STATUS_MAX_CLIENTS + 1)
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "petri_net.h"
+#include "net_analysis.h"
+#include "metrics.h"
+#include "task_stats.h"
+#include "item_tokens.h"
+#include "json_writer.h"
+#include "static_arena.h"
+
+// ====================
+// RTOS -> I/O THREAD HANDOFF
+// ====================
+
+/*
+ * Triple buffer: the publisher task owns one slot, the I/O thread owns
+ * another, and the third is exchanged between them with one interlocked
+ * operation per side. The writer never waits for the reader and the reader
+ * always gets the newest complete snapshot.
+ */
+#define SNAPSHOT_FRESH 0x4             // Set in snapshot_middle when it holds an unread snapshot
+
+static PetriSnapshot snapshot_slots[3];
+static volatile LONG snapshot_middle = 1;
+static int snapshot_back = 0;          // Written only by the publisher
+static int snapshot_front = 2;         // Read only by the I/O thread
+
+/**
+ * @brief Copy the marking, summed over the lines, into the back slot and
+ * make it the newest snapshot.
+ * Runs on the RTOS side.
+ */
+static void publish_status_snapshot(void) {
+    PetriSnapshot* slot = &snapshot_slots[snapshot_back];
+
+    petri_snapshot_all(slot);
+    snapshot_back = (int)(InterlockedExchange(&snapshot_middle, snapshot_back | SNAPSHOT_FRESH) & 0x3);
+
+    // The status has been handed off
+    atomic_store(&status_dirty, false);
+}
+
+/**
+ * @brief Take the newest snapshot, if one arrived since the last call.
+ * Runs on the I/O thread.
+ * @return The snapshot, or NULL if nothing new was published.
+ */
+static const PetriSnapshot* take_status_snapshot(void) {
+    if ((snapshot_middle & SNAPSHOT_FRESH) == 0) {
+        return NULL;
+    }
+    snapshot_front = (int)(InterlockedExchange(&snapshot_middle, snapshot_front) & 0x3);
+    return &snapshot_slots[snapshot_front];
+}
+
+/**
+ * @brief FreeRTOS task: Hands the marking to the I/O thread after every change.
+ * Woken through NET_OBSERVER_NOTIFY_INDEX; a burst of firings between two
+ * wakeups costs a single copy. Every TASK_STATS_SAMPLE_MS it also samples
+ * the task list for /tasks, whether or not the marking moves.
+ * @param params Unused task parameter.
+ */
+static void task_status_publisher(void* params) {
+    (void)params;
+
+    const TickType_t sample_period = pdMS_TO_TICKS(TASK_STATS_SAMPLE_MS);
+    TickType_t last_sample = xTaskGetTickCount();
+
+    set_marking_observer(xTaskGetCurrentTaskHandle());
+    task_stats_sample();
+
+    while (1) {
+        publish_status_snapshot();
+
+        bool changed = false;
+        while (!changed) {
+            TickType_t elapsed = xTaskGetTickCount() - last_sample;
+            if (elapsed >= sample_period) {
+                task_stats_sample();
+                last_sample = xTaskGetTickCount();
+                elapsed = 0;
+            }
+            changed = ulTaskNotifyTakeIndexed(NET_OBSERVER_NOTIFY_INDEX, pdTRUE, sample_period - elapsed) != 0;
+        }
+    }
+}
+
+// ====================
+// I/O THREAD -> RTOS COMMANDS
+// ====================
+
+/*
+ * One command slot. The I/O thread fills it in while it is idle, marks it
+ * pending and raises STATUS_COMMAND_INTERRUPT; the handler applies the
+ * batch and marks it done; the I/O thread answers the client and frees
+ * the slot. Each side only writes the slot in its own state, so the state
+ * word is the only thing they exchange. POSTs arriving meanwhile queue on
+ * the I/O thread, never on the RTOS side.
+ */
+typedef enum {
+    COMMAND_IDLE,                  // Owned by the I/O thread
+    COMMAND_PENDING,               // Owned by the interrupt handler
+    COMMAND_DONE                   // Result ready for the I/O thread
+} StatusCommandState;
+
+typedef struct {
+    int line;                      // Index in petri_lines[]
+    int count;
+    PetriAdjustment adjustments[STATUS_MAX_ADJUSTMENTS];
+    bool applied;                  // Result: false if a place would have gone below zero
+    uint32_t version;              // Result: the line's marking version afterwards
+} StatusCommand;
+
+static StatusCommand status_command;
+static volatile LONG status_command_state = COMMAND_IDLE;
+static int status_command_client = -1; // Client waiting for the result; I/O thread only
+
+/**
+ * @brief Simulated interrupt handler: apply the pending command, if any.
+ * The port may run it more than once per command, so it only acts on a
+ * pending slot.
+ * @return pdFALSE: woken stations run on the next tick, as for the keyboard.
+ */
+static uint32_t status_command_interrupt(void) {
+    if (status_command_state == COMMAND_PENDING) {
+        PetriNet* net = &petri_lines[status_command.line];
+
+        status_command.applied = adjust_marking_from_isr(net, status_command.adjustments, status_command.count);
+        status_command.version = get_marking_version(net);
+        InterlockedExchange(&status_command_state, COMMAND_DONE);
+    }
+    return pdFALSE;
+}
+
+// ====================
+// JSON RENDERING (I/O THREAD)
+// ====================
+
+/**
+ * @brief Render a full snapshot: sequence number plus id, name and tokens of every place.
+ * Reads only the model's place names, so the benchmark may call it from any thread.
+ */
+int build_status_payload(char* buffer, size_t size, uint32_t seq, const int32_t* marking) {
+    if (size == 0) {
+        return 0;
+    }
+
+    JsonWriter out = { buffer, (int)size, 0 };
+    json_append(&out, "{\"seq\":%lu,\"places\":[", (unsigned long)seq);
+    for (int i = 0; i < manufacturing_model.num_places && json_complete(&out); i++) {
+        json_append(&out, "%s{\"id\":%d,\"name\":", i ? "," : "", i);
+        json_append_string(&out, manufacturing_model.places[i].name);
+        json_append(&out, ",\"tokens\":%d}", (int)marking[i]);
+    }
+    json_append(&out, "]}");
+
+    return json_complete(&out) ? out.len : (int)size - 1;
+}
+
+// Fingerprint of the place list, and the GET /schema document, set at startup
+static uint32_t status_schema;
+static char schema_json[STATUS_JSON_BUFFER];
+static int schema_json_len;
+
+static inline void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static inline void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief Render the packed marking: the little-endian header described in
+ * status_server.h, then one int32 per place.
+ * @return Length in bytes, or -1 if the buffer is too small.
+ */
+int build_status_packed(uint8_t* buffer, size_t size, uint32_t seq, const int32_t* marking) {
+    const int num_places = manufacturing_model.num_places;
+    const size_t len = STATUS_PACKED_HEADER + (size_t)num_places * 4;
+
+    if (len > size) {
+        return -1;
+    }
+    put_le16(buffer, STATUS_PACKED_FORMAT);
+    put_le16(buffer + 2, STATUS_PACKED_HEADER);
+    put_le32(buffer + 4, (uint32_t)num_places);
+    put_le32(buffer + 8, seq);
+    put_le32(buffer + 12, status_schema);
+    for (int i = 0; i < num_places; i++) {
+        put_le32(buffer + STATUS_PACKED_HEADER + 4 * i, (uint32_t)marking[i]);
+    }
+    return (int)len;
+}
+
+/**
+ * @brief Write the head of a CBOR item (RFC 8949) in its shortest form.
+ * @param major Major type: 0 unsigned, 1 negative, 3 text, 4 array, 5 map.
+ */
+static uint8_t* cbor_head(uint8_t* out, uint8_t major, uint32_t value) {
+    major = (uint8_t)(major << 5);
+    if (value < 24) {
+        *out++ = (uint8_t)(major | value);
+    } else if (value <= 0xff) {
+        *out++ = major | 24;
+        *out++ = (uint8_t)value;
+    } else if (value <= 0xffff) {
+        *out++ = major | 25;
+        *out++ = (uint8_t)(value >> 8);
+        *out++ = (uint8_t)value;
+    } else {
+        *out++ = major | 26;
+        *out++ = (uint8_t)(value >> 24);
+        *out++ = (uint8_t)(value >> 16);
+        *out++ = (uint8_t)(value >> 8);
+        *out++ = (uint8_t)value;
+    }
+    return out;
+}
+
+static uint8_t* cbor_text(uint8_t* out, const char* text) {
+    size_t len = strlen(text);
+
+    out = cbor_head(out, 3, (uint32_t)len);
+    memcpy(out, text, len);
+    return out + len;
+}
+
+/**
+ * @brief Render the marking as the CBOR map {"seq":N,"schema":N,"tokens":[...]}.
+ * Small counts take one byte each.
+ * @return Length in bytes, or -1 if the buffer may be too small.
+ */
+int build_status_cbor(uint8_t* buffer, size_t size, uint32_t seq, const int32_t* marking) {
+    const int num_places = manufacturing_model.num_places;
+    uint8_t* out = buffer;
+
+    if (size < 48 + (size_t)num_places * 5) {
+        return -1;
+    }
+    out = cbor_head(out, 5, 3);
+    out = cbor_text(out, "seq");
+    out = cbor_head(out, 0, seq);
+    out = cbor_text(out, "schema");
+    out = cbor_head(out, 0, status_schema);
+    out = cbor_text(out, "tokens");
+    out = cbor_head(out, 4, (uint32_t)num_places);
+    for (int i = 0; i < num_places; i++) {
+        int32_t tokens = marking[i];
+        out = tokens >= 0 ? cbor_head(out, 0, (uint32_t)tokens) : cbor_head(out, 1, (uint32_t)(-1 - tokens));
+    }
+    return (int)(out - buffer);
+}
+
+/**
+ * @brief Fingerprint the place list and render GET /schema from it.
+ * The model never changes once built, so this runs once at startup.
+ */
+static void render_status_schema(void) {
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < manufacturing_model.num_places; i++) {
+        // FNV-1a over the names, each with its terminator
+        for (const char* c = manufacturing_model.places[i].name; ; c++) {
+            hash = (hash ^ (uint8_t)*c) * 16777619u;
+            if (*c == '\0') {
+                break;
+            }
+        }
+    }
+    status_schema = hash;
+
+    JsonWriter out = { schema_json, (int)sizeof(schema_json), 0 };
+    json_append(&out, "{\"schema\":%lu,\"num_places\":%d,\"places\":[",
+        (unsigned long)status_schema, manufacturing_model.num_places);
+    for (int i = 0; i < manufacturing_model.num_places; i++) {
+        json_append(&out, "%s{\"id\":%d,\"name\":", i ? "," : "", i);
+        json_append_string(&out, manufacturing_model.places[i].name);
+        json_append(&out, "}");
+    }
+    json_append(&out, "]}");
+    if (!json_complete(&out)) {
+        printf("ERROR: GET /schema needs %d bytes, STATUS_JSON_BUFFER is %d\n", out.len + 1, (int)sizeof(schema_json));
+        out.len = (int)sizeof(schema_json) - 1;
+    }
+    schema_json_len = out.len;
+}
+
+/*
+ * Pre-rendered status payload. It is only rebuilt when the marking version
+ * has moved since the last render, so idle polls cost one version read.
+ * The ETag combines a per-boot epoch with the version, so a tag cached by a
+ * browser before a restart never matches a fresh run.
+ */
+typedef struct {
+    char payload[STATUS_JSON_BUFFER];
+    int payload_len;
+    uint32_t version;
+    bool valid;
+    char etag[STATUS_ETAG_LEN];
+} StatusCache;
+
+static StatusCache status_cache;
+static uint32_t status_epoch;
+
+/*
+ * Ring of the markings the server has rendered, newest last. A delta
+ * update diffs the current marking against the entry for the version the
+ * client last saw; a client whose version has aged out gets a snapshot.
+ */
+typedef struct {
+    uint32_t version;
+    int32_t marking[MAX_PLACES];
+} StatusHistoryEntry;
+
+static StatusHistoryEntry status_history[STATUS_HISTORY_DEPTH];
+static int status_history_count = 0;
+static int status_history_next = 0;
+
+static const StatusHistoryEntry* find_status_history(uint32_t version) {
+    for (int i = 0; i < status_history_count; i++) {
+        const StatusHistoryEntry* entry = &status_history[i];
+        if (entry->version == version) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Render the places whose token count differs between two markings.
+ * Format: {"seq":to,"base":from,"changes":[[place_id,tokens],...]}
+ */
+static int build_status_delta(char* buffer, size_t size, uint32_t base, const int32_t* from,
+                              uint32_t seq, const int32_t* to) {
+    JsonWriter out = { buffer, (int)size, 0 };
+    bool first = true;
+
+    json_append(&out, "{\"seq\":%lu,\"base\":%lu,\"changes\":[", (unsigned long)seq, (unsigned long)base);
+    for (int i = 0; i < manufacturing_model.num_places && json_complete(&out); i++) {
+        if (from[i] == to[i]) {
+            continue;
+        }
+        json_append(&out, "%s[%d,%d]", first ? "" : ",", i, (int)to[i]);
+        first = false;
+    }
+    json_append(&out, "]}");
+
+    return json_complete(&out) ? out.len : -1;
+}
+
+/**
+ * @brief Re-render the cached payload if the RTOS side has published a new marking.
+ */
+static void refresh_status_cache(void) {
+    const PetriSnapshot* snapshot = take_status_snapshot();
+    if (snapshot == NULL || (status_cache.valid && snapshot->version == status_cache.version)) {
+        return;
+    }
+
+    StatusHistoryEntry* entry = &status_history[status_history_next];
+    entry->version = snapshot->version;
+    memcpy(entry->marking, snapshot->marking, sizeof(entry->marking));
+    status_history_next = (status_history_next + 1) % STATUS_HISTORY_DEPTH;
+    if (status_history_count < STATUS_HISTORY_DEPTH) {
+        status_history_count++;
+    }
+
+    status_cache.version = entry->version;
+    status_cache.payload_len = build_status_payload(status_cache.payload,
+        sizeof(status_cache.payload), entry->version, entry->marking);
+    snprintf(status_cache.etag, sizeof(status_cache.etag), "\"%08lx-%lu\"",
+        (unsigned long)status_epoch, (unsigned long)status_cache.version);
+    status_cache.valid = true;
+}
+
+/**
+ * @brief Find a header in a request head.
+ * Only the head is searched: a POST body that happens to contain a line
+ * such as "Content-Length: ..." is never taken for a header.
+ * @param request NUL-terminated request, possibly followed by its body.
+ * @param name Lower-case header name including the colon, e.g. "if-none-match:".
+ * @param value_len Receives the length of the value, leading blanks skipped.
+ * @return Start of the value, or NULL if the header is absent.
+ */
+static const char* find_request_header(const char* request, const char* name, size_t* value_len) {
+    const size_t name_len = strlen(name);
+    const char* head_end = strstr(request, "\r\n\r\n");
+
+    for (const char* line = strstr(request, "\r\n"); line != NULL; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (head_end != NULL && line > head_end) {
+            break;                     // Reached the blank line; the body follows
+        }
+        if (_strnicmp(line, name, name_len) == 0) {
+            const char* value = line + name_len;
+            const char* value_end = strstr(value, "\r\n");
+            size_t len = value_end ? (size_t)(value_end - value) : strlen(value);
+
+            while (len > 0 && (*value == ' ' || *value == '\t')) {
+                value++;
+                len--;
+            }
+            *value_len = len;
+            return value;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Find a query parameter in the request line.
+ * @return Start of the value, or NULL if the parameter is absent.
+ */
+static const char* find_query_param(const char* request, const char* name) {
+    const char* line_end = strstr(request, "\r\n");
+    const char* query = strchr(request, '?');
+    const size_t name_len = strlen(name);
+
+    if (query == NULL || (line_end != NULL && query > line_end)) {
+        return NULL;
+    }
+    for (const char* p = query + 1; *p != '\0' && *p != ' ' && *p != '\r'; ) {
+        if (strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+            return p + name_len + 1;
+        }
+        p += strcspn(p, "& \r");
+        if (*p == '&') {
+            p++;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check whether the request's If-None-Match header names the current ETag.
+ * @param request NUL-terminated request head.
+ * @param etag Quoted ETag of the cached payload.
+ * @return true if the client already has this version.
+ */
+static bool request_matches_etag(const char* request, const char* etag) {
+    size_t value_len;
+    const char* value = find_request_header(request, "if-none-match:", &value_len);
+    size_t etag_len = strlen(etag);
+
+    if (value == NULL) {
+        return false;
+    }
+    if (value_len == 1 && *value == '*') {
+        return true;
+    }
+    // The value may be a list and may carry weak validators (W/"...")
+    for (const char* p = value; p + etag_len <= value + value_len; p++) {
+        if (memcmp(p, etag, etag_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Length of the request body announced by Content-Length; 0 if absent or invalid.
+ */
+static int request_content_length(const char* request) {
+    size_t value_len;
+    const char* value = find_request_header(request, "content-length:", &value_len);
+    long length = value != NULL ? strtol(value, NULL, 10) : 0;
+
+    return length > 0 && length < INT_MAX ? (int)length : 0;
+}
+
+/**
+ * @brief Start of the request body, right after the blank line ending the head.
+ */
+static const char* request_body(const char* request) {
+    const char* head_end = strstr(request, "\r\n\r\n");
+    return head_end != NULL ? head_end + 4 : request + strlen(request);
+}
+
+/*
+ * Connection table of the I/O thread. Sockets are non-blocking; the thread
+ * sleeps in select() until a socket is readable or STATUS_POLL_MS elapses,
+ * then picks up any marking the publisher task has handed over. Event
+ * streams (GET /events) get it as soon as the coalescing interval allows.
+ * Plain GET / keeps the one-shot JSON/304 reply.
+ */
+typedef enum {
+    CLIENT_FREE,
+    CLIENT_READING,                // Waiting for the end of the request head, or of a POST body
+    CLIENT_STREAMING,              // Open text/event-stream connection
+    CLIENT_QUEUED,                 // POST waiting for the command slot
+    CLIENT_APPLYING                // POST whose command is in the slot
+} StatusClientState;
+
+typedef struct {
+    SOCKET sock;
+    StatusClientState state;
+    ULONGLONG since;               // Accept time, or time of the last event sent (ms)
+    uint32_t sent_version;         // Marking version of the last event sent
+    bool delta;                    // Stream sends changed places only (?mode=delta)
+    bool synced;                   // The client holds the marking at sent_version
+    int request_len;
+    char request[STATUS_REQUEST_BUFFER];
+} StatusClient;
+
+static StatusClient status_clients[STATUS_MAX_CLIENTS];
+
+static void close_status_client(StatusClient* client) {
+    if (status_command_client == (int)(client - status_clients)) {
+        status_command_client = -1;
+    }
+    shutdown(client->sock, SD_BOTH);
+    closesocket(client->sock);
+    client->sock = INVALID_SOCKET;
+    client->state = CLIENT_FREE;
+}
+
+/**
+ * @brief Make room for a reply of len bytes in the socket's send buffer.
+ * A large net's reply must fit whole on the non-blocking socket; the buffer
+ * is only ever raised, never cut below the system's default.
+ */
+static void grow_send_buffer(SOCKET sock, int len) {
+    int send_buffer = 0;
+    int option_len = sizeof(send_buffer);
+
+    if (getsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char*)&send_buffer, &option_len) == 0 && len > send_buffer) {
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&len, sizeof(len));
+    }
+}
+
+/**
+ * @brief Send a whole buffer on a non-blocking socket.
+ * @return false if the peer is gone or its send buffer is full; a stream
+ *         that cannot keep up is dropped and EventSource reconnects it.
+ */
+static bool send_status_bytes(SOCKET sock, const char* data, int len) {
+    while (len > 0) {
+        int sent = send(sock, data, len, 0);
+        if (sent == SOCKET_ERROR || sent == 0) {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+/**
+ * @brief Send the current marking as one event.
+ * Full streams get a "status" event with the whole payload. Delta streams
+ * get a "delta" event against the version the client holds, or a
+ * "snapshot" event when that version is no longer in the history.
+ */
+static bool send_status_event(StatusClient* client) {
+    static char event[STATUS_EVENT_BUFFER];
+    static char delta[STATUS_JSON_BUFFER];
+    const StatusHistoryEntry* base = NULL;
+    int len;
+
+    if (client->delta && client->synced) {
+        base = find_status_history(client->sent_version);
+    }
+
+    if (base != NULL) {
+        const StatusHistoryEntry* current = find_status_history(status_cache.version);
+        if (current == NULL || build_status_delta(delta, sizeof(delta), base->version, base->marking,
+                current->version, current->marking) < 0) {
+            return false;
+        }
+        len = snprintf(event, sizeof(event), "id: %08lx-%lu\nevent: delta\ndata: %s\n\n",
+            (unsigned long)status_epoch, (unsigned long)status_cache.version, delta);
+    } else {
+        len = snprintf(event, sizeof(event), "id: %08lx-%lu\nevent: %s\ndata: %s\n\n",
+            (unsigned long)status_epoch, (unsigned long)status_cache.version,
+            client->delta ? "snapshot" : "status",
+            status_cache.payload);
+    }
+    if (len < 0 || len >= (int)sizeof(event)) {
+        return false;
+    }
+    client->synced = true;
+    client->since = GetTickCount64();
+    client->sent_version = status_cache.version;
+    return send_status_bytes(client->sock, event, len);
+}
+
+/**
+ * @brief Send a complete document and close the connection, or 503 if body is NULL.
+ * The socket's send buffer is grown to hold the whole reply first, so a
+ * large document does not run into a full buffer on the non-blocking socket.
+ */
+static void send_status_document(StatusClient* client, const char* content_type, const char* body, int body_len) {
+    static char headers[256];
+    int headers_len;
+
+    if (body == NULL) {
+        headers_len = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 503 Service Unavailable\r\n"
+            "Connection: close\r\n"
+            "Access-Control-Allow-Origin: *\r\n" // CORS header
+            "Content-Length: 0\r\n"
+            "\r\n");
+    } else {
+        headers_len = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: %s\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: close\r\n"
+            "Access-Control-Allow-Origin: *\r\n" // CORS header
+            "Content-Length: %d\r\n"
+            "\r\n",
+            content_type,
+            body_len);
+
+        grow_send_buffer(client->sock, headers_len + body_len);
+    }
+
+    if (send_status_bytes(client->sock, headers, headers_len) && body != NULL) {
+        send_status_bytes(client->sock, body, body_len);
+    }
+    close_status_client(client);
+}
+
+typedef enum {
+    STATUS_FORMAT_JSON,
+    STATUS_FORMAT_CBOR,
+    STATUS_FORMAT_PACKED
+} StatusFormat;
+
+/**
+ * @brief Offset of a media type in an Accept value, or len if it is not listed.
+ */
+static size_t find_media_type(const char* accept, size_t len, const char* type) {
+    const size_t type_len = strlen(type);
+
+    for (size_t i = 0; i + type_len <= len; i++) {
+        char after = i + type_len < len ? accept[i + type_len] : ',';
+        if (_strnicmp(accept + i, type, type_len) == 0 && (after == ',' || after == ';' || after == ' ')) {
+            return i;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Pick the representation of GET /: whichever of application/cbor
+ * and STATUS_PACKED_TYPE the Accept header lists first, otherwise JSON.
+ * Quality values are not weighed; a client asks for one binary form.
+ */
+static StatusFormat negotiate_status_format(const char* request) {
+    size_t len;
+    const char* accept = find_request_header(request, "accept:", &len);
+
+    if (accept == NULL) {
+        return STATUS_FORMAT_JSON;
+    }
+    size_t cbor = find_media_type(accept, len, "application/cbor");
+    size_t packed = find_media_type(accept, len, STATUS_PACKED_TYPE);
+    if (cbor == len && packed == len) {
+        return STATUS_FORMAT_JSON;
+    }
+    return cbor < packed ? STATUS_FORMAT_CBOR : STATUS_FORMAT_PACKED;
+}
+
+/**
+ * @brief Serve GET / as CBOR or packed int32s. Encoding is a few stores per
+ * place, so it is done per request from the newest stored marking rather
+ * than cached. Each representation has its own ETag.
+ */
+static void send_status_binary(StatusClient* client, StatusFormat format) {
+    static uint8_t body[STATUS_BINARY_BUFFER];
+    static char headers[512];
+    char etag[STATUS_ETAG_LEN];
+    const bool cbor = format == STATUS_FORMAT_CBOR;
+    const StatusHistoryEntry* current = find_status_history(status_cache.version);
+    int headers_len;
+
+    if (current == NULL) {
+        send_status_document(client, NULL, NULL, 0);
+        return;
+    }
+    snprintf(etag, sizeof(etag), "\"%08lx-%lu-%s\"",
+        (unsigned long)status_epoch, (unsigned long)current->version, cbor ? "cbor" : "packed");
+
+    if (request_matches_etag(client->request, etag)) {
+        headers_len = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 304 Not Modified\r\n"
+            "ETag: %s\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Vary: Accept\r\n"
+            "Connection: close\r\n"
+            "Access-Control-Allow-Origin: *\r\n" // CORS header
+            "Access-Control-Expose-Headers: ETag\r\n"
+            "\r\n",
+            etag);
+        send_status_bytes(client->sock, headers, headers_len);
+        close_status_client(client);
+        return;
+    }
+
+    int body_len = cbor ? build_status_cbor(body, sizeof(body), current->version, current->marking)
+                        : build_status_packed(body, sizeof(body), current->version, current->marking);
+    headers_len = snprintf(headers, sizeof(headers),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s\r\n"
+        "ETag: %s\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Vary: Accept\r\n"
+        "Connection: close\r\n"
+        "Access-Control-Allow-Origin: *\r\n" // CORS header
+        "Access-Control-Expose-Headers: ETag\r\n"
+        "Content-Length: %d\r\n"
+        "\r\n",
+        cbor ? "application/cbor" : STATUS_PACKED_TYPE,
+        etag,
+        body_len);
+
+    grow_send_buffer(client->sock, headers_len + body_len);
+    if (send_status_bytes(client->sock, headers, headers_len)) {
+        send_status_bytes(client->sock, (const char*)body, body_len);
+    }
+    close_status_client(client);
+}
+
+static void send_status_reply(StatusClient* client) {
+    static char response[STATUS_RESPONSE_BUFFER];
+    int response_len;
+
+    refresh_status_cache();
+
+    // Binary forms always carry the whole marking; ?since= is for JSON
+    StatusFormat format = negotiate_status_format(client->request);
+    if (format != STATUS_FORMAT_JSON) {
+        send_status_binary(client, format);
+        return;
+    }
+
+    // ?since=N asks for the places changed since sequence number N
+    const char* since = find_query_param(client->request, "since");
+    const StatusHistoryEntry* base = since ? find_status_history((uint32_t)strtoul(since, NULL, 10)) : NULL;
+    const StatusHistoryEntry* current = find_status_history(status_cache.version);
+    static char delta[STATUS_JSON_BUFFER];
+    int delta_len = -1;
+    if (base != NULL && current != NULL) {
+        delta_len = build_status_delta(delta, sizeof(delta), base->version, base->marking,
+            current->version, current->marking);
+    }
+
+    if (delta_len >= 0) {
+        response_len = snprintf(response, sizeof(response),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/json\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Vary: Accept\r\n"
+            "Connection: close\r\n"
+            "Access-Control-Allow-Origin: *\r\n" // CORS header
+            "Content-Length: %d\r\n"
+            "\r\n"
+            "%s",
+            delta_len,
+            delta);
+    } else if (request_matches_etag(client->request, status_cache.etag)) {
+        response_len = snprintf(response, sizeof(response),
+            "HTTP/1.1 304 Not Modified\r\n"
+            "ETag: %s\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Vary: Accept\r\n"
+            "Connection: close\r\n"
+            "Access-Control-Allow-Origin: *\r\n" // CORS header
+            "Access-Control-Expose-Headers: ETag\r\n"
+            "\r\n",
+            status_cache.etag);
+    } else {
+        response_len = snprintf(response, sizeof(response),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/json\r\n"
+            "ETag: %s\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Vary: Accept\r\n"
+            "Connection: close\r\n"
+            "Access-Control-Allow-Origin: *\r\n" // CORS header
+            "Access-Control-Expose-Headers: ETag\r\n"
+            "Content-Length: %d\r\n"
+            "\r\n"
+            "%s",
+            status_cache.etag,
+            status_cache.payload_len,
+            status_cache.payload);
+    }
+
+    grow_send_buffer(client->sock, response_len);
+    send_status_bytes(client->sock, response, response_len);
+    close_status_client(client);
+}
+
+/**
+ * @brief Serve GET /analysis: the JSON rendered by net_analysis_run() at startup.
+ * It never changes while the server runs, so the I/O thread reads it freely.
+ */
+static void send_analysis_reply(StatusClient* client) {
+    int body_len = 0;
+    const char* body = net_analysis_json(&body_len);
+
+    send_status_document(client, "application/json", body, body_len);
+}
+
+/**
+ * @brief Serve GET /metrics in the Prometheus text format.
+ * The shards are summed here on the I/O thread, so scraping costs the
+ * stations nothing.
+ */
+static void send_metrics_reply(StatusClient* client) {
+    static char body[METRICS_TEXT_BUFFER];
+    int body_len = metrics_render(body, sizeof(body));
+
+    send_status_document(client, "text/plain; version=0.0.4", body_len < 0 ? NULL : body, body_len);
+}
+
+/**
+ * @brief Serve GET /tasks: per-task CPU share since the previous scrape, state,
+ * priority and stack high-water mark, from the newest periodic sample.
+ */
+static void send_tasks_reply(StatusClient* client) {
+    static char body[TASK_STATS_JSON_BUFFER];
+    int body_len = task_stats_render(body, sizeof(body));
+
+    send_status_document(client, "application/json", body_len < 0 ? NULL : body, body_len);
+}
+
+/**
+ * @brief Serve GET /items: lead times and the newest finished items in
+ * colored-token builds (PETRI_COLORED_TOKENS); 503 otherwise.
+ */
+static void send_items_reply(StatusClient* client) {
+    static char body[ITEM_JSON_BUFFER];
+    int body_len = item_tokens_render(body, sizeof(body));
+
+    send_status_document(client, "application/json", body_len < 0 ? NULL : body, body_len);
+}
+
+/**
+ * @brief Serve GET /schema: the place names and ids the binary forms of GET /
+ * leave out. It is fixed for the life of the process, so clients may keep
+ * it for STATUS_SCHEMA_MAX_AGE_S and revalidate by ETag after that; a
+ * changed "schema" in a binary reply means it must be fetched again.
+ */
+static void send_schema_reply(StatusClient* client) {
+    static char headers[384];
+    char etag[STATUS_ETAG_LEN];
+    int headers_len;
+    bool fresh;
+
+    snprintf(etag, sizeof(etag), "\"schema-%08lx\"", (unsigned long)status_schema);
+    fresh = request_matches_etag(client->request, etag);
+    headers_len = snprintf(headers, sizeof(headers),
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: application/json\r\n"
+        "ETag: %s\r\n"
+        "Cache-Control: max-age=%d\r\n"
+        "Connection: close\r\n"
+        "Access-Control-Allow-Origin: *\r\n" // CORS header
+        "Access-Control-Expose-Headers: ETag\r\n"
+        "Content-Length: %d\r\n"
+        "\r\n",
+        fresh ? "304 Not Modified" : "200 OK",
+        etag,
+        STATUS_SCHEMA_MAX_AGE_S,
+        fresh ? 0 : schema_json_len);
+
+    if (send_status_bytes(client->sock, headers, headers_len) && !fresh) {
+        send_status_bytes(client->sock, schema_json, schema_json_len);
+    }
+    close_status_client(client);
+}
+
+static void start_status_stream(StatusClient* client) {
+    static const char headers[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n"
+        "Access-Control-Allow-Origin: *\r\n" // CORS header
+        "\r\n"
+        "retry: 1000\n\n";
+
+    refresh_status_cache();
+
+    // A reconnecting EventSource names the last event it applied as
+    // "<epoch>-<seq>"; if it is from this boot and still in the history the
+    // stream resumes with a delta
+    const char* mode = find_query_param(client->request, "mode");
+    client->delta = (mode != NULL && strncmp(mode, "delta", 5) == 0);
+    client->synced = false;
+    if (client->delta) {
+        size_t id_len;
+        const char* last_id = find_request_header(client->request, "last-event-id:", &id_len);
+        if (last_id != NULL && id_len > 0) {
+            char* seq = NULL;
+            unsigned long epoch = strtoul(last_id, &seq, 16);
+            if (epoch == status_epoch && *seq == '-') {
+                client->sent_version = (uint32_t)strtoul(seq + 1, NULL, 10);
+                client->synced = true;
+            }
+        }
+    }
+
+    // A client that resumes at the current version has nothing to catch up on
+    bool up_to_date = client->synced && client->sent_version == status_cache.version;
+
+    if (!send_status_bytes(client->sock, headers, (int)sizeof(headers) - 1) ||
+        (!up_to_date && !send_status_event(client))) {
+        close_status_client(client);
+        return;
+    }
+    client->state = CLIENT_STREAMING;
+}
+
+// ====================
+// CONTROL API (I/O THREAD)
+// ====================
+
+/*
+ * Just enough JSON for the POST bodies, read where recv() put them: strings
+ * and keys are pointers into the request buffer, never copied, and escapes
+ * are decoded only while comparing them (json_key_is). Names the loader
+ * decoded from &quot; or &#92;, or that /status sent back escaped, still match.
+ */
+typedef struct {
+    const char* at;
+    const char* end;
+    const char* error;             // First problem found, NULL while the body parses
+} JsonCursor;
+
+static void json_fail(JsonCursor* c, const char* error) {
+    if (c->error == NULL) {
+        c->error = error;
+    }
+}
+
+static void json_skip_space(JsonCursor* c) {
+    while (c->at < c->end && (*c->at == ' ' || *c->at == '\t' || *c->at == '\r' || *c->at == '\n')) {
+        c->at++;
+    }
+}
+
+/**
+ * @brief Consume ch if it is the next character after any blanks.
+ */
+static bool json_take(JsonCursor* c, char ch) {
+    json_skip_space(c);
+    if (c->error == NULL && c->at < c->end && *c->at == ch) {
+        c->at++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Decode the escape at the backslash at[0].
+ * @return Length of the escape, or 0 if it is not one a place name can hold
+ *         (\u beyond ASCII and \u0000 are refused).
+ */
+static int json_escape(const char* at, const char* end, char* ch) {
+    static const char plain[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+
+    if (end - at < 2) {
+        return 0;
+    }
+    for (int i = 0; plain[i] != '\0'; i += 2) {
+        if (at[1] == plain[i]) {
+            *ch = plain[i + 1];
+            return 2;
+        }
+    }
+    if (at[1] != 'u' || end - at < 6 || at[2] != '0' || at[3] != '0') {
+        return 0;
+    }
+    int code = 0;
+    for (int i = 4; i < 6; i++) {
+        char digit = at[i];
+        code *= 16;
+        if (digit >= '0' && digit <= '9') {
+            code += digit - '0';
+        } else if (digit >= 'a' && digit <= 'f') {
+            code += digit - 'a' + 10;
+        } else if (digit >= 'A' && digit <= 'F') {
+            code += digit - 'A' + 10;
+        } else {
+            return 0;
+        }
+    }
+    if (code == 0 || code > 0x7F) {
+        return 0;
+    }
+    *ch = (char)code;
+    return 6;
+}
+
+static bool json_string(JsonCursor* c, const char** start, size_t* len) {
+    if (!json_take(c, '"')) {
+        json_fail(c, "expected a string");
+        return false;
+    }
+    const char* first = c->at;
+    while (c->at < c->end && *c->at != '"') {
+        if (*c->at == '\\') {
+            char ch;
+            int escape_len = json_escape(c->at, c->end, &ch);
+            if (escape_len == 0) {
+                json_fail(c, "unsupported escape");
+                return false;
+            }
+            c->at += escape_len;
+        } else {
+            c->at++;
+        }
+    }
+    if (c->at == c->end) {
+        json_fail(c, "unterminated string");
+        return false;
+    }
+    *start = first;
+    *len = (size_t)(c->at - first);
+    c->at++;
+    return true;
+}
+
+/**
+ * @brief Read an integer that fits in 32 bits.
+ */
+static bool json_integer(JsonCursor* c, int32_t* value) {
+    json_skip_space(c);
+    bool negative = c->at < c->end && *c->at == '-';
+    if (negative) {
+        c->at++;
+    }
+
+    const char* digits = c->at;
+    int64_t magnitude = 0;
+    while (c->at < c->end && *c->at >= '0' && *c->at <= '9' && magnitude <= INT32_MAX) {
+        magnitude = magnitude * 10 + (*c->at - '0');
+        c->at++;
+    }
+    if (c->at == digits || magnitude > INT32_MAX || (c->at < c->end && *c->at >= '0' && *c->at <= '9')) {
+        json_fail(c, "expected a 32-bit integer");
+        return false;
+    }
+    *value = (int32_t)(negative ? -magnitude : magnitude);
+    return true;
+}
+
+/**
+ * @brief Read the token count of one change, at most STATUS_MAX_DELTA either way.
+ */
+static bool json_delta(JsonCursor* c, int32_t* value) {
+    if (!json_integer(c, value)) {
+        return false;
+    }
+    if (*value > STATUS_MAX_DELTA || *value < -STATUS_MAX_DELTA) {
+        json_fail(c, "tokens out of range");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Step to the next member of an object whose '{' has been consumed.
+ * @param first true before the first member; cleared on the way.
+ * @return true with the member's key, false at the closing brace or on error.
+ */
+static bool json_member(JsonCursor* c, bool* first, const char** key, size_t* key_len) {
+    if (json_take(c, '}')) {
+        return false;
+    }
+    if (!*first && !json_take(c, ',')) {
+        json_fail(c, "expected ',' or '}'");
+        return false;
+    }
+    *first = false;
+    if (!json_string(c, key, key_len) || !json_take(c, ':')) {
+        json_fail(c, "expected a member name and ':'");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Compare a string json_string() returned, escapes decoded, with name.
+ */
+static bool json_key_is(const char* key, size_t key_len, const char* name) {
+    const char* end = key + key_len;
+    while (key < end) {
+        char ch = *key;
+        if (ch == '\\') {
+            key += json_escape(key, end, &ch);
+        } else {
+            key++;
+        }
+        if (*name != ch) {
+            return false;
+        }
+        name++;
+    }
+    return *name == '\0';
+}
+
+/**
+ * @brief Read a place, given by name or by id.
+ * @return Index of the place, or -1 if the net has no such place.
+ */
+static int json_place(JsonCursor* c) {
+    json_skip_space(c);
+    if (c->at < c->end && *c->at == '"') {
+        const char* name;
+        size_t name_len;
+        if (json_string(c, &name, &name_len)) {
+            for (int p = 0; p < manufacturing_model.num_places; p++) {
+                if (json_key_is(name, name_len, manufacturing_model.places[p].name)) {
+                    return p;
+                }
+            }
+            json_fail(c, "unknown place");
+        }
+        return -1;
+    }
+
+    int32_t id;
+    if (json_integer(c, &id) && (id < 0 || id >= manufacturing_model.num_places)) {
+        json_fail(c, "unknown place");
+    }
+    return c->error != NULL ? -1 : (int)id;
+}
+
+/**
+ * @brief Read a 1-based line number into an index in petri_lines[].
+ */
+static int json_line(JsonCursor* c) {
+    int32_t line;
+    if (json_integer(c, &line) && (line < 1 || line > petri_num_lines)) {
+        json_fail(c, "no such line");
+    }
+    return c->error != NULL ? -1 : (int)line - 1;
+}
+
+/**
+ * @brief Parse a POST /inject body: {"place":"Raw Material","tokens":10,"line":1}.
+ * The place may also be given by id; the line defaults to 1.
+ */
+static void parse_inject_command(JsonCursor* c, StatusCommand* command) {
+    const char* key;
+    size_t key_len;
+    bool first = true;
+    int place = -1;
+    int32_t tokens = 0;
+
+    command->line = 0;
+    if (!json_take(c, '{')) {
+        json_fail(c, "expected an object");
+    }
+    while (json_member(c, &first, &key, &key_len)) {
+        if (json_key_is(key, key_len, "place")) {
+            place = json_place(c);
+        } else if (json_key_is(key, key_len, "tokens")) {
+            if (json_delta(c, &tokens) && tokens < 1) {
+                json_fail(c, "tokens must be positive");
+            }
+        } else if (json_key_is(key, key_len, "line")) {
+            command->line = json_line(c);
+        } else {
+            json_fail(c, "unknown member");
+        }
+    }
+    if (c->error == NULL && (place < 0 || tokens == 0)) {
+        json_fail(c, "place and tokens are required");
+    }
+    command->count = 1;
+    command->adjustments[0].place = place;
+    command->adjustments[0].delta = tokens;
+}
+
+// Parse error that is answered with 413 rather than 400
+static const char too_many_adjustments[] = "too many adjustments";
+
+/**
+ * @brief Parse a POST /marking body:
+ * {"line":1,"adjust":[{"place":"Raw Material","delta":5},{"place":3,"delta":-1}]}.
+ * The line defaults to 1.
+ */
+static void parse_marking_command(JsonCursor* c, StatusCommand* command) {
+    const char* key;
+    size_t key_len;
+    bool first = true;
+    bool seen_adjust = false;
+
+    command->line = 0;
+    command->count = 0;
+    if (!json_take(c, '{')) {
+        json_fail(c, "expected an object");
+    }
+    while (json_member(c, &first, &key, &key_len)) {
+        if (json_key_is(key, key_len, "line")) {
+            command->line = json_line(c);
+            continue;
+        }
+        if (!json_key_is(key, key_len, "adjust") || !json_take(c, '[')) {
+            json_fail(c, json_key_is(key, key_len, "adjust") ? "adjust must be an array" : "unknown member");
+            break;
+        }
+        seen_adjust = true;
+        for (bool first_entry = true; !json_take(c, ']') && c->error == NULL; first_entry = false) {
+            if (!first_entry && !json_take(c, ',')) {
+                json_fail(c, "expected ',' or ']'");
+                break;
+            }
+            if (command->count == STATUS_MAX_ADJUSTMENTS) {
+                json_fail(c, too_many_adjustments);
+                break;
+            }
+
+            PetriAdjustment* adjustment = &command->adjustments[command->count++];
+            bool first_field = true;
+            bool has_place = false;
+            bool has_delta = false;
+            if (!json_take(c, '{')) {
+                json_fail(c, "expected an object");
+                break;
+            }
+            while (json_member(c, &first_field, &key, &key_len)) {
+                if (json_key_is(key, key_len, "place")) {
+                    adjustment->place = json_place(c);
+                    has_place = true;
+                } else if (json_key_is(key, key_len, "delta")) {
+                    has_delta = json_delta(c, &adjustment->delta);
+                } else {
+                    json_fail(c, "unknown member");
+                }
+            }
+            if (!has_place || !has_delta) {
+                json_fail(c, "place and delta are required");
+            }
+        }
+    }
+    if (c->error == NULL && !seen_adjust) {
+        json_fail(c, "adjust is required");
+    }
+}
+
+/**
+ * @brief Answer a POST with a small JSON body and close the connection.
+ * @param status Status code and reason, e.g. "400 Bad Request".
+ */
+static void send_command_reply(StatusClient* client, const char* status, const char* body) {
+    static char response[512];
+    int response_len = snprintf(response, sizeof(response),
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Cache-Control: no-store\r\n"
+        "Connection: close\r\n"
+        "Access-Control-Allow-Origin: *\r\n" // CORS header
+        "Content-Length: %d\r\n"
+        "\r\n"
+        "%s",
+        status,
+        (int)strlen(body),
+        body);
+
+    send_status_bytes(client->sock, response, response_len);
+    close_status_client(client);
+}
+
+/**
+ * @brief Answer the OPTIONS preflight a browser sends before a JSON POST.
+ */
+static void send_preflight_reply(StatusClient* client) {
+    static const char response[] =
+        "HTTP/1.1 204 No Content\r\n"
+        "Connection: close\r\n"
+        "Access-Control-Allow-Origin: *\r\n" // CORS header
+        "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: Content-Type\r\n"
+        "Access-Control-Max-Age: 600\r\n"
+        "\r\n";
+
+    send_status_bytes(client->sock, response, (int)sizeof(response) - 1);
+    close_status_client(client);
+}
+
+/**
+ * @brief Parse a queued POST straight into the idle command slot.
+ * @return true if the command is ready to apply; false if the client has
+ *         been answered with 400, or 413 for a batch over STATUS_MAX_ADJUSTMENTS.
+ */
+static bool load_status_command(StatusClient* client) {
+    static char body[160];
+    const char* start = request_body(client->request);
+    JsonCursor c = { start, start + request_content_length(client->request), NULL };
+
+    if (strncmp(client->request, "POST /inject", 12) == 0) {
+        parse_inject_command(&c, &status_command);
+    } else {
+        parse_marking_command(&c, &status_command);
+    }
+    if (c.error == NULL) {
+        json_skip_space(&c);
+        if (c.at != c.end) {
+            json_fail(&c, "trailing characters");
+        }
+    }
+    if (c.error == too_many_adjustments) {
+        snprintf(body, sizeof(body), "{\"error\":\"more than %d adjustments in one batch\",\"at\":%d}",
+            STATUS_MAX_ADJUSTMENTS, (int)(c.at - start));
+        send_command_reply(client, "413 Payload Too Large", body);
+        return false;
+    }
+    if (c.error != NULL) {
+        snprintf(body, sizeof(body), "{\"error\":\"%s\",\"at\":%d}", c.error, (int)(c.at - start));
+        send_command_reply(client, "400 Bad Request", body);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Move POSTs through the command slot: answer the one whose result
+ * is ready, then hand the oldest queued one to the RTOS side.
+ * @return Milliseconds to sleep at most: short while a command is in flight.
+ */
+static DWORD service_status_commands(void) {
+    static char body[160];
+
+    if (status_command_state == COMMAND_DONE) {
+        if (status_command_client >= 0) {
+            StatusClient* client = &status_clients[status_command_client];
+            if (status_command.applied) {
+                snprintf(body, sizeof(body), "{\"applied\":%d,\"line\":%d,\"version\":%lu}",
+                    status_command.count, status_command.line + 1, (unsigned long)status_command.version);
+                send_command_reply(client, "200 OK", body);
+            } else {
+                send_command_reply(client, "409 Conflict",
+                    "{\"error\":\"a place would go below zero\",\"applied\":0}");
+            }
+        }
+        status_command_client = -1;
+        InterlockedExchange(&status_command_state, COMMAND_IDLE);
+    }
+
+    if (status_command_state == COMMAND_PENDING) {
+        // Raising it again is harmless; it only matters if the first one came
+        // before the scheduler started
+        vPortGenerateSimulatedInterrupt(STATUS_COMMAND_INTERRUPT);
+        return 1;
+    }
+
+    while (1) {
+        StatusClient* next = NULL;
+        for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+            StatusClient* client = &status_clients[i];
+            if (client->state == CLIENT_QUEUED && (next == NULL || client->since < next->since)) {
+                next = client;
+            }
+        }
+        if (next == NULL) {
+            return INFINITE;
+        }
+        if (load_status_command(next)) {
+            next->state = CLIENT_APPLYING;
+            status_command_client = (int)(next - status_clients);
+            InterlockedExchange(&status_command_state, COMMAND_PENDING);
+            vPortGenerateSimulatedInterrupt(STATUS_COMMAND_INTERRUPT);
+            return 1;
+        }
+    }
+}
+
+static void handle_status_request(StatusClient* client) {
+    if (strncmp(client->request, "GET /events", 11) == 0 &&
+        (client->request[11] == ' ' || client->request[11] == '?')) {
+        start_status_stream(client);
+    } else if (strncmp(client->request, "GET /analysis", 13) == 0 &&
+        (client->request[13] == ' ' || client->request[13] == '?')) {
+        send_analysis_reply(client);
+    } else if (strncmp(client->request, "GET /metrics", 12) == 0 &&
+        (client->request[12] == ' ' || client->request[12] == '?')) {
+        send_metrics_reply(client);
+    } else if (strncmp(client->request, "GET /tasks", 10) == 0 &&
+        (client->request[10] == ' ' || client->request[10] == '?')) {
+        send_tasks_reply(client);
+    } else if (strncmp(client->request, "GET /items", 10) == 0 &&
+        (client->request[10] == ' ' || client->request[10] == '?')) {
+        send_items_reply(client);
+    } else if (strncmp(client->request, "GET /schema", 11) == 0 &&
+        (client->request[11] == ' ' || client->request[11] == '?')) {
+        send_schema_reply(client);
+    } else if ((strncmp(client->request, "POST /inject", 12) == 0 &&
+        (client->request[12] == ' ' || client->request[12] == '?')) ||
+        (strncmp(client->request, "POST /marking", 13) == 0 &&
+        (client->request[13] == ' ' || client->request[13] == '?'))) {
+        // Parsed when the command slot is free, so the body stays where it is
+        client->state = CLIENT_QUEUED;
+    } else if (strncmp(client->request, "POST ", 5) == 0) {
+        send_command_reply(client, "404 Not Found", "{\"error\":\"no such endpoint\"}");
+    } else if (strncmp(client->request, "OPTIONS ", 8) == 0) {
+        send_preflight_reply(client);
+    } else {
+        send_status_reply(client);
+    }
+}
+
+static void accept_status_clients(SOCKET listen_socket) {
+    while (1) {
+        SOCKET sock = accept(listen_socket, NULL, NULL);
+        if (sock == INVALID_SOCKET) {
+            return;
+        }
+
+        StatusClient* client = NULL;
+        for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+            if (status_clients[i].state == CLIENT_FREE) {
+                client = &status_clients[i];
+                break;
+            }
+        }
+        if (client == NULL) {
+            closesocket(sock);
+            continue;
+        }
+
+        u_long non_blocking = 1;
+        ioctlsocket(sock, FIONBIO, &non_blocking);
+        client->sock = sock;
+        client->state = CLIENT_READING;
+        client->since = GetTickCount64();
+        client->request_len = 0;
+    }
+}
+
+static void read_status_client(StatusClient* client) {
+    if (client->state != CLIENT_READING) {
+        // Nothing more is expected after the request; readable means closed
+        char scratch[64];
+        int got = recv(client->sock, scratch, sizeof(scratch), 0);
+        if (got <= 0) {
+            close_status_client(client);
+        }
+        return;
+    }
+
+    int room = (int)sizeof(client->request) - 1 - client->request_len;
+    int got = recv(client->sock, client->request + client->request_len, room, 0);
+    if (got <= 0) {
+        close_status_client(client);
+        return;
+    }
+
+    client->request_len += got;
+    client->request[client->request_len] = '\0';
+
+    // A POST body follows the head and must fit in the buffer with it
+    const char* body = strstr(client->request, "\r\n\r\n");
+    if (body != NULL) {
+        int needed = (int)(body + 4 - client->request) + request_content_length(client->request);
+        if (needed > (int)sizeof(client->request) - 1) {
+            char reply[96];
+            snprintf(reply, sizeof(reply), "{\"error\":\"request head and body exceed %d bytes\"}",
+                (int)sizeof(client->request) - 1);
+            send_command_reply(client, "413 Payload Too Large", reply);
+        } else if (client->request_len >= needed) {
+            handle_status_request(client);
+        }
+    } else if (client->request_len == (int)sizeof(client->request) - 1) {
+        handle_status_request(client);
+    }
+}
+
+static void poll_status_sockets(SOCKET listen_socket, DWORD timeout_ms) {
+    fd_set readable;
+    struct timeval timeout = { 0, (long)timeout_ms * 1000 };
+
+    FD_ZERO(&readable);
+    FD_SET(listen_socket, &readable);
+    for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+        if (status_clients[i].state != CLIENT_FREE) {
+            FD_SET(status_clients[i].sock, &readable);
+        }
+    }
+
+    if (select(0, &readable, NULL, NULL, &timeout) <= 0) {
+        return;
+    }
+
+    if (FD_ISSET(listen_socket, &readable)) {
+        accept_status_clients(listen_socket);
+    }
+    for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+        StatusClient* client = &status_clients[i];
+        if (client->state != CLIENT_FREE && FD_ISSET(client->sock, &readable)) {
+            read_status_client(client);
+        }
+    }
+}
+
+/**
+ * @brief Push the current marking to every open stream, at most once per
+ * STATUS_SSE_MIN_INTERVAL_MS, and keep idle streams alive.
+ * @return Milliseconds until a pending update may be sent, or INFINITE if
+ *         nothing is pending.
+ */
+static DWORD service_status_streams(uint32_t* streamed_version, ULONGLONG* last_push) {
+    const ULONGLONG interval = STATUS_SSE_MIN_INTERVAL_MS;
+    ULONGLONG now = GetTickCount64();
+    bool any_streams = false;
+
+    for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+        StatusClient* client = &status_clients[i];
+        if (client->state == CLIENT_READING &&
+            now - client->since > STATUS_REQUEST_TIMEOUT_MS) {
+            close_status_client(client);
+        } else if (client->state == CLIENT_STREAMING) {
+            any_streams = true;
+        }
+    }
+
+    refresh_status_cache();
+    if (!any_streams || status_cache.version == *streamed_version) {
+        for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+            StatusClient* client = &status_clients[i];
+            if (client->state == CLIENT_STREAMING &&
+                now - client->since > STATUS_SSE_KEEPALIVE_MS) {
+                client->since = now;
+                if (!send_status_bytes(client->sock, ": keepalive\n\n", 13)) {
+                    close_status_client(client);
+                }
+            }
+        }
+        return INFINITE;
+    }
+
+    if (now - *last_push < interval) {
+        return (DWORD)(interval - (now - *last_push));
+    }
+
+    for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+        StatusClient* client = &status_clients[i];
+        if (client->state == CLIENT_STREAMING && client->sent_version != status_cache.version &&
+            !send_status_event(client)) {
+            close_status_client(client);
+        }
+    }
+    *streamed_version = status_cache.version;
+    *last_push = now;
+    return INFINITE;
+}
+
+// ====================
+// I/O THREAD
+// ====================
+
+static SOCKET open_listen_socket(void) {
+    SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket == INVALID_SOCKET) {
+        return INVALID_SOCKET;
+    }
+
+    int opt = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    struct sockaddr_in service;
+    ZeroMemory(&service, sizeof(service));
+    service.sin_family = AF_INET;
+    // Bind to all network interfaces for external access
+    service.sin_addr.s_addr = INADDR_ANY;
+    service.sin_port = htons(STATUS_SERVER_PORT);
+
+    if (bind(listen_socket, (struct sockaddr*)&service, sizeof(service)) == SOCKET_ERROR ||
+        listen(listen_socket, STATUS_SERVER_BACKLOG) == SOCKET_ERROR) {
+        closesocket(listen_socket);
+        return INVALID_SOCKET;
+    }
+
+    u_long non_blocking = 1;
+    ioctlsocket(listen_socket, FIONBIO, &non_blocking);
+    return listen_socket;
+}
+
+/*
+ * Windows thread running the whole network front end. It must not call any
+ * FreeRTOS API; everything it needs from the RTOS side arrives through the
+ * snapshot triple buffer, and place names are read-only once the net is built.
+ */
+static DWORD WINAPI status_io_thread(void* param) {
+    (void)param;
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        printf("ERROR: Status server could not initialize Winsock\n");
+        return 1;
+    }
+
+    SOCKET listen_socket = open_listen_socket();
+    if (listen_socket == INVALID_SOCKET) {
+        printf("ERROR: Status server could not listen on port %d\n", STATUS_SERVER_PORT);
+        WSACleanup();
+        return 1;
+    }
+
+    refresh_status_cache();
+    uint32_t streamed_version = status_cache.version;
+    ULONGLONG last_push = GetTickCount64();
+
+    while (1) {
+        DWORD wait = STATUS_POLL_MS;
+        DWORD pending = service_status_streams(&streamed_version, &last_push);
+        if (pending < wait) {
+            wait = pending;
+        }
+        pending = service_status_commands();
+        if (pending < wait) {
+            wait = pending;
+        }
+
+        poll_status_sockets(listen_socket, wait);
+    }
+}
+
+/**
+ * @brief Start the status server: the publisher task and the native I/O thread.
+ * Call after the net is built and before the scheduler starts.
+ * @return true on success.
+ */
+bool status_server_start(void) {
+    status_epoch = (uint32_t)time(NULL);
+    render_status_schema();
+    for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+        status_clients[i].sock = INVALID_SOCKET;
+        status_clients[i].state = CLIENT_FREE;
+    }
+
+    // Seed the handoff so the first request already has a payload
+    publish_status_snapshot();
+    vPortSetInterruptHandler(STATUS_COMMAND_INTERRUPT, status_command_interrupt);
+
+    if (arena_task_create(task_status_publisher, "StatusPublisher",
+        configMINIMAL_STACK_SIZE * 2, NULL, STATUS_PUBLISHER_PRIORITY, ARENA_ANY_CORE) == NULL) {
+        return false;
+    }
+
+    HANDLE thread = CreateThread(NULL, 0, status_io_thread, NULL, 0, NULL);
+    if (thread == NULL) {
+        return false;
+    }
+
+    // Use the cores that are not used by the FreeRTOS tasks for the Windows thread
+    SetThreadAffinityMask(thread, ~0x01u);
+    return true;
+}
@@ -0,0 +1,83 @@
+/*
+ * HTTP status server for the manufacturing process control demo.
+ *
+ * All socket I/O runs on a native Windows thread outside the FreeRTOS
+ * scheduler, in the same way main.c reads the keyboard. The RTOS side only
+ * runs a small publisher task that copies the marking whenever it changes
+ * and hands it to the I/O thread through a lock-free triple buffer, so no
+ * FreeRTOS task ever blocks inside Winsock and no Windows thread ever calls
+ * into the kernel.
+ *
+ * The control API goes the other way. POST /inject adds tokens to a place
+ * and POST /marking applies a batch of changes to a line's marking; the
+ * I/O thread parses the JSON body in place, checks it against the net and
+ * hands one command at a time to the RTOS side through a simulated
+ * interrupt, as the keyboard does. The interrupt handler applies it with
+ * adjust_marking_from_isr(), all or nothing, and the I/O thread answers
+ * the client once it sees the result.
+ *
+ * GET / serves the marking in the representation the Accept header asks
+ * for: JSON by default, CBOR for application/cbor, or a packed array of
+ * little-endian int32 token counts for STATUS_PACKED_TYPE. The binary
+ * forms carry no names; they come from GET /schema, which never changes
+ * while the server runs, and every binary reply names the schema it
+ * belongs to. Every buffer is sized for MAX_PLACES places (64 as shipped;
+ * add_place() refuses more), so a net of up to that size is always served
+ * whole. A larger net needs MAX_PLACES raised, which grows these buffers
+ * with it; the journal caps it at 256.
+ */
+
+#ifndef STATUS_SERVER_H
+#define STATUS_SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "petri_net.h"
+#include "json_writer.h"
+
+#define STATUS_SERVER_PORT 8080
+#define STATUS_PLACE_JSON_MAX (JSON_STRING_MAX(PETRI_NAME_LEN - 1) + 48)  // One place: {"id":N,"name":"...","tokens":N},
+#define STATUS_JSON_BUFFER (64 + MAX_PLACES * STATUS_PLACE_JSON_MAX)
+#define STATUS_RESPONSE_BUFFER (STATUS_JSON_BUFFER + 512)
+#define STATUS_SERVER_BACKLOG 16
+#define STATUS_REQUEST_BUFFER (1024 + STATUS_MAX_ADJUSTMENTS * STATUS_ADJUSTMENT_JSON)  // Request head plus any POST body
+#define STATUS_ETAG_LEN 32
+#define STATUS_MAX_CLIENTS 128           // Open connections, including event streams
+#define STATUS_SSE_MIN_INTERVAL_MS 100   // Event streams get at most one update per interval
+#define STATUS_SSE_KEEPALIVE_MS 15000    // Comment line sent to idle streams
+#define STATUS_POLL_MS 10                // Longest the I/O thread sleeps in select()
+#define STATUS_REQUEST_TIMEOUT_MS 2000   // Time allowed for a client to send its request head
+#define STATUS_EVENT_BUFFER (STATUS_JSON_BUFFER + 64)
+#define STATUS_HISTORY_DEPTH 16          // Past markings kept for delta updates
+#define STATUS_PUBLISHER_PRIORITY 2
+#define STATUS_SCHEMA_MAX_AGE_S 3600     // How long clients may reuse GET /schema without asking
+#define STATUS_MAX_ADJUSTMENTS (4 * MAX_PLACES)  // Changes one POST /marking may carry (256 as shipped)
+#define STATUS_ADJUSTMENT_JSON (PETRI_NAME_LEN + 32)  // One change: {"place":"...","delta":-N},
+#define STATUS_MAX_DELTA 1000000         // Largest |tokens| or |delta| one change may carry; more is a 400
+#define STATUS_COMMAND_INTERRUPT 4       // Simulated interrupt applying POSTs; main.c uses 3 for the keyboard
+
+/*
+ * Packed marking (Accept: application/vnd.petri.marking), all little-endian:
+ *   uint16 format          STATUS_PACKED_FORMAT
+ *   uint16 header_size     STATUS_PACKED_HEADER; the tokens start here
+ *   uint32 num_places
+ *   uint32 seq             Marking version, as "seq" in the JSON
+ *   uint32 schema          Fingerprint of the place list, as "schema" in GET /schema
+ *   int32  tokens[num_places], in place-id order
+ * CBOR (Accept: application/cbor) is the map {"seq":N,"schema":N,"tokens":[...]}.
+ */
+#define STATUS_PACKED_TYPE "application/vnd.petri.marking"
+#define STATUS_PACKED_FORMAT 1
+#define STATUS_PACKED_HEADER 16
+#define STATUS_BINARY_BUFFER (48 + MAX_PLACES * 5)   // CBOR needs up to 5 bytes a count
+
+bool status_server_start(void);
+
+/* The snapshot served at GET / in each representation; exposed for the benchmark. */
+int build_status_payload(char* buffer, size_t size, uint32_t seq, const int32_t* marking);
+int build_status_packed(uint8_t* buffer, size_t size, uint32_t seq, const int32_t* marking);
+int build_status_cbor(uint8_t* buffer, size_t size, uint32_t seq, const int32_t* marking);
+
+#endif /* STATUS_SERVER_H */
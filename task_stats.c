@@ -0,0 +1,158 @@
+/*
+ * Task statistics sampled on the RTOS side and rendered on the status
+ * server's I/O thread. See task_stats.h.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "task_stats.h"
+
+// Run-time-stats-utils.c counts in hundredths of a millisecond
+#define RUN_TIME_COUNTS_PER_MS 100
+
+typedef struct {
+    UBaseType_t number;                    // Unique per task, survives renames
+    char name[configMAX_TASK_NAME_LEN];
+    eTaskState state;
+    UBaseType_t priority;
+    UBaseType_t base_priority;
+    configRUN_TIME_COUNTER_TYPE run_time;
+    uint32_t stack_free;                   // Least free stack ever seen, in words
+} TaskStatsEntry;
+
+typedef struct {
+    int count;
+    configRUN_TIME_COUNTER_TYPE total_run_time;
+    TaskStatsEntry tasks[TASK_STATS_MAX_TASKS];
+} TaskStatsSample;
+
+// ====================
+// RTOS -> I/O THREAD HANDOFF
+// ====================
+
+/*
+ * Triple buffer with the same protocol as the marking snapshots in
+ * status_server.c: the sampler owns the back slot, the I/O thread the
+ * front slot, and the middle one is swapped with a single interlocked
+ * exchange.
+ */
+#define SAMPLE_FRESH 0x4
+
+static TaskStatsSample sample_slots[3];
+static volatile LONG sample_middle = 1;
+static int sample_back = 0;            // Written only by the sampler
+static int sample_front = 2;           // Read only by the I/O thread
+
+/**
+ * @brief Sample every task into the back slot and publish it.
+ * Runs on the RTOS side; the status publisher task calls it periodically.
+ */
+void task_stats_sample(void) {
+    static TaskStatus_t status[TASK_STATS_MAX_TASKS];
+    static bool warned = false;
+    TaskStatsSample* sample = &sample_slots[sample_back];
+    configRUN_TIME_COUNTER_TYPE total = 0;
+
+    // Returns 0 when the array is too small for every task
+    UBaseType_t count = uxTaskGetSystemState(status, TASK_STATS_MAX_TASKS, &total);
+    if (count == 0) {
+        if (!warned) {
+            printf("ERROR: More than %d tasks, /tasks is not updated\n", TASK_STATS_MAX_TASKS);
+            warned = true;
+        }
+        return;
+    }
+
+    sample->count = (int)count;
+    sample->total_run_time = total;
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskStatsEntry* entry = &sample->tasks[i];
+        entry->number = status[i].xTaskNumber;
+        // The name lives in the TCB, which may be freed before the I/O thread reads it
+        strncpy(entry->name, status[i].pcTaskName, sizeof(entry->name) - 1);
+        entry->name[sizeof(entry->name) - 1] = '\0';
+        entry->state = status[i].eCurrentState;
+        entry->priority = status[i].uxCurrentPriority;
+        entry->base_priority = status[i].uxBasePriority;
+        entry->run_time = status[i].ulRunTimeCounter;
+        entry->stack_free = (uint32_t)status[i].usStackHighWaterMark;
+    }
+
+    sample_back = (int)(InterlockedExchange(&sample_middle, sample_back | SAMPLE_FRESH) & 0x3);
+}
+
+// ====================
+// JSON RENDERING (I/O THREAD)
+// ====================
+
+// Sample served by the previous scrape, and the one before it
+static TaskStatsSample scraped;
+static TaskStatsSample baseline;
+
+static const char* task_state_name(eTaskState state) {
+    switch (state) {
+    case eRunning:   return "running";
+    case eReady:     return "ready";
+    case eBlocked:   return "blocked";
+    case eSuspended: return "suspended";
+    case eDeleted:   return "deleted";
+    default:         return "invalid";
+    }
+}
+
+static configRUN_TIME_COUNTER_TYPE baseline_run_time(UBaseType_t number) {
+    for (int i = 0; i < baseline.count; i++) {
+        if (baseline.tasks[i].number == number) {
+            return baseline.tasks[i].run_time;
+        }
+    }
+    return 0;                          // Task created since the previous scrape
+}
+
+/**
+ * @brief Render the run time each task used since the previous scrape as JSON.
+ * The first scrape covers the time since startup; scrapes that arrive before
+ * a new sample repeat the previous report.
+ * @return Length written, or -1 if the buffer is too small or nothing was sampled yet.
+ */
+int task_stats_render(char* buffer, size_t size) {
+    if ((sample_middle & SAMPLE_FRESH) != 0) {
+        sample_front = (int)(InterlockedExchange(&sample_middle, sample_front) & 0x3);
+        baseline = scraped;
+        scraped = sample_slots[sample_front];
+    }
+    if (scraped.count == 0) {
+        return -1;
+    }
+
+    configRUN_TIME_COUNTER_TYPE interval = scraped.total_run_time - baseline.total_run_time;
+    JsonWriter out = { buffer, (int)size, 0 };
+    json_append(&out, "{\"interval_ms\":%.2f,\"tasks\":[", (double)interval / RUN_TIME_COUNTS_PER_MS);
+
+    for (int i = 0; i < scraped.count && json_complete(&out); i++) {
+        const TaskStatsEntry* entry = &scraped.tasks[i];
+        configRUN_TIME_COUNTER_TYPE used = entry->run_time - baseline_run_time(entry->number);
+        double share = interval > 0 ? 100.0 * (double)used / (double)interval : 0.0;
+
+        json_append(&out, "%s{\"name\":", i ? "," : "");
+        json_append_string(&out, entry->name);
+        json_append(&out, ",\"number\":%lu,\"state\":\"%s\",\"priority\":%lu,\"base_priority\":%lu,"
+            "\"cpu_percent\":%.2f,\"run_time_ms\":%.2f,\"stack_high_water_words\":%lu}",
+            (unsigned long)entry->number,
+            task_state_name(entry->state),
+            (unsigned long)entry->priority,
+            (unsigned long)entry->base_priority,
+            share,
+            (double)used / RUN_TIME_COUNTS_PER_MS,
+            (unsigned long)entry->stack_free);
+    }
+    json_append(&out, "]}");
+
+    return json_complete(&out) ? out.len : -1;
+}
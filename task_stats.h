@@ -0,0 +1,35 @@
+/*
+ * Per-task CPU share, state, priority and stack high-water marks.
+ *
+ * The status publisher task samples the kernel's task list with
+ * uxTaskGetSystemState() into a preallocated array every
+ * TASK_STATS_SAMPLE_MS and hands the copy to the status server's I/O
+ * thread through a triple buffer, since the I/O thread may not call into
+ * the kernel. GET /tasks reports the run time each task used between the
+ * samples taken at the previous scrape and this one, so a scraper sees
+ * current load rather than totals since startup.
+ */
+
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "json_writer.h"
+
+#define TASK_STATS_MAX_TASKS 48
+#define TASK_STATS_SAMPLE_MS 1000
+
+/*
+ * One task is its escaped name, 116 bytes of keys and punctuation, the
+ * state and six numbers. 32 bytes covers any of the last seven (the widest
+ * is a %.2f of a 64-bit run time), so a full task list always fits.
+ */
+#define TASK_STATS_ENTRY_JSON_MAX (JSON_STRING_MAX(configMAX_TASK_NAME_LEN - 1) + 116 + 7 * 32)
+#define TASK_STATS_JSON_BUFFER (64 + TASK_STATS_MAX_TASKS * TASK_STATS_ENTRY_JSON_MAX)
+
+void task_stats_sample(void);
+int task_stats_render(char* buffer, size_t size);
+
+#endif /* TASK_STATS_H */
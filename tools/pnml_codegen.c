@@ -0,0 +1,414 @@
+/*
+ * Build-time net compiler for the manufacturing process control demo.
+ *
+ * Reads a PNML file with the same loader the demo uses at run time and
+ * writes petri_net_generated.h: const CSR arc tables, the consumer index,
+ * and for every transition an enable check and a fire function with the
+ * place indices and weights baked in. Building with PETRI_NET_GENERATED=1
+ * makes petri_net.c fire through that code instead of the RAM tables.
+ *
+ * Usage: pnml_codegen <net.pnml> <petri_net_generated.h>
+ *
+ * This program runs on the build machine, not under FreeRTOS. It supplies
+ * its own versions of the few net-building functions the loader calls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "petri_net.h"
+#include "pnml_loader.h"
+
+PetriModel manufacturing_model;
+
+typedef struct {
+    int trans;
+    int place;
+    int weight;
+} CodegenArc;
+
+static CodegenArc input_arcs[MAX_ARCS];
+static CodegenArc output_arcs[MAX_ARCS];
+
+// ====================
+// NET BUILDING (called by pnml_loader.c)
+// ====================
+
+int add_place(const char* name, int initial_tokens) {
+    if (manufacturing_model.num_places >= MAX_PLACES) {
+        printf("ERROR: Cannot add place '%s' - max places reached\n", name);
+        return -1;
+    }
+
+    int idx = manufacturing_model.num_places++;
+    snprintf(manufacturing_model.places[idx].name, PETRI_NAME_LEN, "%s", name);
+    manufacturing_model.initial_marking[idx] = initial_tokens;
+    return idx;
+}
+
+int add_transition(const char* name) {
+    if (manufacturing_model.num_transitions >= MAX_TRANSITIONS) {
+        printf("ERROR: Cannot add transition '%s' - max transitions reached\n", name);
+        return -1;
+    }
+
+    int idx = manufacturing_model.num_transitions++;
+    snprintf(manufacturing_model.transitions[idx].name, PETRI_NAME_LEN, "%s", name);
+    return idx;
+}
+
+static bool add_arc(CodegenArc* arcs, int* count, const char* kind,
+                    int trans_idx, int place_idx, int weight) {
+    if (weight <= 0 || weight > UINT16_MAX) {
+        printf("ERROR: Cannot add %s arc T%d/P%d - invalid weight %d\n",
+            kind, trans_idx, place_idx, weight);
+        return false;
+    }
+    if (*count >= MAX_ARCS) {
+        printf("ERROR: Cannot add %s arc T%d/P%d - max arcs reached\n",
+            kind, trans_idx, place_idx);
+        return false;
+    }
+
+    arcs[*count].trans = trans_idx;
+    arcs[*count].place = place_idx;
+    arcs[*count].weight = weight;
+    (*count)++;
+    return true;
+}
+
+bool add_arc_input(int trans_idx, int place_idx, int weight) {
+    return add_arc(input_arcs, &manufacturing_model.num_in_arcs, "input",
+        trans_idx, place_idx, weight);
+}
+
+bool add_arc_output(int trans_idx, int place_idx, int weight) {
+    return add_arc(output_arcs, &manufacturing_model.num_out_arcs, "output",
+        trans_idx, place_idx, weight);
+}
+
+int find_place(const char* name) {
+    for (int p = 0; p < manufacturing_model.num_places; p++) {
+        if (strcmp(manufacturing_model.places[p].name, name) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+int find_transition(const char* name) {
+    for (int t = 0; t < manufacturing_model.num_transitions; t++) {
+        if (strcmp(manufacturing_model.transitions[t].name, name) == 0) {
+            return t;
+        }
+    }
+    return -1;
+}
+
+// ====================
+// OUTPUT
+// ====================
+
+static void emit_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20 || (unsigned char)*c >= 0x7f) {
+            fprintf(out, "\\x%02x", (unsigned char)*c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Write a name inside a block comment, defusing anything that would end it.
+ */
+static void emit_comment_text(FILE* out, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '*' && c[1] == '/') {
+            fputs("* ", out);
+        } else if ((unsigned char)*c >= 0x20 && (unsigned char)*c < 0x7f) {
+            fputc(*c, out);
+        }
+    }
+}
+
+/**
+ * @brief Write the CSR table of one arc direction, grouped per transition in
+ * file order (the same layout build_net_index() produces).
+ */
+static void emit_arc_tables(FILE* out, const char* prefix, const CodegenArc* arcs, int count) {
+    int num_transitions = manufacturing_model.num_transitions;
+    int offset = 0;
+
+    fprintf(out, "static const PetriIndex petri_gen_%s_start[PETRI_GEN_NUM_TRANSITIONS + 1] = {", prefix);
+    for (int t = 0; t < num_transitions; t++) {
+        fprintf(out, "%s%d,", (t % 16 == 0) ? "\n    " : " ", offset);
+        for (int a = 0; a < count; a++) {
+            offset += (arcs[a].trans == t);
+        }
+    }
+    fprintf(out, "%s%d\n};\n\n", (num_transitions % 16 == 0) ? "\n    " : " ", offset);
+
+    fprintf(out, "static const Arc petri_gen_%s_arcs[] = {\n", prefix);
+    for (int t = 0; t < num_transitions; t++) {
+        for (int a = 0; a < count; a++) {
+            if (arcs[a].trans == t) {
+                char entry[32];
+                snprintf(entry, sizeof(entry), "{ %d, %d },", arcs[a].place, arcs[a].weight);
+                fprintf(out, "    %-14s/* T%d */\n", entry, t);
+            }
+        }
+    }
+    if (count == 0) {
+        fprintf(out, "    { 0, 0 }      /* unused */\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+static bool consumes_from(int trans, int place) {
+    for (int a = 0; a < manufacturing_model.num_in_arcs; a++) {
+        if (input_arcs[a].trans == trans && input_arcs[a].place == place) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Net token change of each place when a transition fires once.
+ */
+static void transition_delta(int trans, int32_t delta[MAX_PLACES]) {
+    memset(delta, 0, sizeof(int32_t) * MAX_PLACES);
+    for (int a = 0; a < manufacturing_model.num_in_arcs; a++) {
+        if (input_arcs[a].trans == trans) {
+            delta[input_arcs[a].place] -= input_arcs[a].weight;
+        }
+    }
+    for (int a = 0; a < manufacturing_model.num_out_arcs; a++) {
+        if (output_arcs[a].trans == trans) {
+            delta[output_arcs[a].place] += output_arcs[a].weight;
+        }
+    }
+}
+
+/**
+ * @brief Transitions to re-evaluate after trans fires: every consumer of a
+ * place whose count actually changes. Self-loops such as the returned worker
+ * token change nothing and are left out.
+ */
+static int affected_transitions(int trans, int out[MAX_TRANSITIONS]) {
+    int32_t delta[MAX_PLACES];
+    int count = 0;
+
+    transition_delta(trans, delta);
+    for (int u = 0; u < manufacturing_model.num_transitions; u++) {
+        for (int p = 0; p < manufacturing_model.num_places; p++) {
+            if (delta[p] != 0 && consumes_from(u, p)) {
+                out[count++] = u;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+static void emit_consumer_index(FILE* out) {
+    PetriModel* net = &manufacturing_model;
+    int offset = 0;
+
+    fprintf(out, "static const PetriIndex petri_gen_consumer_start[PETRI_GEN_NUM_PLACES + 1] = {");
+    for (int p = 0; p < net->num_places; p++) {
+        fprintf(out, "%s%d,", (p % 16 == 0) ? "\n    " : " ", offset);
+        for (int a = 0; a < net->num_in_arcs; a++) {
+            offset += (input_arcs[a].place == p);
+        }
+    }
+    fprintf(out, "%s%d\n};\n\n", (net->num_places % 16 == 0) ? "\n    " : " ", offset);
+
+    fprintf(out, "static const PetriIndex petri_gen_consumers[] = {");
+    int written = 0;
+    for (int p = 0; p < net->num_places; p++) {
+        for (int t = 0; t < net->num_transitions; t++) {
+            for (int a = 0; a < net->num_in_arcs; a++) {
+                if (input_arcs[a].place == p && input_arcs[a].trans == t) {
+                    fprintf(out, "%s%d,", (written++ % 16 == 0) ? "\n    " : " ", t);
+                }
+            }
+        }
+    }
+    fprintf(out, "%s\n};\n\n", (written == 0) ? "\n    0" : "");
+
+    fprintf(out, "/* Transitions re-evaluated after each transition fires */\n");
+    fprintf(out, "static const PetriIndex petri_gen_affected_start[PETRI_GEN_NUM_TRANSITIONS + 1] = {");
+    int affected[MAX_TRANSITIONS];
+    offset = 0;
+    for (int t = 0; t < net->num_transitions; t++) {
+        fprintf(out, "%s%d,", (t % 16 == 0) ? "\n    " : " ", offset);
+        offset += affected_transitions(t, affected);
+    }
+    fprintf(out, "%s%d\n};\n\n", (net->num_transitions % 16 == 0) ? "\n    " : " ", offset);
+
+    fprintf(out, "static const PetriIndex petri_gen_affected[] = {\n");
+    for (int t = 0; t < net->num_transitions; t++) {
+        int count = affected_transitions(t, affected);
+        if (count == 0) {
+            continue;
+        }
+        fprintf(out, "    ");
+        for (int i = 0; i < count; i++) {
+            fprintf(out, "%d, ", affected[i]);
+        }
+        fprintf(out, "  /* T%d */\n", t);
+    }
+    if (offset == 0) {
+        fprintf(out, "    0\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+static void emit_transition_code(FILE* out, int t) {
+    PetriModel* net = &manufacturing_model;
+    int32_t delta[MAX_PLACES];
+
+    fprintf(out, "/* T%d: ", t);
+    emit_comment_text(out, net->transitions[t].name);
+    fprintf(out, " */\n");
+
+    fprintf(out, "static inline bool petri_gen_enabled_t%d(const int32_t* m) {\n    return ", t);
+    bool first = true;
+    for (int a = 0; a < net->num_in_arcs; a++) {
+        if (input_arcs[a].trans == t) {
+            fprintf(out, "%sm[%d] >= %d", first ? "" : " && ", input_arcs[a].place, input_arcs[a].weight);
+            first = false;
+        }
+    }
+    fprintf(out, "%s;\n}\n\n", first ? "true" : "");
+
+    fprintf(out, "static inline void petri_gen_fire_t%d(int32_t* m) {\n", t);
+    transition_delta(t, delta);
+    bool any = false;
+    for (int p = 0; p < net->num_places; p++) {
+        if (delta[p] < 0) {
+            fprintf(out, "    m[%d] -= %ld;\n", p, (long)-delta[p]);
+            any = true;
+        }
+    }
+    for (int p = 0; p < net->num_places; p++) {
+        if (delta[p] > 0) {
+            fprintf(out, "    m[%d] += %ld;\n", p, (long)delta[p]);
+            any = true;
+        }
+    }
+    if (!any) {
+        fprintf(out, "    (void)m;\n");
+    }
+    fprintf(out, "}\n\n");
+}
+
+static void emit_dispatch(FILE* out) {
+    int num_transitions = manufacturing_model.num_transitions;
+
+    fprintf(out, "static inline bool petri_gen_enabled(int t, const int32_t* m) {\n    switch (t) {\n");
+    for (int t = 0; t < num_transitions; t++) {
+        fprintf(out, "    case %d: return petri_gen_enabled_t%d(m);\n", t, t);
+    }
+    fprintf(out, "    default: return false;\n    }\n}\n\n");
+
+    fprintf(out, "static inline void petri_gen_fire(int t, int32_t* m) {\n    switch (t) {\n");
+    for (int t = 0; t < num_transitions; t++) {
+        fprintf(out, "    case %d: petri_gen_fire_t%d(m); break;\n", t, t);
+    }
+    fprintf(out, "    default: break;\n    }\n}\n\n");
+}
+
+static void emit_header(FILE* out, const char* source) {
+    PetriModel* net = &manufacturing_model;
+    const char* base = source;
+
+    for (const char* c = source; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') {
+            base = c + 1;
+        }
+    }
+
+    fprintf(out, "/*\n * Generated by tools/pnml_codegen from ");
+    emit_comment_text(out, base);
+    fprintf(out, ". Do not edit: change the PNML\n * file and rebuild instead.\n */\n\n");
+    fprintf(out, "#ifndef PETRI_NET_GENERATED_H\n#define PETRI_NET_GENERATED_H\n\n");
+
+    fprintf(out, "#define PETRI_GEN_SOURCE ");
+    emit_string(out, base);
+    fprintf(out, "\n#define PETRI_GEN_NUM_PLACES %d\n", net->num_places);
+    fprintf(out, "#define PETRI_GEN_NUM_TRANSITIONS %d\n", net->num_transitions);
+    fprintf(out, "#define PETRI_GEN_NUM_IN_ARCS %d\n", net->num_in_arcs);
+    fprintf(out, "#define PETRI_GEN_NUM_OUT_ARCS %d\n\n", net->num_out_arcs);
+
+    fprintf(out, "static const char* const petri_gen_place_names[PETRI_GEN_NUM_PLACES] = {\n");
+    for (int p = 0; p < net->num_places; p++) {
+        fprintf(out, "    ");
+        emit_string(out, net->places[p].name);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const int32_t petri_gen_initial_marking[PETRI_GEN_NUM_PLACES] = {");
+    for (int p = 0; p < net->num_places; p++) {
+        fprintf(out, "%s%ld,", (p % 16 == 0) ? "\n    " : " ", (long)net->initial_marking[p]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const char* const petri_gen_transition_names[PETRI_GEN_NUM_TRANSITIONS] = {\n");
+    for (int t = 0; t < net->num_transitions; t++) {
+        fprintf(out, "    ");
+        emit_string(out, net->transitions[t].name);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\n");
+
+    emit_arc_tables(out, "in", input_arcs, net->num_in_arcs);
+    emit_arc_tables(out, "out", output_arcs, net->num_out_arcs);
+    emit_consumer_index(out);
+
+    for (int t = 0; t < net->num_transitions; t++) {
+        emit_transition_code(out, t);
+    }
+    emit_dispatch(out);
+
+    fprintf(out, "#endif /* PETRI_NET_GENERATED_H */\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        printf("Usage: %s <net.pnml> <petri_net_generated.h>\n", argv[0]);
+        return 2;
+    }
+
+    if (!pnml_load_file(argv[1])) {
+        return 1;
+    }
+    if (manufacturing_model.num_transitions == 0) {
+        printf("ERROR: %s: the net has no transitions\n", argv[1]);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        printf("ERROR: Cannot write '%s'\n", argv[2]);
+        return 1;
+    }
+    emit_header(out, argv[1]);
+    if (fclose(out) != 0) {
+        printf("ERROR: Failed to write '%s'\n", argv[2]);
+        return 1;
+    }
+
+    printf("%s: %d places, %d transitions, %d arcs -> %s\n", argv[1],
+        manufacturing_model.num_places, manufacturing_model.num_transitions,
+        manufacturing_model.num_in_arcs + manufacturing_model.num_out_arcs, argv[2]);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Worker pools sized by a resource place. See worker_pool.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "metrics.h"
+#include "petri_net.h"
+#include "station_clock.h"
+#include "worker_pool.h"
+
+#if WORKER_POOL_MAX_WORKERS > MAX_TRANSITION_SUBSCRIBERS
+#error "Every worker subscribes to each stage; raise MAX_TRANSITION_SUBSCRIBERS"
+#endif
+
+#if WORKER_POOL_MAX_STAGES > CONFLICT_MAX_MEMBERS
+#error "A pool's stages form one conflict set; raise CONFLICT_MAX_MEMBERS"
+#endif
+
+typedef struct WorkerPool WorkerPool;
+
+typedef struct {
+    WorkerPool* pool;
+    WorkerContext context;
+    char name[WORKER_POOL_NAME_LEN];       // Task name and metrics label
+} PoolWorker;
+
+struct WorkerPool {
+    WorkerStage stages[WORKER_POOL_MAX_STAGES];
+    int num_stages;
+    ConflictSet* jobs;             // The stages' start transitions
+    int num_workers;
+    PoolWorker workers[WORKER_POOL_MAX_WORKERS];
+};
+
+static WorkerPool pools[WORKER_POOL_MAX_POOLS];
+static int num_pools = 0;
+
+/**
+ * @brief Number of workers a pool on this resource place would start.
+ * @param net Line holding the place.
+ * @param resource_place Net index of the place.
+ * @return One per token, capped at WORKER_POOL_MAX_WORKERS.
+ */
+int worker_pool_size(const PetriNet* net, int resource_place) {
+    int tokens = get_place_tokens(net, resource_place);
+
+    if (tokens < 0) {
+        return 0;
+    }
+    return tokens < WORKER_POOL_MAX_WORKERS ? tokens : WORKER_POOL_MAX_WORKERS;
+}
+
+/*
+ * Take the job the pool's policy picks among the waiting stages and run
+ * it; conflict_fire() moves on to another stage if a different worker
+ * takes the job first.
+ */
+static void worker_task(void* params) {
+    PoolWorker* worker = (PoolWorker*)params;
+    const WorkerPool* pool = worker->pool;
+
+    metrics_register_task(worker->name);
+    bool subscribed = conflict_subscribe(pool->jobs);
+    configASSERT(subscribed);
+
+    while (1) {
+        int s = conflict_fire(pool->jobs, &worker->context.rng);
+        if (s >= 0) {
+            pool->stages[s].run(&pool->stages[s], &worker->context);
+        } else {
+            wait_for_transition_event(portMAX_DELAY);
+        }
+    }
+}
+
+/**
+ * @brief Create one worker task per token in the config's resource place.
+ * @param config Pool description; copied, so it need not outlive the call.
+ * @return Number of workers started, or -1 on error.
+ */
+int worker_pool_start(const WorkerPoolConfig* config) {
+    if (num_pools >= WORKER_POOL_MAX_POOLS) {
+        printf("ERROR: More than %d worker pools\n", WORKER_POOL_MAX_POOLS);
+        return -1;
+    }
+    if (config->num_stages <= 0 || config->num_stages > WORKER_POOL_MAX_STAGES) {
+        printf("ERROR: Worker pool '%s' needs 1 to %d stages\n", config->name, WORKER_POOL_MAX_STAGES);
+        return -1;
+    }
+
+    int tokens = get_place_tokens(config->net, config->resource_place);
+    int size = worker_pool_size(config->net, config->resource_place);
+    if (size == 0) {
+        printf("ERROR: Worker pool '%s' has no tokens to size it\n", config->name);
+        return -1;
+    }
+    if (tokens > size) {
+        printf("WARNING: Worker pool '%s' starts %d workers for %d tokens\n", config->name, size, tokens);
+    }
+
+    // Every stage competes for the resource place
+    ConflictMember members[WORKER_POOL_MAX_STAGES];
+    for (int s = 0; s < config->num_stages; s++) {
+        const WorkerStage* stage = &config->stages[s];
+        members[s] = (ConflictMember){ stage->net, stage->start_transition, stage->priority, stage->weight };
+    }
+    ConflictSet* jobs = conflict_set_create(config->policy_name, members, config->num_stages, config->policy);
+    if (jobs == NULL) {
+        return -1;
+    }
+
+    WorkerPool* pool = &pools[num_pools++];
+    memcpy(pool->stages, config->stages, sizeof(WorkerStage) * config->num_stages);
+    pool->num_stages = config->num_stages;
+    pool->jobs = jobs;
+
+    for (int w = 0; w < size; w++) {
+        PoolWorker* worker = &pool->workers[w];
+
+        worker->pool = pool;
+        worker->context.index = w;
+        rng_init_stream(&worker->context.rng, config->rng_stream_base + (uint32_t)w);
+        snprintf(worker->name, sizeof(worker->name), "%s %d", config->name, w + 1);
+
+        if (!station_task_create(worker_task, worker->name, config->stack_words, worker,
+                config->task_priority, config->cores)) {
+            printf("ERROR: Failed to create %s task\n", worker->name);
+            return -1;
+        }
+        pool->num_workers++;
+    }
+    return pool->num_workers;
+}
@@ -0,0 +1,74 @@
+/*
+ * Pool of identical worker tasks serving several stages of the line.
+ *
+ * A pool is sized by a resource place: one task per token it holds at
+ * startup, so the tasks never outnumber the tokens the stages need. Each
+ * stage is a start transition whose input places are the stage's ready
+ * queue and the resource place, plus a job that does the work and fires
+ * the finish. The start transitions form one conflict set (see
+ * conflict_scheduler.h): a free worker fires whichever enabled stage the
+ * pool's policy picks, and sleeps only when every queue is empty.
+ *
+ * Each stage names the line it fires on, so a pool on a place shared by
+ * several lines (see share_place()) serves the stages of all of them.
+ *
+ * worker_pool_start() copies the configuration, so the caller may build
+ * it on the stack. Call it before the scheduler starts.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "conflict_scheduler.h"
+#include "petri_net.h"
+#include "rng.h"
+
+#define WORKER_POOL_MAX_POOLS PETRI_MAX_LINES  // One per line unless the resource place is shared
+#define WORKER_POOL_MAX_WORKERS 4      // Each worker subscribes to every stage's start transition
+#define WORKER_POOL_MAX_STAGES 16
+#define WORKER_POOL_NAME_LEN 24
+
+/* Worker state handed to each job. */
+typedef struct {
+    int index;                     // 0-based within the pool
+    RngState rng;                  // Stream rng_stream_base + index, so a seed replays per worker
+} WorkerContext;
+
+typedef struct WorkerStage WorkerStage;
+
+/* Does one job after the stage's start transition has fired. */
+typedef void (*WorkerJobFn)(const WorkerStage* stage, WorkerContext* worker);
+
+struct WorkerStage {
+    PetriNet* net;                 // Line the stage belongs to
+    int start_transition;          // Net index; firing it takes a job off the ready queue
+    int priority;                  // Higher is served first under the priority policy
+    uint32_t weight;               // Share of the jobs under the weighted policy
+    WorkerJobFn run;
+    const void* context;           // Passed through to run() in the stage
+};
+
+typedef struct {
+    const char* name;              // Prefix of the task and metrics names, e.g. "QC Worker"
+    const PetriNet* net;           // Line whose resource_place tokens size the pool
+    int resource_place;            // Net index of the place whose tokens size the pool
+    const WorkerStage* stages;
+    int num_stages;
+    UBaseType_t task_priority;
+    uint32_t stack_words;
+    uint32_t rng_stream_base;
+    UBaseType_t cores;             // Cores the workers may run on, see station_task_create()
+    const char* policy_name;       // Conflict set name for PETRI_CONFLICT_POLICY, e.g. "qc"
+    ConflictPolicy policy;         // How a free worker picks among the waiting stages
+} WorkerPoolConfig;
+
+int worker_pool_size(const PetriNet* net, int resource_place);
+int worker_pool_start(const WorkerPoolConfig* config);
+
+#endif /* WORKER_POOL_H */